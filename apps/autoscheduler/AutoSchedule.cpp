@@ -20,9 +20,15 @@
 
   Environment variables used (directly or indirectly):
 
+  HL_AUTOSCHEDULE_NUM_THREADS
+  Number of threads to use to analyze the pipeline and to expand states in the beam search. Defaults to the number of cores. The search is deterministic for a given HL_SEED regardless of this setting.
+
   HL_BEAM_SIZE
   Beam size to use in the beam search. Defaults to 32. Use 1 to get a greedy search instead.
 
+  HL_COST_CACHE_DIR
+  If set, costs assigned to states by the cost model are cached in this (existing) directory, and reused by later runs on the same pipeline with the same weights.
+
   HL_CYOS
   "Choose-your-own-schedule". If set to 1, lets you navigate the search tree by hand in the terminal. Whee! This is for debugging the autoscheduler.
 
@@ -32,11 +38,14 @@
   Needs to be converted to a sample file with the runtime using featurization_to_sample before it can be used to train.
 
   HL_MACHINE_PARAMS
-  An architecture description string. Used by Halide master to configure the cost model. We only use the first term. Set it to the number of cores to target.
+  An architecture description string. Used by Halide master to configure the cost model. We only use the first term. Set it to the number of cores to target, or to "host" to detect it from the machine running the generator.
 
   HL_PERMIT_FAILED_UNROLL
   Set to 1 to tell Halide not to freak out if we try to unroll a loop that doesn't have a constant extent. Should generally not be necessary, but sometimes the autoscheduler's model for what will and will not turn into a constant during lowering is inaccurate, because Halide isn't perfect at constant-folding.
 
+  HL_PREVIOUS_SCHEDULE
+  The schedule output from a previous run on an earlier version of this pipeline. For each Func that hasn't changed since, the search only considers the decisions made for it last time, unless they no longer fit around the Funcs that did change. Funcs are matched by name, so Funcs without a unique explicit name (which get names like f3 or blur$2 that depend on how many Funcs were made before them) are never reused.
+
   HL_SCHEDULE_FILE
     *** DEPRECATED *** use the 'schedule' output from Generator instead
     Write out a human-and-machine readable block of scheduling source code for the selected schedule into this file.
@@ -64,16 +73,21 @@
 #include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
 #include <set>
 #include <sstream>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "ASLog.h"
 #include "AutoSchedule.h"
+#include "CostCache.h"
 #include "CostModel.h"
 #include "DefaultCostModel.h"
 #include "Errors.h"
@@ -167,6 +181,136 @@ bool random_dropout(std::mt19937 &rng, size_t num_decisions) {
     return drop_it;
 }
 
+// Which Func, and which phase of scheduling it, the given decision
+// in the search is about.
+pair<int, int> node_and_phase(const FunctionDAG &dag, int decision) {
+    if (!may_subtile()) {
+        // When emulating the older search space, we do all
+        // parallelizing last, so that it is independent of the
+        // tiling decisions.
+        return {decision % (int)dag.nodes.size(), decision / (int)dag.nodes.size()};
+    }
+    return {decision / 2, decision % 2};
+}
+
+// Hash everything about a single Func that the decisions made for it
+// depend on directly: its definition, its bounds, and its footprint
+// on its producers. Changes to its consumers show up instead as
+// changes to the placement hashes of its decisions.
+uint64_t node_hash(const FunctionDAG::Node &n) {
+    std::ostringstream s;
+    s << n.func.name() << "\n";
+    if (n.func.has_pure_definition()) {
+        vector<Definition> defs = {n.func.definition()};
+        for (const auto &u : n.func.updates()) {
+            defs.push_back(u);
+        }
+        for (const auto &d : defs) {
+            for (const auto &a : d.args()) {
+                s << a << " ";
+            }
+            for (const auto &v : d.values()) {
+                s << v << " ";
+            }
+            s << "\n";
+        }
+    }
+    for (const auto &r : n.estimated_region_required) {
+        s << r.min() << " " << r.max() << "\n";
+    }
+    for (const auto &st : n.stages) {
+        for (const auto &l : st.loop) {
+            s << l.var << " " << l.min << " " << l.max << "\n";
+        }
+        st.features.dump(s);
+        for (const auto *e : st.incoming_edges) {
+            s << e->producer->func.name() << "\n";
+            for (const auto &b : e->bounds) {
+                s << b.first.expr << " " << b.second.expr << "\n";
+            }
+        }
+    }
+    const string str = s.str();
+    return stable_hash(str.data(), str.size());
+}
+
+// Make a name legal in the schedule source, as apply_schedule does.
+string sanitize_name(string name) {
+    for (auto &c : name) {
+        if (c == '$') c = '_';
+    }
+    return name;
+}
+
+// The decisions recorded in the schedule output of a previous run
+// (see HL_PREVIOUS_SCHEDULE), to be reused for the Funcs that
+// haven't changed since. The record is a block of comments at the
+// end of the schedule source, one line per Func, giving its node hash
+// and the placement hash of the decision made for it in each phase.
+// Funcs are keyed by name, and both hashes cover the names of the
+// Funcs involved, so a Func with an automatically generated name
+// (f0, or blur$2 for a second Func named blur) won't match from one
+// run to the next.
+struct PreviousDecisions {
+    static constexpr const char *begin_marker = "// --- BEGIN autoscheduler decisions";
+    static constexpr const char *end_marker = "// --- END autoscheduler decisions";
+
+    struct Decision {
+        bool reusable = false;
+        uint64_t placement[2] = {0, 0};
+    };
+
+    // Indexed like dag.nodes.
+    vector<Decision> decisions;
+
+    // Parse the record in the given schedule file. Returns the
+    // number of Funcs whose decisions can be reused.
+    int load(const string &filename, const FunctionDAG &dag) {
+        decisions.clear();
+        decisions.resize(dag.nodes.size());
+
+        std::ifstream f(filename);
+        user_assert(f) << "Unable to open previous schedule: " << filename << "\n";
+
+        map<string, std::tuple<uint64_t, uint64_t, uint64_t>> recorded;
+        string line;
+        bool in_block = false;
+        while (std::getline(f, line)) {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == string::npos) continue;
+            line = line.substr(start);
+            if (line.rfind(begin_marker, 0) == 0) {
+                in_block = true;
+            } else if (line.rfind(end_marker, 0) == 0) {
+                in_block = false;
+            } else if (in_block && line.rfind("//", 0) == 0) {
+                std::istringstream in(line.substr(2));
+                string name;
+                uint64_t h, p0, p1;
+                if (in >> name >> std::hex >> h >> p0 >> p1) {
+                    recorded[name] = std::make_tuple(h, p0, p1);
+                }
+            }
+        }
+
+        int reusable = 0;
+        for (size_t i = 0; i < dag.nodes.size(); i++) {
+            const auto &n = dag.nodes[i];
+            if (n.is_input) continue;
+            auto it = recorded.find(sanitize_name(n.func.name()));
+            if (it == recorded.end() || std::get<0>(it->second) != node_hash(n)) continue;
+            decisions[i].reusable = true;
+            decisions[i].placement[0] = std::get<1>(it->second);
+            decisions[i].placement[1] = std::get<2>(it->second);
+            reusable++;
+        }
+        return reusable;
+    }
+};
+
+constexpr const char *PreviousDecisions::begin_marker;
+constexpr const char *PreviousDecisions::end_marker;
+
 struct State {
     mutable RefCount ref_count;
     IntrusivePtr<const LoopNest> root;
@@ -175,6 +319,12 @@ struct State {
     int num_decisions_made = 0;
     bool penalized = false;
 
+    // If the cost of this state was computed by the cost model rather
+    // than found in the cost cache, the key to store it under once
+    // it has been evaluated.
+    uint64_t cost_cache_key = 0;
+    bool cost_cache_miss = false;
+
     State() = default;
     State(const State &) = delete;
     State(State &&) = delete;
@@ -183,6 +333,54 @@ struct State {
 
     static int cost_calculations;
 
+    // The cost model batches up the states it's asked to evaluate,
+    // and isn't thread-safe.
+    static std::mutex cost_model_mutex;
+
+    // Costs remembered from previous runs, if HL_COST_CACHE_DIR is set.
+    static CostCache *cost_cache;
+
+    // Decisions to reuse from a previous run, if HL_PREVIOUS_SCHEDULE is set.
+    static const PreviousDecisions *previous_decisions;
+
+    // Does the last decision made to reach this state agree with
+    // the one made for the same Func by the previous run? Always true
+    // if there's nothing to reuse for that Func.
+    bool matches_previous_decision(const FunctionDAG &dag, const FunctionDAG::Node *node, int phase) const {
+        if (!previous_decisions) return true;
+        const auto &d = previous_decisions->decisions[node - &dag.nodes[0]];
+        if (!d.reusable) return true;
+        uint64_t h = 0;
+        root->placement_hash(node, h);
+        return h == d.placement[phase];
+    }
+
+    // Describe the decisions made to reach this state, in the form
+    // read back by PreviousDecisions.
+    string decisions_source(const FunctionDAG &dag) const {
+        vector<PreviousDecisions::Decision> decisions(dag.nodes.size());
+        for (const State *s = this; s->parent.defined(); s = s->parent.get()) {
+            auto np = node_and_phase(dag, s->parent->num_decisions_made);
+            uint64_t h = 0;
+            s->root->placement_hash(&dag.nodes[np.first], h);
+            decisions[np.first].placement[np.second] = h;
+        }
+        std::ostringstream src;
+        src << PreviousDecisions::begin_marker
+            << " (" << cost_calculations << " states evaluated)\n"
+            << std::hex;
+        for (size_t i = 0; i < dag.nodes.size(); i++) {
+            const auto &n = dag.nodes[i];
+            if (n.is_input) continue;
+            src << "// " << sanitize_name(n.func.name())
+                << " " << node_hash(n)
+                << " " << decisions[i].placement[0]
+                << " " << decisions[i].placement[1] << "\n";
+        }
+        src << PreviousDecisions::end_marker << "\n";
+        return src.str();
+    }
+
     uint64_t structural_hash(int depth) const {
         uint64_t h = num_decisions_made;
         internal_assert(root.defined());
@@ -328,7 +526,63 @@ struct State {
         }
     }
 
+    // Write the cost model's prediction for each stage, along with a
+    // few of the schedule features that most often explain it, as
+    // whitespace-separated text. Stages are listed in the same order
+    // as the featurization. A final comment line gives the prediction
+    // for the whole schedule, which the per-stage predictions should
+    // add up to. Returns false if the cost model can't attribute its
+    // prediction to individual stages.
+    bool save_cost_predictions(const FunctionDAG &dag, const MachineParams &params, CostModel *cost_model, std::ostream &out) {
+        StageMap<ScheduleFeatures> features;
+        compute_featurization(dag, params, &features);
+
+        std::vector<double> costs;
+        double total = 0;
+        {
+            std::lock_guard<std::mutex> lock(cost_model_mutex);
+            if (!cost_model->evaluate_costs_per_stage(dag, features, &costs)) {
+                return false;
+            }
+            cost_model->enqueue(dag, features, &total);
+            cost_model->evaluate_costs();
+        }
+
+        out << "# func stage predicted_msec inlined_calls num_realizations "
+            << "points_computed_total inner_parallelism working_set\n";
+        size_t i = 0;
+        for (const auto &n : dag.nodes) {
+            if (n.is_input) continue;
+            for (size_t stage_idx = n.stages.size(); stage_idx > 0; stage_idx--) {
+                const auto &s = n.stages[stage_idx - 1];
+                const auto &feat = features.get(&s);
+                internal_assert(i < costs.size());
+                out << n.func.name() << " "
+                    << s.name << " "
+                    << costs[i++] << " "
+                    << feat.inlined_calls << " "
+                    << feat.num_realizations << " "
+                    << feat.points_computed_total << " "
+                    << feat.inner_parallelism << " "
+                    << feat.working_set << "\n";
+            }
+        }
+        out << "# total predicted_msec " << total << "\n";
+        return true;
+    }
+
     bool calculate_cost(const FunctionDAG &dag, const MachineParams &params, CostModel *cost_model, bool verbose = false) {
+        // The cost is a pure function of the loop nest, so if we've
+        // seen this one before we can skip featurizing it.
+        const bool use_cache = cost_cache && !verbose;
+        if (use_cache) {
+            cost_cache_key = num_decisions_made;
+            root->exact_hash(cost_cache_key);
+            if (cost_cache->lookup(cost_cache_key, &cost)) {
+                return cost < 1e50;
+            }
+        }
+
         StageMap<ScheduleFeatures> features;
         compute_featurization(dag, params, &features);
 
@@ -351,6 +605,9 @@ struct State {
                 auto &feat = it.value();
                 if (feat.points_computed_total + feat.inlined_calls > 8 * feat.points_computed_minimum) {
                     cost = 1e50;
+                    if (use_cache) {
+                        cost_cache->insert(cost_cache_key, cost);
+                    }
                     return false;
                 }
             }
@@ -359,6 +616,9 @@ struct State {
         // Avoid code size explosion from recursive inlining.
         if (root->max_inlined_calls() >= 256) {
             cost = 1e50;
+            if (use_cache) {
+                cost_cache->insert(cost_cache_key, cost);
+            }
             return false;
         }
 
@@ -366,9 +626,12 @@ struct State {
         // evaluate it until we call evaluate_costs (or if it runs out
         // of internal buffer space), so that the evaluations can be
         // batched.
-        cost_model->enqueue(dag, features, &cost);
-
-        cost_calculations++;
+        {
+            std::lock_guard<std::mutex> lock(cost_model_mutex);
+            cost_model->enqueue(dag, features, &cost);
+            cost_calculations++;
+        }
+        cost_cache_miss = use_cache;
         return true;
     }
 
@@ -385,27 +648,22 @@ struct State {
         return s;
     }
 
-    // Generate the successor states to this state
+    // Generate the successor states to this state. If reuse_previous
+    // is set, only consider the decision the previous run made for the
+    // next Func, unless none of the successors match it.
     void generate_children(const FunctionDAG &dag,
                            const MachineParams &params,
                            CostModel *cost_model,
-                           std::function<void(IntrusivePtr<State> &&)> &accept_child) const {
+                           std::function<void(IntrusivePtr<State> &&)> &accept_child,
+                           bool reuse_previous = true) const {
         internal_assert(root.defined() && root->is_root());
 
         if (num_decisions_made == 2 * (int)dag.nodes.size()) {
             return;
         }
 
-        int next_node = num_decisions_made / 2;
-        int phase = num_decisions_made % 2;
-
-        if (!may_subtile()) {
-            // When emulating the older search space, we do all
-            // parallelizing last, so that it is independent of the
-            // tiling decisions.
-            next_node = num_decisions_made % dag.nodes.size();
-            phase = num_decisions_made / dag.nodes.size();
-        }
+        int next_node, phase;
+        std::tie(next_node, phase) = node_and_phase(dag, num_decisions_made);
 
         // Enumerate all legal ways to schedule the next Func
         const FunctionDAG::Node *node = &dag.nodes[next_node];
@@ -453,7 +711,8 @@ struct State {
                     new_root->inline_func(node);
                     child->root = new_root;
                     child->num_decisions_made++;
-                    if (child->calculate_cost(dag, params, cost_model)) {
+                    if ((!reuse_previous || child->matches_previous_decision(dag, node, phase)) &&
+                        child->calculate_cost(dag, params, cost_model)) {
                         num_children++;
                         accept_child(std::move(child));
                     }
@@ -535,7 +794,8 @@ struct State {
                     auto child = make_child();
                     child->root = std::move(n);
                     child->num_decisions_made++;
-                    if (child->calculate_cost(dag, params, cost_model)) {
+                    if ((!reuse_previous || child->matches_previous_decision(dag, node, phase)) &&
+                        child->calculate_cost(dag, params, cost_model)) {
                         num_children++;
                         accept_child(std::move(child));
                     }
@@ -687,7 +947,8 @@ struct State {
                     }
                     child->root = new_root;
                     child->num_decisions_made++;
-                    if (child->calculate_cost(dag, params, cost_model)) {
+                    if ((!reuse_previous || child->matches_previous_decision(dag, node, phase)) &&
+                        child->calculate_cost(dag, params, cost_model)) {
                         num_children++;
                         accept_child(std::move(child));
                     }
@@ -695,6 +956,13 @@ struct State {
             }
         }
 
+        if (num_children == 0 && reuse_previous && previous_decisions) {
+            // The previous decision no longer fits around whatever
+            // changed. Search all the options instead.
+            generate_children(dag, params, cost_model, accept_child, false);
+            return;
+        }
+
         if (num_children == 0) {
             aslog(0) << "Warning: Found no legal way to schedule "
                      << node->func.name() << " in the following State:\n";
@@ -858,6 +1126,9 @@ struct State {
 
 // Keep track of how many times we evaluated a state.
 int State::cost_calculations = 0;
+std::mutex State::cost_model_mutex;
+CostCache *State::cost_cache = nullptr;
+const PreviousDecisions *State::previous_decisions = nullptr;
 
 // A priority queue of states, sorted according to increasing
 // cost. Never shrinks, to avoid reallocations.
@@ -942,7 +1213,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           int pass_idx,
                                           int num_passes,
                                           ProgressBar &tick,
-                                          std::unordered_set<uint64_t> &permitted_hashes) {
+                                          std::unordered_set<uint64_t> &permitted_hashes,
+                                          ThreadPool<void> *thread_pool) {
 
     if (cost_model) {
         configure_pipeline_features(dag, params, cost_model);
@@ -1000,7 +1272,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                              pass_idx,
                                              num_passes,
                                              tick,
-                                             permitted_hashes);
+                                             permitted_hashes,
+                                             thread_pool);
             } else {
                 internal_error << "Ran out of legal states with beam size " << beam_size << "\n";
             }
@@ -1010,8 +1283,12 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
             aslog(0) << "Warning: Huge number of states generated (" << pending.size() << ").\n";
         }
 
-        expanded = 0;
-        while (expanded < beam_size && !pending.empty()) {
+        // The states to expand on this step of the search. Choosing
+        // them depends on the rng and on the order of the queue, so
+        // it's done serially. Expanding them is then done in
+        // parallel.
+        vector<IntrusivePtr<State>> to_expand;
+        while ((int)to_expand.size() < beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -1086,8 +1363,37 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                 return best;
             }
 
-            state->generate_children(dag, params, cost_model, enqueue_new_children);
-            expanded++;
+            to_expand.emplace_back(std::move(state));
+        }
+
+        // Generate the children of each state into its own list, and
+        // then accept them in the order a serial search would have,
+        // so that the result doesn't depend on the number of threads.
+        vector<vector<IntrusivePtr<State>>> children(to_expand.size());
+        auto expand = [&](size_t j) {
+            std::function<void(IntrusivePtr<State> &&)> accept_child =
+                [&children, j](IntrusivePtr<State> &&s) {
+                    children[j].emplace_back(std::move(s));
+                };
+            to_expand[j]->generate_children(dag, params, cost_model, accept_child);
+        };
+        if (thread_pool && to_expand.size() > 1) {
+            vector<std::future<void>> futures;
+            for (size_t j = 0; j < to_expand.size(); j++) {
+                futures.emplace_back(thread_pool->async(expand, j));
+            }
+            for (auto &f : futures) {
+                f.get();
+            }
+        } else {
+            for (size_t j = 0; j < to_expand.size(); j++) {
+                expand(j);
+            }
+        }
+        for (expanded = 0; expanded < (int)to_expand.size(); expanded++) {
+            for (auto &c : children[expanded]) {
+                enqueue_new_children(std::move(c));
+            }
         }
 
         // Drop the other states unconsidered.
@@ -1096,6 +1402,15 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
         if (cost_model) {
             // Now evaluate all the costs and re-sort them in the priority queue
             cost_model->evaluate_costs();
+            if (State::cost_cache) {
+                for (size_t j = 0; j < q.size(); j++) {
+                    auto s = q[j];
+                    if (s->cost_cache_miss) {
+                        State::cost_cache->insert(s->cost_cache_key, s->cost);
+                        s->cost_cache_miss = false;
+                    }
+                }
+            }
             q.resort();
         }
 
@@ -1156,11 +1471,21 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
         num_passes = std::atoi(num_passes_str.c_str());
     }
 
+    // Expanding states is embarrassingly parallel, so use all the
+    // cores unless told otherwise.
+    size_t num_threads = autoschedule_num_threads();
+    aslog(1) << "Expanding states using " << num_threads << " threads\n";
+    std::unique_ptr<ThreadPool<void>> thread_pool;
+    if (num_threads > 1 && beam_size > 1) {
+        thread_pool.reset(new ThreadPool<void>(num_threads));
+    }
+
     for (int i = 0; i < num_passes; i++) {
         ProgressBar tick;
 
         auto pass = optimal_schedule_pass(dag, outputs, params, cost_model,
-                                          rng, beam_size, i, num_passes, tick, permitted_hashes);
+                                          rng, beam_size, i, num_passes, tick, permitted_hashes,
+                                          thread_pool.get());
 
         tick.clear();
 
@@ -1183,6 +1508,23 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
     return best;
 }
 
+// Hash everything about a pipeline and the machine it's being
+// scheduled for that the costs of its states depend on. Used to name
+// the persistent cost cache.
+uint64_t pipeline_hash(const FunctionDAG &dag, const MachineParams &params, const Target &target) {
+    std::ostringstream s;
+    dag.dump(s);
+    for (const auto &n : dag.nodes) {
+        for (const auto &r : n.estimated_region_required) {
+            s << r.min() << " " << r.max() << "\n";
+        }
+    }
+    s << params.to_string() << "\n"
+      << target.to_string() << "\n";
+    const string str = s.str();
+    return stable_hash(str.data(), str.size());
+}
+
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
                        const Target &target,
@@ -1231,6 +1573,25 @@ void generate_schedule(const std::vector<Function> &outputs,
     std::unique_ptr<CostModel> cost_model = make_default_cost_model(weights_in_path, weights_out_path, randomize_weights);
     internal_assert(cost_model != nullptr);
 
+    // Optionally reuse costs computed by previous runs.
+    std::unique_ptr<CostCache> cost_cache;
+    string cost_cache_dir = get_env_variable("HL_COST_CACHE_DIR");
+    uint64_t weights_fingerprint = cost_model->weights_fingerprint();
+    if (!cost_cache_dir.empty() && weights_fingerprint != 0) {
+        cost_cache.reset(new CostCache(cost_cache_dir, pipeline_hash(dag, params, target), weights_fingerprint));
+    }
+    State::cost_cache = cost_cache.get();
+
+    // Optionally reuse the decisions made for unchanged Funcs by a
+    // previous run.
+    PreviousDecisions previous_decisions;
+    string previous_schedule = get_env_variable("HL_PREVIOUS_SCHEDULE");
+    if (!previous_schedule.empty()) {
+        int reusable = previous_decisions.load(previous_schedule, dag);
+        aslog(1) << "Reusing decisions for " << reusable << " Funcs from " << previous_schedule << "\n";
+        State::previous_decisions = &previous_decisions;
+    }
+
     IntrusivePtr<State> optimal;
 
     // Run beam search
@@ -1240,6 +1601,14 @@ void generate_schedule(const std::vector<Function> &outputs,
 
     aslog(1) << "Cost evaluated this many times: " << State::cost_calculations << '\n';
 
+    if (cost_cache) {
+        aslog(1) << "Cost cache hits: " << cost_cache->num_hits()
+                 << " misses: " << cost_cache->num_misses() << '\n';
+        cost_cache->save();
+    }
+    State::cost_cache = nullptr;
+    State::previous_decisions = nullptr;
+
     // Dump the schedule found
     aslog(1) << "** Optimal schedule:\n";
 
@@ -1249,6 +1618,10 @@ void generate_schedule(const std::vector<Function> &outputs,
     // Apply the schedules to the pipeline
     optimal->apply_schedule(dag, params);
 
+    // Record the decisions made, so that later runs on edited
+    // versions of the pipeline can reuse them.
+    optimal->schedule_source += optimal->decisions_source(dag);
+
     // Print out the schedule
     if (aslog::aslog_level() > 0) {
         optimal->dump();
@@ -1286,6 +1659,12 @@ void generate_schedule(const std::vector<Function> &outputs,
             auto_scheduler_results->featurization.resize(out.str().size());
             memcpy(auto_scheduler_results->featurization.data(), out.str().data(), out.str().size());
         }
+        {
+            std::ostringstream out;
+            if (optimal->save_cost_predictions(dag, params, cost_model.get(), out)) {
+                auto_scheduler_results->cost_predictions = out.str();
+            }
+        }
     }
 }
 
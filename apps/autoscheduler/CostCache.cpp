@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "ASLog.h"
+#include "CostCache.h"
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+namespace {
+
+constexpr uint32_t kSignature = 0x68636331;
+
+}  // namespace
+
+/*
+    Structure of a cost cache file:
+
+    uint32 signature                    always 0x68636331 ('hcc1')
+    uint64 weights fingerprint
+    uint64 entry-count
+        uint64 state hash
+        float64 cost
+
+    (all values little-endian)
+*/
+
+CostCache::CostCache(const std::string &dir, uint64_t pipeline_hash, uint64_t weights_fingerprint)
+    : weights_fingerprint(weights_fingerprint) {
+    std::ostringstream name;
+    name << dir << "/" << std::hex << pipeline_hash << ".costcache";
+    filename = name.str();
+    load();
+    aslog(1) << "Loaded " << costs.size() << " cached costs from " << filename << "\n";
+}
+
+void CostCache::load() {
+    std::ifstream i(filename, std::ios_base::binary);
+    if (!i.is_open()) return;
+
+    uint32_t signature;
+    uint64_t fingerprint, count;
+    i.read((char *)&signature, sizeof(signature));
+    i.read((char *)&fingerprint, sizeof(fingerprint));
+    i.read((char *)&count, sizeof(count));
+    if (i.fail() || signature != kSignature) {
+        aslog(0) << "Ignoring malformed cost cache " << filename << "\n";
+        return;
+    }
+    if (fingerprint != weights_fingerprint) {
+        aslog(1) << "Ignoring cost cache " << filename << " computed with different weights\n";
+        return;
+    }
+
+    for (uint64_t j = 0; j < count; j++) {
+        uint64_t state_hash;
+        double cost;
+        i.read((char *)&state_hash, sizeof(state_hash));
+        i.read((char *)&cost, sizeof(cost));
+        if (i.fail()) break;
+        costs.emplace(state_hash, cost);
+    }
+}
+
+bool CostCache::lookup(uint64_t state_hash, double *cost) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = costs.find(state_hash);
+    if (it == costs.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    *cost = it->second;
+    return true;
+}
+
+void CostCache::insert(uint64_t state_hash, double cost) {
+    std::lock_guard<std::mutex> lock(mutex);
+    dirty |= costs.emplace(state_hash, cost).second;
+}
+
+void CostCache::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty) return;
+
+    // Other autoscheduling processes may be sharing this cache
+    // (e.g. the parallel compiles in autotune_loop.sh), so pick up
+    // their entries, write to a temporary file, and atomically rename
+    // it into place. Entries added by a concurrent writer between our
+    // load and rename may be lost, which is harmless for a cache.
+    load();
+
+    std::string tmp = filename + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream o(tmp, std::ios_base::binary | std::ios_base::trunc);
+        const uint32_t signature = kSignature;
+        const uint64_t count = costs.size();
+        o.write((const char *)&signature, sizeof(signature));
+        o.write((const char *)&weights_fingerprint, sizeof(weights_fingerprint));
+        o.write((const char *)&count, sizeof(count));
+        for (const auto &c : costs) {
+            o.write((const char *)&c.first, sizeof(c.first));
+            o.write((const char *)&c.second, sizeof(c.second));
+        }
+        if (o.fail()) {
+            aslog(0) << "Failed to write cost cache " << tmp << "\n";
+            o.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        aslog(0) << "Failed to rename " << tmp << " to " << filename << "\n";
+        std::remove(tmp.c_str());
+        return;
+    }
+    dirty = false;
+}
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
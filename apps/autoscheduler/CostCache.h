@@ -0,0 +1,70 @@
+#ifndef COST_CACHE_H
+#define COST_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+// Hash a range of bytes using FNV-1a. Unlike std::hash, this is
+// stable across runs, compilers, and platforms, so it can be used to
+// name things on disk.
+inline uint64_t stable_hash(const void *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// A persistent cache of the costs the cost model assigns to states,
+// so that repeated autoscheduling runs over the same pipeline
+// (e.g. the iterations of autotune_loop.sh) don't re-featurize and
+// re-score states they have already seen. There is one file per
+// pipeline in the cache directory. Each file records a fingerprint of
+// the weights that produced its costs, and is ignored if the weights
+// have since changed.
+class CostCache {
+    std::string filename;
+    uint64_t weights_fingerprint;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, double> costs;
+    mutable uint64_t hits = 0, misses = 0;
+    bool dirty = false;
+
+    // Add entries from the file on disk, if its weights match.
+    void load();
+
+public:
+    CostCache(const std::string &dir, uint64_t pipeline_hash, uint64_t weights_fingerprint);
+
+    // Look up the cost of a state by its exact hash. Thread-safe.
+    bool lookup(uint64_t state_hash, double *cost) const;
+
+    // Record the cost of a state. Thread-safe.
+    void insert(uint64_t state_hash, double cost);
+
+    // Merge in anything other processes have added since we loaded,
+    // and write the result back to disk.
+    void save();
+
+    uint64_t num_hits() const {
+        return hits;
+    }
+
+    uint64_t num_misses() const {
+        return misses;
+    }
+};
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // COST_CACHE_H
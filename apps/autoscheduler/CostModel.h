@@ -2,6 +2,7 @@
 #define COST_MODEL_H
 
 #include <string>
+#include <vector>
 
 #include "FunctionDAG.h"
 #include "HalideBuffer.h"
@@ -35,6 +36,23 @@ public:
 
     // Discard all schedules in the queue.
     virtual void reset() = 0;
+
+    // Evaluate a single schedule, writing the predicted cost of each
+    // non-input stage to costs, in the same order the stages are
+    // enqueued. Returns false if the model can't attribute its cost
+    // to individual stages.
+    virtual bool evaluate_costs_per_stage(const Internal::Autoscheduler::FunctionDAG &dag,
+                                          const Halide::Internal::Autoscheduler::StageMapOfScheduleFeatures &schedule_feats,
+                                          std::vector<double> *costs) {
+        return false;
+    }
+
+    // A fingerprint of the model's weights, used to invalidate costs
+    // cached across runs when the weights change. Zero means that
+    // costs from this model should not be cached.
+    virtual uint64_t weights_fingerprint() {
+        return 0;
+    }
 };
 
 }  // namespace Halide
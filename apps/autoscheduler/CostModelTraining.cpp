@@ -0,0 +1,711 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "CostModelTraining.h"
+#include "NetworkSize.h"
+#include "SamplePack.h"
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+using Halide::Runtime::Buffer;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+uint64_t hash_floats(uint64_t h, const float *begin, const float *end) {
+    while (begin != end) {
+        uint32_t bits = *((const uint32_t *)begin);
+        // From boost
+        h ^= (bits + 0x9e3779b9 + (h << 6) + (h >> 2));
+        begin++;
+    }
+    return h;
+}
+
+bool ends_with(const string &str, const string &suffix) {
+    if (str.size() < suffix.size()) return false;
+    size_t off = str.size() - suffix.size();
+    for (size_t i = 0; i < suffix.size(); i++) {
+        if (str[off + i] != suffix[i]) return false;
+    }
+    return true;
+}
+
+string leaf(const string &path) {
+    size_t slash_pos = path.rfind('/');
+#ifdef _WIN32
+    if (slash_pos == string::npos) {
+        // Windows is a thing
+        slash_pos = path.rfind('\\');
+    }
+#endif
+    if (slash_pos != string::npos) {
+        return path.substr(slash_pos + 1);
+    } else {
+        return path;
+    }
+}
+
+int resolve_num_threads(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = (int)std::thread::hardware_concurrency();
+    }
+    return std::max(1, num_threads);
+}
+
+// Call f(i, t) for each i in [0, n), using the given number of
+// threads. t is the index of the thread doing the work.
+template<typename F>
+void parallel_for(size_t n, int num_threads, F f) {
+    num_threads = (int)std::min((size_t)num_threads, n);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            f(i, 0);
+        }
+        return;
+    }
+    vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < n; i += num_threads) {
+                f(i, t);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+// A sample that has been validated and converted, but not yet added
+// to a SampleSet. Parsing can be done in parallel; adding can't.
+struct ParsedSample {
+    // Non-empty if the sample should be skipped entirely
+    string rejection;
+    // Messages to print when the sample is added
+    string warnings;
+    // The raw data, which must outlive the call to merge_sample
+    const float *data = nullptr;
+    size_t num_stages = 0;
+    float runtime = 0;
+    int pipeline_id = 0;
+    uint64_t schedule_hash = 0;
+    // False if the schedule features are implausible
+    bool ok = true;
+    Sample sample;
+};
+
+void parse_sample(const float *scratch, size_t floats_read, const string &s, ParsedSample *p) {
+    const size_t features_per_stage = head2_w + (head1_w + 1) * head1_h;
+    if (floats_read < 3 || (floats_read - 3) % features_per_stage != 0) {
+        std::ostringstream o;
+        o << "Truncated sample: " << s << " " << floats_read << "\n";
+        p->rejection = o.str();
+        return;
+    }
+    const size_t num_features = floats_read - 3;
+    const size_t num_stages = num_features / features_per_stage;
+
+    const float runtime = scratch[num_features];
+    if (runtime > 100000) {  // Don't try to predict runtime over 100s
+        std::ostringstream o;
+        o << "Implausible runtime in ms: " << runtime << "\n";
+        p->rejection = o.str();
+        return;
+    }
+    // std::cout << "Runtime: " << runtime << "\n";
+
+    p->data = scratch;
+    p->num_stages = num_stages;
+    p->runtime = runtime;
+    p->pipeline_id = *((const int32_t *)(&scratch[num_features + 1]));
+
+    uint64_t schedule_hash = 0;
+    for (size_t i = 0; i < num_stages; i++) {
+        schedule_hash =
+            hash_floats(schedule_hash,
+                        &scratch[i * features_per_stage],
+                        &scratch[i * features_per_stage + head2_w]);
+    }
+    p->schedule_hash = schedule_hash;
+
+    Sample &sample = p->sample;
+    sample.filename = s;
+    sample.runtimes.push_back(runtime);
+    for (int i = 0; i < kModels; i++) {
+        sample.prediction[i] = 0.0;
+    }
+    sample.schedule_id = *((const int32_t *)(&scratch[num_features + 2]));
+    sample.schedule_features = Buffer<float>(head2_w, num_stages);
+
+    std::ostringstream warnings;
+    for (size_t i = 0; i < num_stages; i++) {
+        for (int x = 0; x < head2_w; x++) {
+            float f = scratch[i * features_per_stage + x];
+            if (f < 0 || f > 1e14 || std::isnan(f)) {
+                warnings << "Negative or implausibly large schedule feature: " << i << " " << x << " " << f << "\n";
+                // Something must have overflowed
+                p->ok = false;
+            }
+            sample.schedule_features(x, i) = f;
+        }
+        /*
+        if (sample.schedule_features(0, i) != sample.schedule_features(1, i)) {
+            std::cout << "Rejecting sliding window schedule for now\n";
+            p->ok = false;
+        }
+        */
+    }
+    p->warnings = warnings.str();
+}
+
+bool merge_sample(ParsedSample &&p, SampleSet *samples, SampleStats *stats) {
+    if (!p.rejection.empty()) {
+        std::cout << p.rejection;
+        return false;
+    }
+
+    const size_t features_per_stage = head2_w + (head1_w + 1) * head1_h;
+    const float runtime = p.runtime;
+    const size_t num_stages = p.num_stages;
+    const uint64_t schedule_hash = p.schedule_hash;
+
+    if (runtime < stats->best_runtime) {
+        stats->best_runtime = runtime;
+        stats->best_schedule_id = p.sample.schedule_id;
+        stats->best_path = p.sample.filename;
+    }
+
+    PipelineSample &ps = (*samples)[p.pipeline_id];
+
+    if (ps.pipeline_features.data() == nullptr) {
+        ps.pipeline_id = p.pipeline_id;
+        ps.num_stages = (int)num_stages;
+        ps.pipeline_features = Buffer<float>(head1_w, head1_h, num_stages);
+        ps.fastest_runtime = 1e30f;
+        for (size_t i = 0; i < num_stages; i++) {
+            for (int x = 0; x < head1_w; x++) {
+                for (int y = 0; y < head1_h; y++) {
+                    float f = p.data[i * features_per_stage + (x + 1) * 7 + y + head2_w];
+                    if (f < 0 || std::isnan(f)) {
+                        std::cout << "Negative or NaN pipeline feature: " << x << " " << y << " " << i << " " << f << "\n";
+                    }
+                    ps.pipeline_features(x, y, i) = f;
+                }
+            }
+        }
+
+        ps.pipeline_hash = hash_floats(0, ps.pipeline_features.begin(), ps.pipeline_features.end());
+    }
+
+    bool ok = true;
+    auto it = ps.schedules.find(schedule_hash);
+    if (it != ps.schedules.end()) {
+        // Keep the smallest runtime at the front
+        float best = it->second.runtimes[0];
+        if (runtime < best) {
+            it->second.runtimes.push_back(best);
+            it->second.runtimes[0] = runtime;
+            it->second.filename = p.sample.filename;
+        } else {
+            it->second.runtimes.push_back(runtime);
+        }
+        if (runtime < ps.fastest_runtime) {
+            ps.fastest_runtime = runtime;
+            ps.fastest_schedule_hash = schedule_hash;
+        }
+    } else {
+        std::cout << p.warnings;
+        ok = p.ok;
+        if (ok) {
+            if (runtime < ps.fastest_runtime) {
+                ps.fastest_runtime = runtime;
+                ps.fastest_schedule_hash = schedule_hash;
+            }
+            ps.schedules.emplace(schedule_hash, std::move(p.sample));
+            stats->num_unique++;
+        }
+    }
+    stats->num_read++;
+
+    if (stats->num_read % 10000 == 0) {
+        std::cout << "Samples loaded: " << stats->num_read << " (" << stats->num_unique << " unique)\n";
+    }
+
+    return ok;
+}
+
+}  // namespace
+
+bool add_sample(const float *data, size_t num_floats, const string &filename,
+                SampleSet *samples, SampleStats *stats) {
+    ParsedSample p;
+    parse_sample(data, num_floats, filename, &p);
+    return merge_sample(std::move(p), samples, stats);
+}
+
+SampleSet load_samples(const vector<string> &filenames, SampleStats *stats, int num_threads) {
+    num_threads = resolve_num_threads(num_threads);
+
+    vector<string> to_load;
+    for (const string &s : filenames) {
+        if (!ends_with(s, ".sample") && !ends_with(s, ".samplepack")) {
+            std::cout << "Skipping file: " << s << "\n";
+            continue;
+        }
+        to_load.push_back(s);
+    }
+
+    // Map all the files, and find the samples within them.
+    vector<std::unique_ptr<MappedFile>> files(to_load.size());
+    vector<vector<SampleView>> views_per_file(to_load.size());
+    parallel_for(to_load.size(), num_threads, [&](size_t i, int) {
+        files[i].reset(new MappedFile(to_load[i]));
+        if (files[i]->valid()) {
+            if (!get_sample_views(*files[i], to_load[i], &views_per_file[i])) {
+                std::cerr << "Malformed sample pack: " << to_load[i] << "\n";
+                views_per_file[i].clear();
+            }
+        }
+    });
+
+    vector<SampleView> views;
+    for (size_t i = 0; i < to_load.size(); i++) {
+        if (!files[i]->valid()) {
+            std::cout << "Unable to read sample: " << to_load[i] << "\n";
+            continue;
+        }
+        views.insert(views.end(), views_per_file[i].begin(), views_per_file[i].end());
+    }
+    views_per_file.clear();
+
+    // Parse them in parallel, then add them in order, so that the
+    // result doesn't depend on the number of threads. We expect
+    // truncated files if the benchmarking or autoscheduling
+    // procedure crashes and want to filter them out with a warning,
+    // which parse_sample does by checking the number of floats.
+    vector<ParsedSample> parsed(views.size());
+    parallel_for(views.size(), num_threads, [&](size_t i, int) {
+        parse_sample(views[i].data, views[i].num_floats, views[i].filename, &parsed[i]);
+    });
+
+    SampleSet result;
+    for (auto &p : parsed) {
+        merge_sample(std::move(p), &result, stats);
+    }
+    parsed.clear();
+
+    // Check the noise level
+    for (const auto &pipe : result) {
+        double variance_sum = 0;
+        size_t count = 0;
+        // Compute the weighted average of variances across all samples
+        for (const auto &p : pipe.second.schedules) {
+            if (p.second.runtimes.empty()) {
+                std::cerr << "Empty runtimes for schedule: " << p.first << "\n";
+                abort();
+            }
+            std::cout << "Unique sample: " << leaf(p.second.filename) << " : " << p.second.runtimes[0] << "\n";
+            if (p.second.runtimes.size() > 1) {
+                // Compute variance from samples
+                double mean = 0;
+                for (float f : p.second.runtimes) {
+                    mean += f;
+                }
+                mean /= p.second.runtimes.size();
+                double variance = 0;
+                for (float f : p.second.runtimes) {
+                    f -= mean;
+                    variance += f * f;
+                }
+                variance_sum += variance;
+                count += p.second.runtimes.size() - 1;
+            }
+        }
+        if (count > 0) {
+            double stddev = std::sqrt(variance_sum / count);
+            std::cout << "Noise level: " << stddev << "\n";
+        }
+    }
+
+    std::cout << "Distinct pipelines: " << result.size() << "\n";
+
+    return result;
+}
+
+void report_best_sample(const SampleStats &stats,
+                        const string &best_benchmark_path,
+                        const string &best_schedule_path) {
+    std::ostringstream o;
+    o << "Best runtime is " << stats.best_runtime << " msec, from schedule id " << stats.best_schedule_id << " in file " << stats.best_path << "\n";
+    std::cout << o.str();
+    if (!best_benchmark_path.empty()) {
+        std::ofstream f(best_benchmark_path, std::ios_base::trunc);
+        f << o.str();
+        f.close();
+        assert(!f.fail());
+    }
+    if (!best_schedule_path.empty()) {
+        // best_path points to a .sample file; look for a .schedule.h file in the same dir
+        size_t dot = stats.best_path.rfind('.');
+        assert(dot != string::npos && stats.best_path.substr(dot) == ".sample");
+        string schedule_file = stats.best_path.substr(0, dot) + ".schedule.h";
+        std::ifstream src(schedule_file);
+        std::ofstream dst(best_schedule_path);
+        dst << src.rdbuf();
+        assert(!src.fail());
+        assert(!dst.fail());
+    }
+}
+
+namespace {
+
+struct Inversion {
+    int pipeline_id;
+    string f1, f2;
+    float p1, p2;
+    float r1, r2;
+    float badness = 0;
+};
+
+// What we learned from one pass over some pipelines.
+struct PassStats {
+    float loss_sum = 0, loss_sum_counter = 0;
+    float good = 0, bad = 0;
+    float worst_miss = 0;
+    uint64_t worst_miss_pipeline_id = 0;
+    uint64_t worst_miss_schedule_id = 0;
+    Inversion worst_inversion;
+
+    void merge(const PassStats &other) {
+        loss_sum += other.loss_sum;
+        loss_sum_counter += other.loss_sum_counter;
+        good += other.good;
+        bad += other.bad;
+        if (other.worst_miss > worst_miss) {
+            worst_miss = other.worst_miss;
+            worst_miss_pipeline_id = other.worst_miss_pipeline_id;
+            worst_miss_schedule_id = other.worst_miss_schedule_id;
+        }
+        if (other.worst_inversion.badness > worst_inversion.badness) {
+            worst_inversion = other.worst_inversion;
+        }
+    }
+};
+
+// Train on (or just evaluate, if train is false) a mini-batch of
+// schedules of a single pipeline. Returns true if the weights changed.
+bool process_pipeline(DefaultCostModel *tp, int model, int pipeline_id, PipelineSample &ps,
+                      bool train, float learning_rate, int num_cores,
+                      std::mt19937 &rng, PassStats *stats) {
+    if (kModels > 1 && rng() & 1) return false;  // If we are training multiple kModels, allow them to diverge.
+    if (ps.schedules.size() < 8) {
+        return false;
+    }
+    tp->reset();
+    tp->set_pipeline_features(ps.pipeline_features, num_cores);
+
+    size_t batch_size = std::min((size_t)1024, ps.schedules.size());
+
+    size_t fastest_idx = 0;
+    Halide::Runtime::Buffer<float> runtimes(batch_size);
+
+    size_t first = 0;
+    if (ps.schedules.size() > 1024) {
+        first = rng() % (ps.schedules.size() - 1024);
+    }
+
+    auto it = ps.schedules.begin();
+    std::advance(it, first);
+    for (size_t j = 0; j < batch_size; j++) {
+        auto &sched = it->second;
+        Halide::Runtime::Buffer<float> buf;
+        tp->enqueue(ps.num_stages, &buf, &sched.prediction[model]);
+        runtimes(j) = sched.runtimes[0];
+        if (runtimes(j) < runtimes(fastest_idx)) {
+            fastest_idx = j;
+        }
+        buf.copy_from(sched.schedule_features);
+        it++;
+    }
+
+    float loss = 0.0f;
+    if (train) {
+        loss = tp->backprop(runtimes, learning_rate);
+        assert(!std::isnan(loss));
+        stats->loss_sum += loss;
+        stats->loss_sum_counter++;
+
+        auto it = ps.schedules.begin();
+        std::advance(it, first);
+        for (size_t j = 0; j < batch_size; j++) {
+            auto &sched = it->second;
+            float m = sched.runtimes[0] / (sched.prediction[model] + 1e-10f);
+            if (m > stats->worst_miss) {
+                stats->worst_miss = m;
+                stats->worst_miss_pipeline_id = pipeline_id;
+                stats->worst_miss_schedule_id = it->first;
+            }
+            it++;
+        }
+    } else {
+        tp->evaluate_costs();
+    }
+
+    if (true) {
+        int good = 0, bad = 0;
+        for (auto &sched : ps.schedules) {
+            auto &ref = ps.schedules[ps.fastest_schedule_hash];
+            if (sched.second.prediction[model] == 0) continue;
+            assert(sched.second.runtimes[0] >= ref.runtimes[0]);
+            float runtime_ratio = sched.second.runtimes[0] / ref.runtimes[0];
+            if (runtime_ratio <= 1.3f) continue;  // Within 30% of the runtime of the best
+            if (sched.second.prediction[model] >= ref.prediction[model]) {
+                good++;
+            } else {
+                if (train) {
+                    float badness = (sched.second.runtimes[0] - ref.runtimes[0]) * (ref.prediction[model] - sched.second.prediction[model]);
+                    badness /= (ref.runtimes[0] * ref.runtimes[0]);
+                    if (badness > stats->worst_inversion.badness) {
+                        Inversion &worst_inversion = stats->worst_inversion;
+                        worst_inversion.pipeline_id = pipeline_id;
+                        worst_inversion.badness = badness;
+                        worst_inversion.r1 = ref.runtimes[0];
+                        worst_inversion.r2 = sched.second.runtimes[0];
+                        worst_inversion.p1 = ref.prediction[model];
+                        worst_inversion.p2 = sched.second.prediction[model];
+                        worst_inversion.f1 = ref.filename;
+                        worst_inversion.f2 = sched.second.filename;
+                    }
+                }
+                bad++;
+            }
+        }
+        stats->good += good;
+        stats->bad += bad;
+    }
+
+    return train;
+}
+
+vector<Buffer<float>> weight_buffers(DefaultCostModel *model) {
+    vector<Buffer<float>> result;
+    model->get_weights().for_each_buffer([&](const Buffer<float> &b) {
+        result.push_back(b);
+    });
+    return result;
+}
+
+// Set the weights of all the replicas to the average of the weights
+// of the first n of them.
+void average_weights(const vector<DefaultCostModel *> &replicas, size_t n) {
+    vector<vector<Buffer<float>>> buffers;
+    for (DefaultCostModel *r : replicas) {
+        buffers.push_back(weight_buffers(r));
+    }
+    for (size_t b = 0; b < buffers[0].size(); b++) {
+        Buffer<float> &avg = buffers[0][b];
+        for (size_t r = 1; r < n; r++) {
+            avg.for_each_value([](float &a, float x) { a += x; }, buffers[r][b]);
+        }
+        const float scale = 1.0f / n;
+        avg.for_each_value([=](float &a) { a *= scale; });
+        for (size_t r = 1; r < replicas.size(); r++) {
+            buffers[r][b].copy_from(avg);
+        }
+    }
+}
+
+}  // namespace
+
+void train_on_samples(SampleSet samples,
+                      const vector<std::unique_ptr<DefaultCostModel>> &tpp,
+                      const TrainingParams &params) {
+    assert(tpp.size() == (size_t)kModels);
+
+    std::cout.setf(std::ios::fixed, std::ios::floatfield);
+    std::cout.precision(4);
+
+    auto seed = time(NULL);
+
+    std::cout << "Iterating over " << samples.size() << " samples using seed = " << seed << "\n";
+    decltype(samples) validation_set;
+    uint64_t unique_schedules = 0;
+    if (samples.size() > 16) {
+        for (auto p : samples) {
+            unique_schedules += p.second.schedules.size();
+            // Whether or not a pipeline is part of the validation set
+            // can't be a call to rand. It must be a fixed property of a
+            // hash of some aspect of it.  This way you don't accidentally
+            // do a training run where a validation set member was in the
+            // training set of a previous run. The id of the fastest
+            // schedule will do as a hash.
+            if ((p.second.pipeline_hash & 7) == 0) {
+                validation_set.insert(p);
+            }
+        }
+
+        for (auto p : validation_set) {
+            samples.erase(p.first);
+        }
+    }
+
+    std::cout << "Number of unique schedules: " << unique_schedules << "\n";
+
+    // Train on several pipelines at once (data parallelism across
+    // mini-batches), using a copy of each model per thread. The
+    // copies start with the same weights, and their weights are
+    // averaged after every step, so they never diverge by more than
+    // one step. Each copy keeps its own ADAM state. With one thread
+    // this is just the usual serial training loop.
+    const size_t num_threads = std::min((size_t)resolve_num_threads(params.num_threads),
+                                        std::max((size_t)1, std::max(samples.size(), validation_set.size())));
+    vector<std::unique_ptr<DefaultCostModel>> replica_storage;
+    vector<vector<DefaultCostModel *>> replicas(kModels);
+    for (int model = 0; model < kModels; model++) {
+        replicas[model].push_back(tpp[model].get());
+        for (size_t t = 1; t < num_threads; t++) {
+            replica_storage.emplace_back(make_default_cost_model());
+            replicas[model].push_back(replica_storage.back().get());
+        }
+        average_weights(replicas[model], 1);
+    }
+    vector<std::mt19937> rngs;
+    for (size_t t = 0; t < num_threads; t++) {
+        rngs.emplace_back((uint32_t)(seed + t));
+    }
+
+    for (float learning_rate : params.rates) {
+        float loss_sum[kModels] = {0}, loss_sum_counter[kModels] = {0};
+        float correct_ordering_rate_sum[kModels] = {0};
+        float correct_ordering_rate_count[kModels] = {0};
+        float v_correct_ordering_rate_sum[kModels] = {0};
+        float v_correct_ordering_rate_count[kModels] = {0};
+
+        for (int e = 0; e < params.epochs; e++) {
+            PassStats epoch;
+
+            for (int model = 0; model < kModels; model++) {
+                for (int train = 0; train < 2; train++) {
+                    auto &pipelines = train ? samples : validation_set;
+                    vector<SampleSet::value_type *> work;
+                    for (auto &p : pipelines) {
+                        work.push_back(&p);
+                    }
+
+                    PassStats pass;
+                    for (size_t first = 0; first < work.size(); first += num_threads) {
+                        const size_t n = std::min(num_threads, work.size() - first);
+                        vector<PassStats> step(n);
+                        vector<char> trained(n, 0);
+                        parallel_for(n, (int)n, [&](size_t t, int) {
+                            auto &p = *work[first + t];
+                            trained[t] = process_pipeline(replicas[model][t], model, p.first, p.second,
+                                                          train, learning_rate, params.num_cores,
+                                                          rngs[t], &step[t]);
+                        });
+                        for (const auto &s : step) {
+                            pass.merge(s);
+                        }
+
+                        // Gather the replicas that took a step at the
+                        // front, and average over those.
+                        vector<DefaultCostModel *> order;
+                        for (size_t t = 0; t < n; t++) {
+                            if (trained[t]) order.push_back(replicas[model][t]);
+                        }
+                        const size_t num_trained = order.size();
+                        if (num_trained > 0 && num_threads > 1) {
+                            for (size_t t = 0; t < num_threads; t++) {
+                                if (t >= n || !trained[t]) order.push_back(replicas[model][t]);
+                            }
+                            average_weights(order, num_trained);
+                        }
+                    }
+
+                    if (train) {
+                        loss_sum[model] += pass.loss_sum;
+                        loss_sum_counter[model] += pass.loss_sum_counter;
+                        correct_ordering_rate_sum[model] += pass.good;
+                        correct_ordering_rate_count[model] += pass.good + pass.bad;
+                        epoch.merge(pass);
+                    } else {
+                        v_correct_ordering_rate_sum[model] += pass.good;
+                        v_correct_ordering_rate_count[model] += pass.good + pass.bad;
+                    }
+                }
+            }
+
+            std::cout << "Loss: ";
+            for (int model = 0; model < kModels; model++) {
+                std::cout << loss_sum[model] / loss_sum_counter[model] << " ";
+                loss_sum[model] *= 0.9f;
+                loss_sum_counter[model] *= 0.9f;
+            }
+            if (kModels > 1) std::cout << "\n";
+            std::cout << " Rate: ";
+            int best_model = 0;
+            float best_rate = 0;
+            for (int model = 0; model < kModels; model++) {
+                float rate = correct_ordering_rate_sum[model] / correct_ordering_rate_count[model];
+                std::cout << rate << " ";
+                correct_ordering_rate_sum[model] *= 0.9f;
+                correct_ordering_rate_count[model] *= 0.9f;
+
+                rate = v_correct_ordering_rate_sum[model] / v_correct_ordering_rate_count[model];
+                if (rate < best_rate) {
+                    best_model = model;
+                    best_rate = rate;
+                }
+                std::cout << rate << " ";
+                v_correct_ordering_rate_sum[model] *= 0.9f;
+                v_correct_ordering_rate_count[model] *= 0.9f;
+            }
+
+            if (kModels > 1) std::cout << "\n";
+            if (samples.count(epoch.worst_miss_pipeline_id)) {
+                std::cout << " Worst: " << epoch.worst_miss << " " << leaf(samples[epoch.worst_miss_pipeline_id].schedules[epoch.worst_miss_schedule_id].filename) << "\n";
+                // samples[epoch.worst_miss_pipeline_id].schedules.erase(epoch.worst_miss_schedule_id);
+            } else {
+                std::cout << "\n";
+            }
+
+            const Inversion &worst_inversion = epoch.worst_inversion;
+            if (worst_inversion.badness > 0) {
+                std::cout << "Worst inversion:\n"
+                          << leaf(worst_inversion.f1) << " predicted: " << worst_inversion.p1 << " actual: " << worst_inversion.r1 << "\n"
+                          << leaf(worst_inversion.f2) << " predicted: " << worst_inversion.p2 << " actual: " << worst_inversion.r2 << "\n";
+                if (samples.size() > 50000) {
+                    // For robustness during training on large numbers
+                    // of random pipelines, we discard poorly
+                    // performing samples from the training set
+                    // only. Some of them are weird degenerate
+                    // pipelines.
+                    samples.erase(worst_inversion.pipeline_id);
+                }
+            }
+
+            tpp[best_model]->save_weights();
+
+            if (loss_sum[best_model] < 1e-5f) {
+                std::cout << "Zero loss, returning early\n";
+                return;
+            }
+        }
+    }
+}
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
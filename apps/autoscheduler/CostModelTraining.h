@@ -0,0 +1,94 @@
+#ifndef COST_MODEL_TRAINING_H
+#define COST_MODEL_TRAINING_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DefaultCostModel.h"
+#include "HalideBuffer.h"
+
+// The sample loading and training loop shared by retrain_cost_model
+// and the autotune driver.
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+constexpr int kModels = 1;
+
+struct Sample {
+    std::vector<float> runtimes;  // in msec
+    double prediction[kModels];
+    std::string filename;
+    int32_t schedule_id;
+    Runtime::Buffer<float> schedule_features;
+};
+
+struct PipelineSample {
+    int32_t pipeline_id;
+    int32_t num_stages;
+    Runtime::Buffer<float> pipeline_features;
+    std::map<uint64_t, Sample> schedules;
+    uint64_t fastest_schedule_hash;
+    float fastest_runtime;  // in msec
+    uint64_t pipeline_hash;
+};
+
+// All the samples seen so far, keyed by pipeline id.
+typedef std::map<int, PipelineSample> SampleSet;
+
+// Running statistics over the samples added to a SampleSet.
+struct SampleStats {
+    size_t num_read = 0, num_unique = 0;
+    int best_schedule_id = -1;
+    float best_runtime = 1e20f;
+    std::string best_path;
+};
+
+// Add a single sample to the set. A sample is a featurization
+// followed by a runtime in msec, a pipeline id, and a schedule id,
+// as produced by featurization_to_sample. The data is that of a
+// sample file of the given name, which is only used for
+// reporting. Returns false (with a message on stdout) if the sample
+// is malformed or implausible.
+bool add_sample(const float *data, size_t num_floats, const std::string &filename,
+                SampleSet *samples, SampleStats *stats);
+
+// Load all the samples in the named .sample and .samplepack files,
+// and report on their noise level. The files are mapped and parsed
+// using the given number of threads (zero means one per core), but
+// the result is the same as loading them one at a time in order.
+SampleSet load_samples(const std::vector<std::string> &filenames, SampleStats *stats,
+                       int num_threads = 0);
+
+// Report the best runtime seen, and optionally write it to
+// best_benchmark_path, and copy the schedule that produced it to
+// best_schedule_path.
+void report_best_sample(const SampleStats &stats,
+                        const std::string &best_benchmark_path,
+                        const std::string &best_schedule_path);
+
+struct TrainingParams {
+    int epochs = 0;
+    std::vector<float> rates = {0.0001f};
+    int num_cores = 32;
+    // How many pipelines' worth of samples to train on at once. Each
+    // is trained on by a separate copy of the model, and the copies'
+    // weights are averaged after every step. Zero means one per core.
+    int num_threads = 0;
+};
+
+// Train the models on the samples, saving the weights of the best
+// one after each epoch.
+void train_on_samples(SampleSet samples,
+                      const std::vector<std::unique_ptr<DefaultCostModel>> &models,
+                      const TrainingParams &params);
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // COST_MODEL_TRAINING_H
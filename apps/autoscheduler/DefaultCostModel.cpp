@@ -11,6 +11,7 @@
 #include <string>
 
 #include "ASLog.h"
+#include "CostCache.h"
 #include "DefaultCostModel.h"
 #include "HalideBuffer.h"
 #include "NetworkSize.h"
@@ -293,6 +294,69 @@ void DefaultCostModel::evaluate_costs() {
     cursor = 0;
 }
 
+bool DefaultCostModel::evaluate_costs_per_stage(const Internal::Autoscheduler::FunctionDAG &dag,
+                                                const Halide::Internal::Autoscheduler::StageMapOfScheduleFeatures &schedule_feats,
+                                                std::vector<double> *costs) {
+    internal_assert(pipeline_feat_queue.data() && "Call set_pipeline_features before calling evaluate_costs_per_stage\n");
+
+    // Flush anything already queued, so that the state of the queue
+    // isn't disturbed.
+    evaluate_costs();
+
+    // Stages are laid out in the same order as in enqueue, which is
+    // also the order of the pipeline features.
+    const int max_num_stages = pipeline_feat_queue.dim(2).extent();
+    Runtime::Buffer<float> schedule_features(1, head2_w, max_num_stages);
+    int stage = 0;
+    for (const auto &n : dag.nodes) {
+        if (n.is_input) continue;
+        for (auto it = n.stages.rbegin(); it != n.stages.rend(); it++) {
+            internal_assert(stage < max_num_stages);
+            if (!schedule_feats.contains(&*it)) {
+                return false;
+            }
+            const auto &feat = schedule_feats.get(&*it);
+            for (size_t i = 0; i < ScheduleFeatures::num_features(); i++) {
+                schedule_features(0, i, stage) = feat[i];
+            }
+            stage += 1;
+        }
+    }
+
+    // The prediction is a sum of per-stage terms, but the term for
+    // the first stage (the output) is computed differently, so a
+    // stage can't be evaluated on its own. Instead, evaluate the
+    // schedule truncated to its first k stages for each k. Each
+    // stage's cost is the difference between successive predictions,
+    // so they add up to the prediction for the whole schedule.
+    Runtime::Buffer<float> dst(1);
+    auto loss = Runtime::Buffer<float>::make_scalar();
+    double previous = 0;
+    for (int k = 1; k <= stage; k++) {
+        int result = cost_model(k, 1, num_cores,
+                                pipeline_feat_queue,
+                                schedule_features,
+                                weights.head1_filter, weights.head1_bias,
+                                weights.head2_filter, weights.head2_bias,
+                                weights.conv1_filter, weights.conv1_bias,
+                                0.0f, 0, 0, nullptr,
+                                dst, loss);
+        (void)result;
+        internal_assert(result == 0);
+        costs->push_back(dst(0) - previous);
+        previous = dst(0);
+    }
+    return true;
+}
+
+uint64_t DefaultCostModel::weights_fingerprint() {
+    std::ostringstream o;
+    bool ok = weights.save(o);
+    internal_assert(ok);
+    const std::string bytes = o.str();
+    return Internal::Autoscheduler::stable_hash(bytes.data(), bytes.size());
+}
+
 void DefaultCostModel::load_weights() {
     bool need_randomize = randomize_weights;
 
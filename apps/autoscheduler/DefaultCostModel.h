@@ -53,9 +53,25 @@ public:
     // Discard all schedules in the queue.
     void reset() override;
 
+    // Evaluate a single schedule, attributing the prediction to its
+    // stages. The per-stage costs add up to the cost of the whole
+    // schedule, as evaluate_costs would predict it.
+    bool evaluate_costs_per_stage(const Internal::Autoscheduler::FunctionDAG &dag,
+                                  const Halide::Internal::Autoscheduler::StageMapOfScheduleFeatures &schedule_feats,
+                                  std::vector<double> *costs) override;
+
+    // A hash of the serialized weights.
+    uint64_t weights_fingerprint() override;
+
     // Update model weights using true measured runtimes.
     float backprop(const Runtime::Buffer<const float> &true_runtimes, float learning_rate);
 
+    // Direct access to the model weights, e.g. to average those of
+    // several copies of the model being trained in parallel.
+    Internal::Weights &get_weights() {
+        return weights;
+    }
+
     // Save/Load the model weights to/from disk.
     void save_weights();
     void load_weights();
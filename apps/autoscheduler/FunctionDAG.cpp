@@ -1,5 +1,8 @@
 #include "FunctionDAG.h"
 
+#include <functional>
+#include <future>
+
 #include "ASLog.h"
 
 namespace Halide {
@@ -303,8 +306,36 @@ public:
     }
 };
 
+// Call f(i) for each i in [0, n), on as many threads as the
+// autoscheduler is allowed to use.
+void parallel_for_each(size_t n, const std::function<void(size_t)> &f) {
+    const size_t num_threads = std::min((size_t)autoschedule_num_threads(), n);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+    ThreadPool<void> thread_pool(num_threads);
+    vector<std::future<void>> futures;
+    for (size_t i = 0; i < n; i++) {
+        futures.emplace_back(thread_pool.async(f, i));
+    }
+    for (auto &fut : futures) {
+        fut.get();
+    }
+}
+
 }  // namespace
 
+int autoschedule_num_threads() {
+    string num_threads_str = get_env_variable("HL_AUTOSCHEDULE_NUM_THREADS");
+    if (!num_threads_str.empty()) {
+        return std::max(1, std::atoi(num_threads_str.c_str()));
+    }
+    return ThreadPool<void>::num_processors_online();
+}
+
 void LoadJacobian::dump(const char *prefix) const {
     if (count() > 1) {
         aslog(0) << prefix << count() << " x\n";
@@ -375,6 +406,7 @@ void BoundContents::Layout::allocate_some_more() const {
 }
 
 BoundContents *BoundContents::Layout::make() const {
+    std::lock_guard<std::mutex> lock(mutex);
     if (pool.empty()) {
         allocate_some_more();
     }
@@ -387,6 +419,7 @@ BoundContents *BoundContents::Layout::make() const {
 void BoundContents::Layout::release(const BoundContents *b) const {
     internal_assert(b->layout == this) << "Releasing BoundContents onto the wrong pool!";
     b->~BoundContents();
+    std::lock_guard<std::mutex> lock(mutex);
     pool.push_back(const_cast<BoundContents *>(b));
     num_live--;
 }
@@ -593,10 +626,20 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
         node_map[f] = &nodes[i];
     }
 
-    int stage_count = 0;
+    // The bounds on the values of every Func are the same for every
+    // stage, so compute them once up front, both as they are and with
+    // the parameter estimates applied.
+    const FuncValueBounds func_value_bounds = compute_function_value_bounds(order, env);
+    FuncValueBounds func_value_bounds_with_estimates = func_value_bounds;
+    for (auto &p : func_value_bounds_with_estimates) {
+        p.second.min = apply_param_estimates.mutate(p.second.min);
+        p.second.max = apply_param_estimates.mutate(p.second.max);
+    }
 
-    for (size_t i = order.size(); i > 0; i--) {
-        Node &node = nodes[order.size() - i];
+    // Analyze a single Func, appending the edges that lead to it to
+    // node_edges. The Funcs are independent of each other, so this
+    // is done in parallel.
+    auto analyze_node = [&](Node &node, vector<Edge> *node_edges) {
         Function consumer = node.func;
         Scope<Interval> scope;
 
@@ -612,7 +655,6 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
         auto pure_args = node.func.args();
 
         for (int s = 0; s <= (int)consumer.updates().size(); s++) {
-            stage_count++;
             if (s == 0) {
                 node.stages.emplace_back(Stage(consumer, consumer.definition(), 0));
             } else {
@@ -648,7 +690,6 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
                 node.region_computed.resize(consumer.dimensions());
             }
 
-            FuncValueBounds func_value_bounds = compute_function_value_bounds(order, env);
             for (int j = 0; j < consumer.dimensions(); j++) {
                 // The region computed always uses the full extent of the rvars
                 Interval in = bounds_of_expr_in_scope(def.args()[j], stage_scope_with_concrete_rvar_bounds, func_value_bounds);
@@ -885,11 +926,6 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
 
             exprs = apply_param_estimates.mutate(exprs);
 
-            for (auto &p : func_value_bounds) {
-                p.second.min = apply_param_estimates.mutate(p.second.min);
-                p.second.max = apply_param_estimates.mutate(p.second.max);
-            }
-
             // For this stage scope we want symbolic bounds for the rvars
 
             // Now create the edges that lead to this func
@@ -899,14 +935,14 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
             // TODO: peephole the boundary condition call pattern instead of assuming the user used the builtin
             node.is_boundary_condition = node.is_pointwise && starts_with(node.func.name(), "repeat_edge");
 
-            auto boxes = boxes_required(exprs, stage_scope_with_symbolic_rvar_bounds, func_value_bounds);
+            auto boxes = boxes_required(exprs, stage_scope_with_symbolic_rvar_bounds, func_value_bounds_with_estimates);
             for (auto &p : boxes) {
                 auto it = env.find(p.first);
                 if (it != env.end() && p.first != consumer.name()) {
                     // Discard loads from input images and self-loads
                     Edge edge;
                     edge.consumer = &stage;
-                    edge.producer = node_map.at(env[p.first]);
+                    edge.producer = node_map.at(it->second);
                     edge.all_bounds_affine = true;
 
                     for (Interval &in : p.second.bounds) {
@@ -923,7 +959,7 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
                     edge.calls = checker.calls[edge.producer->func.name()];
                     any_incoming_edges = true;
                     node.is_pointwise &= checker.is_pointwise;
-                    edges.emplace_back(std::move(edge));
+                    node_edges->emplace_back(std::move(edge));
                 }
             }
 
@@ -931,6 +967,31 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
             node.is_input = !node.func.has_update_definition() && node.is_wrapper && !any_incoming_edges;
             node.dimensions = node.func.dimensions();
         }
+    };
+
+    vector<vector<Edge>> node_edges(nodes.size());
+    parallel_for_each(nodes.size(), [&](size_t i) {
+        analyze_node(nodes[i], &node_edges[i]);
+    });
+
+    // Gather up the edges in the order a serial analysis would have
+    // produced them. Many of them have identical symbolic bounds
+    // (e.g. a consumer reading several producers at the same
+    // offsets), so share a single copy of each bounds expression.
+    std::map<Expr, Expr, IRDeepCompare> interned_bounds;
+    auto intern = [&](Expr &e) {
+        e = interned_bounds.emplace(e, e).first->second;
+    };
+    int stage_count = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        stage_count += (int)nodes[i].stages.size();
+        for (auto &e : node_edges[i]) {
+            for (auto &b : e.bounds) {
+                intern(b.first.expr);
+                intern(b.second.expr);
+            }
+            edges.emplace_back(std::move(e));
+        }
     }
 
     // Initialize the memory layouts for the bounds structs
@@ -983,7 +1044,8 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const MachineParams &p
 }
 
 void FunctionDAG::featurize() {
-    for (Node &node : nodes) {
+    parallel_for_each(nodes.size(), [&](size_t i) {
+        Node &node = nodes[i];
         for (size_t stage_idx = 0; stage_idx < node.stages.size(); stage_idx++) {
             Node::Stage &stage = node.stages[stage_idx];
 
@@ -1012,7 +1074,7 @@ void FunctionDAG::featurize() {
                 }
             }
         }
-    }
+    });
 }
 
 template<typename OS>
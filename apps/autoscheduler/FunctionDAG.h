@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <map>
+#include <mutex>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -297,9 +298,13 @@ struct BoundContents {
     // We're frequently going to need to make these concrete bounds
     // arrays.  It makes things more efficient if we figure out the
     // memory layout of those data structures once ahead of time, and
-    // make each individual instance just use that. Note that this is
-    // not thread-safe.
+    // make each individual instance just use that. Making and
+    // releasing objects is thread-safe, so that states can be
+    // expanded in parallel.
     class Layout {
+        // Guards the pool, the blocks, and the live count
+        mutable std::mutex mutex;
+
         // A memory pool of free BoundContent objects with this layout
         mutable std::vector<BoundContents *> pool;
 
@@ -559,6 +564,11 @@ private:
     void dump_internal(OS &os) const;
 };
 
+// The number of threads the autoscheduler may use, both to analyze
+// the pipeline and to search for a schedule: one per core, unless
+// HL_AUTOSCHEDULE_NUM_THREADS says otherwise.
+int autoschedule_num_threads();
+
 }  // namespace Autoscheduler
 }  // namespace Internal
 }  // namespace Halide
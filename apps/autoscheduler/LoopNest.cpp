@@ -1,4 +1,5 @@
 #include "LoopNest.h"
+#include "CostCache.h"
 
 using std::set;
 using std::vector;
@@ -112,7 +113,7 @@ void LoopNest::copy_from(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
+    copy_bounds_from(n);
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -176,6 +177,82 @@ void LoopNest::structural_hash(uint64_t &h, int depth) const {
     }
 }
 
+void LoopNest::exact_hash(uint64_t &h) const {
+    hash_combine(h, node ? node->id : -1);
+    hash_combine(h, stage ? stage->index : -1);
+    for (int64_t s : size) {
+        hash_combine(h, s);
+    }
+    hash_combine(h, innermost);
+    hash_combine(h, tileable);
+    hash_combine(h, parallel);
+    hash_combine(h, vector_dim);
+    hash_combine(h, vectorized_loop_index);
+
+    // store_at is ordered by pointer, so combine it in an
+    // order-independent way. Do the same for inlined for good
+    // measure.
+    uint64_t stored = 0;
+    for (const auto *n : store_at) {
+        uint64_t e = 0;
+        hash_combine(e, n->id);
+        stored += e;
+    }
+    hash_combine(h, stored);
+
+    uint64_t inlined_here = 0;
+    for (auto it = inlined.begin(); it != inlined.end(); it++) {
+        uint64_t e = 0;
+        hash_combine(e, it.key()->id);
+        hash_combine(e, it.value());
+        inlined_here += e;
+    }
+    hash_combine(h, inlined_here);
+
+    hash_combine(h, children.size());
+    for (const auto &c : children) {
+        c->exact_hash(h);
+    }
+}
+
+void LoopNest::placement_hash(const FunctionDAG::Node *f, uint64_t &h, uint64_t path) const {
+    if (!is_root()) {
+        const string &name = node->func.name();
+        hash_combine(path, stable_hash(name.data(), name.size()));
+        hash_combine(path, stage->index);
+        for (int64_t s : size) {
+            hash_combine(path, s);
+        }
+    }
+
+    if (node == f) {
+        // One of f's own loops. Anything else inside it belongs to
+        // f's producers.
+        hash_combine(h, path);
+        hash_combine(h, innermost);
+        hash_combine(h, parallel);
+        hash_combine(h, vector_dim);
+        hash_combine(h, vectorized_loop_index);
+        for (const auto &c : children) {
+            if (c->node == f) {
+                c->placement_hash(f, h, path);
+            }
+        }
+        return;
+    }
+
+    if (store_at.count(f)) {
+        hash_combine(h, path);
+    }
+    if (inlined.contains(f)) {
+        hash_combine(h, path);
+        hash_combine(h, inlined.get(f));
+    }
+    for (const auto &c : children) {
+        c->placement_hash(f, h, path);
+    }
+}
+
 // Compute all the sites of interest for each pipeline stage
 void LoopNest::get_sites(StageMap<Sites> &sites,
                          const LoopNest *task,
@@ -935,12 +1012,15 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 // Get the region required of a Func at this site, from which we
 // know what region would be computed if it were scheduled here,
 // and what its loop nest would be.
-const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
-    if (bounds.contains(f)) {
-        const Bound &b = bounds.get(f);
-        // Expensive validation for debugging
-        // b->validate();
-        return b;
+Bound LoopNest::get_bounds(const FunctionDAG::Node *f) const {
+    {
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        if (bounds.contains(f)) {
+            const Bound &b = bounds.get(f);
+            // Expensive validation for debugging
+            // b->validate();
+            return b;
+        }
     }
     auto bound = f->make_bound();
 
@@ -992,7 +1072,7 @@ const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
         f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
     }
 
-    const Bound &b = set_bounds(f, bound);
+    Bound b = set_bounds(f, bound);
     // Validation is expensive, turn if off by default.
     // b->validate();
     return b;
@@ -1270,7 +1350,7 @@ IntrusivePtr<const LoopNest> LoopNest::parallelize_in_tiles(const MachineParams
     inner->innermost = innermost;
     inner->children = children;
     inner->inlined = inlined;
-    inner->bounds = bounds;
+    inner->copy_bounds_from(*this);
     inner->store_at = store_at;
 
     auto b = inner->get_bounds(node)->make_copy();
@@ -1434,7 +1514,7 @@ vector<IntrusivePtr<const LoopNest>> LoopNest::compute_in_tiles(const FunctionDA
             inner->innermost = innermost;
             inner->children = children;
             inner->inlined = inlined;
-            inner->bounds = bounds;
+            inner->copy_bounds_from(*this);
             inner->store_at = store_at;
 
             {
@@ -8,6 +8,7 @@
 
 #include "FunctionDAG.h"
 #include "PerfectHashMap.h"
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -50,8 +51,12 @@ struct LoopNest {
 
     // The total bounds required of any given Func over all iterations
     // of this loop. In the paper, this is represented using the
-    // little boxes to the left of the loop nest tree figures.
+    // little boxes to the left of the loop nest tree figures. This
+    // is filled in lazily, and loop nests are shared between states
+    // that may be expanded concurrently, so it's guarded by
+    // bounds_mutex.
     mutable NodeMap<Bound> bounds;
+    mutable std::mutex bounds_mutex;
 
     // The Func this loop nest belongs to
     const FunctionDAG::Node *node = nullptr;
@@ -86,6 +91,18 @@ struct LoopNest {
     // the paper.
     void structural_hash(uint64_t &h, int depth) const;
 
+    // Hash everything about the loop nest that affects its
+    // featurization. Unlike the structural hash, this is stable
+    // across runs, so it can be used to key the persistent cost
+    // cache.
+    void exact_hash(uint64_t &h) const;
+
+    // Hash where a Func is realized or inlined and the shape of its
+    // own loops, identifying the Funcs involved by name rather than
+    // by id. Used to recognize the same scheduling decision across
+    // runs on edited versions of a pipeline.
+    void placement_hash(const FunctionDAG::Node *f, uint64_t &h, uint64_t path = 0) const;
+
     // How many funcs are scheduled inside this loop level. Used in
     // the structural hash.
     size_t funcs_realized_or_inlined() const {
@@ -140,15 +157,29 @@ struct LoopNest {
         return node == nullptr;
     }
 
-    // Set the region required of a Func at this site.
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
-        return bounds.emplace(f, b);
+    // Set the region required of a Func at this site. If another
+    // thread got there first, keeps and returns its (identical)
+    // value instead.
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        Bound bound(b);
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        if (bounds.contains(f)) {
+            return bounds.get(f);
+        }
+        return bounds.emplace(f, std::move(bound));
+    }
+
+    // Copy all the bounds known at another site to this one.
+    void copy_bounds_from(const LoopNest &n) {
+        std::lock_guard<std::mutex> lock(n.bounds_mutex);
+        bounds = n.bounds;
     }
 
     // Get the region required of a Func at this site, from which we
     // know what region would be computed if it were scheduled here,
-    // and what its loop nest would be.
-    const Bound &get_bounds(const FunctionDAG::Node *f) const;
+    // and what its loop nest would be. Returned by value, as the
+    // cache may be modified concurrently by other threads.
+    Bound get_bounds(const FunctionDAG::Node *f) const;
 
     // Recursively print a loop nest representation to stderr
     void dump(string prefix, const LoopNest *parent) const;
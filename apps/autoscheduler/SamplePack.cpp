@@ -0,0 +1,168 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "SamplePack.h"
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+constexpr uint32_t kSignature = 0x68737031;
+constexpr uint32_t kVersion = 1;
+
+/*
+    Structure of the .samplepack file format:
+
+    uint32 signature                    always 0x68737031 ('hsp1')
+    uint32 version                      currently 1
+    uint64 sample-count
+        uint32 float-count
+        uint32 filename-length
+            char x(filename-length)     the .sample file the sample came from
+            zero padding to a multiple of 4 bytes
+            float32x(float-count)       the contents of the .sample file
+
+    (all values little-endian)
+
+    The padding keeps the samples aligned, so they can be used in
+    place when the file is memory-mapped.
+*/
+
+namespace {
+
+bool ends_with(const std::string &str, const std::string &suffix) {
+    if (str.size() < suffix.size()) return false;
+    size_t off = str.size() - suffix.size();
+    for (size_t i = 0; i < suffix.size(); i++) {
+        if (str[off + i] != suffix[i]) return false;
+    }
+    return true;
+}
+
+size_t align4(size_t n) {
+    return (n + 3) & ~(size_t)3;
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &filename) {
+    std::ifstream f(filename, std::ios::binary);
+    if (!f) return;
+    storage.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    if (f.bad()) return;
+    // Make sure data() is non-null even for empty files.
+    storage.reserve(1);
+    contents = storage.data();
+    length = storage.size();
+}
+
+MappedFile::~MappedFile() {
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat s;
+    if (fstat(fd, &s) == 0) {
+        if (s.st_size == 0) {
+            static const char empty = 0;
+            contents = &empty;
+        } else {
+            void *p = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                contents = (const char *)p;
+                length = s.st_size;
+            }
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (length) {
+        munmap((void *)contents, length);
+    }
+}
+
+#endif
+
+bool get_sample_views(const MappedFile &file, const std::string &filename,
+                      std::vector<SampleView> *views) {
+    if (!ends_with(filename, ".samplepack")) {
+        views->push_back({(const float *)file.data(), file.size() / sizeof(float), filename});
+        return true;
+    }
+
+    const char *p = file.data(), *end = file.data() + file.size();
+    auto read_u32 = [&](uint32_t *v) {
+        if (end - p < 4) return false;
+        memcpy(v, p, 4);
+        p += 4;
+        return true;
+    };
+
+    uint32_t signature, version, count_lo, count_hi;
+    if (!read_u32(&signature) || signature != kSignature ||
+        !read_u32(&version) || version != kVersion ||
+        !read_u32(&count_lo) || !read_u32(&count_hi)) {
+        return false;
+    }
+    uint64_t count = ((uint64_t)count_hi << 32) | count_lo;
+
+    for (uint64_t i = 0; i < count; i++) {
+        uint32_t num_floats, name_len;
+        if (!read_u32(&num_floats) || !read_u32(&name_len) ||
+            (size_t)(end - p) < align4(name_len) + (size_t)num_floats * sizeof(float)) {
+            return false;
+        }
+        std::string name(p, name_len);
+        p += align4(name_len);
+        views->push_back({(const float *)p, num_floats, name});
+        p += (size_t)num_floats * sizeof(float);
+    }
+    return true;
+}
+
+bool write_sample_pack(const std::string &filename, const std::vector<std::string> &sample_files) {
+    std::ofstream o(filename, std::ios_base::trunc | std::ios_base::binary);
+    if (o.fail()) return false;
+
+    const uint64_t count = sample_files.size();
+    const uint32_t header[] = {kSignature, kVersion, (uint32_t)count, (uint32_t)(count >> 32)};
+    o.write((const char *)header, sizeof(header));
+
+    const char padding[4] = {0, 0, 0, 0};
+    for (const std::string &s : sample_files) {
+        MappedFile f(s);
+        if (!f.valid()) {
+            std::cerr << "Unable to read sample: " << s << "\n";
+            return false;
+        }
+        const uint32_t lengths[] = {(uint32_t)(f.size() / sizeof(float)), (uint32_t)s.size()};
+        o.write((const char *)lengths, sizeof(lengths));
+        o.write(s.data(), s.size());
+        o.write(padding, align4(s.size()) - s.size());
+        o.write(f.data(), lengths[0] * sizeof(float));
+    }
+
+    o.close();
+    return !o.fail();
+}
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
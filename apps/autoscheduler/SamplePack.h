@@ -0,0 +1,65 @@
+#ifndef SAMPLE_PACK_H
+#define SAMPLE_PACK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reading training samples without copying them, from either
+// individual .sample files or .samplepack files that hold many
+// samples each.
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+// The read-only contents of a file, memory-mapped where the platform
+// allows it.
+class MappedFile {
+    const char *contents = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> storage;
+#endif
+
+public:
+    explicit MappedFile(const std::string &filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool valid() const {
+        return contents != nullptr;
+    }
+
+    const char *data() const {
+        return contents;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+// A single sample within a mapped file.
+struct SampleView {
+    const float *data;
+    size_t num_floats;
+    std::string filename;
+};
+
+// Append the samples in a mapped .sample or .samplepack file to
+// views. The views are only valid for as long as the file stays
+// mapped. Returns false if a .samplepack file is malformed.
+bool get_sample_views(const MappedFile &file, const std::string &filename,
+                      std::vector<SampleView> *views);
+
+// Pack the given .sample files into a single .samplepack file.
+bool write_sample_pack(const std::string &filename, const std::vector<std::string> &sample_files);
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // SAMPLE_PACK_H
@@ -0,0 +1,729 @@
+// An autotuning driver for the Adams2019 autoscheduler. It does the job
+// of autotune_loop.sh without the shell: each batch compiles a set of
+// randomized schedules for a generator in parallel, benchmarks them
+// (concurrently, if asked, with each benchmark pinned to its own
+// disjoint set of cores), adds the results straight to the training set
+// held in memory, and retrains the cost model in-process. Progress is
+// checkpointed in the samples directory, so an interrupted run picks up
+// where it left off when rerun with the same arguments.
+//
+// Linux and OS X only.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "cmdline.h"
+
+#include "CostModelTraining.h"
+#include "DefaultCostModel.h"
+#include "Halide.h"
+
+extern char **environ;
+
+namespace {
+
+using namespace Halide;
+using namespace Halide::Internal::Autoscheduler;
+
+using std::string;
+using std::vector;
+
+struct Flags {
+    string generator;
+    string pipeline;
+    string target;
+    string initial_weights_path;
+    string autoschedule_bin;
+    string halide_distrib;
+    string samples_dir;
+    vector<vector<string>> generator_args_sets;
+    int batches = 1;
+    int batch_size = 32;
+    int compile_jobs = 0;
+    int benchmark_cores = 0;
+    int compile_timeout = 600;
+    int benchmark_timeout = 60;
+    int epochs = 0;
+    vector<float> rates = {0.0001f};
+
+    Flags(int argc, char **argv) {
+        cmdline::parser a;
+
+        const char *kNoDesc = "";
+
+        constexpr bool kOptional = false;
+        a.add<string>("generator", '\0', "path to the generator binary");
+        a.add<string>("pipeline", '\0', "name of the generator to autotune");
+        a.add<string>("target", '\0', "target to tune for (defaults to the host, without AVX-512)", kOptional, "");
+        a.add<string>("initial_weights", '\0', "weights to start from (random if not given)", kOptional, "");
+        a.add<string>("autoschedule_bin", '\0', "directory containing libauto_schedule.so");
+        a.add<string>("halide_distrib", '\0', "path to a Halide distribution");
+        a.add<string>("samples", '\0', "directory to write samples, weights, and checkpoints to");
+        a.add<string>("generator_args", '\0', "space-separated sets of ;-separated generator args", kOptional, "");
+        a.add<int>("batches", '\0', "number of batches to complete", kOptional, 1);
+        a.add<int>("batch_size", '\0', kNoDesc, kOptional, 32);
+        a.add<int>("compile_jobs", '\0', "samples to compile at once (defaults to the number of cores)", kOptional, 0);
+        a.add<int>("benchmark_cores", '\0', "cores per benchmark (defaults to all of them)", kOptional, 0);
+        a.add<int>("compile_timeout", '\0', "in seconds", kOptional, 600);
+        a.add<int>("benchmark_timeout", '\0', "in seconds", kOptional, 60);
+        a.add<int>("epochs", '\0', "training epochs per batch (defaults to the batch size)", kOptional, 0);
+        a.add<string>("rates", '\0', kNoDesc, kOptional, "0.0001");
+
+        a.parse_check(argc, argv);  // exits if parsing fails
+
+        generator = a.get<string>("generator");
+        pipeline = a.get<string>("pipeline");
+        target = a.get<string>("target");
+        initial_weights_path = a.get<string>("initial_weights");
+        autoschedule_bin = a.get<string>("autoschedule_bin");
+        halide_distrib = a.get<string>("halide_distrib");
+        samples_dir = a.get<string>("samples");
+        batches = a.get<int>("batches");
+        batch_size = a.get<int>("batch_size");
+        compile_jobs = a.get<int>("compile_jobs");
+        benchmark_cores = a.get<int>("benchmark_cores");
+        compile_timeout = a.get<int>("compile_timeout");
+        benchmark_timeout = a.get<int>("benchmark_timeout");
+        epochs = a.get<int>("epochs");
+        rates = split_floats(a.get<string>("rates"));
+
+        // Each set is delimited by space; multiple values within each set are
+        // are delimited with ; e.g. "set1arg1=1;set1arg2=foo set2=bar"
+        for (const string &set : split(a.get<string>("generator_args"), ' ')) {
+            generator_args_sets.push_back(split(set, ';'));
+        }
+        if (generator_args_sets.empty()) {
+            generator_args_sets.emplace_back();
+        }
+
+        if (batch_size <= 0) {
+            std::cerr << "--batch_size must be > 0.\n";
+            std::cerr << a.usage();
+            exit(1);
+        }
+        if (epochs <= 0) {
+            epochs = batch_size;
+        }
+        if (rates.empty()) {
+            std::cerr << "--rates cannot be empty.\n";
+            std::cerr << a.usage();
+            exit(1);
+        }
+    }
+
+    static vector<string> split(const string &s, char delim) {
+        vector<string> result;
+        std::istringstream in(s);
+        string item;
+        while (std::getline(in, item, delim)) {
+            if (!item.empty()) {
+                result.push_back(item);
+            }
+        }
+        return result;
+    }
+
+    static vector<float> split_floats(const string &s) {
+        vector<float> result;
+        for (const string &f : split(s, ' ')) {
+            result.push_back(std::atof(f.c_str()));
+        }
+        return result;
+    }
+};
+
+bool file_exists(const string &path) {
+    struct stat s;
+    return stat(path.c_str(), &s) == 0;
+}
+
+bool make_dir(const string &path) {
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// Write a file such that a reader never sees it half-written, even if
+// we are killed partway through.
+bool write_file_atomically(const string &path, const char *data, size_t size) {
+    string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(data, size);
+        f.close();
+        if (f.fail()) {
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+bool read_file(const string &path, vector<char> *data) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        return false;
+    }
+    data->assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return !f.bad();
+}
+
+bool copy_file(const string &src, const string &dst) {
+    vector<char> data;
+    return read_file(src, &data) && write_file_atomically(dst, data.data(), data.size());
+}
+
+// Recursively find all the .sample files under a directory.
+void find_samples(const string &dir, vector<string> *result) {
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        return;
+    }
+    while (struct dirent *e = readdir(d)) {
+        string name = e->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        string path = dir + "/" + name;
+        struct stat s;
+        if (stat(path.c_str(), &s) != 0) {
+            continue;
+        }
+        if (S_ISDIR(s.st_mode)) {
+            find_samples(path, result);
+        } else if (name.size() > 7 && name.substr(name.size() - 7) == ".sample") {
+            result->push_back(path);
+        }
+    }
+    closedir(d);
+}
+
+// A child process to run.
+struct Process {
+    vector<string> args;
+    // Extra environment variables, as NAME=value. These take
+    // precedence over the ones we inherit.
+    vector<string> env;
+    // Where to redirect stdout and stderr to, if anywhere.
+    string stdout_path, stderr_path;
+    // The cores the process may run on. Empty means any of them.
+    vector<int> cores;
+    // In seconds. Zero means no timeout.
+    int timeout = 0;
+};
+
+// Run a process to completion, killing it if it runs over its
+// timeout. Returns true if it exited cleanly with a status of zero.
+bool run_process(const Process &p) {
+    // Build everything the child needs before forking, so that it
+    // doesn't need to allocate.
+    vector<string> env = p.env;
+    for (char **e = environ; *e; e++) {
+        const char *eq = strchr(*e, '=');
+        size_t name_len = eq ? (size_t)(eq - *e) + 1 : strlen(*e);
+        bool overridden = false;
+        for (const string &o : p.env) {
+            overridden |= o.compare(0, name_len, *e, name_len) == 0;
+        }
+        if (!overridden) {
+            env.emplace_back(*e);
+        }
+    }
+    vector<char *> argv, envp;
+    for (const string &s : p.args) {
+        argv.push_back(const_cast<char *>(s.c_str()));
+    }
+    argv.push_back(nullptr);
+    for (const string &s : env) {
+        envp.push_back(const_cast<char *>(s.c_str()));
+    }
+    envp.push_back(nullptr);
+
+#ifdef __linux__
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    for (int c : p.cores) {
+        CPU_SET(c, &cores);
+    }
+#endif
+
+    // Opened with O_CLOEXEC so that processes spawned concurrently
+    // from other threads don't inherit them.
+    int out_fd = -1, err_fd = -1;
+    if (!p.stdout_path.empty()) {
+        out_fd = open(p.stdout_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (!p.stderr_path.empty()) {
+        err_fd = open(p.stderr_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Put the child in its own process group, so that on timeout
+        // we can kill anything it has spawned too.
+        setpgid(0, 0);
+        if (out_fd >= 0) {
+            dup2(out_fd, STDOUT_FILENO);
+        }
+        if (err_fd >= 0) {
+            dup2(err_fd, STDERR_FILENO);
+        }
+#ifdef __linux__
+        if (!p.cores.empty()) {
+            sched_setaffinity(0, sizeof(cores), &cores);
+        }
+#endif
+        environ = envp.data();
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    if (out_fd >= 0) {
+        close(out_fd);
+    }
+    if (err_fd >= 0) {
+        close(err_fd);
+    }
+    if (pid < 0) {
+        std::cerr << "Unable to fork to run " << p.args[0] << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    setpgid(pid, pid);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(p.timeout);
+    int status = 0;
+    while (true) {
+        pid_t r = waitpid(pid, &status, WNOHANG);
+        if (r == pid) {
+            break;
+        } else if (r < 0 && errno != EINTR) {
+            return false;
+        }
+        if (p.timeout > 0 && std::chrono::steady_clock::now() > deadline) {
+            kill(-pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// The sets of cores to run benchmarks on. Each is disjoint from the
+// others, so that concurrent benchmarks don't fight over cores.
+vector<vector<int>> benchmark_core_sets(int cores_per_set) {
+    vector<int> cores;
+#ifdef __linux__
+    // Respect any affinity mask we were launched with (e.g. by taskset).
+    cpu_set_t mask;
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &mask)) {
+                cores.push_back(c);
+            }
+        }
+    }
+#endif
+    if (cores.empty()) {
+        for (int c = 0; c < (int)std::max(1u, std::thread::hardware_concurrency()); c++) {
+            cores.push_back(c);
+        }
+    }
+
+    if (cores_per_set <= 0 || cores_per_set > (int)cores.size()) {
+        cores_per_set = (int)cores.size();
+    }
+
+    vector<vector<int>> sets;
+    for (size_t i = 0; i + cores_per_set <= cores.size(); i += cores_per_set) {
+        sets.emplace_back(cores.begin() + i, cores.begin() + i + cores_per_set);
+    }
+#ifndef __linux__
+    // We can't pin processes to cores, so don't run benchmarks concurrently.
+    sets.resize(1);
+#endif
+    return sets;
+}
+
+// Where we are in the run. Stored in the samples directory.
+struct Checkpoint {
+    int batch_id = 1;
+    int args_idx = 0;
+
+    bool load(const string &path) {
+        std::ifstream f(path);
+        return (bool)(f >> batch_id >> args_idx);
+    }
+
+    bool save(const string &path) const {
+        std::ostringstream o;
+        o << batch_id << " " << args_idx << "\n";
+        string s = o.str();
+        return write_file_atomically(path, s.data(), s.size());
+    }
+};
+
+class Autotuner {
+    const Flags &flags;
+    string target;
+    string weights_path, cost_cache_dir, rungen_obj;
+    vector<vector<int>> core_sets;
+
+    std::mutex samples_mutex;
+    SampleSet samples;
+    SampleStats stats;
+    vector<std::unique_ptr<DefaultCostModel>> models;
+
+    struct Job {
+        string dir, fname;
+        int pipeline_id;
+        int schedule_id;
+        vector<string> generator_args;
+        string weights_path;
+
+        string path(const string &suffix) const {
+            return dir + "/" + fname + suffix;
+        }
+    };
+
+    // Mark a sample as failed, so that resuming doesn't retry it.
+    void mark_failed(const Job &job, const string &why) {
+        std::cout << why << " for " << job.dir << "\n";
+        string failed = job.dir + "/failed";
+        std::ofstream(failed) << why << "\n";
+    }
+
+    bool is_failed(const Job &job) const {
+        return file_exists(job.dir + "/failed");
+    }
+
+    // Build a featurization of the pipeline with a random schedule, and a
+    // binary to benchmark it with.
+    //
+    // Each sample runs the generator in its own child process. Halide
+    // itself can compile distinct Pipelines on several threads at once
+    // (it's only a single Pipeline that mustn't be compiled
+    // concurrently). The Adams2019 autoscheduler, however, takes the
+    // settings for each search (HL_SEED, HL_BEAM_SIZE, and so on) from
+    // the process environment and keeps some search state in globals.
+    // A process can also be killed when it overruns its timeout, which
+    // a thread can't.
+    void compile(const Job &job) {
+        if (is_failed(job) || file_exists(job.dir + "/bench")) {
+            return;
+        }
+        make_dir(job.dir);
+
+        Process gen;
+        gen.args = {flags.generator,
+                    "-g", flags.pipeline,
+                    "-f", job.fname,
+                    "-o", job.dir,
+                    "-e", "stmt,assembly,static_library,c_header,registration,schedule,featurization",
+                    "target=" + target,
+                    "auto_schedule=true"};
+        gen.args.insert(gen.args.end(), job.generator_args.begin(), job.generator_args.end());
+        gen.args.insert(gen.args.end(), {"-p", flags.autoschedule_bin + "/libauto_schedule.so", "-s", "Adams2019"});
+
+        // Sample 0 in each batch is best effort beam search, with no
+        // randomness. The other samples are random probes biased by
+        // the cost model.
+        bool greedy = job.schedule_id % 10000 == 0;
+        const int parallelism = (int)core_sets[0].size();
+        gen.env = {"HL_SEED=" + std::to_string(job.schedule_id),
+                   "HL_WEIGHTS_DIR=" + job.weights_path,
+                   "HL_COST_CACHE_DIR=" + cost_cache_dir,
+                   string("HL_RANDOM_DROPOUT=") + (greedy ? "100" : "1"),
+                   string("HL_BEAM_SIZE=") + (greedy ? "32" : "1"),
+                   "HL_MACHINE_PARAMS=" + std::to_string(parallelism) + ",24000000,40",
+                   // We're already compiling many samples at once
+                   "HL_AUTOSCHEDULE_NUM_THREADS=1"};
+        gen.stderr_path = job.dir + "/compile_log.txt";
+        gen.timeout = flags.compile_timeout;
+        if (!run_process(gen)) {
+            mark_failed(job, "Compilation failed or timed out");
+            return;
+        }
+
+        // We don't need image I/O for this purpose, so RunGenMain was
+        // built without libpng and libjpeg.
+        Process link;
+        link.args = {cxx(), "-std=c++11",
+                     "-I", flags.halide_distrib + "/include",
+                     rungen_obj,
+                     job.path(".registration.cpp"),
+                     job.path(".a"),
+                     "-o", job.dir + "/bench.tmp",
+                     "-ldl", "-lpthread"};
+        link.stderr_path = job.dir + "/link_log.txt";
+        link.timeout = flags.compile_timeout;
+        if (!run_process(link) ||
+            std::rename((job.dir + "/bench.tmp").c_str(), (job.dir + "/bench").c_str()) != 0) {
+            mark_failed(job, "Linking the benchmark failed");
+        }
+    }
+
+    // Benchmark one of the random samples on the given cores, and add
+    // the result to the training set.
+    void benchmark(const Job &job, const vector<int> &cores) {
+        if (is_failed(job) || file_exists(job.path(".sample")) || !file_exists(job.dir + "/bench")) {
+            return;
+        }
+
+        // Give CPU clocks a chance to spin back up if we're thermally throttling
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        Process bench;
+        bench.args = {job.dir + "/bench", "--estimate_all", "--benchmarks=all"};
+        bench.env = {"HL_NUM_THREADS=" + std::to_string(cores.size())};
+        bench.stdout_path = job.dir + "/bench.txt";
+        bench.cores = cores;
+        bench.timeout = flags.benchmark_timeout;
+        if (!run_process(bench)) {
+            mark_failed(job, "Benchmarking failed or timed out");
+            return;
+        }
+
+        // Looks like: Benchmark for foo produces best case of 0.0123 sec/iter (over ...
+        double seconds = -1;
+        std::ifstream results(job.dir + "/bench.txt");
+        string line;
+        while (std::getline(results, line)) {
+            if (line.compare(0, 14, "Benchmark for ") == 0) {
+                size_t pos = line.find(" of ");
+                if (pos != string::npos) {
+                    seconds = std::atof(line.c_str() + pos + 4);
+                }
+            }
+        }
+        if (seconds <= 0) {
+            mark_failed(job, "Unable to parse the benchmark output");
+            return;
+        }
+
+        // A sample is the featurization, followed by the runtime in
+        // msec, the pipeline id, and the schedule id.
+        vector<char> data;
+        if (!read_file(job.path(".featurization"), &data)) {
+            mark_failed(job, "Unable to read the featurization");
+            return;
+        }
+        float runtime = (float)(seconds * 1000);
+        int32_t ids[] = {job.pipeline_id, job.schedule_id};
+        data.insert(data.end(), (const char *)&runtime, (const char *)&runtime + sizeof(runtime));
+        data.insert(data.end(), (const char *)ids, (const char *)ids + sizeof(ids));
+        if (!write_file_atomically(job.path(".sample"), data.data(), data.size())) {
+            mark_failed(job, "Unable to write the sample");
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(samples_mutex);
+        add_sample((const float *)data.data(), data.size() / sizeof(float), job.path(".sample"), &samples, &stats);
+    }
+
+    // Run f(item, worker index) over the items with the given number of threads.
+    template<typename T, typename F>
+    static void parallel_for_each(const vector<T> &items, int threads, F f) {
+        std::atomic<size_t> next(0);
+        vector<std::thread> workers;
+        for (int w = 0; w < threads; w++) {
+            workers.emplace_back([&, w]() {
+                for (size_t i = next++; i < items.size(); i = next++) {
+                    f(items[i], w);
+                }
+            });
+        }
+        for (auto &t : workers) {
+            t.join();
+        }
+    }
+
+    static string cxx() {
+        const char *c = getenv("CXX");
+        return (c && *c) ? c : "c++";
+    }
+
+public:
+    Autotuner(const Flags &flags)
+        : flags(flags) {
+    }
+
+    bool init() {
+        target = flags.target;
+        if (target.empty()) {
+            // Use the host target -- but remove features that we don't want to train
+            // for by default, at least not yet (most notably, AVX512).
+            target = get_host_target()
+                         .without_feature(Target::AVX512)
+                         .without_feature(Target::AVX512_KNL)
+                         .without_feature(Target::AVX512_Skylake)
+                         .without_feature(Target::AVX512_Cannonlake)
+                         .to_string();
+        }
+        std::cout << "Training target is: " << target << "\n";
+
+        core_sets = benchmark_core_sets(flags.benchmark_cores);
+        std::cout << "Benchmarking on " << core_sets.size() << " sets of " << core_sets[0].size() << " cores\n";
+
+        if (!make_dir(flags.samples_dir)) {
+            std::cerr << "Unable to create " << flags.samples_dir << "\n";
+            return false;
+        }
+        cost_cache_dir = flags.samples_dir + "/cost_cache";
+        make_dir(cost_cache_dir);
+
+        // The weights being trained live in the samples directory, so
+        // that a resumed run carries on from where the last one got to.
+        weights_path = flags.samples_dir + "/autotune.weights";
+        bool randomize = false;
+        if (!file_exists(weights_path)) {
+            if (flags.initial_weights_path.empty()) {
+                randomize = true;
+            } else if (!copy_file(flags.initial_weights_path, weights_path)) {
+                std::cerr << "Unable to copy " << flags.initial_weights_path << " to " << weights_path << "\n";
+                return false;
+            }
+        }
+        for (int i = 0; i < kModels; i++) {
+            models.emplace_back(make_default_cost_model(randomize ? "" : weights_path, weights_path, randomize));
+        }
+        if (randomize) {
+            models[0]->save_weights();
+        }
+
+        // Build the benchmarking harness once, rather than per sample.
+        rungen_obj = flags.samples_dir + "/RunGenMain.o";
+        if (!file_exists(rungen_obj)) {
+            Process p;
+            p.args = {cxx(), "-std=c++11", "-c",
+                      "-I", flags.halide_distrib + "/include",
+                      flags.halide_distrib + "/tools/RunGenMain.cpp",
+                      "-DHALIDE_NO_PNG", "-DHALIDE_NO_JPEG",
+                      "-o", rungen_obj + ".tmp"};
+            if (!run_process(p) ||
+                std::rename((rungen_obj + ".tmp").c_str(), rungen_obj.c_str()) != 0) {
+                std::cerr << "Unable to compile RunGenMain.cpp\n";
+                return false;
+            }
+        }
+
+        // Everything benchmarked so far is part of the training set.
+        vector<string> existing;
+        find_samples(flags.samples_dir, &existing);
+        samples = load_samples(existing, &stats);
+
+        return true;
+    }
+
+    void run() {
+        const string checkpoint_path = flags.samples_dir + "/autotune.checkpoint";
+        Checkpoint checkpoint;
+        if (checkpoint.load(checkpoint_path)) {
+            std::cout << "Resuming from batch " << checkpoint.batch_id << "\n";
+        }
+
+        const int num_sets = (int)flags.generator_args_sets.size();
+        int compile_jobs = flags.compile_jobs > 0 ? flags.compile_jobs : (int)std::max(1u, std::thread::hardware_concurrency());
+
+        for (int b = 0; b < flags.batches; b++) {
+            auto start = std::chrono::steady_clock::now();
+            const int batch_id = checkpoint.batch_id;
+
+            for (; checkpoint.args_idx < num_sets; checkpoint.args_idx++) {
+                // Record where we are before doing any work, so that
+                // a crash partway through a batch resumes it.
+                checkpoint.save(checkpoint_path);
+
+                const int args_idx = checkpoint.args_idx;
+                const string dir = flags.samples_dir + "/batch_" + std::to_string(batch_id) + "_" + std::to_string(args_idx);
+                make_dir(dir);
+
+                // Copy the weights being used into the batch folder so
+                // that we can repro failures. A resumed batch keeps
+                // using the weights it started with.
+                const string used_weights = dir + "/used.weights";
+                if (!file_exists(used_weights) && !copy_file(weights_path, used_weights)) {
+                    std::cerr << "Unable to copy weights to " << used_weights << "\n";
+                    return;
+                }
+
+                vector<Job> jobs;
+                for (int sample_id = 0; sample_id < flags.batch_size; sample_id++) {
+                    char fname[1024];
+                    snprintf(fname, sizeof(fname), "%s_batch_%04d_sample_%04d", flags.pipeline.c_str(), batch_id, sample_id);
+                    Job job;
+                    job.dir = dir + "/" + std::to_string(sample_id);
+                    job.fname = fname;
+                    job.pipeline_id = args_idx;
+                    job.schedule_id = batch_id * 10000 + sample_id;
+                    job.generator_args = flags.generator_args_sets[args_idx];
+                    job.weights_path = used_weights;
+                    jobs.push_back(job);
+                }
+
+                std::cout << "Compiling " << jobs.size() << " samples for batch_" << batch_id << "_" << args_idx << "\n";
+                parallel_for_each(jobs, compile_jobs, [&](const Job &job, int) {
+                    compile(job);
+                });
+
+                std::cout << "Benchmarking...\n";
+                parallel_for_each(jobs, (int)core_sets.size(), [&](const Job &job, int worker) {
+                    benchmark(job, core_sets[worker]);
+                });
+
+                // retrain model weights on all samples seen so far
+                std::cout << "Retraining model...\n";
+                TrainingParams params;
+                params.epochs = flags.epochs;
+                params.rates = flags.rates;
+                params.num_cores = (int)core_sets[0].size();
+                train_on_samples(samples, models, params);
+                if (stats.best_schedule_id >= 0) {
+                    report_best_sample(stats,
+                                       flags.samples_dir + "/best." + flags.pipeline + ".benchmark.txt",
+                                       flags.samples_dir + "/best." + flags.pipeline + ".schedule.h");
+                }
+            }
+
+            checkpoint.batch_id++;
+            checkpoint.args_idx = 0;
+            checkpoint.save(checkpoint_path);
+
+            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start);
+            std::cout << "Batch " << batch_id << " took " << elapsed.count() << " seconds to compile, benchmark, and retrain\n";
+        }
+    }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Flags flags(argc, argv);
+
+    Autotuner tuner(flags);
+    if (!tuner.init()) {
+        return 1;
+    }
+    tuner.run();
+
+    return 0;
+}
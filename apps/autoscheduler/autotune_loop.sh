@@ -1,3 +1,7 @@
+# See also autotune.cpp, which does the same thing in-process, with
+# parallel benchmarking on disjoint sets of cores, and can resume an
+# interrupted run.
+#
 # Build the generator to autotune. This script will be autotuning the
 # autoscheduler's cost model training pipeline, which is large enough
 # to be interesting.
@@ -63,6 +67,12 @@ else
     echo Copying starting weights from ${START_WEIGHTS_FILE} to ${WEIGHTS}
 fi
 
+# Costs computed by the autoscheduler are shared between the samples
+# in a batch. They are discarded automatically once retraining
+# changes the weights.
+COST_CACHE_DIR=${SAMPLES}/cost_cache
+mkdir -p ${COST_CACHE_DIR}
+
 # We could add this unconditionally, but it's easier to wade thru
 # results if we only add if needed
 for F in disable_llvm_loop_opt; do
@@ -105,6 +115,7 @@ make_featurization() {
     fi
     HL_SEED=${SEED} \
         HL_WEIGHTS_DIR=${WEIGHTS} \
+        HL_COST_CACHE_DIR=${COST_CACHE_DIR} \
         HL_RANDOM_DROPOUT=${dropout} \
         HL_BEAM_SIZE=${beam} \
         HL_MACHINE_PARAMS=32,24000000,40 \
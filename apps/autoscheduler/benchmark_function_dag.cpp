@@ -0,0 +1,90 @@
+#include "FunctionDAG.h"
+#include "Halide.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Halide;
+
+// Measures how long it takes to construct the FunctionDAG (the
+// autoscheduler's analysis of the pipeline, done once before the
+// search) for pipelines of increasing size, on one thread and on all
+// of them.
+
+namespace {
+
+void set_num_threads(const std::string &n) {
+#ifdef _WIN32
+    _putenv_s("HL_AUTOSCHEDULE_NUM_THREADS", n.c_str());
+#else
+    setenv("HL_AUTOSCHEDULE_NUM_THREADS", n.c_str(), 1);
+#endif
+}
+
+// A pipeline of num_stages stencils, each of which reads the two
+// before it, with a reduction every eighth stage.
+Func make_pipeline(int num_stages) {
+    Var x("x"), y("y");
+    ImageParam input(Float(32), 2, "input");
+    std::vector<Func> stages;
+    Func first("stage_0");
+    first(x, y) = input(x, y);
+    stages.push_back(first);
+    for (int i = 1; i < num_stages; i++) {
+        Func f("stage_" + std::to_string(i));
+        const Func &a = stages[i - 1];
+        const Func &b = stages[std::max(0, i - 2)];
+        if (i % 8 == 0) {
+            RDom r(-2, 5);
+            f(x, y) = a(x, y);
+            f(x, y) += b(x + r, y) * 0.2f;
+        } else {
+            f(x, y) = (a(x - 1, y) + a(x + 1, y)) * 0.25f + b(x, y - 1) * 0.5f;
+        }
+        stages.push_back(f);
+    }
+    Func out = stages.back();
+    out.set_estimate(x, 0, 1536).set_estimate(y, 0, 2560);
+    input.set_estimates({{0, 1600}, {0, 2600}});
+    return out;
+}
+
+double time_construction_ms(const Func &out, const MachineParams &params, const Target &target, int samples) {
+    std::vector<Internal::Function> outputs = {out.function()};
+    double best = 1e100;
+    for (int i = 0; i < samples; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        Internal::Autoscheduler::FunctionDAG dag(outputs, params, target);
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int max_stages = argc > 1 ? std::atoi(argv[1]) : 512;
+    const int samples = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    MachineParams params(32, 16000000, 40);
+    Target target("x86-64-linux-sse41-avx-avx2");
+
+    printf("%8s %14s %14s %8s\n", "stages", "1 thread (ms)", "all (ms)", "speedup");
+    for (int n = 8; n <= max_stages; n *= 2) {
+        Func out = make_pipeline(n);
+
+        set_num_threads("1");
+        double serial = time_construction_ms(out, params, target, samples);
+
+        set_num_threads(std::to_string(Internal::ThreadPool<void>::num_processors_online()));
+        double parallel = time_construction_ms(out, params, target, samples);
+
+        printf("%8d %14.2f %14.2f %7.2fx\n", n, serial, parallel, serial / parallel);
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+# Time the autoscheduler's beam search on some generators, first with
+# HL_AUTOSCHEDULE_NUM_THREADS=1 and then with more threads, and check
+# that every thread count produces the same schedule.
+#
+# Each generator is given as path:name, e.g. bin/demo.generator:demo.
+if [ $# -lt 5 ]; then
+  echo "Usage: $0 autoschedule_bin_dir halide_target \"thread_counts\" out_dir /path/to/some.generator:generatorname..."
+  exit
+fi
+
+set -eu
+
+AUTOSCHED_BIN=${1}
+HL_TARGET=${2}
+THREAD_COUNTS=${3}
+OUT_DIR=${4}
+shift 4
+
+AUTOSCHED_SRC=$(cd "$(dirname "$0")" && pwd)
+
+for GENERATOR_AND_NAME in "$@"; do
+    GENERATOR=${GENERATOR_AND_NAME%:*}
+    PIPELINE=${GENERATOR_AND_NAME##*:}
+    BASELINE=
+    for THREADS in ${THREAD_COUNTS}; do
+        D=${OUT_DIR}/${PIPELINE}/${THREADS}
+        mkdir -p ${D}
+        # A fixed seed, so that the searches are comparable.
+        START=$(date +%s%N)
+        HL_SEED=0 \
+        HL_AUTOSCHEDULE_NUM_THREADS=${THREADS} \
+        HL_WEIGHTS_DIR=${AUTOSCHED_SRC}/baseline.weights \
+            ${GENERATOR} -g ${PIPELINE} -o ${D} -f ${PIPELINE} -e schedule \
+            target=${HL_TARGET} auto_schedule=true \
+            -p ${AUTOSCHED_BIN}/libauto_schedule.so -s Adams2019 2> ${D}/stderr.txt
+        END=$(date +%s%N)
+        MS=$(( (END - START) / 1000000 ))
+        if [ -z "${BASELINE}" ]; then
+            BASELINE=${MS}
+        fi
+        awk "BEGIN { printf(\"%s: %d thread(s): %d ms, %.2fx speedup\\n\", \"${PIPELINE}\", ${THREADS}, ${MS}, ${BASELINE} / (${MS} > 0 ? ${MS} : 1)) }"
+        if ! cmp -s ${OUT_DIR}/${PIPELINE}/${THREADS}/${PIPELINE}.schedule.h \
+                    ${OUT_DIR}/${PIPELINE}/${THREAD_COUNTS%% *}/${PIPELINE}.schedule.h; then
+            echo "${PIPELINE}: the schedule found with ${THREADS} threads differs from that found with ${THREAD_COUNTS%% *}"
+            exit 1
+        fi
+    done
+done
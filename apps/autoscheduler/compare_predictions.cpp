@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Compares the per-stage predictions made by the autoscheduler (the
+// cost_predictions output of a Generator) against the per-Func times
+// reported by the Halide profiler (the report printed when the
+// pipeline is compiled with -profile), and lists the Funcs whose
+// predicted share of the runtime is furthest from their measured
+// share. These are the places where the cost model is most likely to
+// have misled the autoscheduler.
+
+namespace {
+
+struct Entry {
+    double predicted = 0, actual = 0;
+    bool in_profile = false;
+    std::string features;
+};
+
+// Parse the lines of a profiler report of the form
+//   "  func_name: 1.234ms   (12%) ..."
+// and add the times to the entries.
+bool parse_profile(std::istream &in, std::map<std::string, Entry> *entries) {
+    std::string line;
+    bool found = false;
+    while (std::getline(in, line)) {
+        if (line.size() < 3 || line[0] != ' ' || line[1] != ' ' || line[2] == ' ') continue;
+        size_t colon = line.find(": ");
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(2, colon - 2);
+        const char *start = line.c_str() + colon + 2;
+        char *end = nullptr;
+        double ms = strtod(start, &end);
+        if (end == start || end[0] != 'm' || end[1] != 's') continue;
+        auto &e = (*entries)[name];
+        e.actual += ms;
+        e.in_profile = true;
+        found = true;
+    }
+    return found;
+}
+
+// Parse a cost_predictions file, summing the stages of each Func.
+bool parse_predictions(std::istream &in, std::map<std::string, Entry> *entries) {
+    std::string line;
+    bool found = false;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream s(line);
+        std::string func, stage;
+        double predicted;
+        if (!(s >> func >> stage >> predicted)) {
+            std::cerr << "Malformed line in predictions: " << line << "\n";
+            return false;
+        }
+        auto &e = (*entries)[func];
+        e.predicted += predicted;
+        // Keep the features of the pure definition, which comes last.
+        std::getline(s, e.features);
+        found = true;
+    }
+    return found;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 3 && argc != 4) {
+        std::cout << "Usage: compare_predictions foo.cost_predictions profiler_report.txt [num_to_show]\n";
+        return -1;
+    }
+
+    std::map<std::string, Entry> entries;
+
+    std::ifstream predictions(argv[1]);
+    if (!predictions) {
+        std::cerr << "Unable to open input file: " << argv[1] << "\n";
+        return -1;
+    }
+    if (!parse_predictions(predictions, &entries)) {
+        std::cerr << "No predictions found in " << argv[1] << "\n";
+        return -1;
+    }
+
+    std::ifstream profile(argv[2]);
+    if (!profile) {
+        std::cerr << "Unable to open input file: " << argv[2] << "\n";
+        return -1;
+    }
+    if (!parse_profile(profile, &entries)) {
+        std::cerr << "No per-Func times found in " << argv[2] << "\n";
+        return -1;
+    }
+
+    const size_t num_to_show = argc == 4 ? (size_t)atoi(argv[3]) : 10;
+
+    // The model's units are only roughly milliseconds, so compare
+    // each Func's share of the total rather than absolute times. Only
+    // Funcs that were both predicted and measured take part; the rest
+    // were either inlined (so their time is attributed to their
+    // consumers) or are profiler bookkeeping.
+    double total_predicted = 0, total_actual = 0;
+    std::vector<std::string> matched, unmatched;
+    for (const auto &p : entries) {
+        if (p.second.in_profile && p.second.predicted > 0) {
+            matched.push_back(p.first);
+            total_predicted += p.second.predicted;
+            total_actual += p.second.actual;
+        } else if (!p.second.in_profile && p.second.predicted > 0) {
+            unmatched.push_back(p.first);
+        }
+    }
+    if (matched.empty() || total_predicted <= 0 || total_actual <= 0) {
+        std::cerr << "No Funcs appear in both the predictions and the profile\n";
+        return -1;
+    }
+
+    // How far off is the prediction, as a factor of two either way.
+    auto error = [&](const std::string &name) {
+        const auto &e = entries[name];
+        const double pred_share = e.predicted / total_predicted;
+        const double actual_share = std::max(e.actual, 1e-6) / total_actual;
+        return std::log2(pred_share / actual_share);
+    };
+
+    std::sort(matched.begin(), matched.end(), [&](const std::string &a, const std::string &b) {
+        return std::abs(error(a)) > std::abs(error(b));
+    });
+
+    std::cout << "Total predicted: " << total_predicted << " measured: " << total_actual << " ms\n\n";
+    printf("%-32s %12s %12s %10s %10s %8s\n", "func", "predicted", "measured_ms", "pred_%", "meas_%", "error");
+    for (size_t i = 0; i < matched.size() && i < num_to_show; i++) {
+        const auto &e = entries[matched[i]];
+        const double err = error(matched[i]);
+        printf("%-32s %12.4g %12.4g %9.1f%% %9.1f%% %7.2fx %s\n",
+               matched[i].c_str(), e.predicted, e.actual,
+               100 * e.predicted / total_predicted,
+               100 * e.actual / total_actual,
+               std::exp2(std::abs(err)),
+               err > 0 ? "over" : err < 0 ? "under" : "");
+        std::cout << "    features (inlined_calls num_realizations points_computed_total inner_parallelism working_set):"
+                  << e.features << "\n";
+    }
+
+    if (!unmatched.empty()) {
+        std::cout << "\nPredicted but not in the profile (probably inlined):\n";
+        for (const auto &name : unmatched) {
+            std::cout << "  " << name << " " << entries[name].predicted << "\n";
+        }
+    }
+
+    return 0;
+}
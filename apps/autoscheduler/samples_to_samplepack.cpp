@@ -0,0 +1,36 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "SamplePack.h"
+
+// Utility to pack many .sample files (read as a list of filenames on
+// stdin) into a single .samplepack file, which retrain_cost_model can
+// load much faster than the individual files.
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cout << "Usage: samples_to_samplepack out.samplepack < list_of_sample_files\n";
+        return -1;
+    }
+
+    std::vector<std::string> samples;
+    while (!std::cin.eof()) {
+        std::string s;
+        std::cin >> s;
+        if (!s.empty()) {
+            samples.push_back(s);
+        }
+    }
+
+    if (!Halide::Internal::Autoscheduler::write_sample_pack(argv[1], samples)) {
+        std::cerr << "Unable to save output file: " << argv[1] << "\n";
+        return -1;
+    }
+
+    std::cout << "Packed " << samples.size() << " samples into " << argv[1] << "\n";
+
+    return 0;
+}
@@ -1,5 +1,11 @@
 #include "Halide.h"
 
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
 using namespace Halide;
 
 int main(int argc, char **argv) {
@@ -478,5 +484,108 @@ int main(int argc, char **argv) {
         Pipeline(output).auto_schedule(target, params);
     }
 
+    if (1) {
+        // Reusing the decisions of a previous run on the same
+        // pipeline should reproduce its schedule while evaluating far
+        // fewer states, and reusing them after an edit should still
+        // produce a schedule.
+        auto make_pipeline = [&](int last_stencil_width) {
+            Func f("f"), g("g"), h("h");
+            f(x, y) = (x + y) * (x + 2 * y) * (x + 3 * y);
+            g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1);
+            Expr e = 0;
+            for (int i = -last_stencil_width; i <= last_stencil_width; i++) {
+                e += g(x + i, y);
+            }
+            h(x, y) = e;
+            h.set_estimate(x, 0, 2048).set_estimate(y, 0, 2048);
+            return Pipeline(h);
+        };
+
+        // The record of decisions at the end of the schedule starts
+        // with a line giving the number of states evaluated. Split
+        // that count out of the schedule.
+        auto states_evaluated = [](std::string &schedule) {
+            const std::string marker = "// --- BEGIN autoscheduler decisions (";
+            size_t start = schedule.find(marker);
+            size_t end = schedule.find('\n', start);
+            if (start == std::string::npos || end == std::string::npos) {
+                std::cerr << "No record of decisions in schedule:\n"
+                          << schedule << "\n";
+                exit(-1);
+            }
+            int count = atoi(schedule.c_str() + start + marker.size());
+            schedule.erase(start, end - start);
+            return count;
+        };
+
+        Internal::TemporaryFile previous("previous", ".schedule.h");
+        std::string first = make_pipeline(1).auto_schedule(target, params).schedule_source;
+        {
+            std::ofstream f(previous.pathname());
+            f << first;
+        }
+        int first_states = states_evaluated(first);
+
+#ifdef _WIN32
+        _putenv_s("HL_PREVIOUS_SCHEDULE", previous.pathname().c_str());
+#else
+        setenv("HL_PREVIOUS_SCHEDULE", previous.pathname().c_str(), 1);
+#endif
+        std::string second = make_pipeline(1).auto_schedule(target, params).schedule_source;
+        int second_states = states_evaluated(second);
+        if (second != first) {
+            std::cerr << "Reusing all the decisions of a previous run changed the schedule:\n"
+                      << first << "\n"
+                      << second << "\n";
+            return -1;
+        }
+        if (second_states <= 0 || second_states * 2 > first_states) {
+            std::cerr << "Reusing all the decisions of a previous run didn't prune the search: "
+                      << first_states << " states evaluated at first, "
+                      << second_states << " when reusing\n";
+            return -1;
+        }
+        make_pipeline(3).auto_schedule(target, params);
+#ifdef _WIN32
+        _putenv_s("HL_PREVIOUS_SCHEDULE", "");
+#else
+        unsetenv("HL_PREVIOUS_SCHEDULE");
+#endif
+    }
+
+    if (1) {
+        // The per-stage cost predictions should add up to the
+        // prediction for the whole schedule, including the output
+        // stage, which the cost model treats specially.
+        Func f("f"), g("g"), h("h");
+        f(x, y) = (x + y) * (x + 2 * y);
+        g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1);
+        h(x, y) = g(x, y) + g(x + 1, y + 1);
+        h.set_estimate(x, 0, 2048).set_estimate(y, 0, 2048);
+
+        std::istringstream predictions(Pipeline(h).auto_schedule(target, params).cost_predictions);
+        double sum = 0, total = -1;
+        int stages = 0;
+        std::string line;
+        while (std::getline(predictions, line)) {
+            std::istringstream in(line);
+            std::string func, stage;
+            double cost;
+            if (line.rfind("# total predicted_msec ", 0) == 0) {
+                total = std::atof(line.c_str() + 23);
+            } else if (!line.empty() && line[0] != '#' && in >> func >> stage >> cost) {
+                sum += cost;
+                stages++;
+            }
+        }
+        if (stages != 3 || total <= 0 || std::abs(sum - total) > 1e-4 * total) {
+            std::cerr << "Per-stage cost predictions (" << stages << " stages, sum " << sum
+                      << ") don't add up to the total prediction (" << total << "):\n"
+                      << predictions.str() << "\n";
+            return -1;
+        }
+    }
+
     return 0;
 }
@@ -0,0 +1,75 @@
+# Check that retrain_cost_model loads the same samples from a
+# .samplepack built by samples_to_samplepack as it does from the
+# .sample files that went into it.
+#
+# The generator is given as path:name, e.g. bin/demo.generator:demo.
+if [ $# -ne 4 ]; then
+  echo "Usage: $0 autoschedule_bin_dir halide_target out_dir /path/to/some.generator:generatorname"
+  exit
+fi
+
+set -eu
+
+AUTOSCHED_BIN=${1}
+HL_TARGET=${2}
+OUT_DIR=${3}
+GENERATOR=${4%:*}
+PIPELINE=${4##*:}
+
+AUTOSCHED_SRC=$(cd "$(dirname "$0")" && pwd)
+WEIGHTS=${AUTOSCHED_SRC}/baseline.weights
+NUM_SAMPLES=4
+
+rm -rf ${OUT_DIR}
+mkdir -p ${OUT_DIR}
+
+# Make a few samples from random probes of the schedule space, with
+# made-up runtimes.
+for ((S=1;S<=${NUM_SAMPLES};S++)); do
+    D=${OUT_DIR}/${S}
+    mkdir -p ${D}
+    HL_SEED=${S} \
+    HL_WEIGHTS_DIR=${WEIGHTS} \
+    HL_RANDOM_DROPOUT=1 \
+    HL_BEAM_SIZE=1 \
+        ${GENERATOR} -g ${PIPELINE} -o ${D} -f ${PIPELINE} -e schedule,featurization \
+        target=${HL_TARGET} auto_schedule=true \
+        -p ${AUTOSCHED_BIN}/libauto_schedule.so -s Adams2019 2> ${D}/stderr.txt
+    ${AUTOSCHED_BIN}/featurization_to_sample ${D}/${PIPELINE}.featurization 0.00${S} 0 ${S} ${D}/${PIPELINE}.sample
+done
+
+find ${OUT_DIR} -name "*.sample" | sort > ${OUT_DIR}/samples.txt
+${AUTOSCHED_BIN}/samples_to_samplepack ${OUT_DIR}/all.samplepack < ${OUT_DIR}/samples.txt
+
+# Retrain from each, keeping only what retrain_cost_model reports
+# about the samples it loaded; the training itself is randomly seeded.
+retrain() {
+    ${AUTOSCHED_BIN}/retrain_cost_model \
+        --epochs=1 \
+        --rates="0.0001" \
+        --num_cores=32 \
+        --initial_weights=${WEIGHTS} \
+        --weights_out=${OUT_DIR}/${1}.weights \
+        --best_benchmark=${OUT_DIR}/${1}.benchmark.txt | \
+        grep -E "^(Unique sample|Noise level|Distinct pipelines|Best runtime)" > ${OUT_DIR}/${1}.loaded.txt
+}
+
+retrain files < ${OUT_DIR}/samples.txt
+echo ${OUT_DIR}/all.samplepack | retrain pack
+
+# The fastest sample is the first one, at 1 msec.
+if ! grep -q "Best runtime is 1 msec, from schedule id 1 " ${OUT_DIR}/files.loaded.txt; then
+    echo "Expected the best sample to be schedule id 1:"
+    cat ${OUT_DIR}/files.loaded.txt
+    exit 1
+fi
+
+for F in loaded.txt benchmark.txt; do
+    if ! cmp -s ${OUT_DIR}/files.${F} ${OUT_DIR}/pack.${F}; then
+        echo "Loading ${OUT_DIR}/all.samplepack differs from loading the samples in it:"
+        diff ${OUT_DIR}/files.${F} ${OUT_DIR}/pack.${F} || true
+        exit 1
+    fi
+done
+
+echo "Success!"
@@ -84,6 +84,23 @@ int natural_vector_size(const Target &target, const Type &t) {
     }
 }
 
+// The loops created by parallelize_vars_and_rvars that later scheduling
+// decisions refer to. Any of them may be empty.
+struct ParallelLoops {
+    // The innermost pure loop, which is vectorized.
+    std::string vectorized_var;
+    // The parallel loop over the pure vars.
+    std::string parallel_var;
+    // The serial loop just inside the parallel one, over the points of
+    // each parallel task.
+    std::string task_var;
+    // The number of points computed by each iteration of the parallel
+    // loop.
+    int points_per_task = 1;
+    // The RVars that were split, which can't be split again.
+    std::set<std::string> split_rvars;
+};
+
 template<typename FuncOrStage>
 void parallelize_vars_and_rvars_gpu(
     const MachineParams &params,
@@ -247,7 +264,7 @@ void parallelize_vars_and_rvars_gpu(
 }
 
 template<typename FuncOrStage>
-void parallelize_vars_and_rvars_cpu(
+ParallelLoops parallelize_vars_and_rvars_cpu(
     const MachineParams &params,
     FuncOrStage func_or_stage,
     int natural_vector_size,
@@ -297,6 +314,7 @@ void parallelize_vars_and_rvars_cpu(
     // Two cases: 1) not enough threads 2) no vectorized dimension
     std::vector<RVar> serial_rvars;
     std::vector<RVar> parallel_rvars;
+    std::set<std::string> split_rvars;
     std::string vectorized_rvar;
     int num_threads_rvar = 1;
     for (int i = 0; i < (int)rvars.size(); i++) {
@@ -324,6 +342,7 @@ void parallelize_vars_and_rvars_cpu(
             } else {
                 serial_rvars.push_back(outer);
             }
+            split_rvars.insert(rvars[i].name());
             vectorized_rvar = inner.name();
         } else {
             if (num_threads_var * num_threads_rvar < params.parallelism) {
@@ -402,16 +421,34 @@ void parallelize_vars_and_rvars_cpu(
         }
     }
 
+    ParallelLoops loops;
+    loops.vectorized_var = vectorized_var;
+    loops.parallel_var = fused_var;
+    loops.split_rvars = split_rvars;
+    if (!vectorized_var.empty()) {
+        loops.points_per_task = split_size;
+    }
     if (!fused_var.empty()) {
         // Parallelize vars
         if (num_threads_var > params.parallelism * 8) {
-            func_or_stage.parallel(Var(fused_var),
-                                   num_threads_var / (params.parallelism * 8),
-                                   tail);
-            schedule_source << "    .parallel("
+            // Equivalent to parallel(fused_var, factor), but with a name
+            // for the inner loop.
+            Var task;
+            func_or_stage.split(Var(fused_var),
+                                Var(fused_var),
+                                task,
+                                num_threads_var / (params.parallelism * 8),
+                                tail)
+                .parallel(Var(fused_var));
+            schedule_source << "    .split("
+                            << fused_var << ","
                             << fused_var << ","
+                            << task.name() << ","
                             << num_threads_var / (params.parallelism * 8) << ","
                             << tail << ")\n";
+            schedule_source << "    .parallel(" << fused_var << ")\n";
+            loops.task_var = task.name();
+            loops.points_per_task *= num_threads_var / (params.parallelism * 8);
         } else {
             func_or_stage.parallel(Var(fused_var));
             schedule_source << "    .parallel(" << fused_var << ")\n";
@@ -448,10 +485,11 @@ void parallelize_vars_and_rvars_cpu(
         schedule_source << "    .vectorize("
                         << vectorized_rvar << ")\n";
     }
+    return loops;
 }
 
 template<typename FuncOrStage>
-void parallelize_vars_and_rvars(
+ParallelLoops parallelize_vars_and_rvars(
     const MachineParams &params,
     FuncOrStage func_or_stage,
     int natural_vector_size,
@@ -464,7 +502,7 @@ void parallelize_vars_and_rvars(
     bool is_gpu,
     std::ostringstream &schedule_source) {
     if (is_gpu) {
-        return parallelize_vars_and_rvars_gpu(
+        parallelize_vars_and_rvars_gpu(
             params,
             func_or_stage,
             is_pure_def,
@@ -474,6 +512,7 @@ void parallelize_vars_and_rvars(
             rvar_bounds,
             tail,
             schedule_source);
+        return ParallelLoops();
     } else {
         return parallelize_vars_and_rvars_cpu(
             params,
@@ -489,18 +528,158 @@ void parallelize_vars_and_rvars(
     }
 }
 
-void apply_schedule(const MachineParams &params,
-                    const Target &target,
-                    Func func,
-                    int update_id,
-                    const std::vector<int> &var_bounds,
-                    bool is_gpu,
-                    std::ostringstream &schedule_source) {
+// Split the outermost RVar of a reduction so that one iteration of the
+// outer loop over all the points of a parallel task touches about one L2's
+// worth of data, assuming each point reads its own input for each point of
+// the reduction domain. Return the name of the outer loop, or an empty
+// string if the whole reduction already fits.
+std::string split_reduction_for_cache(const MachineParams &params,
+                                      Func func,
+                                      int update_id,
+                                      const std::vector<RVar> &rvars,
+                                      const std::vector<int> &rvar_bounds,
+                                      int points_per_task,
+                                      std::ostringstream &schedule_source) {
+    const int64_t cache_size = params.l2_cache_size > 0 ? params.l2_cache_size : 256 * 1024;
+    const int64_t bytes = func.values()[0].type().bytes();
+    int64_t inner_size = points_per_task;
+    for (int i = 0; i < (int)rvars.size() - 1; i++) {
+        inner_size *= rvar_bounds[i];
+    }
+    const int outer_bound = rvar_bounds.back();
+    if (inner_size * outer_bound * bytes <= cache_size) {
+        return "";
+    }
+    const int split_size = int(cache_size / (inner_size * bytes)) / 8 * 8;
+    if (split_size < 8 || split_size >= outer_bound) {
+        return "";
+    }
+    RVar outer, inner;
+    func.update(update_id)
+        .split(rvars.back(), outer, inner, split_size, TailStrategy::GuardWithIf);
+    schedule_source << "    .split("
+                    << rvars.back().name() << ","
+                    << outer.name() << ","
+                    << inner.name() << ","
+                    << split_size << ","
+                    << TailStrategy::GuardWithIf << ")\n";
+    return outer.name();
+}
+
+// Schedule a Func that is only used element-wise by the pure definition of
+// 'consumer' at the given loop of it. The consumer's loops are already
+// parallel, so this only vectorizes.
+void apply_fused_schedule(const Target &target,
+                          Func func,
+                          Func consumer,
+                          const std::string &loop,
+                          const std::vector<int> &var_bounds,
+                          std::ostringstream &schedule_source) {
+    // Use the loop of the consumer's pure definition even if the consumer
+    // has updates.
+    func.compute_at(LoopLevel(consumer, Var(loop), 0));
+    schedule_source << func.name() << ".compute_at(LoopLevel("
+                    << consumer.name() << ","
+                    << loop << ",0))\n";
+    const int vector_size = natural_vector_size(target, func.values()[0].type());
+    const bool vectorize = func.dimensions() > 0 && var_bounds[0] >= vector_size;
+    if (vectorize) {
+        func.vectorize(func.args()[0], vector_size);
+        schedule_source << "    .vectorize("
+                        << func.args()[0].name() << ","
+                        << vector_size << ")\n";
+    }
+    schedule_source << ";\n";
+    for (int update_id = 0; update_id < func.num_update_definitions(); update_id++) {
+        if (vectorize) {
+            func.update(update_id).vectorize(func.args()[0], vector_size);
+            schedule_source << func.name() << ".update(" << update_id << ")\n"
+                            << "    .vectorize("
+                            << func.args()[0].name() << ","
+                            << vector_size << ")\n"
+                            << ";\n";
+        }
+    }
+}
+
+// If 'f' is used by exactly one other Func, only by that Func's pure
+// definition, and only at the point being computed, return that Func's
+// name. 'f' must be element-wise too: its updates may only write to the
+// point being computed. Such a Func can be computed at any loop of the
+// consumer's pure definition without computing anything twice.
+std::string find_element_wise_consumer(const Function &f,
+                                       const std::map<std::string, Function> &env) {
+    if (f.has_extern_definition()) {
+        return "";
+    }
+    auto is_same_point = [](const std::vector<Expr> &args, const std::vector<std::string> &vars) {
+        if (args.size() != vars.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < args.size(); i++) {
+            const Variable *v = args[i].as<Variable>();
+            if (v == nullptr || v->name != vars[i]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (const Definition &def : f.updates()) {
+        if (!is_same_point(def.args(), f.args())) {
+            return "";
+        }
+    }
+
+    std::string consumer;
+    for (const auto &it : env) {
+        const Function &g = it.second;
+        if (g.name() == f.name()) {
+            continue;
+        }
+        if (g.has_extern_definition()) {
+            for (const ExternFuncArgument &arg : g.extern_arguments()) {
+                if (arg.is_func() && Function(arg.func).name() == f.name()) {
+                    return "";
+                }
+            }
+            continue;
+        }
+        int num_stages = g.updates().size() + 1;
+        for (int s = 0; s < num_stages; s++) {
+            FindAllCalls find;
+            get_stage_definition(g, s).accept(&find);
+            if (!find.funcs_called.count(f.name())) {
+                continue;
+            }
+            if (s != 0 || !consumer.empty()) {
+                return "";
+            }
+            consumer = g.name();
+            for (const auto &call : find.call_args) {
+                if (call.first == f.name() && !is_same_point(call.second, g.args())) {
+                    return "";
+                }
+            }
+        }
+    }
+    return consumer;
+}
+
+// Schedule one stage of a Func. For the pure definition, return the loops
+// created for it.
+ParallelLoops apply_schedule(const MachineParams &params,
+                             const Target &target,
+                             Func func,
+                             int update_id,
+                             const std::vector<int> &var_bounds,
+                             bool is_gpu,
+                             std::ostringstream &schedule_source) {
+    ParallelLoops root_loops;
     if (update_id == -1) {
         func.compute_root();
         schedule_source << func.name() << ".compute_root()\n";
         if (func.dimensions() > 0) {
-            parallelize_vars_and_rvars(
+            root_loops = parallelize_vars_and_rvars(
                 params,
                 func,
                 natural_vector_size(target, func.values()[0].type()),
@@ -557,15 +736,34 @@ void apply_schedule(const MachineParams &params,
                 is_associative = prover_result.associative();
                 if (is_associative) {
                     schedule_source << func.name() << ".update(" << update_id << ")\n";
+                    // On CPU, if we know the size of L2, keep the inner
+                    // tile of the reduction small enough to fit in it.
+                    int max_split_size = std::numeric_limits<int>::max();
+                    if (!is_gpu && params.l2_cache_size > 0) {
+                        int num_split = 0;
+                        for (int b : rvar_bounds) {
+                            if (b >= 8) {
+                                num_split++;
+                            }
+                        }
+                        if (num_split > 0) {
+                            double elems = (double)params.l2_cache_size /
+                                           func.values()[0].type().bytes();
+                            int s = int(std::pow(elems, 1.0 / num_split)) / 8 * 8;
+                            max_split_size = std::max(8, s);
+                        }
+                    }
                     // Generate a list of tiled RVars
                     std::vector<RVar> outer_rvars, inner_rvars;
                     std::vector<int> outer_rvar_sizes, inner_rvar_sizes;
                     for (int i = 0; i < (int)rvars.size(); i++) {
                         if (rvar_bounds[i] >= 8) {
                             // Let split_size = 8 * n where n is an integer and
-                            // split_size > sqrt(rvar_bounds)
+                            // split_size > sqrt(rvar_bounds), unless that
+                            // exceeds max_split_size.
                             float target = std::sqrt(rvar_bounds[i]);
-                            int split_size = int(std::ceil(target / 8.f)) * 8;
+                            int split_size = std::min(int(std::ceil(target / 8.f)) * 8,
+                                                      max_split_size);
                             // Split the rvar
                             RVar outer, inner;
                             func.update(update_id)
@@ -579,7 +777,7 @@ void apply_schedule(const MachineParams &params,
                                             << TailStrategy::GuardWithIf << ")\n";
                             outer_rvars.push_back(outer);
                             inner_rvars.push_back(inner);
-                            int outer_size = rvar_bounds[i] % split_size == 0 ? split_size : split_size + 1;
+                            int outer_size = (rvar_bounds[i] + split_size - 1) / split_size;
                             outer_rvar_sizes.push_back(outer_size);
                             inner_rvar_sizes.push_back(split_size);
                         } else {
@@ -681,7 +879,7 @@ void apply_schedule(const MachineParams &params,
             is_gpu ? gpu_min_parallelism : cpu_min_parallelism;
         if (parallelism >= min_parallelism) {
             schedule_source << func.name() << ".update(" << update_id << ")\n";
-            parallelize_vars_and_rvars(
+            ParallelLoops loops = parallelize_vars_and_rvars(
                 params,
                 func.update(update_id),
                 natural_vector_size(target, func.values()[0].type()),
@@ -693,6 +891,34 @@ void apply_schedule(const MachineParams &params,
                 TailStrategy::GuardWithIf,
                 is_gpu,
                 schedule_source);
+            // On CPU, tile large reductions: apply each chunk of the
+            // reduction to all the points of a parallel task before moving
+            // on to the next, so that the chunk stays in cache.
+            std::string tile_rvar;
+            if (!is_gpu && !rvars.empty() && !loops.task_var.empty() &&
+                !loops.split_rvars.count(rvars.back().name())) {
+                tile_rvar = split_reduction_for_cache(params, func, update_id,
+                                                      rvars, rvar_bounds,
+                                                      loops.points_per_task,
+                                                      schedule_source);
+            }
+            if (!tile_rvar.empty()) {
+                std::vector<VarOrRVar> order;
+                if (!loops.vectorized_var.empty()) {
+                    order.emplace_back(Var(loops.vectorized_var));
+                }
+                order.emplace_back(Var(loops.task_var));
+                order.emplace_back(RVar(tile_rvar));
+                func.update(update_id).reorder(order);
+                schedule_source << "    .reorder(";
+                for (int i = 0; i < (int)order.size(); i++) {
+                    schedule_source << order[i].name();
+                    if (i != (int)order.size() - 1) {
+                        schedule_source << ",";
+                    }
+                }
+                schedule_source << ")\n";
+            }
         } else {
             // Not enough parallelism. Find parallelism from RDoms.
             if (!checked_associative) {
@@ -739,6 +965,7 @@ void apply_schedule(const MachineParams &params,
         }
     }
     schedule_source << ";\n";
+    return root_loops;
 }
 
 }  // namespace
@@ -831,6 +1058,8 @@ void generate_schedule(const std::vector<Function> &outputs,
     }
 
     std::ostringstream schedule_source;
+    // The loops of the pure definitions of the Funcs scheduled so far.
+    std::map<std::string, ParallelLoops> root_loops;
     // Traverse from the consumers to the producers
     for (auto it = order.rbegin(); it != order.rend(); it++) {
         Func func(env[*it]);
@@ -838,8 +1067,21 @@ void generate_schedule(const std::vector<Function> &outputs,
         // Get the bounds in integer constant by substitute all the parameters' estimates.
         Box bounds = func_bounds[*it];
         std::vector<int> int_bounds = get_int_bounds(bounds);
+        // On CPU, compute Funcs that are only used element-wise by another
+        // Func (e.g. the adjoints accumulated by the backward pass) inside
+        // each parallel task of their consumer, instead of at root.
+        if (!target.has_gpu_feature() && !output_set.count(*it)) {
+            std::string consumer = find_element_wise_consumer(env[*it], env);
+            auto loops = root_loops.find(consumer);
+            if (loops != root_loops.end() && !loops->second.parallel_var.empty()) {
+                aslog(1) << "[gradient_autoscheduler] Fusing " << *it << " into " << consumer << "\n";
+                apply_fused_schedule(target, func, Func(env[consumer]),
+                                     loops->second.parallel_var, int_bounds, schedule_source);
+                continue;
+            }
+        }
         // Scheduling pure definition
-        apply_schedule(params, target, func, -1, int_bounds, target.has_gpu_feature(), schedule_source);
+        root_loops[*it] = apply_schedule(params, target, func, -1, int_bounds, target.has_gpu_feature(), schedule_source);
         // Scheduling the updates
         for (int update_id = 0;
              update_id < func.num_update_definitions(); update_id++) {
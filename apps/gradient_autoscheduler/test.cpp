@@ -2,6 +2,23 @@
 
 using namespace Halide;
 
+// Check that a scheduled Func computes the same values as an unscheduled
+// copy of its algorithm.
+bool check_same(Func scheduled, Func reference, int width, int height) {
+    Buffer<float> out = scheduled.realize({width, height});
+    Buffer<float> expected = reference.realize({width, height});
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (std::abs(out(x, y) - expected(x, y)) > 1e-3f * std::abs(expected(x, y)) + 1e-3f) {
+                std::cerr << scheduled.name() << "(" << x << ", " << y << ") = " << out(x, y)
+                          << " instead of " << expected(x, y) << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 int main(int argc, char **argv) {
     // Loads libgradient_autoscheduler.so (or gradient_autoscheduler.dll),
     // which is presumed to be in current library search path
@@ -157,5 +174,68 @@ int main(int argc, char **argv) {
         std::cout << result.schedule_source << std::endl;
         std::cout << std::endl;
     }
+
+    {  // Accumulation used element-wise by its consumer. Should be computed inside the consumer.
+        auto make_f1 = [&]() {
+            Func in("in");
+            in(x, y) = cast<float>(x + y);
+            Func f0("f0");
+            f0(x, y) = in(x, y);
+            f0(x, y) += sin(in(x, y));
+            Func f1("f1");
+            f1(x, y) = f0(x, y) * f0(x, y) + in(x + 1, y);
+            return f1;
+        };
+        Func f1 = make_f1();
+
+        f1.set_estimate(x, 0, 1000)
+            .set_estimate(y, 0, 1000);
+
+        AutoSchedulerResults result =
+            Pipeline(f1).auto_schedule(target, params);
+        std::cout << "Schedule for element-wise accumulation:" << std::endl;
+        std::cout << result.schedule_source << std::endl;
+        std::cout << std::endl;
+
+        if (result.schedule_source.find("f0.compute_at(LoopLevel(f1,") == std::string::npos) {
+            std::cerr << "f0 was not computed inside f1" << std::endl;
+            return 1;
+        }
+        if (!check_same(f1, make_f1(), 100, 100)) {
+            return 1;
+        }
+    }
+
+    {  // Large matrix multiply-like reduction. Should be tiled over the reduction.
+        RDom r(0, 4096, "r");
+        auto make_c = [&]() {
+            Func a("a"), b("b");
+            a(x, y) = cast<float>(x + y);
+            b(x, y) = cast<float>(x - y);
+            Func c("c");
+            c(x, y) += a(r, y) * b(x, r);
+            return c;
+        };
+        Func c = make_c();
+
+        c.set_estimate(x, 0, 1024)
+            .set_estimate(y, 0, 1024);
+
+        AutoSchedulerResults result =
+            Pipeline(c).auto_schedule(target, params);
+        std::cout << "Schedule for large reduction:" << std::endl;
+        std::cout << result.schedule_source << std::endl;
+        std::cout << std::endl;
+
+        if (result.schedule_source.find(".split(" + r.x.name() + ",") == std::string::npos) {
+            std::cerr << "The reduction over " << r.x.name() << " was not tiled" << std::endl;
+            return 1;
+        }
+        // Realize a smaller region than estimated, to keep the
+        // unscheduled reference quick.
+        if (!check_same(c, make_c(), 64, 64)) {
+            return 1;
+        }
+    }
     return 0;
 }
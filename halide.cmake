@@ -24,6 +24,9 @@ foreach(LIB IN ITEMS PNG JPEG)
     target_compile_definitions(halide_image_io INTERFACE HALIDE_NO_${LIB})
   endif()
 endforeach()
+# halide_image_io encodes and decodes large images on multiple threads.
+find_package(Threads REQUIRED)
+target_link_libraries(halide_image_io INTERFACE Threads::Threads)
 add_library(Halide::ImageIO ALIAS halide_image_io)
 
 function(halide_use_image_io TARGET)
@@ -210,6 +213,7 @@ function(halide_library_from_generator BASENAME)
   set(assembly_ext ".s")
   set(bitcode_ext ".bc")
   set(c_header_ext ".h")
+  set(cost_predictions_ext ".cost_predictions")
   set(featurization_ext ".featurization")
   set(llvm_assembly_ext ".ll")
   set(object_ext ${CMAKE_C_OUTPUT_EXTENSION})
@@ -519,6 +523,9 @@ function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
         wasm_signext
         sve
         sve2
+        profile_by_loop
+        profile_perf_counters
+        batch_entry_point
       )
     # Synthesize a one-or-two-char abbreviation based on the feature's position
     # in the KNOWN_FEATURES list.
@@ -30,6 +30,24 @@ def test_runtime_error():
     else:
         assert False, 'Did not see expected exception!'
 
+def test_realize_uses_compiled_target():
+    # Without a target, realize should use the one the pipeline was
+    # compiled for, rather than recompiling for the host.
+    x = hl.Var('x')
+    f = hl.Func('f')
+    f[x] = hl.u8(x)
+    f.bound(x, 0, 1)
+    f.compile_jit(hl.get_jit_target_from_environment().with_feature(hl.TargetFeature.NoAsserts))
+    # This would fail the bounds check, if there were one.
+    buf = hl.Buffer(hl.UInt(8), [10])
+    f.realize(buf)
+    f.realize([10])
+
+    p = hl.Pipeline(f)
+    p.compile_jit(hl.get_jit_target_from_environment().with_feature(hl.TargetFeature.NoAsserts))
+    p.realize(buf)
+    p.realize([10])
+
 def test_misused_and():
     x = hl.Var('x')
     y = hl.Var('y')
@@ -269,6 +287,7 @@ def test_int_promotion():
 if __name__ == "__main__":
     test_compiletime_error()
     test_runtime_error()
+    test_realize_uses_compiled_target()
     test_misused_and()
     test_misused_or()
     test_float_or_int()
@@ -185,6 +185,47 @@ def test_interleaved_ndarray():
     assert b.dim(2).extent() == c
     assert b.dim(2).stride() == 1
 
+def test_noncontiguous_zero_copy():
+    # Strided, reversed and transposed views of an ndarray are aliased,
+    # not copied, in both directions.
+    base = np.full((20, 30), -1, dtype=np.int32)
+    view = base[2:18:3, ::-2].T
+    assert view.shape == (15, 6)
+
+    b = hl.Buffer(view)
+    assert b.dim(0).extent() == 15
+    assert b.dim(0).stride() == -2
+    assert b.dim(1).extent() == 6
+    assert b.dim(1).stride() == 90
+
+    x, y = hl.Var("x"), hl.Var("y")
+    f = hl.Func("f")
+    f[x, y] = x + y * 100
+    # By default the innermost dimension of an output must be dense;
+    # allow any stride, so that we can realize into the view.
+    f.output_buffer().dim(0).set_stride(hl.Expr())
+    f.realize(b)
+    for i in range(15):
+        for j in range(6):
+            assert view[i, j] == i + j * 100
+    # Nothing outside of the view was written.
+    assert np.count_nonzero(base == -1) == base.size - view.size
+
+    a = np.asarray(b)
+    assert np.shares_memory(a, base)
+    assert a.shape == view.shape
+    assert a.strides == view.strides
+    a[3, 4] = 7
+    assert view[3, 4] == 7
+    assert b[3, 4] == 7
+
+    # The same goes for the Buffers that realize allocates.
+    out = f.realize([4, 5])
+    a = np.asarray(out)
+    a[1, 2] = 9
+    assert out[1, 2] == 9
+
+
 def test_reorder():
     W = 7
     H = 5
@@ -261,6 +302,7 @@ def test_buffer_to_str():
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
+    test_noncontiguous_zero_copy()
     test_ndarray_to_buffer()
     test_buffer_to_ndarray()
     test_for_each_element()
@@ -0,0 +1,80 @@
+import asyncio
+import halide as hl
+import numpy as np
+
+def make_pipeline():
+    x, y = hl.Var('x'), hl.Var('y')
+    f = hl.Func('f')
+    f[x, y] = hl.u16(x + y * 10)
+    f.parallel(y)
+    return hl.Pipeline(f)
+
+async def realize_several(p, n):
+    bufs = [hl.Buffer(hl.UInt(16), [64, 32]) for _ in range(n)]
+    # Start them all before waiting on any of them.
+    futures = [p.realize_async(b) for b in bufs]
+    for fut in futures:
+        assert await fut is None
+    return bufs
+
+def test_realize_async():
+    p = make_pipeline()
+    loop = asyncio.new_event_loop()
+    asyncio.set_event_loop(loop)
+    try:
+        bufs = loop.run_until_complete(realize_several(p, 8))
+    finally:
+        loop.close()
+    expected = np.fromfunction(lambda x, y: x + y * 10, (64, 32), dtype=np.uint16)
+    for b in bufs:
+        assert np.array_equal(np.array(b), expected)
+
+def test_realize_async_error():
+    x = hl.Var('x')
+    f = hl.Func('f')
+    f[x] = hl.u8(x)
+    f.bound(x, 0, 1)
+    p = hl.Pipeline(f)
+
+    async def run():
+        # Deliberate runtime error
+        buf = hl.Buffer(hl.UInt(8), [10])
+        await p.realize_async(buf)
+
+    loop = asyncio.new_event_loop()
+    asyncio.set_event_loop(loop)
+    try:
+        loop.run_until_complete(run())
+    except RuntimeError as e:
+        assert 'do not cover required region' in str(e)
+    else:
+        assert False, 'Did not see expected exception!'
+    finally:
+        loop.close()
+
+def test_print_from_pool_threads():
+    # The print handler takes the GIL, so this deadlocks if any of
+    # these hold it while the pipeline runs on other threads.
+    x, y = hl.Var('x'), hl.Var('y')
+    f = hl.Func('f')
+    f[x, y] = hl.print_when(x == 0, hl.u16(x + y), 'row', y)
+    f.parallel(y)
+    p = hl.Pipeline(f)
+
+    expected = np.fromfunction(lambda x, y: x + y, (8, 16), dtype=np.uint16)
+    assert np.array_equal(np.array(f.realize(8, 16)), expected)
+    assert np.array_equal(np.array(p.realize([8, 16])), expected)
+
+    buf = hl.Buffer(hl.UInt(16), [8, 16])
+    loop = asyncio.new_event_loop()
+    asyncio.set_event_loop(loop)
+    try:
+        loop.run_until_complete(p.realize_async(buf))
+    finally:
+        loop.close()
+    assert np.array_equal(np.array(buf), expected)
+
+if __name__ == "__main__":
+    test_realize_async()
+    test_realize_async_error()
+    test_print_from_pool_threads()
@@ -239,9 +239,18 @@ class PyBuffer : public Buffer<> {
         std::vector<halide_dimension_t> dims;
         dims.reserve(info.ndim);
         for (int i = 0; i < info.ndim; i++) {
-            if (INT_MAX < info.shape[i] || INT_MAX < (info.strides[i] / t.bytes())) {
+            if (INT_MAX < info.shape[i] ||
+                INT_MAX < (info.strides[i] / t.bytes()) ||
+                INT_MIN > (info.strides[i] / t.bytes())) {
                 throw py::value_error("Out of range arguments to make_dim_vec.");
             }
+            // We always alias the source's storage, whatever its
+            // strides (including negative ones, e.g. from a reversed
+            // numpy slice), but Halide strides count elements, not
+            // bytes.
+            if (info.strides[i] % t.bytes() != 0) {
+                throw py::value_error("Buffer strides must be a multiple of the element size.");
+            }
             dims.push_back({0, (int32_t)info.shape[i], (int32_t)(info.strides[i] / t.bytes())});
         }
         return dims;
@@ -304,7 +313,8 @@ void define_buffer(py::module &m) {
         py::class_<Buffer<>, PyBuffer>(m, "Buffer", py::buffer_protocol())
 
             // Note that this allows us to convert a Buffer<> to any buffer-like object in Python;
-            // most notably, we can convert to an ndarray by calling numpy.array()
+            // most notably, we can convert to an ndarray by calling numpy.array(). The result
+            // aliases the Buffer's storage with the same strides, so numpy.asarray() never copies.
             .def_buffer([](Buffer<> &b) -> py::buffer_info {
                 if (b.data() == nullptr) {
                     throw py::value_error("Cannot convert a Buffer<> with null host ptr to a Python buffer.");
@@ -315,7 +325,8 @@ void define_buffer(py::module &m) {
                 std::vector<ssize_t> shape, strides;
                 for (int i = 0; i < d; i++) {
                     shape.push_back((ssize_t)b.raw_buffer()->dim[i].extent);
-                    strides.push_back((ssize_t)(b.raw_buffer()->dim[i].stride * bytes));
+                    // Widen before scaling, so that large strides don't overflow.
+                    strides.push_back((ssize_t)b.raw_buffer()->dim[i].stride * bytes);
                 }
 
                 return py::buffer_info(
@@ -142,6 +142,9 @@ void define_enums(py::module &m) {
         .value("WasmSignExt", Target::Feature::WasmSignExt)
         .value("SVE", Target::Feature::SVE)
         .value("SVE2", Target::Feature::SVE2)
+        .value("ProfileByLoop", Target::Feature::ProfileByLoop)
+        .value("ProfilePerfCounters", Target::Feature::ProfilePerfCounters)
+        .value("BatchEntryPoint", Target::Feature::BatchEntryPoint)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -155,6 +158,7 @@ void define_enums(py::module &m) {
         .value("bitcode", Output::bitcode)
         .value("c_header", Output::c_header)
         .value("c_source", Output::c_source)
+        .value("cost_predictions", Output::cost_predictions)
         .value("cpp_stub", Output::cpp_stub)
         .value("featurization", Output::featurization)
         .value("llvm_assembly", Output::llvm_assembly)
@@ -10,12 +10,17 @@ void halide_python_error(void *, const char *msg) {
 }
 
 void halide_python_print(void *, const char *msg) {
+    // Pipelines may print from thread pool threads (e.g. when run with
+    // realize_async), which don't hold the GIL.
+    py::gil_scoped_acquire acquire;
     py::print(msg, py::arg("end") = "");
 }
 
 class HalidePythonCompileTimeErrorReporter : public CompileTimeErrorReporter {
 public:
     void warning(const char *msg) {
+        // The GIL is released while compiling (see ScopedCompile).
+        py::gil_scoped_acquire acquire;
         py::print(msg, py::arg("end") = "");
     }
 
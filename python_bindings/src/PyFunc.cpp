@@ -4,6 +4,7 @@
 #include "PyExpr.h"
 #include "PyFuncRef.h"
 #include "PyLoopLevel.h"
+#include "PyPipeline.h"
 #include "PyScheduleMethods.h"
 #include "PyStage.h"
 #include "PyTuple.h"
@@ -104,6 +105,7 @@ void define_func(py::module &m) {
     // - set_error_handler()
     // - set_custom_trace()
     // - set_custom_print()
+    // - set_custom_get_job_priority()
 
     auto func_class =
         py::class_<Func>(m, "Func")
@@ -118,7 +120,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-                    f.realize(buffer, target);
+                    realize_without_gil(f, Realization(buffer), target, param_map);
                 },
                 py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
@@ -126,14 +128,14 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-                    f.realize(Realization(buffers), t);
+                    realize_without_gil(f, Realization(buffers), t, param_map);
                 },
                 py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             .def(
                 "realize",
                 [](Func &f, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(f.realize(sizes, target, param_map));
+                    return realization_to_object(realize_without_gil(f, sizes, target, param_map));
                 },
                 py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
@@ -141,7 +143,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(f.realize(x_size, target, param_map));
+                    return realization_to_object(realize_without_gil(f, std::vector<int32_t>{x_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
@@ -149,7 +151,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(f.realize(x_size, y_size, target, param_map));
+                    return realization_to_object(realize_without_gil(f, std::vector<int32_t>{x_size, y_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
@@ -157,7 +159,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(f.realize(x_size, y_size, z_size, target, param_map));
+                    return realization_to_object(realize_without_gil(f, std::vector<int32_t>{x_size, y_size, z_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
@@ -165,7 +167,7 @@ void define_func(py::module &m) {
             .def(
                 "realize",
                 [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(f.realize(x_size, y_size, z_size, w_size, target, param_map));
+                    return realization_to_object(realize_without_gil(f, std::vector<int32_t>{x_size, y_size, z_size, w_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
@@ -203,36 +205,36 @@ void define_func(py::module &m) {
 
             .def("store_in", &Func::store_in, py::arg("memory_type"))
 
-            .def("compile_to", &Func::compile_to, py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+            .def("compile_to", &Func::compile_to, py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_bitcode, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_bitcode, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_bitcode, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
+            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_bitcode, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_llvm_assembly, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_llvm_assembly, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_llvm_assembly, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
+            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_llvm_assembly, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_object, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_object, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_object, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
+            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_object, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_header", &Func::compile_to_header, py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_header", &Func::compile_to_header, py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_assembly, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_assembly, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_assembly, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
+            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_assembly, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_c", &Func::compile_to_c, py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_c", &Func::compile_to_c, py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_lowered_stmt", &Func::compile_to_lowered_stmt, py::arg("filename"), py::arg("arguments"), py::arg("fmt") = Text, py::arg("target") = get_target_from_environment())
+            .def("compile_to_lowered_stmt", &Func::compile_to_lowered_stmt, py::arg("filename"), py::arg("arguments"), py::arg("fmt") = Text, py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_file", &Func::compile_to_file, py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_file", &Func::compile_to_file, py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_static_library", &Func::compile_to_static_library, py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_static_library", &Func::compile_to_static_library, py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_to_multitarget_static_library", &Func::compile_to_multitarget_static_library, py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"))
+            .def("compile_to_multitarget_static_library", &Func::compile_to_multitarget_static_library, py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"), py::call_guard<ScopedCompile>())
 
             // TODO: useless until Module is defined.
-            .def("compile_to_module", &Func::compile_to_module, py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_module", &Func::compile_to_module, py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
-            .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment())
+            .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment(), py::call_guard<ScopedCompile>())
 
             .def("has_update_definition", &Func::has_update_definition)
             .def("num_update_definitions", &Func::num_update_definitions)
@@ -271,19 +273,19 @@ void define_func(py::module &m) {
             .def("output_buffer", &Func::output_buffer)
             .def("output_buffers", &Func::output_buffers)
 
-            .def("infer_input_bounds", (void (Func::*)(int, int, int, int, const ParamMap &)) & Func::infer_input_bounds, py::arg("x_size") = 0, py::arg("y_size") = 0, py::arg("z_size") = 0, py::arg("w_size") = 0, py::arg("param_map") = ParamMap())
+            .def("infer_input_bounds", (void (Func::*)(int, int, int, int, const ParamMap &)) & Func::infer_input_bounds, py::arg("x_size") = 0, py::arg("y_size") = 0, py::arg("z_size") = 0, py::arg("w_size") = 0, py::arg("param_map") = ParamMap(), py::call_guard<ScopedCompile>())
 
             .def(
                 "infer_input_bounds", [](Func &f, Buffer<> buffer, const ParamMap &param_map) -> void {
                     f.infer_input_bounds(buffer, param_map);
                 },
-                py::arg("dst"), py::arg("param_map") = ParamMap())
+                py::arg("dst"), py::arg("param_map") = ParamMap(), py::call_guard<ScopedCompile>())
 
             .def(
                 "infer_input_bounds", [](Func &f, std::vector<Buffer<>> buffer, const ParamMap &param_map) -> void {
                     f.infer_input_bounds(Realization(buffer), param_map);
                 },
-                py::arg("dst"), py::arg("param_map") = ParamMap())
+                py::arg("dst"), py::arg("param_map") = ParamMap(), py::call_guard<ScopedCompile>())
 
             .def("in_", (Func(Func::*)(const Func &)) & Func::in, py::arg("f"))
             .def("in_", (Func(Func::*)(const std::vector<Func> &fs)) & Func::in, py::arg("fs"))
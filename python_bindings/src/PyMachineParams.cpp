@@ -12,7 +12,13 @@ void define_machine_params(py::module &m) {
             .def_readwrite("parallelism", &MachineParams::parallelism)
             .def_readwrite("last_level_cache_size", &MachineParams::last_level_cache_size)
             .def_readwrite("balance", &MachineParams::balance)
+            .def_readwrite("l1_cache_size", &MachineParams::l1_cache_size)
+            .def_readwrite("l2_cache_size", &MachineParams::l2_cache_size)
+            .def_readwrite("cache_line_size", &MachineParams::cache_line_size)
+            .def_readwrite("threads_per_core", &MachineParams::threads_per_core)
+            .def_readwrite("numa_nodes", &MachineParams::numa_nodes)
             .def_static("generic", &MachineParams::generic)
+            .def_static("host", &MachineParams::host)
             .def("__str__", &MachineParams::to_string)
             .def("__repr__", [](const MachineParams &mp) -> std::string {
                 std::ostringstream o;
@@ -17,6 +17,7 @@ void define_module(py::module &m) {
             .def_readwrite("machine_params_string", &AutoSchedulerResults::machine_params_string)
             .def_readwrite("schedule_source", &AutoSchedulerResults::schedule_source)
             .def_readwrite("featurization", &AutoSchedulerResults::featurization)
+            .def_readwrite("cost_predictions", &AutoSchedulerResults::cost_predictions)
             .def("__repr__", [](const AutoSchedulerResults &o) -> std::string {
                 return "<halide.AutoSchedulerResults>";
             });
@@ -7,6 +7,23 @@ namespace PythonBindings {
 
 namespace {
 
+// Held (without the GIL) while compiling; see ScopedCompile.
+std::mutex compile_mutex;
+
+// Compile p (a Pipeline or a Func) for the given target if necessary,
+// holding compile_mutex, and return the target to realize it for. Once
+// this has returned, realize doesn't compile anything, so several
+// Python threads can realize the same Pipeline at once.
+template<typename T>
+Target compile_for_realize(T &p, const Target &target) {
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    // Resolve an unspecified target just as realize would, so that a
+    // Pipeline already compiled for e.g. a GPU target stays that way.
+    Target t = p.realize_target(target);
+    p.compile_jit(t);
+    return t;
+}
+
 py::object realization_to_object(const Realization &r) {
     // Only one Buffer -> just return it
     if (r.size() == 1) {
@@ -17,8 +34,87 @@ py::object realization_to_object(const Realization &r) {
     return to_python_tuple(r);
 }
 
+// Start realizing into the given buffers on the Halide thread pool, and
+// return an asyncio future (on the current event loop) that is
+// resolved, or fails with RuntimeError, when the pipeline finishes.
+py::object realize_async(Pipeline &p, Realization r, const Target &target, const ParamMap &param_map) {
+    py::object loop = py::module::import("asyncio").attr("get_event_loop")();
+    py::object future = loop.attr("create_future")();
+
+    // Everything the completion callback touches. It runs on a thread
+    // pool thread, so it must hold the GIL while using (or releasing)
+    // these; the buffers also stay alive until the pipeline is done.
+    struct AsyncRealize {
+        py::object loop, future;
+        Realization outputs;
+    };
+
+    BoundCall call;
+    {
+        ScopedCompile compile;
+        call = p.bind(r, target, param_map);
+    }
+
+    AsyncRealize *state = new AsyncRealize{loop, future, r};
+    // Without a thread pool to hand it to, run_async runs the pipeline
+    // right here, and anything it prints needs the GIL.
+    {
+        py::gil_scoped_release release;
+        call.run_async([state](int exit_status, const std::string &error) {
+            py::gil_scoped_acquire acquire;
+            std::unique_ptr<AsyncRealize> s(state);
+            // Resolve the future on its own loop, unless it was cancelled
+            // in the meantime.
+            py::cpp_function resolve([](py::object future, py::object exception) {
+                if (!future.attr("done")().cast<bool>()) {
+                    if (exception.is_none()) {
+                        future.attr("set_result")(py::none());
+                    } else {
+                        future.attr("set_exception")(exception);
+                    }
+                }
+            });
+            py::object exception = py::none();
+            if (!error.empty()) {
+                exception = py::module::import("builtins").attr("RuntimeError")(error);
+            }
+            try {
+                s->loop.attr("call_soon_threadsafe")(resolve, s->future, exception);
+            } catch (py::error_already_set &) {
+                // The event loop has been closed, so there is nobody left
+                // to tell.
+            }
+        });
+    }
+    return future;
+}
+
 }  // namespace
 
+ScopedCompile::ScopedCompile()
+    : lock(compile_mutex) {
+}
+
+void realize_without_gil(Pipeline &p, Realization outputs, const Target &target, const ParamMap &param_map) {
+    py::gil_scoped_release release;
+    p.realize(outputs, compile_for_realize(p, target), param_map);
+}
+
+Realization realize_without_gil(Pipeline &p, const std::vector<int32_t> &sizes, const Target &target, const ParamMap &param_map) {
+    py::gil_scoped_release release;
+    return p.realize(sizes, compile_for_realize(p, target), param_map);
+}
+
+void realize_without_gil(Func &f, Realization outputs, const Target &target, const ParamMap &param_map) {
+    py::gil_scoped_release release;
+    f.realize(outputs, compile_for_realize(f, target), param_map);
+}
+
+Realization realize_without_gil(Func &f, const std::vector<int32_t> &sizes, const Target &target, const ParamMap &param_map) {
+    py::gil_scoped_release release;
+    return f.realize(sizes, compile_for_realize(f, target), param_map);
+}
+
 void define_pipeline(py::module &m) {
 
     // Deliberately not supported, because they don't seem to make sense for Python:
@@ -38,6 +134,7 @@ void define_pipeline(py::module &m) {
     // - set_error_handler()
     // - set_custom_trace()
     // - set_custom_print()
+    // - set_custom_get_job_priority()
 
     auto pipeline_class =
         py::class_<Pipeline>(m, "Pipeline")
@@ -60,99 +157,111 @@ void define_pipeline(py::module &m) {
             .def("print_loop_nest", &Pipeline::print_loop_nest)
 
             .def("compile_to", &Pipeline::compile_to,
-                 py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
             .def("compile_to_bitcode", &Pipeline::compile_to_bitcode,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_llvm_assembly", &Pipeline::compile_to_llvm_assembly,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_object", &Pipeline::compile_to_object,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_header", &Pipeline::compile_to_header,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_assembly", &Pipeline::compile_to_assembly,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_c", &Pipeline::compile_to_c,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_file", &Pipeline::compile_to_file,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
             .def("compile_to_static_library", &Pipeline::compile_to_static_library,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
             .def("compile_to_lowered_stmt", &Pipeline::compile_to_lowered_stmt,
-                 py::arg("filename"), py::arg("arguments"), py::arg("format") = StmtOutputFormat::Text, py::arg("target") = get_target_from_environment())
+                 py::arg("filename"), py::arg("arguments"), py::arg("format") = StmtOutputFormat::Text, py::arg("target") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
             .def("compile_to_multitarget_static_library", &Pipeline::compile_to_multitarget_static_library,
-                 py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets") = get_target_from_environment())
+                 py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets") = get_target_from_environment(), py::call_guard<ScopedCompile>())
 
             .def("compile_to_module", &Pipeline::compile_to_module,
-                 py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata)
+                 py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata, py::call_guard<ScopedCompile>())
 
-            .def("compile_jit", &Pipeline::compile_jit, py::arg("target") = get_jit_target_from_environment())
+            .def("compile_jit", &Pipeline::compile_jit, py::arg("target") = get_jit_target_from_environment(), py::call_guard<ScopedCompile>())
 
             .def(
                 "realize", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-                    p.realize(Realization(buffer), target);
+                    realize_without_gil(p, Realization(buffer), target, param_map);
                 },
                 py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
             .def(
                 "realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-                    p.realize(Realization(buffers), t);
+                    realize_without_gil(p, Realization(buffers), t, param_map);
                 },
                 py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             .def(
                 "realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(p.realize(sizes, target, param_map));
+                    return realization_to_object(realize_without_gil(p, sizes, target, param_map));
                 },
                 py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(p.realize(x_size, target, param_map));
+                    return realization_to_object(realize_without_gil(p, std::vector<int32_t>{x_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(p.realize(x_size, y_size, target, param_map));
+                    return realization_to_object(realize_without_gil(p, std::vector<int32_t>{x_size, y_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(p.realize(x_size, y_size, z_size, target, param_map));
+                    return realization_to_object(realize_without_gil(p, std::vector<int32_t>{x_size, y_size, z_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
             // TODO: deprecate in favor of std::vector<int32_t> size version?
             .def(
                 "realize", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-                    return realization_to_object(p.realize(x_size, y_size, z_size, w_size, target, param_map));
+                    return realization_to_object(realize_without_gil(p, std::vector<int32_t>{x_size, y_size, z_size, w_size}, target, param_map));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
+            .def(
+                "realize_async", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> py::object {
+                    return realize_async(p, Realization(buffer), target, param_map);
+                },
+                py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+
+            .def(
+                "realize_async", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &target, const ParamMap &param_map) -> py::object {
+                    return realize_async(p, Realization(buffers), target, param_map);
+                },
+                py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+
             .def(
                 "infer_input_bounds", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const ParamMap &param_map) -> void {
                     p.infer_input_bounds(x_size, y_size, z_size, w_size, param_map);
                 },
-                py::arg("x_size") = 0, py::arg("y_size") = 0, py::arg("z_size") = 0, py::arg("w_size") = 0, py::arg("param_map") = ParamMap())
+                py::arg("x_size") = 0, py::arg("y_size") = 0, py::arg("z_size") = 0, py::arg("w_size") = 0, py::arg("param_map") = ParamMap(), py::call_guard<ScopedCompile>())
 
             .def(
                 "infer_input_bounds", [](Pipeline &p, Buffer<> buffer, const ParamMap &param_map) -> void {
                     p.infer_input_bounds(Realization(buffer), param_map);
                 },
-                py::arg("dst"), py::arg("param_map") = ParamMap())
+                py::arg("dst"), py::arg("param_map") = ParamMap(), py::call_guard<ScopedCompile>())
             .def(
                 "infer_input_bounds", [](Pipeline &p, std::vector<Buffer<>> buffers, const ParamMap &param_map) -> void {
                     p.infer_input_bounds(Realization(buffers), param_map);
                 },
-                py::arg("dst"), py::arg("param_map") = ParamMap())
+                py::arg("dst"), py::arg("param_map") = ParamMap(), py::call_guard<ScopedCompile>())
 
             .def("infer_arguments", [](Pipeline &p) -> std::vector<Argument> {
                 return p.infer_arguments();
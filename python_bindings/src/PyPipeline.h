@@ -3,11 +3,32 @@
 
 #include "PyHalide.h"
 
+#include <mutex>
+
 namespace Halide {
 namespace PythonBindings {
 
 void define_pipeline(py::module &m);
 
+// Compile p if necessary, then realize it into the given buffers, or
+// into new buffers of the given size, without holding the GIL while
+// it compiles or runs. Used by both Pipeline.realize and Func.realize.
+void realize_without_gil(Pipeline &p, Realization outputs, const Target &target, const ParamMap &param_map);
+Realization realize_without_gil(Pipeline &p, const std::vector<int32_t> &sizes, const Target &target, const ParamMap &param_map);
+void realize_without_gil(Func &f, Realization outputs, const Target &target, const ParamMap &param_map);
+Realization realize_without_gil(Func &f, const std::vector<int32_t> &sizes, const Target &target, const ParamMap &param_map);
+
+// A call guard for anything that compiles a Pipeline or Func: releases
+// the GIL, then takes a lock that keeps two Python threads from
+// compiling at once, since a Pipeline must not be compiled concurrently
+// with itself.
+struct ScopedCompile {
+    py::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock;
+
+    ScopedCompile();
+};
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
@@ -0,0 +1,38 @@
+#include "AddCancellationChecks.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+class AddCancellationChecks : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        // Checking per loop iteration would be too expensive for
+        // tight serial loops. Parallel loops are covered by the
+        // thread pool.
+        return op;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        Stmt s = IRMutator::visit(op);
+        if (op->is_producer) {
+            Expr cancelled = Call::make(Int(32), "halide_cancelled", {}, Call::Extern);
+            Expr error = Call::make(Int(32), "halide_error_cancelled", {}, Call::Extern);
+            s = Block::make(AssertStmt::make(cancelled == 0, error), s);
+        }
+        return s;
+    }
+};
+
+}  // namespace
+
+Stmt add_cancellation_checks(const Stmt &s) {
+    return AddCancellationChecks().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
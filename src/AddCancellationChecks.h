@@ -0,0 +1,23 @@
+#ifndef HALIDE_ADD_CANCELLATION_CHECKS_H
+#define HALIDE_ADD_CANCELLATION_CHECKS_H
+
+/** \file
+ * Defines the lowering pass that lets a running pipeline be cancelled.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Insert a call to halide_cancelled before the production of each
+ * stage that is computed outside of any loop, and bail out with
+ * halide_error_code_cancelled if it returns non-zero. Stages computed
+ * inside loops are not checked here; the thread pool checks before
+ * dispatching each parallel task instead. */
+Stmt add_cancellation_checks(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <future>
+#include <mutex>
 #include <regex>
 #include <utility>
 
@@ -14,6 +16,7 @@
 #include "RegionCosts.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "ThreadPool.h"
 #include "Util.h"
 
 namespace Halide {
@@ -186,24 +189,55 @@ struct DependenceAnalysis {
             return prods < other.prods;
         }
     };
-    struct RegionsRequired {
-        DimBounds bounds;
-        // Regions required to compute 'bounds' given a particular
-        // RegionsRequiredQuery.
-        map<string, Box> regions;
-        RegionsRequired(const DimBounds &b, const map<string, Box> &r)
-            : bounds(b), regions(r) {
+    // Orders bounds by the structure of their Exprs, rather than by their
+    // identity, so that queries for the same bounds built in different
+    // places (e.g. by each of the tile configurations of a group) share a
+    // cache entry.
+    struct DimBoundsLess {
+        bool operator()(const DimBounds &a, const DimBounds &b) const {
+            IRDeepCompare less;
+            auto ia = a.begin(), ib = b.begin();
+            for (; ia != a.end() && ib != b.end(); ++ia, ++ib) {
+                if (ia->first != ib->first) {
+                    return ia->first < ib->first;
+                }
+                if (less(ia->second.min, ib->second.min)) {
+                    return true;
+                } else if (less(ib->second.min, ia->second.min)) {
+                    return false;
+                }
+                if (less(ia->second.max, ib->second.max)) {
+                    return true;
+                } else if (less(ib->second.max, ia->second.max)) {
+                    return false;
+                }
+            }
+            return (ia == a.end()) && (ib != b.end());
         }
     };
     // Cache for bounds queries (bound queries with the same parameters are
-    // common during the grouping process).
-    map<RegionsRequiredQuery, vector<RegionsRequired>> regions_required_cache;
+    // common during the grouping process). Maps each query to the regions
+    // required to compute each of the bounds it has been asked about. The
+    // grouping choices are evaluated concurrently, so this is guarded by
+    // 'regions_required_mutex'.
+    map<RegionsRequiredQuery, map<DimBounds, map<string, Box>, DimBoundsLess>> regions_required_cache;
+    std::mutex regions_required_mutex;
 
     DependenceAnalysis(const map<string, Function> &env, const vector<string> &order,
                        const FuncValueBounds &func_val_bounds)
         : env(env), order(order), func_val_bounds(func_val_bounds) {
     }
 
+    // The mutex can't be moved, but it only needs to guard the cache while
+    // it is in use, so moving everything else is enough.
+    DependenceAnalysis &operator=(DependenceAnalysis &&other) {
+        env = std::move(other.env);
+        order = std::move(other.order);
+        func_val_bounds = std::move(other.func_val_bounds);
+        regions_required_cache = std::move(other.regions_required_cache);
+        return *this;
+    }
+
     // Return the regions of the producers ('prods') required to compute the region
     // of the function stage ('f', 'stage_num') specified by 'bounds'. When
     // 'only_regions_computed' is set to true, this only returns the computed
@@ -394,13 +428,14 @@ DependenceAnalysis::regions_required(const Function &f, int stage_num,
 
     // Check the cache if we've already computed this previously.
     RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed);
-    const auto &iter = regions_required_cache.find(query);
-    if (iter != regions_required_cache.end()) {
-        const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
-                                      [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
-        if (it != iter->second.end()) {
-            internal_assert((iter->first == query) && (it->bounds == bounds));
-            return it->regions;
+    {
+        std::lock_guard<std::mutex> lock(regions_required_mutex);
+        const auto &iter = regions_required_cache.find(query);
+        if (iter != regions_required_cache.end()) {
+            const auto &it = iter->second.find(bounds);
+            if (it != iter->second.end()) {
+                return it->second;
+            }
         }
     }
 
@@ -582,7 +617,10 @@ DependenceAnalysis::regions_required(const Function &f, int stage_num,
         concrete_regions[f_reg.first] = concrete_box;
     }
 
-    regions_required_cache[query].push_back(RegionsRequired(bounds, concrete_regions));
+    // Another thread may have computed the same regions in the meantime, in
+    // which case this is a no-op.
+    std::lock_guard<std::mutex> lock(regions_required_mutex);
+    regions_required_cache[query].emplace(bounds, concrete_regions);
     return concrete_regions;
 }
 
@@ -1070,6 +1108,9 @@ struct Partitioner {
     RegionCosts &costs;
     // Output functions of the pipeline.
     const vector<Function> &outputs;
+    // Workers for evaluating grouping choices and tile configurations
+    // concurrently.
+    ThreadPool<void> thread_pool;
 
     Partitioner(const map<string, Box> &_pipeline_bounds,
                 const MachineParams &_arch_params,
@@ -1105,6 +1146,17 @@ struct Partitioner {
     // reached.
     void group(Partitioner::Level level);
 
+    // Return the cost of a load relative to the cost of an arithmetic
+    // operation, given the memory footprint of the loads around it, based on
+    // the cache hierarchy described by 'arch_params'.
+    Expr load_cost_factor(const Expr &footprint) const;
+
+    // Call 'f(i)' for each i in [0, n) on 'thread_pool', and wait for them all
+    // to finish. Calls made from within 'f' run serially on the calling
+    // worker, so that a worker never waits on work queued behind it.
+    template<typename F>
+    void parallel_for(int n, F f);
+
     // Given a grouping choice, return a configuration for the group that gives
     // the highest estimated benefits.
     GroupConfig evaluate_choice(const GroupingChoice &group, Partitioner::Level level);
@@ -1422,9 +1474,82 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
     return reuse;
 }
 
+namespace {
+
+// True on threads that are running a task for Partitioner::parallel_for.
+thread_local bool in_partitioner_worker = false;
+
+}  // namespace
+
+template<typename F>
+void Partitioner::parallel_for(int n, F f) {
+    if (n <= 1 || in_partitioner_worker) {
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+
+    vector<std::future<void>> results;
+#ifdef WITH_EXCEPTIONS
+    // Errors must be rethrown on this thread, not the worker's.
+    vector<std::exception_ptr> errors(n);
+#endif
+    for (int i = 0; i < n; i++) {
+        results.push_back(thread_pool.async([&, i]() {
+            in_partitioner_worker = true;
+#ifdef WITH_EXCEPTIONS
+            try {
+                f(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+#else
+            f(i);
+#endif
+            in_partitioner_worker = false;
+        }));
+    }
+    for (auto &r : results) {
+        r.wait();
+    }
+#ifdef WITH_EXCEPTIONS
+    for (const auto &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+#endif
+}
+
 vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
 Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
                                        Partitioner::Level level) {
+    // Evaluate all the candidates that haven't been evaluated for grouping
+    // before concurrently, and cache the results. The evaluations are
+    // independent of each other, and the choice among them is made below in
+    // a fixed order, so the result doesn't depend on the order in which they
+    // finish.
+    vector<GroupingChoice> to_evaluate;
+    set<GroupingChoice> seen;
+    for (const auto &p : cands) {
+        const Function &prod_f = get_element(dep_analysis.env, p.first);
+        FStage prod(prod_f, prod_f.updates().size());
+        for (const FStage &c : get_element(children, prod)) {
+            GroupingChoice cand_choice(prod_f.name(), c);
+            if (!grouping_cache.count(cand_choice) && seen.insert(cand_choice).second) {
+                to_evaluate.push_back(cand_choice);
+            }
+        }
+    }
+    vector<GroupConfig> evaluated(to_evaluate.size());
+    parallel_for(to_evaluate.size(), [&](int i) {
+        evaluated[i] = evaluate_choice(to_evaluate[i], level);
+    });
+    for (size_t i = 0; i < to_evaluate.size(); i++) {
+        grouping_cache.emplace(to_evaluate[i], evaluated[i]);
+    }
+
     vector<pair<GroupingChoice, GroupConfig>> best_grouping;
     Expr best_benefit = make_zero(Int(64));
     for (const auto &p : cands) {
@@ -1437,20 +1562,8 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
         FStage prod(prod_f, final_stage);
 
         for (const FStage &c : get_element(children, prod)) {
-            GroupConfig best_config;
             GroupingChoice cand_choice(prod_f.name(), c);
-
-            // Check if the candidate has been evaluated for grouping before
-            const auto &iter = grouping_cache.find(cand_choice);
-            if (iter != grouping_cache.end()) {
-                best_config = iter->second;
-            } else {
-                best_config = evaluate_choice(cand_choice, level);
-                // Cache the result of the evaluation for the pair
-                grouping_cache.emplace(cand_choice, best_config);
-            }
-
-            grouping.emplace_back(cand_choice, best_config);
+            grouping.emplace_back(cand_choice, get_element(grouping_cache, cand_choice));
         }
 
         bool no_redundant_work = false;
@@ -1605,12 +1718,21 @@ Partitioner::find_best_tile_config(const Group &g) {
     // Generate tiling configurations
     vector<map<string, Expr>> configs = generate_tile_configs(g.output);
 
+    // Analyze them all concurrently, then pick the best in order.
+    vector<GroupAnalysis> analyses(configs.size());
+    parallel_for(configs.size(), [&](int i) {
+        Group new_group = g;
+        new_group.tile_sizes = configs[i];
+        analyses[i] = analyze_group(new_group, show_analysis);
+    });
+
     Group best_group = g;
-    for (const auto &config : configs) {
+    for (size_t i = 0; i < configs.size(); i++) {
+        const auto &config = configs[i];
         Group new_group = g;
         new_group.tile_sizes = config;
 
-        GroupAnalysis new_analysis = analyze_group(new_group, show_analysis);
+        const GroupAnalysis &new_analysis = analyses[i];
 
         bool no_redundant_work = false;
         Expr benefit = estimate_benefit(best_analysis, new_analysis,
@@ -1952,18 +2074,17 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
     // TODO: Use smooth step curve from Jon to better model cache behavior,
     // where each step corresponds to different cache level.
     //
-    // The current cost model drops off linearly. Larger memory footprint is
-    // penalized more than smaller memory footprint (since smaller one can fit
-    // more in the cache). The cost is clamped at 'balance', which is roughly at
-    // memory footprint equal to or larger than the last level cache size.
+    // The current cost model drops off piecewise-linearly (see
+    // 'load_cost_factor'). Larger memory footprint is penalized more than
+    // smaller memory footprint (since smaller one can fit more in the cache).
+    // The cost is clamped at 'balance', which is roughly at memory footprint
+    // equal to or larger than the last level cache size.
 
     // If 'model_reuse' is set, the cost model should take into account memory
     // reuse within the tile, e.g. matrix multiply reuses inputs multiple times.
     // TODO: Implement a better reuse model.
     bool model_reuse = false;
 
-    // Linear dropoff
-    float load_slope = arch_params.balance / arch_params.last_level_cache_size;
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure fuction \"" << f_load.first
@@ -2005,8 +2126,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
 
             if (model_reuse) {
-                Expr initial_factor =
-                    cast<int64_t>(min(1 + initial_footprint * load_slope, arch_params.balance));
+                Expr initial_factor = load_cost_factor(initial_footprint);
                 per_tile_cost.memory += initial_factor * footprint;
             } else {
                 footprint = initial_footprint;
@@ -2017,7 +2137,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
         }
 
-        Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        Expr cost_factor = load_cost_factor(footprint);
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
@@ -2040,6 +2160,30 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
     return g_analysis;
 }
 
+Expr Partitioner::load_cost_factor(const Expr &footprint) const {
+    const float balance = arch_params.balance;
+    const float l1 = arch_params.l1_cache_size;
+    const float l2 = arch_params.l2_cache_size;
+    const float llc = arch_params.last_level_cache_size;
+
+    if (l1 <= 0 || l2 <= l1 || llc <= l2) {
+        // Linear dropoff
+        return cast<int64_t>(min(1 + footprint * (balance / llc), balance));
+    }
+
+    // One linear segment per cache level: loads from a footprint that fits
+    // in L1 cost the same as an arithmetic operation, the cost rises to a
+    // quarter of 'balance' as the footprint grows to the size of L2, and to
+    // all of it at the size of the last level cache.
+    const float l2_cost = std::max(1.0f, balance / 4);
+    Expr f = cast<float>(footprint);
+    Expr cost = select(f <= l1, 1.0f,
+                       f <= l2, 1.0f + (f - l1) * ((l2_cost - 1.0f) / (l2 - l1)),
+                       f <= llc, l2_cost + (f - l2) * ((balance - l2_cost) / (llc - l2)),
+                       balance);
+    return cast<int64_t>(cost);
+}
+
 Partitioner::Group Partitioner::merge_groups(const Group &prod_group,
                                              const Group &cons_group) {
     vector<FStage> group_members;
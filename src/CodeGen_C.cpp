@@ -1620,6 +1620,13 @@ void CodeGen_C::compile(const Module &input) {
             set_name_mangling_mode(NameMangling::C);
             e.emit_c_declarations(stream);
         }
+
+        if (target.has_feature(Target::BatchEntryPoint)) {
+            // Called by the batched entry points; not in HalideRuntime.h.
+            set_name_mangling_mode(NameMangling::C);
+            stream << "int halide_do_batch(void *user_context, int (*pipeline)(void **args), "
+                   << "int count, void ***args, int *results);\n";
+        }
     }
 
     for (const auto &b : input.buffers()) {
@@ -1712,6 +1719,34 @@ void CodeGen_C::compile(const LoweredFunc &f) {
 
         indent -= 1;
         stream << "}\n";
+
+        if (f.linkage == LinkageType::ExternalPlusMetadata &&
+            target.has_feature(Target::BatchEntryPoint)) {
+            // The batched entry point. halide_do_batch runs an argv-style
+            // function per item, and this backend doesn't emit the
+            // _argv wrapper, so define a private one to pass it.
+            stream << "\nstatic int " << simple_name << "_batch_item(void **args) {\n";
+            indent += 1;
+            stream << get_indent() << "return " << simple_name << "(";
+            for (size_t i = 0; i < args.size(); i++) {
+                if (args[i].is_buffer()) {
+                    stream << "(struct halide_buffer_t *)args[" << i << "]";
+                } else {
+                    stream << "*(" << print_type(args[i].type) << " *)args[" << i << "]";
+                }
+
+                if (i < args.size() - 1) stream << ", ";
+            }
+            stream << ");\n";
+            indent -= 1;
+            stream << "}\n";
+
+            stream << "\nHALIDE_FUNCTION_ATTRS\nint " << simple_name << "_batch(int count, void ***args, int *results) {\n";
+            indent += 1;
+            stream << get_indent() << "return halide_do_batch(nullptr, " << simple_name << "_batch_item, count, args, results);\n";
+            indent -= 1;
+            stream << "}\n";
+        }
     }
 
     if (is_header_or_extern_decl() && f.linkage == LinkageType::ExternalPlusMetadata) {
@@ -1720,6 +1755,11 @@ void CodeGen_C::compile(const LoweredFunc &f) {
 
         // And also the metadata.
         stream << "\nHALIDE_FUNCTION_ATTRS\nconst struct halide_filter_metadata_t *" << simple_name << "_metadata();\n";
+
+        if (target.has_feature(Target::BatchEntryPoint)) {
+            // And the batched entry point.
+            stream << "\nHALIDE_FUNCTION_ATTRS\nint " << simple_name << "_batch(int count, void ***args, int *results);\n";
+        }
     }
 
     if (!namespaces.empty()) {
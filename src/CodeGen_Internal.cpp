@@ -141,6 +141,7 @@ llvm::Type *llvm_type_of(LLVMContext *c, Halide::Type t) {
 bool function_takes_user_context(const std::string &name) {
     static const char *user_context_runtime_funcs[] = {
         "halide_buffer_copy",
+        "halide_cancelled",
         "halide_copy_to_host",
         "halide_copy_to_device",
         "halide_current_time_ns",
@@ -165,6 +166,7 @@ bool function_takes_user_context(const std::string &name) {
         "halide_profiler_memory_free",
         "halide_profiler_pipeline_start",
         "halide_profiler_pipeline_end",
+        "halide_profiler_perf_counters_update",
         "halide_profiler_stack_peak_update",
         "halide_spawn_thread",
         "halide_device_release",
@@ -505,6 +505,7 @@ struct MangledNames {
     string extern_name;
     string argv_name;
     string metadata_name;
+    string batch_name;
 };
 
 MangledNames get_mangled_names(const std::string &name,
@@ -518,6 +519,7 @@ MangledNames get_mangled_names(const std::string &name,
     names.extern_name = names.simple_name;
     names.argv_name = names.simple_name + "_argv";
     names.metadata_name = names.simple_name + "_metadata";
+    names.batch_name = names.simple_name + "_batch";
 
     if (linkage != LinkageType::Internal &&
         ((mangling == NameMangling::Default &&
@@ -538,6 +540,15 @@ MangledNames get_mangled_names(const std::string &name,
         Type void_star_star(Handle(1, &inner_type));
         names.argv_name = cplusplus_function_mangled_name(names.argv_name, namespaces, type_of<int>(), {ExternFuncArgument(make_zero(void_star_star))}, target);
         names.metadata_name = cplusplus_function_mangled_name(names.metadata_name, namespaces, type_of<const struct halide_filter_metadata_t *>(), {}, target);
+        halide_handle_cplusplus_type args_type(halide_cplusplus_type_name(halide_cplusplus_type_name::Simple, "void"), {}, {},
+                                               {halide_handle_cplusplus_type::Pointer, halide_handle_cplusplus_type::Pointer, halide_handle_cplusplus_type::Pointer});
+        halide_handle_cplusplus_type results_type(halide_cplusplus_type_name(halide_cplusplus_type_name::Simple, "int"), {}, {},
+                                                  {halide_handle_cplusplus_type::Pointer});
+        names.batch_name = cplusplus_function_mangled_name(names.batch_name, namespaces, type_of<int>(),
+                                                           {ExternFuncArgument(make_zero(Int(32))),
+                                                            ExternFuncArgument(make_zero(Type(Handle(1, &args_type)))),
+                                                            ExternFuncArgument(make_zero(Type(Handle(1, &results_type))))},
+                                                           target);
     }
     return names;
 }
@@ -662,6 +673,9 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
             if (target.has_feature(Target::Matlab)) {
                 define_matlab_wrapper(module.get(), wrapper, metadata_getter);
             }
+            if (target.has_feature(Target::BatchEntryPoint)) {
+                add_batch_wrapper(wrapper, names.batch_name);
+            }
         }
     }
 
@@ -1099,6 +1113,42 @@ llvm::Function *CodeGen_LLVM::add_argv_wrapper(llvm::Function *fn,
     return wrapper_func;
 }
 
+llvm::Function *CodeGen_LLVM::add_batch_wrapper(llvm::Function *argv_wrapper,
+                                                const std::string &name) {
+    // The work is done by halide_do_batch in the runtime; this is just
+    // a thunk that passes it the argv wrapper to run.
+    llvm::Type *args_t = i8_t->getPointerTo()->getPointerTo()->getPointerTo();
+    llvm::Type *results_t = i32_t->getPointerTo();
+    llvm::Function *do_batch = module->getFunction("halide_do_batch");
+    if (!do_batch) {
+        llvm::Type *do_batch_args_t[] = {i8_t->getPointerTo(), argv_wrapper->getType(), i32_t, args_t, results_t};
+        llvm::FunctionType *do_batch_t = llvm::FunctionType::get(i32_t, do_batch_args_t, false);
+        do_batch = llvm::Function::Create(do_batch_t, llvm::GlobalValue::ExternalLinkage, "halide_do_batch", module.get());
+    }
+
+    llvm::Type *batch_args_t[] = {i32_t, args_t, results_t};
+    llvm::FunctionType *batch_func_t = llvm::FunctionType::get(i32_t, batch_args_t, false);
+    llvm::Function *batch_func = llvm::Function::Create(batch_func_t, llvm::GlobalValue::ExternalLinkage, name, module.get());
+    llvm::BasicBlock *block = llvm::BasicBlock::Create(module->getContext(), "entry", batch_func);
+    builder->SetInsertPoint(block);
+
+    llvm::Function::arg_iterator arg = batch_func->arg_begin();
+    llvm::Value *count = iterator_to_pointer(arg++);
+    llvm::Value *args = iterator_to_pointer(arg++);
+    llvm::Value *results = iterator_to_pointer(arg++);
+    llvm::FunctionType *do_batch_t = do_batch->getFunctionType();
+    llvm::Value *call_args[] = {
+        ConstantPointerNull::get(i8_t->getPointerTo()),
+        builder->CreatePointerCast(argv_wrapper, do_batch_t->getParamType(1)),
+        count,
+        builder->CreatePointerCast(args, do_batch_t->getParamType(3)),
+        builder->CreatePointerCast(results, do_batch_t->getParamType(4)),
+    };
+    builder->CreateRet(builder->CreateCall(do_batch, call_args));
+    internal_assert(!verifyFunction(*batch_func, &llvm::errs()));
+    return batch_func;
+}
+
 llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_name,
                                                     const std::string &function_name, const std::vector<LoweredArgument> &args,
                                                     const std::map<std::string, std::string> &metadata_name_map) {
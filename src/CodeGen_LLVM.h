@@ -552,6 +552,13 @@ private:
 
     llvm::Function *add_argv_wrapper(llvm::Function *fn, const std::string &name, bool result_in_argv = false);
 
+    /** Make an entry point with the signature
+     * int name(int count, void ***args, int *results), which runs the
+     * given argv wrapper once per element of args, in parallel across
+     * the batch. Per-item results are stored in results if it is
+     * non-null. Used for the batch_entry_point target feature. */
+    llvm::Function *add_batch_wrapper(llvm::Function *argv_wrapper, const std::string &name);
+
     llvm::Value *codegen_dense_vector_load(const Load *load, llvm::Value *vpred = nullptr);
 
     virtual void codegen_predicated_vector_load(const Load *op);
@@ -3119,6 +3119,14 @@ void Func::set_custom_print(void (*cust_print)(void *, const char *)) {
     pipeline().set_custom_print(cust_print);
 }
 
+void Func::set_custom_cancelled(int (*cust_cancelled)(void *)) {
+    pipeline().set_custom_cancelled(cust_cancelled);
+}
+
+void Func::set_custom_get_job_priority(void (*cust_get_job_priority)(void *, halide_job_priority_t *)) {
+    pipeline().set_custom_get_job_priority(cust_get_job_priority);
+}
+
 void Func::add_custom_lowering_pass(IRMutator *pass, std::function<void()> deleter) {
     pipeline().add_custom_lowering_pass(pass, std::move(deleter));
 }
@@ -3149,4 +3157,8 @@ void Func::compile_jit(const Target &target) {
     pipeline().compile_jit(target);
 }
 
+Target Func::realize_target(const Target &t) {
+    return pipeline().realize_target(t);
+}
+
 }  // namespace Halide
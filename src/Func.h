@@ -903,7 +903,9 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. If the Func was last realized with the profile and
+     * profile_by_loop target features, the html is annotated with the
+     * time per run spent in each loop. */
     void compile_to_lowered_stmt(const std::string &filename,
                                  const std::vector<Argument> &args,
                                  StmtOutputFormat fmt = Text,
@@ -964,6 +966,10 @@ public:
      */
     void compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** The target that realize uses when given the target t. See
+     * Pipeline::realize_target. */
+    Target realize_target(const Target &t = Target());
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -1060,6 +1066,33 @@ public:
      */
     void set_custom_print(void (*handler)(void *, const char *));
 
+    /** Set a function that the pipeline polls to find out whether it
+     * should stop early. It is called before each parallel task is
+     * dispatched and before each top-level stage is computed; if it
+     * returns non-zero, the pipeline returns
+     * halide_error_code_cancelled without computing anything
+     * further. The contents of the output buffers are then
+     * undefined. The function may be called concurrently from
+     * multiple threads, so it should be cheap and thread-safe
+     * (e.g. read an atomic flag). Stage-level checks are compiled
+     * out when the no_asserts target feature is set. If you are
+     * compiling statically, you can also just define your own
+     * version of halide_cancelled (see HalideRuntime.h), and it will
+     * clobber Halide's version.
+     */
+    void set_custom_cancelled(int (*cancelled)(void *));
+
+    /** Set a function that the default thread pool calls to find out
+     * the priority and deadline of this pipeline's parallel work, so
+     * that latency-critical pipelines can share the thread pool with
+     * background ones without being starved. Idle threads prefer
+     * jobs with a higher priority, and among those, an earlier
+     * deadline. See halide_job_priority_t in HalideRuntime.h. If you
+     * are compiling statically, use halide_set_custom_get_job_priority
+     * instead.
+     */
+    void set_custom_get_job_priority(void (*get_job_priority)(void *, halide_job_priority_t *));
+
     /** Get a struct containing the currently set custom functions
      * used by JIT. */
     const Internal::JITHandlers &jit_handlers();
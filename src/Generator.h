@@ -227,7 +227,8 @@
  *  - 'machine_params' is only used if auto_schedule is true; it is ignored
  *    if auto_schedule is false. It provides details about the machine architecture
  *    being targeted which may be used to enhance the automatically-generated
- *    schedule.
+ *    schedule. Pass machine_params=host to describe the machine running the
+ *    Generator.
  *
  * Generators are added to a global registry to simplify AOT build mechanics; this
  * is done by simply using the HALIDE_REGISTER_GENERATOR macro at global scope:
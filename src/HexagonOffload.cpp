@@ -967,6 +967,7 @@ Stmt inject_hexagon_rpc(Stmt s, const Target &host_target,
     // constitutes valid debug info.
     static const Target::Feature shared_features[] = {
         Target::Profile,
+        Target::ProfileByLoop,
         Target::NoAsserts,
         Target::HVX_64,
         Target::HVX_128,
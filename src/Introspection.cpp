@@ -6,10 +6,15 @@
 #include "Error.h"
 #include "LLVM_Headers.h"
 
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <stdio.h>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // defines backtrace, which gets the call stack as instruction pointers
 #include <execinfo.h>
@@ -54,6 +59,100 @@ typedef uint64_t llvm_offset_t;
 typedef uint32_t llvm_offset_t;
 #endif
 
+// Serialization for the on-disk index of the parsed debug info (see
+// DebugSections::save_index). The index is only ever read back by the
+// same binary, so plain host-endian fields are fine.
+class IndexWriter {
+    std::string &out;
+
+public:
+    IndexWriter(std::string &out)
+        : out(out) {
+    }
+
+    template<typename T>
+    void pod(T x) {
+        out.append((const char *)&x, sizeof(x));
+    }
+
+    void str(const std::string &s) {
+        pod<uint64_t>(s.size());
+        out.append(s);
+    }
+};
+
+class IndexReader {
+    const std::string &in;
+    size_t pos;
+
+public:
+    bool ok;
+
+    IndexReader(const std::string &in)
+        : in(in), pos(0), ok(true) {
+    }
+
+    template<typename T>
+    T pod() {
+        T x = T();
+        if (!ok || in.size() - pos < sizeof(T)) {
+            ok = false;
+            return x;
+        }
+        memcpy(&x, in.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return x;
+    }
+
+    std::string str() {
+        uint64_t n = pod<uint64_t>();
+        if (!ok || in.size() - pos < n) {
+            ok = false;
+            return "";
+        }
+        std::string s = in.substr(pos, n);
+        pos += n;
+        return s;
+    }
+
+    // The length of a vector. Every element takes at least one byte,
+    // so a corrupt index can't make us allocate more than its size.
+    size_t count() {
+        uint64_t n = pod<uint64_t>();
+        if (!ok || in.size() - pos < n) {
+            ok = false;
+            return 0;
+        }
+        return (size_t)n;
+    }
+
+    bool done() const {
+        return ok && pos == in.size();
+    }
+};
+
+const char *const index_magic = "Halide introspection index v1";
+
+// Where to keep indices of parsed debug info, or the empty string if
+// they shouldn't be cached.
+std::string index_cache_dir() {
+    std::string dir = get_env_variable("HL_INTROSPECTION_CACHE_DIR");
+    if (dir == "0") {
+        return "";
+    } else if (!dir.empty()) {
+        return dir;
+    }
+    std::string base = get_env_variable("XDG_CACHE_HOME");
+    if (base.empty()) {
+        std::string home = get_env_variable("HOME");
+        if (home.empty()) {
+            return "";
+        }
+        base = home + "/.cache";
+    }
+    return base + "/halide";
+}
+
 }  // namespace
 
 class DebugSections {
@@ -937,14 +1036,300 @@ private:
         obj = maybe_obj.get().getBinary();
 
         if (obj) {
+            // Parsing the debug info of a large binary can take
+            // seconds, so reuse the result of a previous run of the
+            // same build if we have it.
+            std::string index_path;
+            std::string id = get_build_id(obj);
+            std::string cache_dir = index_cache_dir();
+            if (!id.empty() && !cache_dir.empty()) {
+                index_path = cache_dir + "/introspection-" + id + ".idx";
+                if (load_index(index_path, id)) {
+                    debug(2) << "Loaded debug info index from " << index_path << "\n";
+                    working = true;
+                    return;
+                }
+            }
+
             working = true;
             parse_object_file(obj);
+
+            if (working && !index_path.empty()) {
+                save_index(cache_dir, index_path, id);
+            }
         } else {
             debug(1) << "Could not load object file: " << binary << "\n";
             working = false;
         }
     }
 
+    // Get the GNU build-id of a binary as a hex string, or the empty
+    // string if it doesn't have one.
+    std::string get_build_id(llvm::object::ObjectFile *obj) {
+        for (llvm::object::section_iterator iter = obj->section_begin();
+             iter != obj->section_end(); ++iter) {
+#if LLVM_VERSION >= 100
+            auto expected_name = iter->getName();
+            if (!expected_name) {
+                consumeError(expected_name.takeError());
+                continue;
+            }
+            llvm::StringRef name = expected_name.get();
+#else
+            llvm::StringRef name;
+            iter->getName(name);
+#endif
+            if (name != ".note.gnu.build-id") {
+                continue;
+            }
+            llvm::StringRef note;
+#if LLVM_VERSION >= 90
+            auto e = iter->getContents();
+            if (!e) {
+                consumeError(e.takeError());
+                return "";
+            }
+            note = *e;
+#else
+            iter->getContents(note);
+#endif
+            // An ELF note: namesz, descsz, type, the name ("GNU")
+            // padded to four bytes, and then the id itself.
+            const uint8_t *data = (const uint8_t *)note.data();
+            if (note.size() < 12) {
+                return "";
+            }
+            uint32_t namesz = load_misaligned((const uint32_t *)data);
+            uint32_t descsz = load_misaligned((const uint32_t *)(data + 4));
+            uint64_t desc_start = 12 + (((uint64_t)namesz + 3) & ~(uint64_t)3);
+            if (descsz == 0 || desc_start + descsz > note.size()) {
+                return "";
+            }
+            std::ostringstream oss;
+            oss << std::hex;
+            for (uint32_t i = 0; i < descsz; i++) {
+                oss << (int)(data[desc_start + i] >> 4) << (int)(data[desc_start + i] & 0xf);
+            }
+            return oss.str();
+        }
+        return "";
+    }
+
+    void write_type_ref(IndexWriter &w, const TypeInfo *t) {
+        w.pod<int64_t>(t ? (int64_t)(t - types.data()) : -1);
+    }
+
+    TypeInfo *read_type_ref(IndexReader &r) {
+        int64_t idx = r.pod<int64_t>();
+        if (idx < -1 || idx >= (int64_t)types.size()) {
+            r.ok = false;
+            return nullptr;
+        }
+        return idx < 0 ? nullptr : &types[idx];
+    }
+
+    void write_local_variable(IndexWriter &w, const LocalVariable &v) {
+        w.str(v.name);
+        write_type_ref(w, v.type);
+        w.pod<int32_t>(v.stack_offset);
+        w.pod<uint64_t>(v.type_def_loc);
+        w.pod<uint64_t>(v.def_loc);
+        w.pod<uint64_t>(v.origin_loc);
+        w.pod<uint64_t>(v.live_ranges.size());
+        for (const LiveRange &l : v.live_ranges) {
+            w.pod<uint64_t>(l.pc_begin);
+            w.pod<uint64_t>(l.pc_end);
+        }
+    }
+
+    void read_local_variable(IndexReader &r, LocalVariable &v) {
+        v.name = r.str();
+        v.type = read_type_ref(r);
+        v.stack_offset = r.pod<int32_t>();
+        v.type_def_loc = r.pod<uint64_t>();
+        v.def_loc = r.pod<uint64_t>();
+        v.origin_loc = r.pod<uint64_t>();
+        v.live_ranges.resize(r.count());
+        for (LiveRange &l : v.live_ranges) {
+            l.pc_begin = r.pod<uint64_t>();
+            l.pc_end = r.pod<uint64_t>();
+        }
+    }
+
+    // Write out everything the queries use, as it stands after
+    // parsing (i.e. before calibrate_pc_offset adjusts it for where
+    // the binary was loaded this time). Types are referred to by index.
+    void save_index(const std::string &dir, const std::string &path, const std::string &id) {
+        std::string data;
+        IndexWriter w(data);
+        w.str(index_magic);
+        w.str(id);
+
+        w.pod<uint64_t>(types.size());
+        for (const TypeInfo &t : types) {
+            w.str(t.name);
+            w.pod<uint64_t>(t.size);
+            w.pod<uint64_t>(t.def_loc);
+            w.pod<int32_t>(t.type);
+            w.pod<uint64_t>(t.members.size());
+            for (const LocalVariable &m : t.members) {
+                write_local_variable(w, m);
+            }
+        }
+
+        w.pod<uint64_t>(functions.size());
+        for (const FunctionInfo &f : functions) {
+            w.str(f.name);
+            w.pod<uint64_t>(f.pc_begin);
+            w.pod<uint64_t>(f.pc_end);
+            w.pod<uint64_t>(f.def_loc);
+            w.pod<uint64_t>(f.spec_loc);
+            w.pod<int32_t>(f.frame_base);
+            w.pod<uint64_t>(f.variables.size());
+            for (const LocalVariable &v : f.variables) {
+                write_local_variable(w, v);
+            }
+        }
+
+        w.pod<uint64_t>(global_variables.size());
+        for (const GlobalVariable &g : global_variables) {
+            w.str(g.name);
+            write_type_ref(w, g.type);
+            w.pod<uint64_t>(g.type_def_loc);
+            w.pod<uint64_t>(g.def_loc);
+            w.pod<uint64_t>(g.spec_loc);
+            w.pod<uint64_t>(g.addr);
+        }
+
+        w.pod<uint64_t>(source_files.size());
+        for (const std::string &f : source_files) {
+            w.str(f);
+        }
+
+        w.pod<uint64_t>(source_lines.size());
+        for (const LineInfo &l : source_lines) {
+            w.pod<uint64_t>(l.pc);
+            w.pod<uint32_t>(l.line);
+            w.pod<uint32_t>(l.file);
+        }
+
+        // Failing to cache is harmless. Write to a temporary file and
+        // rename it into place, so that concurrent runs never see a
+        // partial index.
+        size_t last_slash = dir.rfind('/');
+        if (last_slash != std::string::npos && last_slash > 0) {
+            mkdir(dir.substr(0, last_slash).c_str(), 0755);
+        }
+        mkdir(dir.c_str(), 0755);
+        std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+        {
+            std::ofstream f(tmp_path, std::ios::binary);
+            f.write(data.data(), data.size());
+            if (!f.good()) {
+                debug(2) << "Could not write debug info index to " << tmp_path << "\n";
+                f.close();
+                unlink(tmp_path.c_str());
+                return;
+            }
+        }
+        if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+            unlink(tmp_path.c_str());
+            return;
+        }
+        debug(2) << "Saved debug info index to " << path << "\n";
+    }
+
+    // Load an index written by save_index. Returns false, leaving
+    // everything empty, if it's missing, for another binary, or
+    // corrupt.
+    bool load_index(const std::string &path, const std::string &id) {
+        std::string data;
+        {
+            std::ifstream f(path, std::ios::binary);
+            if (!f) {
+                return false;
+            }
+            std::ostringstream oss;
+            oss << f.rdbuf();
+            data = oss.str();
+        }
+
+        IndexReader r(data);
+        if (r.str() != index_magic || r.str() != id) {
+            return false;
+        }
+
+        types.resize(r.count());
+        for (TypeInfo &t : types) {
+            t.name = r.str();
+            t.size = r.pod<uint64_t>();
+            t.def_loc = r.pod<uint64_t>();
+            int32_t kind = r.pod<int32_t>();
+            if (kind < TypeInfo::Primitive || kind > TypeInfo::Array) {
+                r.ok = false;
+            }
+            t.type = (decltype(t.type))kind;
+            t.members.resize(r.count());
+            for (LocalVariable &m : t.members) {
+                read_local_variable(r, m);
+            }
+        }
+
+        functions.resize(r.count());
+        for (FunctionInfo &f : functions) {
+            f.name = r.str();
+            f.pc_begin = r.pod<uint64_t>();
+            f.pc_end = r.pod<uint64_t>();
+            f.def_loc = r.pod<uint64_t>();
+            f.spec_loc = r.pod<uint64_t>();
+            int32_t frame_base = r.pod<int32_t>();
+            if (frame_base < FunctionInfo::Unknown || frame_base > FunctionInfo::ClangNoFP) {
+                r.ok = false;
+            }
+            f.frame_base = (decltype(f.frame_base))frame_base;
+            f.variables.resize(r.count());
+            for (LocalVariable &v : f.variables) {
+                read_local_variable(r, v);
+            }
+        }
+
+        global_variables.resize(r.count());
+        for (GlobalVariable &g : global_variables) {
+            g.name = r.str();
+            g.type = read_type_ref(r);
+            g.type_def_loc = r.pod<uint64_t>();
+            g.def_loc = r.pod<uint64_t>();
+            g.spec_loc = r.pod<uint64_t>();
+            g.addr = r.pod<uint64_t>();
+        }
+
+        source_files.resize(r.count());
+        for (std::string &f : source_files) {
+            f = r.str();
+        }
+
+        source_lines.resize(r.count());
+        for (LineInfo &l : source_lines) {
+            l.pc = r.pod<uint64_t>();
+            l.line = r.pod<uint32_t>();
+            l.file = r.pod<uint32_t>();
+            if (l.file >= source_files.size()) {
+                r.ok = false;
+            }
+        }
+
+        if (!r.done()) {
+            debug(2) << "Ignoring corrupt debug info index " << path << "\n";
+            types.clear();
+            functions.clear();
+            global_variables.clear();
+            source_files.clear();
+            source_lines.clear();
+            return false;
+        }
+        return true;
+    }
+
     void parse_object_file(llvm::object::ObjectFile *obj) {
         // Look for the debug_info, debug_abbrev, debug_line, and debug_str sections
         llvm::StringRef debug_info, debug_abbrev, debug_str, debug_line, debug_ranges;
@@ -2245,56 +2630,141 @@ private:
 };
 
 namespace {
+
 DebugSections *debug_sections = nullptr;
+
+// The compilation units that have registered a test routine (see
+// test_compilation_unit) which hasn't been run yet. Loading the debug
+// info and running the tests is deferred until something first asks
+// for it, so that programs that never need a name don't pay for
+// parsing their own debug info at startup.
+struct PendingTest {
+    bool (*test)(bool (*)(const void *, const std::string &));
+    bool (*test_a)(const void *, const std::string &);
+    void (*calib)();
+};
+
+// These may be used during static initialization, so construct them
+// on first use.
+vector<PendingTest> &pending_tests() {
+    static vector<PendingTest> *tests = new vector<PendingTest>;
+    return *tests;
+}
+
+std::recursive_mutex &introspection_mutex() {
+    static std::recursive_mutex *mutex = new std::recursive_mutex;
+    return *mutex;
+}
+
+std::atomic<bool> tests_pending{false};
+
+bool saves_frame_pointer(void *fn) {
+    // On x86-64, if we save the frame pointer, the first two instructions should be pushing the stack pointer and the frame pointer:
+    const uint8_t *ptr = (const uint8_t *)(fn);
+    return ptr[0] == 0x55;  // push %rbp
 }
 
+void run_test(const PendingTest &t) {
+    debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(t.calib) << "\n";
+
+    if (!debug_sections) {
+        char path[2048];
+        get_program_name(path, sizeof(path));
+        debug_sections = new DebugSections(path);
+    }
+
+    if (!saves_frame_pointer(reinterpret_bits<void *>(&test_compilation_unit)) ||
+        !saves_frame_pointer(reinterpret_bits<void *>(t.test))) {
+        // Make sure libHalide and the test compilation unit both save the frame pointer
+        debug_sections->working = false;
+        debug(5) << "Failed because frame pointer not saved\n";
+    } else if (debug_sections->working) {
+        debug_sections->calibrate_pc_offset(t.calib);
+        if (!debug_sections->working) {
+            debug(5) << "Failed because offset calibration failed\n";
+            return;
+        }
+
+        debug_sections->working = (*t.test)(t.test_a);
+        if (!debug_sections->working) {
+            debug(5) << "Failed because test routine failed\n";
+            return;
+        }
+
+        debug(5) << "Test passed\n";
+    }
+}
+
+// Get the debug info if introspection is working, loading it and
+// running any pending tests first.
+DebugSections *get_debug_sections() {
+    if (tests_pending) {
+        std::lock_guard<std::recursive_mutex> lock(introspection_mutex());
+        // The tests themselves query the debug info, which lands back
+        // here on the same thread, so don't recurse into them. Other
+        // threads wait on the lock until they are all done.
+        static bool running = false;
+        if (!running) {
+            running = true;
+            while (!pending_tests().empty()) {
+                PendingTest t = pending_tests().front();
+                pending_tests().erase(pending_tests().begin());
+                run_test(t);
+            }
+            tests_pending = false;
+            running = false;
+        }
+    }
+    if (debug_sections && debug_sections->working) {
+        return debug_sections;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
 bool dump_stack_frame() {
-    if (!debug_sections || !debug_sections->working) {
+    DebugSections *sections = get_debug_sections();
+    if (!sections) {
         return false;
     }
     void *ptr = __builtin_return_address(0);
-    return debug_sections->dump_stack_frame(ptr);
+    return sections->dump_stack_frame(ptr);
 }
 
 std::string get_variable_name(const void *var, const std::string &expected_type) {
-    if (!debug_sections) return "";
-    if (!debug_sections->working) return "";
-    std::string name = debug_sections->get_stack_variable_name(var, expected_type);
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return "";
+    std::string name = sections->get_stack_variable_name(var, expected_type);
     if (name.empty()) {
         // Maybe it's a member of a heap object.
-        name = debug_sections->get_heap_member_name(var, expected_type);
+        name = sections->get_heap_member_name(var, expected_type);
     }
     if (name.empty()) {
         // Maybe it's a global
-        name = debug_sections->get_global_variable_name(var, expected_type);
+        name = sections->get_global_variable_name(var, expected_type);
     }
 
     return name;
 }
 
 std::string get_source_location() {
-    if (!debug_sections) return "";
-    if (!debug_sections->working) return "";
-    return debug_sections->get_source_location();
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return "";
+    return sections->get_source_location();
 }
 
 void register_heap_object(const void *obj, size_t size, const void *helper) {
-    if (!debug_sections) return;
-    if (!debug_sections->working) return;
     if (!helper) return;
-    debug_sections->register_heap_object(obj, size, helper);
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return;
+    sections->register_heap_object(obj, size, helper);
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
-    if (!debug_sections) return;
-    if (!debug_sections->working) return;
-    debug_sections->deregister_heap_object(obj, size);
-}
-
-bool saves_frame_pointer(void *fn) {
-    // On x86-64, if we save the frame pointer, the first two instructions should be pushing the stack pointer and the frame pointer:
-    const uint8_t *ptr = (const uint8_t *)(fn);
-    return ptr[0] == 0x55;  // push %rbp
+    DebugSections *sections = get_debug_sections();
+    if (!sections) return;
+    sections->deregister_heap_object(obj, size);
 }
 
 void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string &)),
@@ -2309,34 +2779,15 @@ void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string
         return;
     }
 
-    debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(calib) << "\n";
-
-    if (!debug_sections) {
-        char path[2048];
-        get_program_name(path, sizeof(path));
-        debug_sections = new DebugSections(path);
+    // Production builds may turn introspection off altogether. Names
+    // then come from unique_name alone, which is still deterministic.
+    if (get_env_variable("HL_DISABLE_INTROSPECTION") == "1") {
+        return;
     }
 
-    if (!saves_frame_pointer(reinterpret_bits<void *>(&test_compilation_unit)) ||
-        !saves_frame_pointer(reinterpret_bits<void *>(test))) {
-        // Make sure libHalide and the test compilation unit both save the frame pointer
-        debug_sections->working = false;
-        debug(5) << "Failed because frame pointer not saved\n";
-    } else if (debug_sections->working) {
-        debug_sections->calibrate_pc_offset(calib);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because offset calibration failed\n";
-            return;
-        }
-
-        debug_sections->working = (*test)(test_a);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because test routine failed\n";
-            return;
-        }
-
-        debug(5) << "Test passed\n";
-    }
+    std::lock_guard<std::recursive_mutex> lock(introspection_mutex());
+    pending_tests().push_back({test, test_a, calib});
+    tests_pending = true;
 
 #endif
 }
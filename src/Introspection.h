@@ -12,6 +12,14 @@
  * Defines methods for introspecting in C++. Relies on DWARF debugging
  * metadata, so the compilation unit that uses this must be compiled
  * with -g.
+ *
+ * The debug info is loaded on the first query, not at startup. The
+ * parsed result is cached on disk, keyed by the binary's GNU build-id,
+ * in $HL_INTROSPECTION_CACHE_DIR (default $XDG_CACHE_HOME/halide or
+ * ~/.cache/halide; set it to 0 to disable caching). Setting
+ * HL_DISABLE_INTROSPECTION=1 turns introspection off entirely, in
+ * which case Funcs and Vars get the same deterministic generated
+ * names as in builds without introspection.
  */
 
 namespace Halide {
@@ -59,8 +67,9 @@ const void *get_introspection_helper() {
 std::string get_source_location();
 
 // This gets called automatically by anyone who includes Halide.h by
-// the code below. It tests if this functionality works for the given
-// compilation unit, and disables it if not.
+// the code below. It registers a test of whether this functionality
+// works for the given compilation unit, which is run (disabling
+// introspection if it fails) before the first query is answered.
 void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string &)),
                            bool (*test_a)(const void *, const std::string &),
                            void (*calib)());
@@ -510,6 +510,12 @@ void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_get_library_symbol) {
         base.custom_get_library_symbol = addins.custom_get_library_symbol;
     }
+    if (addins.custom_cancelled) {
+        base.custom_cancelled = addins.custom_cancelled;
+    }
+    if (addins.custom_get_job_priority) {
+        base.custom_get_job_priority = addins.custom_get_job_priority;
+    }
 }
 
 void print_handler(void *context, const char *msg) {
@@ -577,6 +583,24 @@ int32_t trace_handler(void *context, const halide_trace_event_t *e) {
     }
 }
 
+int cancelled_handler(void *context) {
+    if (context) {
+        JITUserContext *jit_user_context = (JITUserContext *)context;
+        return (*jit_user_context->handlers.custom_cancelled)(context);
+    } else {
+        return (*active_handlers.custom_cancelled)(context);
+    }
+}
+
+void get_job_priority_handler(void *context, halide_job_priority_t *priority) {
+    if (context) {
+        JITUserContext *jit_user_context = (JITUserContext *)context;
+        (*jit_user_context->handlers.custom_get_job_priority)(context, priority);
+    } else {
+        (*active_handlers.custom_get_job_priority)(context, priority);
+    }
+}
+
 void *get_symbol_handler(const char *name) {
     return (*active_handlers.custom_get_symbol)(name);
 }
@@ -801,6 +825,12 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             runtime_internal_handlers.custom_trace =
                 hook_function(runtime.exports(), "halide_set_custom_trace", trace_handler);
 
+            runtime_internal_handlers.custom_cancelled =
+                hook_function(runtime.exports(), "halide_set_custom_cancelled", cancelled_handler);
+
+            runtime_internal_handlers.custom_get_job_priority =
+                hook_function(runtime.exports(), "halide_set_custom_get_job_priority", get_job_priority_handler);
+
             runtime_internal_handlers.custom_get_symbol =
                 hook_function(shared_runtimes(MainShared).exports(), "halide_set_custom_get_symbol", get_symbol_handler);
 
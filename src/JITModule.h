@@ -147,6 +147,8 @@ struct JITHandlers {
     void *(*custom_get_symbol)(const char *name){nullptr};
     void *(*custom_load_library)(const char *name){nullptr};
     void *(*custom_get_library_symbol)(void *lib, const char *name){nullptr};
+    int (*custom_cancelled)(void *){nullptr};
+    void (*custom_get_job_priority)(void *, halide_job_priority_t *){nullptr};
 };
 
 struct JITUserContext {
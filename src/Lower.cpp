@@ -6,6 +6,7 @@
 #include "Lower.h"
 
 #include "AddAtomicMutex.h"
+#include "AddCancellationChecks.h"
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
@@ -380,9 +381,16 @@ Module lower(const vector<Function> &output_funcs,
     debug(2) << "Lowering after bounding small allocations:\n"
              << s << "\n\n";
 
+    if (!t.has_feature(Target::NoAsserts)) {
+        debug(1) << "Adding cancellation checks...\n";
+        s = add_cancellation_checks(s);
+        debug(2) << "Lowering after adding cancellation checks:\n"
+                 << s << "\n\n";
+    }
+
     if (t.has_feature(Target::Profile)) {
         debug(1) << "Injecting profiling...\n";
-        s = inject_profiling(s, pipeline_name);
+        s = inject_profiling(s, pipeline_name, t);
         debug(2) << "Lowering after injecting profiling:\n"
                  << s << "\n\n";
     }
@@ -42,6 +42,7 @@ std::map<Output, OutputInfo> get_output_info(const Target &target) {
         {Output::bitcode, {"bitcode", ".bc"}},
         {Output::c_header, {"c_header", ".h"}},
         {Output::c_source, {"c_source", ".halide_generated.cpp"}},
+        {Output::cost_predictions, {"cost_predictions", ".cost_predictions"}},
         {Output::cpp_stub, {"cpp_stub", ".stub.h"}},
         {Output::featurization, {"featurization", ".featurization"}},
         {Output::llvm_assembly, {"llvm_assembly", ".ll"}},
@@ -661,6 +662,16 @@ void Module::compile(const std::map<Output, std::string> &output_files) const {
         }
         binfile.close();
     }
+    if (contains(output_files, Output::cost_predictions)) {
+        debug(1) << "Module.compile(): cost_predictions " << output_files.at(Output::cost_predictions) << "\n";
+        // If there are no predictions, just write an empty file
+        std::ofstream file(output_files.at(Output::cost_predictions));
+        auto *r = contents->auto_scheduler_results.get();
+        if (r) {
+            file << r->cost_predictions;
+        }
+        file.close();
+    }
     if (contains(output_files, Output::registration)) {
         debug(1) << "Module.compile(): registration " << output_files.at(Output::registration) << "\n";
         std::ofstream file(output_files.at(Output::registration));
@@ -757,8 +768,9 @@ void compile_multitarget(const std::string &fn_name,
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
         // Some features must match across all targets.
-        static const std::array<Target::Feature, 9> must_match_features = {{
+        static const std::array<Target::Feature, 10> must_match_features = {{
             Target::ASAN,
+            Target::BatchEntryPoint,
             Target::CPlusPlusMangling,
             Target::Debug,
             Target::JIT,
@@ -780,10 +792,12 @@ void compile_multitarget(const std::string &fn_name,
         std::string sub_fn_name = needs_wrapper ? (fn_name + suffix) : fn_name;
 
         // We always produce the runtime separately, so add NoRuntime explicitly.
-        // Matlab should be added to the wrapper pipeline below, instead of each sub-pipeline.
+        // Matlab and BatchEntryPoint should be added to the wrapper pipeline below, instead of each sub-pipeline.
         Target sub_fn_target = target.with_feature(Target::NoRuntime);
         if (needs_wrapper) {
-            sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
+            sub_fn_target = sub_fn_target
+                                .without_feature(Target::Matlab)
+                                .without_feature(Target::BatchEntryPoint);
         }
 
         Module sub_module = module_producer(sub_fn_name, sub_fn_target);
@@ -877,6 +891,10 @@ void compile_multitarget(const std::string &fn_name,
         if (base_target.has_feature(Target::Matlab)) {
             wrapper_target = wrapper_target.with_feature(Target::Matlab);
         }
+        // Likewise for the batch entry point.
+        if (base_target.has_feature(Target::BatchEntryPoint)) {
+            wrapper_target = wrapper_target.with_feature(Target::BatchEntryPoint);
+        }
 
         Module wrapper_module(fn_name, wrapper_target);
         wrapper_module.append(LoweredFunc(fn_name, base_target_args, wrapper_body, LinkageType::ExternalPlusMetadata));
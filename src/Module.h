@@ -25,6 +25,7 @@ enum class Output {
     bitcode,
     c_header,
     c_source,
+    cost_predictions,
     cpp_stub,
     featurization,
     llvm_assembly,
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <memory>
 #include <utility>
 
 #include "Argument.h"
@@ -15,6 +16,7 @@
 #include "Pipeline.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "StmtToHtml.h"
 #include "WasmExecutor.h"
 
 using namespace Halide::Internal;
@@ -68,6 +70,11 @@ struct PipelineContents {
     // Cached compiled JavaScript and/or wasm if defined */
     WasmModule wasm_module;
 
+    // Milliseconds per run spent in each loop, as measured by the
+    // profiler during the last realize of a jit-compiled pipeline
+    // with the profile_by_loop feature.
+    std::map<string, double> profiled_loop_times;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
@@ -75,6 +82,7 @@ struct PipelineContents {
         jit_target = Target();
         inferred_args.clear();
         wasm_module = WasmModule();
+        profiled_loop_times.clear();
     }
 
     // The outputs
@@ -137,6 +145,13 @@ template<>
 void destroy<PipelineContents>(const PipelineContents *p) {
     delete p;
 }
+
+// Defined with BoundCallContents below, but used before then.
+template<>
+RefCount &ref_count<BoundCallContents>(const BoundCallContents *p) noexcept;
+
+template<>
+void destroy<BoundCallContents>(const BoundCallContents *p);
 }  // namespace Internal
 
 Pipeline::Pipeline()
@@ -325,7 +340,11 @@ void Pipeline::compile_to_lowered_stmt(const string &filename,
                                        StmtOutputFormat fmt,
                                        const Target &target) {
     Module m = compile_to_module(args, "", target);
-    m.compile(single_output(filename, m, fmt == HTML ? Output::stmt_html : Output::stmt));
+    if (fmt == HTML && !contents->profiled_loop_times.empty()) {
+        print_to_html(filename, m, contents->profiled_loop_times);
+    } else {
+        m.compile(single_output(filename, m, fmt == HTML ? Output::stmt_html : Output::stmt));
+    }
 }
 
 void Pipeline::compile_to_static_library(const string &filename_prefix,
@@ -653,6 +672,16 @@ void Pipeline::set_custom_print(void (*cust_print)(void *, const char *)) {
     contents->jit_handlers.custom_print = cust_print;
 }
 
+void Pipeline::set_custom_cancelled(int (*cust_cancelled)(void *)) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    contents->jit_handlers.custom_cancelled = cust_cancelled;
+}
+
+void Pipeline::set_custom_get_job_priority(void (*cust_get_job_priority)(void *, halide_job_priority_t *)) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    contents->jit_handlers.custom_get_job_priority = cust_get_job_priority;
+}
+
 void Pipeline::set_jit_externs(const std::map<std::string, JITExtern> &externs) {
     user_assert(defined()) << "Pipeline is undefined\n";
     contents->jit_externs = externs;
@@ -697,16 +726,20 @@ Realization Pipeline::realize(vector<int32_t> sizes, const Target &target,
         }
     }
     Realization r(bufs);
+    // The same call serves as both the bounds query and the real
+    // computation; allocating the outputs in between doesn't move
+    // their halide_buffer_t.
+    BoundCall call = bind(r, target, param_map);
     // Do an output bounds query if we can. Otherwise just assume the
     // output size is good.
     if (!target.has_feature(Target::NoBoundsQuery)) {
-        realize(r, target, param_map);
+        call.run();
     }
     for (size_t i = 0; i < r.size(); i++) {
         r[i].allocate();
     }
     // Do the actual computation
-    realize(r, target, param_map);
+    call.run();
 
     // Crop back to the requested size if necessary
     bool needs_crop = false;
@@ -870,21 +903,36 @@ struct JITFuncCallContext {
                  << "custom_do_task: " << (void *)jit_context.handlers.custom_do_task << '\n'
                  << "custom_do_par_for: " << (void *)jit_context.handlers.custom_do_par_for << '\n'
                  << "custom_error: " << (void *)jit_context.handlers.custom_error << '\n'
-                 << "custom_trace: " << (void *)jit_context.handlers.custom_trace << '\n';
+                 << "custom_trace: " << (void *)jit_context.handlers.custom_trace << '\n'
+                 << "custom_cancelled: " << (void *)jit_context.handlers.custom_cancelled << '\n'
+                 << "custom_get_job_priority: " << (void *)jit_context.handlers.custom_get_job_priority << '\n';
     }
 
-    void report_if_error(int exit_status) {
+    // Get the error message to report for the given exit status, and
+    // clear the error buffer. Returns an empty string if there is
+    // nothing to report.
+    std::string take_error(int exit_status) {
         // Only report the errors if no custom error handler was installed
+        std::string output;
         if (exit_status && !custom_error_handler) {
-            std::string output = error_buffer.str();
-            if (output.empty()) {
+            output = error_buffer.str();
+            if (output.empty() && exit_status == halide_error_code_cancelled) {
+                output = "The pipeline was cancelled.\n";
+            } else if (output.empty()) {
                 output = ("The pipeline returned exit status " +
                           std::to_string(exit_status) +
                           " but halide_error was never called.\n");
             }
-            halide_runtime_error << output;
             error_buffer.end = 0;
         }
+        return output;
+    }
+
+    void report_if_error(int exit_status) {
+        std::string output = take_error(exit_status);
+        if (!output.empty()) {
+            halide_runtime_error << output;
+        }
     }
 
     void finalize(int exit_status) {
@@ -1055,23 +1103,93 @@ int Pipeline::call_jit_code(const Target &target, const JITCallArgs &args) {
     return contents->jit_module.argv_function()(args.store);
 }
 
-void Pipeline::realize(RealizationArg outputs, const Target &t,
-                       const ParamMap &param_map) {
-    Target target = t;
-    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
-
-    debug(2) << "Realizing Pipeline for " << target << "\n";
+namespace {
 
+// Resolve the target to use when realizing a pipeline.
+Target get_realize_target(const Target &t, const PipelineContents &contents) {
     // If target is unspecified...
-    if (target.os == Target::OSUnknown) {
+    if (t.os == Target::OSUnknown) {
         // If we've already jit-compiled for a specific target, use that.
-        if (contents->jit_module.compiled()) {
-            target = contents->jit_target;
+        if (contents.jit_module.compiled()) {
+            return contents.jit_target;
         } else {
             // Otherwise get the target from the environment
-            target = get_jit_target_from_environment();
+            return get_jit_target_from_environment();
         }
     }
+    return t;
+}
+
+// Read the time per run of every profiled Func and loop out of the
+// profiler state, keyed by name.
+std::map<string, double> get_profiled_times(const JITModule &jit_module) {
+    std::map<string, double> times;
+    JITModule::Symbol state_sym =
+        jit_module.find_symbol_by_name("halide_profiler_get_state");
+    JITModule::Symbol lock_sym =
+        jit_module.find_symbol_by_name("halide_mutex_lock");
+    JITModule::Symbol unlock_sym =
+        jit_module.find_symbol_by_name("halide_mutex_unlock");
+    if (!state_sym.address || !lock_sym.address || !unlock_sym.address) {
+        return times;
+    }
+    auto get_state_fn_ptr = (halide_profiler_state * (*)()) state_sym.address;
+    auto lock_fn_ptr = (void (*)(halide_mutex *))lock_sym.address;
+    auto unlock_fn_ptr = (void (*)(halide_mutex *))unlock_sym.address;
+
+    halide_profiler_state *s = get_state_fn_ptr();
+    lock_fn_ptr(&s->lock);
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (p->runs == 0) {
+            continue;
+        }
+        for (int i = 0; i < p->num_funcs; i++) {
+            const halide_profiler_func_stats &fs = p->funcs[i];
+            times[fs.name] += fs.time / (p->runs * 1000000.0);
+        }
+    }
+    unlock_fn_ptr(&s->lock);
+    return times;
+}
+
+// If we're profiling, report runtimes and reset profiler stats. If
+// loop_times is non-null, it is first filled in with the profiled
+// times.
+void report_and_reset_profiler(const JITModule &jit_module, JITFuncCallContext &jit_context,
+                               std::map<string, double> *loop_times = nullptr) {
+    JITModule::Symbol report_sym =
+        jit_module.find_symbol_by_name("halide_profiler_report");
+    JITModule::Symbol reset_sym =
+        jit_module.find_symbol_by_name("halide_profiler_reset");
+    if (report_sym.address && reset_sym.address) {
+        if (loop_times) {
+            *loop_times = get_profiled_times(jit_module);
+        }
+
+        void *uc = &jit_context.jit_context;
+        void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
+        report_fn_ptr(uc);
+
+        void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
+        reset_fn_ptr();
+    }
+}
+
+}  // namespace
+
+Target Pipeline::realize_target(const Target &t) const {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    return get_realize_target(t, *contents);
+}
+
+void Pipeline::realize(RealizationArg outputs, const Target &t,
+                       const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+
+    debug(2) << "Realizing Pipeline for " << t << "\n";
+
+    Target target = get_realize_target(t, *contents);
 
     // We need to make a context for calling the jitted function to
     // carry the the set of custom handlers. Here's how handlers get
@@ -1147,25 +1265,189 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     int exit_status = call_jit_code(target, args);
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
-    // If we're profiling, report runtimes and reset profiler stats.
     if (target.has_feature(Target::Profile)) {
-        JITModule::Symbol report_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_report");
-        JITModule::Symbol reset_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
-        if (report_sym.address && reset_sym.address) {
-            void *uc = &jit_context.jit_context;
-            void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
-            report_fn_ptr(uc);
-
-            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
-            reset_fn_ptr();
-        }
+        report_and_reset_profiler(contents->jit_module, jit_context,
+                                  target.has_feature(Target::ProfileByLoop) ? &contents->profiled_loop_times : nullptr);
     }
 
     jit_context.finalize(exit_status);
 }
 
+struct BoundCallContents {
+    mutable RefCount ref_count;
+
+    // The handlers and error buffer for every run. The jitted code
+    // gets a pointer to user_context_storage, which points to
+    // jit_context.jit_context, so this struct must not move.
+    JITFuncCallContext jit_context;
+    void *user_context_storage;
+
+    // The marshalled arguments, as passed to the argv function.
+    vector<const void *> args;
+
+    // The code to call. Exactly one of these is defined.
+    JITModule jit_module;
+    WasmModule wasm_module;
+
+    Target target;
+
+    // Keep the storage for the bound Parameters and input Buffers
+    // alive, as args points into them.
+    vector<Parameter> params;
+    vector<Buffer<>> buffers;
+
+    BoundCallContents(const JITHandlers &handlers)
+        : jit_context(handlers), user_context_storage(&jit_context.jit_context) {
+    }
+};
+
+namespace Internal {
+template<>
+RefCount &ref_count<BoundCallContents>(const BoundCallContents *p) noexcept {
+    return p->ref_count;
+}
+
+template<>
+void destroy<BoundCallContents>(const BoundCallContents *p) {
+    delete p;
+}
+}  // namespace Internal
+
+BoundCall Pipeline::bind(RealizationArg outputs, const Target &t,
+                         const ParamMap &param_map) {
+    user_assert(defined()) << "Can't bind an undefined Pipeline\n";
+
+    debug(2) << "Binding Pipeline for " << t << "\n";
+
+    Target target = get_realize_target(t, *contents);
+
+    compile_jit(target);
+
+    BoundCall call;
+    call.contents = new BoundCallContents(jit_handlers());
+    BoundCallContents &c = *call.contents;
+
+    JITCallArgs args(contents->inferred_args.size() + outputs.size());
+    prepare_jit_call_arguments(outputs, target, param_map,
+                               &c.user_context_storage, false, args);
+    c.args.assign(args.store, args.store + args.size);
+
+    for (const InferredArgument &arg : contents->inferred_args) {
+        if (arg.param.defined()) {
+            if (!arg.param.same_as(contents->user_context_arg.param)) {
+                Buffer<> *buf_out_param = nullptr;
+                const Parameter &p = param_map.map(arg.param, buf_out_param);
+                c.params.push_back(p);
+                if (p.is_buffer() && p.buffer().defined()) {
+                    c.buffers.push_back(p.buffer());
+                }
+            }
+        } else {
+            c.buffers.push_back(arg.buffer);
+        }
+    }
+
+    if (target.arch == Target::WebAssembly) {
+        c.wasm_module = contents->wasm_module;
+    } else {
+        c.jit_module = contents->jit_module;
+    }
+    c.target = target;
+
+    return call;
+}
+
+bool BoundCall::defined() const {
+    return contents.defined();
+}
+
+namespace {
+
+int run_bound_call(BoundCallContents &c) {
+    int exit_status;
+    if (c.target.arch == Target::WebAssembly) {
+        exit_status = c.wasm_module.run(c.args.data());
+    } else {
+        exit_status = c.jit_module.argv_function()(c.args.data());
+    }
+
+    if (c.target.has_feature(Target::Profile)) {
+        report_and_reset_profiler(c.jit_module, c.jit_context);
+    }
+    return exit_status;
+}
+
+}  // namespace
+
+void BoundCall::run() {
+    user_assert(defined()) << "Can't run an undefined BoundCall\n";
+
+    int exit_status = run_bound_call(*contents);
+    contents->jit_context.finalize(exit_status);
+}
+
+void BoundCall::run_async(std::function<void(int exit_status, const std::string &error)> on_done) {
+    user_assert(defined()) << "Can't run an undefined BoundCall\n";
+
+    using DoAsyncFn = int (*)(void *, halide_async_task_t, void *, halide_async_done_t);
+    DoAsyncFn do_async = nullptr;
+    if (contents->target.arch != Target::WebAssembly) {
+        do_async = reinterpret_bits<DoAsyncFn>(contents->jit_module.find_symbol_by_name("halide_do_async").address);
+    }
+    if (!do_async) {
+        // No thread pool to hand it to, so run it here.
+        int exit_status = run_bound_call(*contents);
+        on_done(exit_status, contents->jit_context.take_error(exit_status));
+        return;
+    }
+
+    struct AsyncCall {
+        BoundCall call;
+        std::function<void(int, const std::string &)> on_done;
+    };
+    auto task = [](void *user_context, void *closure) -> int {
+        return run_bound_call(*((AsyncCall *)closure)->call.contents);
+    };
+    auto done = [](void *user_context, void *closure, int exit_status) {
+        std::unique_ptr<AsyncCall> async_call((AsyncCall *)closure);
+        std::string error = async_call->call.contents->jit_context.take_error(exit_status);
+        async_call->on_done(exit_status, error);
+    };
+
+    AsyncCall *async_call = new AsyncCall{*this, std::move(on_done)};
+    // Pass the call's user context, so that its custom handlers
+    // (e.g. for job priorities) apply.
+    int result = do_async(&contents->jit_context.jit_context, task, async_call, done);
+    if (result != 0) {
+        delete async_call;
+        halide_runtime_error << "halide_do_async failed with exit status " << result << "\n";
+    }
+}
+
+std::future<void> BoundCall::run_async() {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> result = promise->get_future();
+    run_async([promise](int exit_status, const std::string &error) {
+        if (error.empty()) {
+            promise->set_value();
+        } else {
+#ifdef WITH_EXCEPTIONS
+            promise->set_exception(std::make_exception_ptr(RuntimeError(error)));
+#else
+            halide_runtime_error << error;
+#endif
+        }
+    });
+    return result;
+}
+
+std::future<void> Pipeline::realize_async(RealizationArg outputs, const Target &target,
+                                          const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+
+    return bind(std::move(outputs), target, param_map).run_async();
+}
+
 void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_map) {
     if (!contents->jit_module.compiled() ||
         contents->jit_target.has_feature(Target::NoBoundsQuery)) {
@@ -1311,27 +1593,87 @@ JITExtern::JITExtern(const ExternCFunction &extern_c_function)
     : extern_c_function_(extern_c_function) {
 }
 
+namespace {
+
+// The machine params to use when HL_MACHINE_PARAMS is not set.
+MachineParams default_machine_params() {
+    return MachineParams(16, 16 * 1024 * 1024, 40);
+}
+
+}  // namespace
+
 MachineParams MachineParams::generic() {
     std::string params = Internal::get_env_variable("HL_MACHINE_PARAMS");
     if (params.empty()) {
-        return MachineParams(16, 16 * 1024 * 1024, 40);
+        return default_machine_params();
     } else {
         return MachineParams(params);
     }
 }
 
+MachineParams MachineParams::host() {
+    Internal::HostTopology t = Internal::get_host_topology();
+    // Anything we can't detect comes from generic(), unless
+    // HL_MACHINE_PARAMS is "host", in which case generic() would
+    // come straight back here, so use its defaults instead.
+    MachineParams p = Internal::get_env_variable("HL_MACHINE_PARAMS") == "host" ?
+                          default_machine_params() :
+                          generic();
+    // Hyperthreads share a core's caches and execution units, so don't
+    // count them as extra parallelism.
+    if (t.physical_cores > 0) {
+        p.parallelism = t.physical_cores;
+    } else if (t.logical_cores > 0) {
+        p.parallelism = t.logical_cores;
+    }
+    if (t.last_level_cache_size > 0) {
+        p.last_level_cache_size = t.last_level_cache_size;
+    }
+    if (t.l1_cache_size > 0) {
+        p.l1_cache_size = t.l1_cache_size;
+    }
+    if (t.l2_cache_size > 0) {
+        p.l2_cache_size = t.l2_cache_size;
+    }
+    if (t.cache_line_size > 0) {
+        p.cache_line_size = t.cache_line_size;
+    }
+    if (t.physical_cores > 0 && t.logical_cores >= t.physical_cores) {
+        p.threads_per_core = t.logical_cores / t.physical_cores;
+    }
+    if (t.numa_nodes > 0) {
+        p.numa_nodes = t.numa_nodes;
+    }
+    return p;
+}
+
 std::string MachineParams::to_string() const {
     std::ostringstream o;
     o << parallelism << "," << last_level_cache_size << "," << balance;
+    if (l1_cache_size || l2_cache_size || cache_line_size || threads_per_core || numa_nodes) {
+        o << "," << l1_cache_size << "," << l2_cache_size << "," << cache_line_size
+          << "," << threads_per_core << "," << numa_nodes;
+    }
     return o.str();
 }
 
 MachineParams::MachineParams(const std::string &s) {
+    if (s == "host") {
+        *this = host();
+        return;
+    }
     std::vector<std::string> v = Internal::split_string(s, ",");
-    user_assert(v.size() == 3) << "Unable to parse MachineParams: " << s;
+    user_assert(v.size() == 3 || v.size() == 8) << "Unable to parse MachineParams: " << s;
     parallelism = std::atoi(v[0].c_str());
     last_level_cache_size = std::atoll(v[1].c_str());
     balance = std::atof(v[2].c_str());
+    if (v.size() == 8) {
+        l1_cache_size = std::atoll(v[3].c_str());
+        l2_cache_size = std::atoll(v[4].c_str());
+        cache_line_size = std::atoi(v[5].c_str());
+        threads_per_core = std::atoi(v[6].c_str());
+        numa_nodes = std::atoi(v[7].c_str());
+    }
 }
 
 }  // namespace Halide
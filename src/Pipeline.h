@@ -7,6 +7,8 @@
  * pipeline.
  */
 
+#include <functional>
+#include <future>
 #include <map>
 #include <vector>
 
@@ -23,7 +25,9 @@
 namespace Halide {
 
 struct Argument;
+class BoundCall;
 class Func;
+struct BoundCallContents;
 struct PipelineContents;
 
 /** A struct representing the machine parameters to generate the auto-scheduled
@@ -37,17 +41,48 @@ struct MachineParams {
      * the cost of an arithmetic operation at last level cache. */
     float balance;
 
+    /** The remaining fields describe the cache hierarchy and core
+     * topology in more detail. Autoschedulers may use them to refine
+     * their choices, and must fall back to the fields above when they
+     * are zero (unknown). */
+    // @{
+    /** Size of the L1 data cache of a single core (in bytes). */
+    uint64_t l1_cache_size = 0;
+    /** Size of the L2 cache (in bytes). */
+    uint64_t l2_cache_size = 0;
+    /** Size of a cache line (in bytes). */
+    int cache_line_size = 0;
+    /** Number of hardware threads sharing each core. */
+    int threads_per_core = 0;
+    /** Number of NUMA nodes. */
+    int numa_nodes = 0;
+    // @}
+
     explicit MachineParams(int parallelism, uint64_t llc, float balance)
         : parallelism(parallelism), last_level_cache_size(llc), balance(balance) {
     }
 
-    /** Default machine parameters for generic CPU architecture. */
+    /** Default machine parameters for generic CPU architecture. These
+     * can be overridden by setting the HL_MACHINE_PARAMS environment
+     * variable to any string accepted by the string constructor below. */
     static MachineParams generic();
 
-    /** Convert the MachineParams into canonical string form. */
+    /** Machine parameters describing the machine we're running on, with
+     * the cache sizes and core counts queried from the operating
+     * system. Anything that can't be determined, including the
+     * balance, is taken from generic(), and so may be set with
+     * HL_MACHINE_PARAMS. */
+    static MachineParams host();
+
+    /** Convert the MachineParams into canonical string form. This is
+     * "parallelism,last_level_cache_size,balance", followed by
+     * ",l1_cache_size,l2_cache_size,cache_line_size,threads_per_core,numa_nodes"
+     * if any of those are known. */
     std::string to_string() const;
 
-    /** Reconstruct a MachineParams from canonical string form. */
+    /** Reconstruct a MachineParams from canonical string form. The
+     * string "host" is also accepted, and is equivalent to calling
+     * host(). */
     explicit MachineParams(const std::string &s);
 };
 
@@ -86,6 +121,7 @@ struct AutoSchedulerResults {
     std::string machine_params_string;   // MachineParams specified to the autoscheduler (in string form)
     std::string schedule_source;         // The C++ source code of the generated schedule
     std::vector<uint8_t> featurization;  // The featurization of the pipeline (if any)
+    std::string cost_predictions;        // The predicted runtime of each stage of the schedule, as text (if any)
 };
 
 class Pipeline;
@@ -275,7 +311,9 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. If the pipeline was last realized with the profile and
+     * profile_by_loop target features, the html is annotated with the
+     * time per run spent in each loop. */
     void compile_to_lowered_stmt(const std::string &filename,
                                  const std::vector<Argument> &args,
                                  StmtOutputFormat fmt = Text,
@@ -327,6 +365,12 @@ public:
      */
     void compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** The target that realize and bind use when given the target t.
+     * An unspecified target (the default) means the one the Pipeline
+     * was last jit-compiled for, if any, and otherwise the Target
+     * returned from Halide::get_jit_target_from_environment(). */
+    Target realize_target(const Target &t = Target()) const;
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -423,6 +467,33 @@ public:
      */
     void set_custom_print(void (*handler)(void *, const char *));
 
+    /** Set a function that the pipeline polls to find out whether it
+     * should stop early. It is called before each parallel task is
+     * dispatched and before each top-level stage is computed; if it
+     * returns non-zero, the pipeline returns
+     * halide_error_code_cancelled without computing anything
+     * further. The contents of the output buffers are then
+     * undefined. The function may be called concurrently from
+     * multiple threads, so it should be cheap and thread-safe
+     * (e.g. read an atomic flag). Stage-level checks are compiled
+     * out when the no_asserts target feature is set. If you are
+     * compiling statically, you can also just define your own
+     * version of halide_cancelled (see HalideRuntime.h), and it will
+     * clobber Halide's version.
+     */
+    void set_custom_cancelled(int (*cancelled)(void *));
+
+    /** Set a function that the default thread pool calls to find out
+     * the priority and deadline of this pipeline's parallel work, so
+     * that latency-critical pipelines can share the thread pool with
+     * background ones without being starved. Idle threads prefer
+     * jobs with a higher priority, and among those, an earlier
+     * deadline. See halide_job_priority_t in HalideRuntime.h. If you
+     * are compiling statically, use halide_set_custom_get_job_priority
+     * instead.
+     */
+    void set_custom_get_job_priority(void (*get_job_priority)(void *, halide_job_priority_t *));
+
     /** Install a set of external C functions or Funcs to satisfy
      * dependencies introduced by HalideExtern and define_extern
      * mechanisms. These will be used by calls to realize,
@@ -491,6 +562,24 @@ public:
     void realize(RealizationArg output, const Target &target = Target(),
                  const ParamMap &param_map = ParamMap::empty_map());
 
+    /** Compile the pipeline if necessary and validate and bind all
+     * of the arguments for a call that evaluates it into the given
+     * output buffers, without running it. The returned BoundCall can
+     * then be run many times with much lower overhead than calling
+     * realize each time. See BoundCall for which changes to the
+     * arguments are seen by subsequent runs. */
+    BoundCall bind(RealizationArg output, const Target &target = Target(),
+                   const ParamMap &param_map = ParamMap::empty_map());
+
+    /** Evaluate this Pipeline into existing output buffers without
+     * blocking the calling thread. The Pipeline is compiled and its
+     * arguments bound (see bind) before this returns, and it then runs
+     * on the Halide thread pool. The returned future becomes ready
+     * when it has finished; get() on it reports errors just as realize
+     * does. The output buffers must stay alive until then. */
+    std::future<void> realize_async(RealizationArg output, const Target &target = Target(),
+                                    const ParamMap &param_map = ParamMap::empty_map());
+
     /** For a given size of output, or a given set of output buffers,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
@@ -544,6 +633,59 @@ private:
     std::string generate_function_name() const;
 };
 
+/** A call to a jit-compiled Pipeline with all of its arguments
+ * validated and bound ahead of time. Made by Pipeline::bind. Running
+ * it skips the per-call work that Pipeline::realize does: resolving
+ * the target, checking whether the Pipeline needs compiling, setting
+ * up the JIT handlers, and marshalling the arguments. This makes it
+ * suitable for very cheap pipelines that are run very many times.
+ *
+ * Scalar Params are read on every run, so Param::set between runs
+ * takes effect. Values given in the ParamMap are captured at bind
+ * time, as ParamMap::set makes a new Parameter; to change them, bind a
+ * new call. Buffers are bound by
+ * address: the contents of the output buffers and of Buffers bound to
+ * ImageParams may change between runs, but the output buffers must
+ * outlive the BoundCall, and binding a different Buffer to an
+ * ImageParam requires binding a new call. Custom handlers (see
+ * Pipeline::set_custom_print etc.) are also captured at bind time. A
+ * BoundCall keeps the code it was bound to alive, so rescheduling or
+ * recompiling the Pipeline does not affect it.
+ *
+ * A BoundCall must not be run concurrently from several threads
+ * (including via run_async). To call the same Pipeline from several
+ * threads, bind one per thread. */
+class BoundCall {
+    Internal::IntrusivePtr<BoundCallContents> contents;
+
+    friend class Pipeline;
+
+public:
+    /** Make an undefined BoundCall. */
+    BoundCall() = default;
+
+    /** Check if this BoundCall has been bound to a Pipeline. */
+    bool defined() const;
+
+    /** Run the pipeline with the bound arguments. Errors are reported
+     * just as they are for Pipeline::realize. */
+    void run();
+
+    /** Start running the pipeline with the bound arguments on the
+     * Halide thread pool, and return without waiting for it (see
+     * halide_do_async). When it has finished, on_done is called on a
+     * thread pool thread with the exit status, and with the message
+     * that run() would have reported as an error, or an empty string
+     * if run() would have succeeded. The BoundCall is kept alive until
+     * then. */
+    void run_async(std::function<void(int exit_status, const std::string &error)> on_done);
+
+    /** As above, but return a future that becomes ready when the
+     * pipeline has finished. get() on it reports errors just as run()
+     * does. */
+    std::future<void> run_async();
+};
+
 struct ExternSignature {
 private:
     Type ret_type_;  // Only meaningful if is_void_return is false; must be default value otherwise
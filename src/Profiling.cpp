@@ -27,8 +27,18 @@ public:
 
     string pipeline_name;
 
-    InjectProfiling(const string &pipeline_name)
-        : pipeline_name(pipeline_name) {
+    // Whether to also attribute time to individual loops, in
+    // addition to Funcs.
+    bool profile_loops;
+
+    // Whether to read hardware performance counters at Func
+    // boundaries.
+    bool profile_perf_counters;
+
+    InjectProfiling(const string &pipeline_name, const Target &t)
+        : pipeline_name(pipeline_name),
+          profile_loops(t.has_feature(Target::ProfileByLoop)),
+          profile_perf_counters(t.has_feature(Target::ProfilePerfCounters)) {
         indices["overhead"] = 0;
         stack.push_back(0);
     }
@@ -68,6 +78,49 @@ private:
         return idx;
     }
 
+    // Loops are keyed by their full name (e.g. f.s1.r4$x), which
+    // identifies both the stage and the loop variable. These always
+    // contain a '.', so they can't collide with the normalized Func
+    // names above.
+    int get_loop_id(const string &name) {
+        int idx = -1;
+        map<string, int>::iterator iter = indices.find(name);
+        if (iter == indices.end()) {
+            idx = (int)indices.size();
+            indices[name] = idx;
+        } else {
+            idx = iter->second;
+        }
+        return idx;
+    }
+
+    Stmt set_current_func(int idx) {
+        Expr profiler_token = Variable::make(Int(32), "profiler_token");
+        Expr profiler_state = Variable::make(Handle(), "profiler_state");
+
+        // This call gets inlined and becomes a single store instruction.
+        Expr set_task = Call::make(Int(32), "halide_profiler_set_current_func",
+                                   {profiler_state, profiler_token, idx}, Call::Extern);
+        Stmt s = Evaluate::make(set_task);
+        if (profile_perf_counters) {
+            s = Block::make(s, update_perf_counters(idx));
+        }
+        return s;
+    }
+
+public:
+    // Bill the calling thread's hardware counters so far to the Func
+    // it was previously in, and start billing to idx. An idx of -1
+    // means the thread is leaving the pipeline (e.g. at the end of a
+    // parallel task).
+    Stmt update_perf_counters(int idx) {
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        return Evaluate::make(Call::make(Int(32), "halide_profiler_perf_counters_update",
+                                         {profiler_pipeline_state, idx}, Call::Extern));
+    }
+
+private:
+
     Expr compute_allocation_size(const vector<Expr> &extents,
                                  const Expr &condition,
                                  const Type &type,
@@ -201,14 +254,7 @@ private:
             idx = stack.back();
         }
 
-        Expr profiler_token = Variable::make(Int(32), "profiler_token");
-        Expr profiler_state = Variable::make(Handle(), "profiler_state");
-
-        // This call gets inlined and becomes a single store instruction.
-        Expr set_task = Call::make(Int(32), "halide_profiler_set_current_func",
-                                   {profiler_state, profiler_token, idx}, Call::Extern);
-
-        body = Block::make(Evaluate::make(set_task), body);
+        body = Block::make(set_current_func(idx), body);
 
         return ProducerConsumer::make(op->name, op->is_producer, body);
     }
@@ -231,18 +277,39 @@ private:
         } else if (const Acquire *a = s.as<Acquire>()) {
             return Acquire::make(a->semaphore, a->count, visit_parallel_task(a->body));
         } else {
-            return Block::make({incr_active_threads(), mutate(s), decr_active_threads()});
+            return wrap_parallel_task(mutate(s));
+        }
+    }
+
+    // Parallel tasks may run on any thread, so with hardware counters
+    // enabled, each task must claim its thread's counters on entry and
+    // release them on exit.
+    Stmt wrap_parallel_task(const Stmt &s) {
+        if (profile_perf_counters) {
+            return Block::make({incr_active_threads(), update_perf_counters(stack.back()),
+                                s, update_perf_counters(-1), decr_active_threads()});
+        } else {
+            return Block::make({incr_active_threads(), s, decr_active_threads()});
+        }
+    }
+
+    // The calling thread may have run some of the tasks itself, so
+    // reclaim its counters once they're all done.
+    Stmt wrap_parallel_launch(const Stmt &s) {
+        if (profile_perf_counters) {
+            return Block::make({decr_active_threads(), s, incr_active_threads(),
+                                update_perf_counters(stack.back())});
+        } else {
+            return Block::make({decr_active_threads(), s, incr_active_threads()});
         }
     }
 
     Stmt visit(const Acquire *op) override {
-        Stmt s = visit_parallel_task(op);
-        return Block::make({decr_active_threads(), s, incr_active_threads()});
+        return wrap_parallel_launch(visit_parallel_task(op));
     }
 
     Stmt visit(const Fork *op) override {
-        Stmt s = visit_parallel_task(op);
-        return Block::make({decr_active_threads(), s, incr_active_threads()});
+        return wrap_parallel_launch(visit_parallel_task(op));
     }
 
     Stmt visit(const For *op) override {
@@ -255,8 +322,20 @@ private:
         bool update_active_threads = (op->device_api == DeviceAPI::Hexagon ||
                                       op->is_unordered_parallel());
 
-        if (update_active_threads) {
-            body = Block::make({incr_active_threads(), body, decr_active_threads()});
+        // In loop-level mode, bill time spent in this loop nest to
+        // the loop itself rather than to the enclosing Func. Loops
+        // that will be vectorized or unrolled away, device loops, and
+        // the placeholder outermost loops are not tracked.
+        bool profile_this_loop = (profile_loops &&
+                                  (op->for_type == ForType::Serial ||
+                                   op->for_type == ForType::Parallel) &&
+                                  (op->device_api == DeviceAPI::None ||
+                                   op->device_api == DeviceAPI::Host) &&
+                                  !ends_with(op->name, ".__outermost"));
+        int loop_idx = -1;
+        if (profile_this_loop) {
+            loop_idx = get_loop_id(op->name);
+            stack.push_back(loop_idx);
         }
 
         // We profile by storing a token to global memory, so don't enter GPU loops
@@ -266,9 +345,15 @@ private:
             // hexagon. We don't support per-func stats remotely,
             // which means we can't do memory accounting.
             bool old_profiling_memory = profiling_memory;
+            bool old_profile_perf_counters = profile_perf_counters;
             profiling_memory = false;
+            profile_perf_counters = false;
             body = mutate(body);
+            if (update_active_threads) {
+                body = wrap_parallel_task(body);
+            }
             profiling_memory = old_profiling_memory;
+            profile_perf_counters = old_profile_perf_counters;
 
             // Get the profiler state pointer from scratch inside the
             // kernel. There will be a separate copy of the state on
@@ -279,21 +364,33 @@ private:
         } else if (op->device_api == DeviceAPI::None ||
                    op->device_api == DeviceAPI::Host) {
             body = mutate(body);
+            if (update_active_threads) {
+                body = wrap_parallel_task(body);
+            }
         } else {
             body = op->body;
         }
 
+        // The per-loop slot (if any) is still on top of the stack
+        // here, so that parallel tasks bill their counters to it.
         Stmt stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
 
         if (update_active_threads) {
-            stmt = Block::make({decr_active_threads(), stmt, incr_active_threads()});
+            stmt = wrap_parallel_launch(stmt);
+        }
+
+        if (profile_this_loop) {
+            // Enter the loop's slot before the loop begins, and
+            // return to the enclosing loop or Func once it's done.
+            stack.pop_back();
+            stmt = Block::make({set_current_func(loop_idx), stmt, set_current_func(stack.back())});
         }
         return stmt;
     }
 };
 
-Stmt inject_profiling(Stmt s, const string &pipeline_name) {
-    InjectProfiling profiling(pipeline_name);
+Stmt inject_profiling(Stmt s, const string &pipeline_name, const Target &t) {
+    InjectProfiling profiling(pipeline_name, t);
     s = profiling.mutate(s);
 
     int num_funcs = (int)(profiling.indices.size());
@@ -329,6 +426,11 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
     Stmt decr_active_threads =
         Evaluate::make(Call::make(Int(32), "halide_profiler_decr_active_threads",
                                   {profiler_state}, Call::Extern));
+    if (t.has_feature(Target::ProfilePerfCounters)) {
+        // Start billing hardware counters to the overhead slot, and
+        // stop once the pipeline is done.
+        s = Block::make({profiling.update_perf_counters(0), s, profiling.update_perf_counters(-1)});
+    }
     s = Block::make({incr_active_threads, s, decr_active_threads});
 
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
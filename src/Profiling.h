@@ -22,9 +22,28 @@
  *   f0:          0.025673ms (42%)
  *   mandelbrot:  0.006444ms (10%)   peak: 505344   num: 104000   avg: 5376
  *   argmin:      0.027715ms (46%)   stack: 20
+ *
+ * If the target additionally has the 'profile_by_loop' flag, time is
+ * further broken down by loop. Each serial or parallel loop gets its
+ * own line in the report, named after the loop (e.g. f.s1.r4$x for
+ * the r4.x loop of the first update of f), and the line for a Func
+ * then only contains time spent outside of any of its loops. The
+ * loop names match the For loops in the stmt and stmt_html outputs.
+ * After a jit-compiled pipeline has been realized with this flag,
+ * compile_to_lowered_stmt with the HTML format shows the time per run
+ * next to each profiled loop.
+ *
+ * If the target has the 'profile_perf_counters' flag, each thread
+ * also reads its hardware performance counters whenever it crosses a
+ * Func boundary, and the report includes instructions per cycle,
+ * cache misses and branch mispredicts per run for each Func. This
+ * uses perf_event_open on x86 Linux; elsewhere, or when the counters
+ * can't be opened (e.g. due to perf_event_paranoid), the counters
+ * are silently omitted from the report.
  */
 
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -33,10 +52,12 @@ namespace Internal {
  * high-resolution timing into the generated code (via spawning a
  * thread that acts as a sampling profiler); summaries of execution
  * times and counts will be logged at the end. Should be done before
- * storage flattening, but after all bounds inference.
+ * storage flattening, but after all bounds inference. The target's
+ * ProfileByLoop and ProfilePerfCounters features select the
+ * additional modes described above.
  *
  */
-Stmt inject_profiling(Stmt, const std::string &);
+Stmt inject_profiling(Stmt, const std::string &, const Target &);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -32,6 +32,9 @@ class StmtToHtml : public IRVisitor {
 private:
     std::ofstream stream;
 
+    // Per-loop times in ms, from the loop-level profiler.
+    std::map<string, double> loop_times;
+
     int unique_id() {
         return ++id_count;
     }
@@ -413,6 +416,10 @@ private:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        auto t = loop_times.find(op->name);
+        if (t != loop_times.end()) {
+            stream << " " << open_span("ProfileTime") << "// " << t->second << "ms" << close_span();
+        }
         stream << open_div("ForBody Indent", id);
         print(op->body);
         stream << close_div();
@@ -786,8 +793,9 @@ public:
         scope.pop(m.name());
     }
 
-    StmtToHtml(const string &filename)
-        : id_count(0), context_stack(1, 0) {
+    StmtToHtml(const string &filename,
+               const std::map<string, double> &loop_times = std::map<string, double>())
+        : id_count(0), loop_times(loop_times), context_stack(1, 0) {
         stream.open(filename.c_str());
         stream << "<head>";
         stream << "<style type='text/css'>" << css << "</style>\n";
@@ -826,6 +834,7 @@ span.Type { color: #445588; font-weight: bold; }\n \
 span.StringImm { color: #d14; }\n \
 span.IntImm { color: #099; }\n \
 span.FloatImm { color: #099; }\n \
+span.ProfileTime { color: #c60; font-weight: bold; }\n \
 b.Highlight { font-weight: bold; background-color: #DDD; }\n \
 span.Highlight { font-weight: bold; background-color: #FF0; }\n \
 ";
@@ -858,5 +867,11 @@ void print_to_html(const string &filename, const Module &m) {
     sth.print(m);
 }
 
+void print_to_html(const string &filename, const Module &m,
+                   const std::map<string, double> &loop_times) {
+    StmtToHtml sth(filename, loop_times);
+    sth.print(m);
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -5,6 +5,8 @@
  * Defines a function to dump an HTML-formatted stmt to a file.
  */
 
+#include <map>
+
 #include "Module.h"
 
 namespace Halide {
@@ -18,6 +20,15 @@ void print_to_html(const std::string &filename, const Stmt &s);
 /** Dump an HTML-formatted print of a Module to filename. */
 void print_to_html(const std::string &filename, const Module &m);
 
+/** Dump an HTML-formatted print of a Module to filename, annotating
+ * each loop with the time spent in it. loop_times maps loop names
+ * (e.g. f.s0.y) to milliseconds per run, as reported by the profiler
+ * for a pipeline compiled with Target::ProfileByLoop. Loops without
+ * an entry are printed as usual. Pipeline::compile_to_lowered_stmt
+ * uses this after a profiled realize. */
+void print_to_html(const std::string &filename, const Module &m,
+                   const std::map<std::string, double> &loop_times);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -361,6 +361,9 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"wasm_signext", Target::WasmSignExt},
     {"sve", Target::SVE},
     {"sve2", Target::SVE2},
+    {"profile_by_loop", Target::ProfileByLoop},
+    {"profile_perf_counters", Target::ProfilePerfCounters},
+    {"batch_entry_point", Target::BatchEntryPoint},
     // NOTE: When adding features to this map, be sure to update
     // PyEnums.cpp and halide.cmake as well.
 };
@@ -121,6 +121,9 @@ struct Target {
         WasmSignExt = halide_target_feature_wasm_signext,
         SVE = halide_target_feature_sve,
         SVE2 = halide_target_feature_sve2,
+        ProfileByLoop = halide_target_feature_profile_by_loop,
+        ProfilePerfCounters = halide_target_feature_profile_perf_counters,
+        BatchEntryPoint = halide_target_feature_batch_entry_point,
         FeatureEnd = halide_target_feature_end
     };
     Target()
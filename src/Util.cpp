@@ -37,6 +37,7 @@
 #ifdef __APPLE__
 #define CAN_GET_RUNNING_PROGRAM_NAME
 #include <mach-o/dyld.h>
+#include <sys/sysctl.h>
 #endif
 
 namespace Halide {
@@ -73,6 +74,135 @@ std::string get_env_variable(char const *env_var_name) {
     return "";
 }
 
+namespace {
+
+#ifdef __linux__
+std::string read_sysfs_line(const std::string &path) {
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+// Parse a size like "32K" or "8M", as used in /sys/devices/system/cpu.
+uint64_t parse_sysfs_size(const std::string &s) {
+    uint64_t v = std::strtoull(s.c_str(), nullptr, 10);
+    if (s.find('K') != std::string::npos) {
+        v <<= 10;
+    } else if (s.find('M') != std::string::npos) {
+        v <<= 20;
+    } else if (s.find('G') != std::string::npos) {
+        v <<= 30;
+    }
+    return v;
+}
+
+// Count the entries in a list like "0-3,8-11", as used in
+// /sys/devices/system/cpu and /sys/devices/system/node.
+int count_sysfs_list(const std::string &s) {
+    int count = 0;
+    for (const std::string &range : split_string(s, ",")) {
+        if (range.empty()) {
+            continue;
+        }
+        vector<string> ends = split_string(range, "-");
+        if (ends.size() == 2) {
+            count += std::atoi(ends[1].c_str()) - std::atoi(ends[0].c_str()) + 1;
+        } else {
+            count++;
+        }
+    }
+    return count;
+}
+#endif
+
+#ifdef __APPLE__
+uint64_t sysctl_value(const char *name) {
+    // Some of these are 32-bit values. We're little-endian, so they
+    // land in the low bytes either way.
+    uint64_t v = 0;
+    size_t size = sizeof(v);
+    if (sysctlbyname(name, &v, &size, nullptr, 0) != 0) {
+        return 0;
+    }
+    return v;
+}
+#endif
+
+}  // namespace
+
+HostTopology get_host_topology() {
+    HostTopology t;
+#if defined(__linux__)
+    const string cpu0 = "/sys/devices/system/cpu/cpu0/";
+    for (int i = 0;; i++) {
+        const string index = cpu0 + "cache/index" + std::to_string(i) + "/";
+        const string level = read_sysfs_line(index + "level");
+        if (level.empty()) {
+            break;
+        }
+        if (read_sysfs_line(index + "type") == "Instruction") {
+            continue;
+        }
+        const uint64_t size = parse_sysfs_size(read_sysfs_line(index + "size"));
+        if (level == "1") {
+            t.l1_cache_size = size;
+            t.cache_line_size = std::atoi(read_sysfs_line(index + "coherency_line_size").c_str());
+        } else if (level == "2") {
+            t.l2_cache_size = size;
+        }
+        // The caches are listed in order of increasing level.
+        t.last_level_cache_size = size;
+    }
+    t.logical_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const int siblings = count_sysfs_list(read_sysfs_line(cpu0 + "topology/thread_siblings_list"));
+    if (t.logical_cores > 0 && siblings > 0) {
+        t.physical_cores = t.logical_cores / siblings;
+    }
+    t.numa_nodes = count_sysfs_list(read_sysfs_line("/sys/devices/system/node/online"));
+#elif defined(__APPLE__)
+    t.l1_cache_size = sysctl_value("hw.l1dcachesize");
+    t.l2_cache_size = sysctl_value("hw.l2cachesize");
+    t.last_level_cache_size = sysctl_value("hw.l3cachesize");
+    if (t.last_level_cache_size == 0) {
+        t.last_level_cache_size = t.l2_cache_size;
+    }
+    t.cache_line_size = (int)sysctl_value("hw.cachelinesize");
+    t.logical_cores = (int)sysctl_value("hw.logicalcpu");
+    t.physical_cores = (int)sysctl_value("hw.physicalcpu");
+    t.numa_nodes = 1;
+#elif defined(_WIN32)
+    DWORD length = 0;
+    GetLogicalProcessorInformation(nullptr, &length);
+    vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!info.empty() && GetLogicalProcessorInformation(info.data(), &length)) {
+        int last_level = 0;
+        for (const auto &i : info) {
+            if (i.Relationship == RelationProcessorCore) {
+                t.physical_cores++;
+                for (ULONG_PTR mask = i.ProcessorMask; mask; mask &= mask - 1) {
+                    t.logical_cores++;
+                }
+            } else if (i.Relationship == RelationNumaNode) {
+                t.numa_nodes++;
+            } else if (i.Relationship == RelationCache && i.Cache.Type != CacheInstruction) {
+                if (i.Cache.Level == 1) {
+                    t.l1_cache_size = i.Cache.Size;
+                    t.cache_line_size = i.Cache.LineSize;
+                } else if (i.Cache.Level == 2) {
+                    t.l2_cache_size = i.Cache.Size;
+                }
+                if (i.Cache.Level >= last_level) {
+                    last_level = i.Cache.Level;
+                    t.last_level_cache_size = i.Cache.Size;
+                }
+            }
+        }
+    }
+#endif
+    return t;
+}
+
 string running_program_name() {
 #ifndef CAN_GET_RUNNING_PROGRAM_NAME
     return "";
@@ -128,6 +128,19 @@ std::string get_env_variable(char const *env_var_name);
  * If program name cannot be retrieved, function returns an empty string. */
 std::string running_program_name();
 
+/** The cache sizes and core topology of a machine. Anything that
+ * couldn't be determined is zero. */
+struct HostTopology {
+    uint64_t l1_cache_size = 0, l2_cache_size = 0, last_level_cache_size = 0;
+    int cache_line_size = 0;
+    int logical_cores = 0, physical_cores = 0;
+    int numa_nodes = 0;
+};
+
+/** Query the machine we're running on for its cache sizes and core
+ * topology. Platform-specific. */
+HostTopology get_host_topology();
+
 /** Generate a unique name starting with the given prefix. It's unique
  * relative to all other strings returned by unique_name in this
  * process.
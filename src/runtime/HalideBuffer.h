@@ -178,6 +178,26 @@ public:
     }
 
 private:
+    /** The allocation header used for host memory handed to
+     * take_ownership_of_host. The header comes first, so that the
+     * deallocate_fn it holds is passed a pointer to the whole
+     * struct. */
+    struct ForeignAllocation {
+        AllocationHeader header;
+        void (*release_fn)(void *);
+        void *context;
+
+        ForeignAllocation(void (*release_fn)(void *), void *context)
+            : header(release), release_fn(release_fn), context(context) {
+        }
+
+        static void release(void *ptr) {
+            ForeignAllocation *a = (ForeignAllocation *)ptr;
+            a->release_fn(a->context);
+            free(ptr);
+        }
+    };
+
     /** Increment the reference count of any owned allocation */
     void incref() const {
         if (owns_host_memory()) {
@@ -798,6 +818,19 @@ public:
         decref();
     }
 
+    /** Take ownership of host memory this Buffer refers to but did not
+     * allocate itself (e.g. a memory-mapped file). When the last
+     * Buffer sharing it is destroyed or deallocated, release_fn is
+     * called with the given context. The Buffer must not already own
+     * its host memory. */
+    void take_ownership_of_host(void (*release_fn)(void *context), void *context) {
+        assert(!owns_host_memory() && "Buffer already owns its host memory");
+        assert(release_fn);
+        void *storage = malloc(sizeof(ForeignAllocation));
+        ForeignAllocation *a = new (storage) ForeignAllocation(release_fn, context);
+        alloc = &a->header;
+    }
+
     /** Drop reference to any owned device memory, possibly freeing it
      * if this buffer held the last reference to it. Asserts that
      * device_dirty is false. */
@@ -1227,6 +1260,15 @@ public:
             src.crop(i, min_coord, max_coord - min_coord + 1);
         }
 
+        // Where the layouts allow it (e.g. dense rows, or packed to
+        // planar), copy a run of elements along the innermost
+        // dimension at a time, which is much faster than going
+        // element by element.
+        if (Buffer<>::try_copy_runs(src.raw_buffer(), dst.raw_buffer())) {
+            set_host_dirty();
+            return;
+        }
+
         // If T is void, we need to do runtime dispatch to an
         // appropriately-typed lambda. We're copying, so we only care
         // about the element size. (If not, this should optimize away
@@ -2057,6 +2099,116 @@ private:
         return innermost_strides_are_one;
     }
 
+    /** Helper functions for copy_from. */
+    // @{
+
+    // Copy a run of n elements of type MemType that are dst_step and
+    // src_step elements apart in dst and src. The steps are
+    // compile-time constants so that the loop can be vectorized.
+    template<typename MemType, int dst_step, int src_step>
+    HALIDE_ALWAYS_INLINE static void copy_run(uint8_t *dst, const uint8_t *src, int n) {
+        MemType *d = (MemType *)dst;
+        const MemType *s = (const MemType *)src;
+        for (int i = 0; i < n; i++) {
+            d[i * dst_step] = s[i * src_step];
+        }
+    }
+
+    // Dispatch to the right copy_run for steps accepted by try_copy_runs.
+    template<typename MemType>
+    HALIDE_ALWAYS_INLINE static void copy_run(uint8_t *dst, const uint8_t *src, int n, int dst_step, int src_step) {
+        if (dst_step == 1 && src_step == 1) {
+            memcpy(dst, src, n * sizeof(MemType));
+        } else if (dst_step == 1) {
+            switch (src_step) {
+            case 2:
+                copy_run<MemType, 1, 2>(dst, src, n);
+                break;
+            case 3:
+                copy_run<MemType, 1, 3>(dst, src, n);
+                break;
+            default:
+                copy_run<MemType, 1, 4>(dst, src, n);
+                break;
+            }
+        } else {
+            switch (dst_step) {
+            case 2:
+                copy_run<MemType, 2, 1>(dst, src, n);
+                break;
+            case 3:
+                copy_run<MemType, 3, 1>(dst, src, n);
+                break;
+            default:
+                copy_run<MemType, 4, 1>(dst, src, n);
+                break;
+            }
+        }
+    }
+
+    HALIDE_NEVER_INLINE static void copy_runs(int d, const for_each_value_task_dim<2> *t, int elem_size,
+                                              uint8_t *dst, const uint8_t *src) {
+        if (d == 0) {
+            const int n = t[0].extent, dst_step = t[0].stride[0], src_step = t[0].stride[1];
+            switch (elem_size) {
+            case 1:
+                copy_run<uint8_t>(dst, src, n, dst_step, src_step);
+                break;
+            case 2:
+                copy_run<uint16_t>(dst, src, n, dst_step, src_step);
+                break;
+            case 4:
+                copy_run<uint32_t>(dst, src, n, dst_step, src_step);
+                break;
+            default:
+                copy_run<uint64_t>(dst, src, n, dst_step, src_step);
+                break;
+            }
+        } else {
+            for (int i = t[d].extent; i != 0; i--) {
+                copy_runs(d - 1, t, elem_size, dst, src);
+                dst += (int64_t)t[d].stride[0] * elem_size;
+                src += (int64_t)t[d].stride[1] * elem_size;
+            }
+        }
+    }
+
+    // Copy the host memory of src to dst, which must have the same
+    // shape and element size, a run at a time along the innermost
+    // dimension. That dimension (after sorting by stride and
+    // flattening) must be dense in one buffer and have a stride of
+    // at most four elements in the other. Returns false, having done
+    // nothing, if there is no such dimension.
+    HALIDE_NEVER_INLINE static bool try_copy_runs(const halide_buffer_t *src, halide_buffer_t *dst) {
+        const int dimensions = dst->dimensions;
+        const int elem_size = dst->type.bytes();
+        if (dimensions == 0 ||
+            (elem_size != 1 && elem_size != 2 && elem_size != 4 && elem_size != 8)) {
+            return false;
+        }
+        for_each_value_task_dim<2> *t =
+            (for_each_value_task_dim<2> *)HALIDE_ALLOCA((dimensions + 1) * sizeof(for_each_value_task_dim<2>));
+        // Try the dimensions in the order of the dst strides first, then
+        // in the order of the src strides (e.g. for planar to packed).
+        for (int i = 0; i < 2; i++) {
+            const halide_buffer_t *buffers[] = {i == 0 ? dst : src, i == 0 ? src : dst};
+            for_each_value_prep(t, buffers);
+            if (i == 1) {
+                for (int j = 0; j < dimensions; j++) {
+                    std::swap(t[j].stride[0], t[j].stride[1]);
+                }
+            }
+            const int dst_step = t[0].stride[0], src_step = t[0].stride[1];
+            if ((dst_step == 1 && src_step >= 1 && src_step <= 4) ||
+                (src_step == 1 && dst_step >= 1 && dst_step <= 4)) {
+                copy_runs(dimensions - 1, t, elem_size, dst->host, src->host);
+                return true;
+            }
+        }
+        return false;
+    }
+    // @}
+
     template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
     void for_each_value_impl(Fn &&f, Args &&... other_buffers) const {
         Buffer<>::for_each_value_task_dim<N> *t =
@@ -313,6 +313,78 @@ extern struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closur
 /** Join a thread. */
 extern void halide_join_thread(struct halide_thread *);
 
+/** Cooperative cancellation of running pipelines. A pipeline calls
+ * halide_cancelled before computing each of its top-level stages, and
+ * the default thread pool calls it before running each parallel task.
+ * If it returns nonzero, the pipeline skips the remaining work, frees
+ * its allocations, and returns halide_error_code_cancelled. The
+ * default implementation always returns zero. To make pipelines
+ * cancellable, replace it with halide_set_custom_cancelled (or
+ * Func::set_custom_cancelled when jitting), typically with a function
+ * that checks a flag reachable from the user_context. If you are
+ * statically compiling, you can also just define your own version of
+ * halide_cancelled. Pipelines compiled with no_asserts ignore
+ * cancellation at stage boundaries, as they cannot exit early. */
+//@{
+extern int halide_cancelled(void *user_context);
+extern int halide_default_cancelled(void *user_context);
+typedef int (*halide_cancelled_t)(void *user_context);
+extern halide_cancelled_t halide_set_custom_cancelled(halide_cancelled_t cancelled);
+//@}
+
+/** Scheduling hints for the work a pipeline submits to the default
+ * thread pool. When several pipelines run concurrently they share one
+ * pool, and idle threads prefer jobs with a higher priority. Among
+ * jobs of equal priority, ones with an earlier deadline are
+ * preferred. Nested parallel work inherits the priority and deadline
+ * of the task that launched it. Priorities only affect which job an
+ * idle thread picks up next; running tasks are never preempted. */
+struct halide_job_priority_t {
+    /** Higher values run first. The default priority is zero, so
+     * latency-critical work should use positive values and
+     * background work negative ones. */
+    int32_t priority;
+
+    /** An absolute deadline in nanoseconds, used to order jobs of
+     * equal priority. Any clock may be used as long as all
+     * concurrent callers agree on it (e.g. halide_current_time_ns).
+     * Zero means no deadline, which sorts after all deadlines. */
+    uint64_t deadline_ns;
+};
+
+/** The default thread pool calls halide_get_job_priority once per
+ * top-level call to halide_do_par_for or halide_do_parallel_tasks to
+ * find the priority of the work being enqueued. The default
+ * implementation leaves the priority and deadline at zero. Replace
+ * it with halide_set_custom_get_job_priority (or
+ * Func::set_custom_get_job_priority when jitting), typically with a
+ * function that reads the priority from the user_context, to give
+ * different calls different priorities. It is called without the
+ * thread pool lock held, but may be called concurrently from several
+ * threads. */
+//@{
+extern void halide_get_job_priority(void *user_context, struct halide_job_priority_t *priority);
+extern void halide_default_get_job_priority(void *user_context, struct halide_job_priority_t *priority);
+typedef void (*halide_get_job_priority_t)(void *user_context, struct halide_job_priority_t *priority);
+extern halide_get_job_priority_t halide_set_custom_get_job_priority(halide_get_job_priority_t get_job_priority);
+//@}
+
+/** Run task(user_context, closure) on the thread pool without waiting
+ * for it, e.g. to call an AOT pipeline from an event loop. When the
+ * task returns, done (if non-NULL) is called on the same pool thread
+ * with the task's result. Returns zero once the task has been queued,
+ * or an error code if it could not be. The task is ordered against
+ * other work using halide_get_job_priority. It always runs on a pool
+ * thread, even if halide_set_num_threads(1) was called, and
+ * halide_shutdown_thread_pool waits for outstanding tasks to finish.
+ * On platforms without threads the task runs before this returns. */
+//@{
+typedef int (*halide_async_task_t)(void *user_context, void *closure);
+typedef void (*halide_async_done_t)(void *user_context, void *closure, int result);
+extern int halide_do_async(void *user_context, halide_async_task_t task, void *closure,
+                           halide_async_done_t done);
+//@}
+
 /** Set the number of threads used by Halide's thread pool. Returns
  * the old number.
  *
@@ -1157,6 +1229,10 @@ enum halide_error_code_t {
      * by zero was evaluated. */
     halide_error_code_device_dirty_with_no_device_support = -44,
 
+    /** The pipeline was cancelled: halide_cancelled returned nonzero
+     * while it was running. */
+    halide_error_code_cancelled = -45,
+
 };
 
 /** Halide calls the functions below on various error conditions. The
@@ -1228,6 +1304,7 @@ extern int halide_error_device_interface_no_device(void *user_context);
 extern int halide_error_host_and_device_dirty(void *user_context);
 extern int halide_error_buffer_is_null(void *user_context, const char *routine);
 extern int halide_error_device_dirty_with_no_device_support(void *user_context, const char *buffer_name);
+extern int halide_error_cancelled(void *user_context);
 // @}
 
 /** Optional features a compilation Target can have.
@@ -1312,6 +1389,9 @@ typedef enum halide_target_feature_t {
     halide_target_feature_sve,                    ///< Enable ARM Scalable Vector Extensions
     halide_target_feature_sve2,                   ///< Enable ARM Scalable Vector Extensions v2
     halide_target_feature_egl,                    ///< Force use of EGL support.
+    halide_target_feature_profile_by_loop,        ///< Used together with halide_target_feature_profile: additionally report the runtime used by each loop of each Func.
+    halide_target_feature_profile_perf_counters,  ///< Used together with halide_target_feature_profile: additionally report hardware performance counters (cycles, instructions, cache misses, branch mispredicts) for each Func, where the platform supports it.
+    halide_target_feature_batch_entry_point,      ///< Generate an additional entry point that runs a batch of argument sets in parallel.
 
     halide_target_feature_end  ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
@@ -1663,6 +1743,16 @@ void halide_register_argv_and_metadata(
  * the -profile target flag, which runs a sampling profiler thread
  * alongside the pipeline. */
 
+/** The hardware performance counters tracked per Func by the
+ * profiler when the profile_perf_counters target feature is set. */
+enum halide_profiler_perf_counter_t {
+    halide_profiler_perf_counter_cycles = 0,
+    halide_profiler_perf_counter_instructions,
+    halide_profiler_perf_counter_cache_misses,
+    halide_profiler_perf_counter_branch_misses,
+    halide_profiler_num_perf_counters
+};
+
 /** Per-Func state tracked by the sampling profiler. */
 struct halide_profiler_func_stats {
     /** Total time taken evaluating this Func (in nanoseconds). */
@@ -1688,6 +1778,13 @@ struct halide_profiler_func_stats {
 
     /** The total number of memory allocation of this Func. */
     int num_allocs;
+
+    /** Hardware performance counter totals for this Func, summed
+     * over all threads, indexed by halide_profiler_perf_counter_t. All
+     * zero unless the pipeline was compiled with the
+     * profile_perf_counters target feature and the counters could be
+     * opened. */
+    uint64_t perf_counters[halide_profiler_num_perf_counters];
 };
 
 /** Per-pipeline state tracked by the sampling profiler. These exist
@@ -0,0 +1,61 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+struct batch_closure {
+    int (*pipeline)(void **args);
+    void ***args;
+    int *results;
+    volatile int error;
+};
+
+WEAK int batch_item_task(void *user_context, int idx, uint8_t *closure) {
+    batch_closure *c = (batch_closure *)closure;
+    int result = c->pipeline(c->args[idx]);
+    if (c->results) {
+        c->results[idx] = result;
+    }
+    if (result != 0) {
+        __sync_val_compare_and_swap(&c->error, 0, result);
+    }
+    // A failing item does not cancel the rest of the batch.
+    return 0;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+// Called by the NAME_batch entry point generated with the
+// batch_entry_point target feature. Runs the argv wrapper of the
+// pipeline once for each of count argument lists, in parallel across
+// the batch, while scratch allocations are recycled between items.
+WEAK int halide_do_batch(void *user_context, int (*pipeline)(void **args),
+                         int count, void ***args, int *results) {
+    if (count <= 0) {
+        return 0;
+    }
+
+    batch_closure c;
+    c.pipeline = pipeline;
+    c.args = args;
+    c.results = results;
+    c.error = 0;
+
+    halide_begin_shared_scratch();
+    int result = 0;
+    if (count == 1) {
+        batch_item_task(user_context, 0, (uint8_t *)&c);
+    } else {
+        result = halide_do_par_for(user_context, batch_item_task, 0, count, (uint8_t *)&c);
+    }
+    halide_end_shared_scratch();
+
+    return result != 0 ? result : c.error;
+}
+}
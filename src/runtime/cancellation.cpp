@@ -0,0 +1,33 @@
+#include "HalideRuntime.h"
+
+extern "C" {
+
+WEAK int halide_default_cancelled(void *user_context) {
+    return 0;
+}
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+WEAK halide_cancelled_t custom_cancelled = halide_default_cancelled;
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+WEAK halide_cancelled_t halide_set_custom_cancelled(halide_cancelled_t f) {
+    halide_cancelled_t result = custom_cancelled;
+    custom_cancelled = f;
+    return result;
+}
+
+WEAK int halide_cancelled(void *user_context) {
+    return custom_cancelled(user_context);
+}
+
+}  // extern "C"
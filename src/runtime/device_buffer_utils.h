@@ -44,6 +44,49 @@ struct device_copy {
     uint64_t chunk_size;
 };
 
+// Copy n chunks of sizeof(T) bytes, where consecutive chunks are
+// src_step and dst_step chunks apart in the source and the
+// destination. The steps are compile-time constants so that the
+// common interleaving and deinterleaving patterns (e.g. between
+// packed RGB and planar images) can be vectorized when the runtime is
+// compiled into a pipeline for a specific target.
+template<typename T, int src_step, int dst_step>
+__attribute__((always_inline)) void copy_chunks(const uint8_t *from, uint8_t *to, uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        T v;
+        __builtin_memcpy(&v, from + i * src_step * sizeof(T), sizeof(T));
+        __builtin_memcpy(to + i * dst_step * sizeof(T), &v, sizeof(T));
+    }
+}
+
+// Copy a single dimension of chunks of sizeof(T) bytes (typically
+// single elements of a strided or interleaved buffer) without a call
+// to memcpy per chunk.
+template<typename T>
+__attribute__((always_inline)) void copy_small_chunks(const uint8_t *from, uint8_t *to, uint64_t n,
+                                                      uint64_t src_stride, uint64_t dst_stride) {
+    const uint64_t s = sizeof(T);
+    if (dst_stride == s && src_stride == 2 * s) {
+        copy_chunks<T, 2, 1>(from, to, n);
+    } else if (dst_stride == s && src_stride == 3 * s) {
+        copy_chunks<T, 3, 1>(from, to, n);
+    } else if (dst_stride == s && src_stride == 4 * s) {
+        copy_chunks<T, 4, 1>(from, to, n);
+    } else if (src_stride == s && dst_stride == 2 * s) {
+        copy_chunks<T, 1, 2>(from, to, n);
+    } else if (src_stride == s && dst_stride == 3 * s) {
+        copy_chunks<T, 1, 3>(from, to, n);
+    } else if (src_stride == s && dst_stride == 4 * s) {
+        copy_chunks<T, 1, 4>(from, to, n);
+    } else {
+        for (uint64_t i = 0; i < n; i++) {
+            T v;
+            __builtin_memcpy(&v, from + i * src_stride, sizeof(T));
+            __builtin_memcpy(to + i * dst_stride, &v, sizeof(T));
+        }
+    }
+}
+
 WEAK void copy_memory_helper(const device_copy &copy, int d, int64_t src_off, int64_t dst_off) {
     // Skip size-1 dimensions
     while (d >= 0 && copy.extent[d] == 1)
@@ -53,6 +96,24 @@ WEAK void copy_memory_helper(const device_copy &copy, int d, int64_t src_off, in
         const void *from = (void *)(copy.src + src_off);
         void *to = (void *)(copy.dst + dst_off);
         memcpy(to, from, copy.chunk_size);
+    } else if (d == 0 && (copy.chunk_size == 1 || copy.chunk_size == 2 ||
+                          copy.chunk_size == 4 || copy.chunk_size == 8)) {
+        const uint8_t *from = (const uint8_t *)(copy.src + src_off);
+        uint8_t *to = (uint8_t *)(copy.dst + dst_off);
+        switch (copy.chunk_size) {
+        case 1:
+            copy_small_chunks<uint8_t>(from, to, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0]);
+            break;
+        case 2:
+            copy_small_chunks<uint16_t>(from, to, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0]);
+            break;
+        case 4:
+            copy_small_chunks<uint32_t>(from, to, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0]);
+            break;
+        default:
+            copy_small_chunks<uint64_t>(from, to, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0]);
+            break;
+        }
     } else {
         for (uint64_t i = 0; i < copy.extent[d]; i++) {
             copy_memory_helper(copy, d - 1, src_off, dst_off);
@@ -71,6 +132,84 @@ WEAK void copy_memory(const device_copy &copy, void *user_context) {
     }
 }
 
+// Host to host copies at least this big are split across the thread
+// pool by copy_memory_parallel.
+#define MIN_PARALLEL_COPY_BYTES (1 << 21)
+
+struct parallel_copy_closure {
+    const device_copy *copy;
+    // The dimension split across tasks, or -1 if the copy is a single
+    // chunk, which is split into blocks of bytes instead.
+    int d;
+    // The number of slices of dimension d (or bytes) done per task.
+    uint64_t per_task;
+};
+
+WEAK int parallel_copy_task(void *user_context, int task, uint8_t *closure) {
+    const parallel_copy_closure *c = (const parallel_copy_closure *)closure;
+    const device_copy &copy = *c->copy;
+    const uint64_t begin = task * c->per_task;
+    if (c->d == -1) {
+        uint64_t size = copy.chunk_size - begin;
+        if (size > c->per_task) {
+            size = c->per_task;
+        }
+        memcpy((void *)(copy.dst + begin), (const void *)(copy.src + copy.src_begin + begin), size);
+    } else {
+        uint64_t end = begin + c->per_task;
+        if (end > copy.extent[c->d]) {
+            end = copy.extent[c->d];
+        }
+        for (uint64_t i = begin; i < end; i++) {
+            copy_memory_helper(copy, c->d - 1,
+                               copy.src_begin + i * copy.src_stride_bytes[c->d],
+                               i * copy.dst_stride_bytes[c->d]);
+        }
+    }
+    return 0;
+}
+
+// Like copy_memory, but split big copies between host buffers across
+// the runtime's thread pool, along the outermost dimension of the
+// copy (or into blocks of bytes, if it is a single contiguous chunk).
+// Returns the result of halide_do_par_for. Must not be called with
+// any lock held that the pool's tasks might also take.
+WEAK int copy_memory_parallel(const device_copy &copy, void *user_context) {
+    if (copy.src == copy.dst) {
+        copy_memory(copy, user_context);
+        return 0;
+    }
+
+    uint64_t total_bytes = copy.chunk_size;
+    int d = -1;
+    for (int i = 0; i < MAX_COPY_DIMS; i++) {
+        total_bytes *= copy.extent[i];
+        if (copy.extent[i] > 1) {
+            d = i;
+        }
+    }
+
+    const uint64_t max_tasks = total_bytes / (MIN_PARALLEL_COPY_BYTES / 2);
+    const uint64_t units = d == -1 ? copy.chunk_size : copy.extent[d];
+    if (max_tasks < 2 || units < 2) {
+        copy_memory(copy, user_context);
+        return 0;
+    }
+
+    parallel_copy_closure closure;
+    closure.copy = &copy;
+    closure.d = d;
+    closure.per_task = (units + max_tasks - 1) / max_tasks;
+    if (d == -1) {
+        // Keep the blocks aligned to cache lines.
+        closure.per_task = (closure.per_task + 63) & ~(uint64_t)63;
+    }
+    const int num_tasks = (int)((units + closure.per_task - 1) / closure.per_task);
+    debug(user_context) << "copy_memory_parallel: " << total_bytes << " bytes in "
+                        << num_tasks << " tasks\n";
+    return halide_do_par_for(user_context, parallel_copy_task, 0, num_tasks, (uint8_t *)&closure);
+}
+
 // Fills the entire dst buffer, which must be contained within src
 WEAK device_copy make_buffer_copy(const halide_buffer_t *src, bool src_host,
                                   const halide_buffer_t *dst, bool dst_host) {
@@ -135,6 +274,32 @@ WEAK device_copy make_buffer_copy(const halide_buffer_t *src, bool src_host,
         c.src_stride_bytes[insert] = src_stride_bytes;
     };
 
+    // Drop size-1 dimensions, and merge each dimension into the one
+    // inside it when the pair is contiguous in both src and dst
+    // (e.g. the rows and planes of a buffer cropped in x), so that
+    // there are as few loops over chunks as possible, and the
+    // innermost one is as long as possible.
+    int dims = 0;
+    for (int i = 0; i < MAX_COPY_DIMS; i++) {
+        if (c.extent[i] == 1) {
+            continue;
+        }
+        if (dims > 0 &&
+            c.src_stride_bytes[dims - 1] * c.extent[dims - 1] == c.src_stride_bytes[i] &&
+            c.dst_stride_bytes[dims - 1] * c.extent[dims - 1] == c.dst_stride_bytes[i]) {
+            c.extent[dims - 1] *= c.extent[i];
+        } else {
+            c.extent[dims] = c.extent[i];
+            c.src_stride_bytes[dims] = c.src_stride_bytes[i];
+            c.dst_stride_bytes[dims] = c.dst_stride_bytes[i];
+            dims++;
+        }
+    }
+    for (int i = dims; i < MAX_COPY_DIMS; i++) {
+        c.extent[i] = 1;
+        c.src_stride_bytes[i] = 0;
+        c.dst_stride_bytes[i] = 0;
+    }
     // Attempt to fold contiguous dimensions into the chunk
     // size. Since the dimensions are sorted by stride, and the
     // strides must be greater than or equal to the chunk size, this
@@ -156,6 +321,7 @@ WEAK device_copy make_buffer_copy(const halide_buffer_t *src, bool src_host,
         c.src_stride_bytes[MAX_COPY_DIMS - 1] = 0;
         c.dst_stride_bytes[MAX_COPY_DIMS - 1] = 0;
     }
+
     return c;
 }
 
@@ -531,6 +531,8 @@ WEAK int halide_buffer_copy_already_locked(void *user_context, struct halide_buf
         }
 
         if (to_host && from_host_valid) {
+            // halide_buffer_copy does big host to host copies in
+            // parallel before taking the lock; under it, copy serially.
             device_copy c = make_buffer_copy(src, true, dst, true);
             copy_memory(c, user_context);
             err = 0;
@@ -592,6 +594,20 @@ WEAK int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
                         << " interface " << dst_device_interface << "\n"
                         << " dst " << *dst << "\n";
 
+    // A copy between valid host allocations doesn't touch any device
+    // state, so do it without holding device_copy_mutex. It may run on
+    // the thread pool, whose tasks could themselves need the lock.
+    if (!dst_device_interface && dst->host && src->host &&
+        (!src->device_dirty() || src->device_interface == NULL)) {
+        device_copy c = make_buffer_copy(src, true, dst, true);
+        int err = copy_memory_parallel(c, user_context);
+        if (err == 0 && dst != src) {
+            dst->set_host_dirty(true);
+            dst->set_device_dirty(false);
+        }
+        return err;
+    }
+
     ScopedMutexLock lock(&device_copy_mutex);
 
     if (dst_device_interface) {
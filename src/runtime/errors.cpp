@@ -201,6 +201,13 @@ WEAK int halide_error_device_dirty_with_no_device_support(void *user_context, co
     return halide_error_code_device_dirty_with_no_device_support;
 }
 
+WEAK int halide_error_cancelled(void *user_context) {
+    // Cancellation is requested by the caller, so it isn't reported
+    // via halide_error. The error code alone is enough to tell it
+    // apart from a genuine failure.
+    return halide_error_code_cancelled;
+}
+
 WEAK int halide_error_host_is_null(void *user_context, const char *func) {
     error(user_context)
         << "The host pointer of " << func
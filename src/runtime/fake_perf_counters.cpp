@@ -0,0 +1,23 @@
+#include "HalideRuntime.h"
+
+// Hardware performance counters are not supported on this platform;
+// the profiler reports wall time and memory only.
+
+extern "C" {
+
+WEAK int halide_perf_counters_thread_id() {
+    return 0;
+}
+
+WEAK int halide_perf_counters_open() {
+    return -1;
+}
+
+WEAK int halide_perf_counters_read(int handle, uint64_t *values) {
+    return -1;
+}
+
+WEAK void halide_perf_counters_close(int handle) {
+}
+
+}  // extern "C"
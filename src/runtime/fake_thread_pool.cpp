@@ -2,6 +2,9 @@
 
 extern "C" {
 
+WEAK void halide_default_get_job_priority(void *user_context, halide_job_priority_t *priority) {
+}
+
 WEAK int halide_default_do_task(void *user_context, halide_task_t f, int idx,
                                 uint8_t *closure) {
     return f(user_context, idx, closure);
@@ -16,6 +19,9 @@ WEAK int halide_default_do_loop_task(void *user_context, halide_loop_task_t f,
 WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
                                    int min, int size, uint8_t *closure) {
     for (int x = min; x < min + size; x++) {
+        if (halide_cancelled(user_context)) {
+            return halide_error_cancelled(user_context);
+        }
         int result = halide_do_task(user_context, f, x, closure);
         if (result) {
             return result;
@@ -31,6 +37,16 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     return -1;
 }
 
+WEAK int halide_do_async(void *user_context, halide_async_task_t task, void *closure,
+                         halide_async_done_t done) {
+    // There are no threads to hand the task to, so just run it.
+    int result = task(user_context, closure);
+    if (done) {
+        done(user_context, closure, result);
+    }
+    return 0;
+}
+
 WEAK int halide_default_semaphore_init(halide_semaphore_t *s, int n) {
     halide_error(NULL, "halide_default_semaphore_init not implemented on this platform.");
     return 0;
@@ -59,6 +75,7 @@ WEAK halide_do_parallel_tasks_t custom_do_parallel_tasks = halide_default_do_par
 WEAK halide_semaphore_init_t custom_semaphore_init = halide_default_semaphore_init;
 WEAK halide_semaphore_try_acquire_t custom_semaphore_try_acquire = halide_default_semaphore_try_acquire;
 WEAK halide_semaphore_release_t custom_semaphore_release = halide_default_semaphore_release;
+WEAK halide_get_job_priority_t custom_get_job_priority = halide_default_get_job_priority;
 
 }  // namespace Internal
 }  // namespace Runtime
@@ -114,6 +131,16 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK halide_get_job_priority_t halide_set_custom_get_job_priority(halide_get_job_priority_t f) {
+    halide_get_job_priority_t result = custom_get_job_priority;
+    custom_get_job_priority = f;
+    return result;
+}
+
+WEAK void halide_get_job_priority(void *user_context, halide_job_priority_t *priority) {
+    (*custom_get_job_priority)(user_context, priority);
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
@@ -0,0 +1,118 @@
+#include "HalideRuntime.h"
+
+// Hardware performance counters for the profiler, read via the Linux
+// perf_event_open syscall. Counters are opened per thread as a single
+// group, so that they can be read with one syscall and are always
+// scheduled onto the PMU together.
+
+extern "C" {
+
+extern int syscall(int num, ...);
+extern ssize_t read(int fd, void *buf, size_t count);
+
+}  // extern "C"
+
+// The syscall numbers vary across platforms. This module is only
+// used on x86.
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 298
+#define SYS_GETTID 186
+#endif
+
+#ifdef BITS_32
+#define SYS_PERF_EVENT_OPEN 336
+#define SYS_GETTID 224
+#endif
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The original (PERF_ATTR_SIZE_VER0) layout of struct
+// perf_event_attr. The kernel accepts any of the published sizes.
+struct perf_event_attr_v0 {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+};
+
+#define PERF_TYPE_HARDWARE 0
+#define PERF_FORMAT_GROUP (1 << 3)
+#define PERF_ATTR_FLAG_EXCLUDE_KERNEL (1 << 5)
+#define PERF_ATTR_FLAG_EXCLUDE_HV (1 << 6)
+
+// In the order of halide_profiler_perf_counter_t.
+WEAK uint64_t perf_counter_configs[halide_profiler_num_perf_counters] = {
+    0,  // PERF_COUNT_HW_CPU_CYCLES
+    1,  // PERF_COUNT_HW_INSTRUCTIONS
+    3,  // PERF_COUNT_HW_CACHE_MISSES
+    5,  // PERF_COUNT_HW_BRANCH_MISSES
+};
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+WEAK int halide_perf_counters_thread_id() {
+    return syscall(SYS_GETTID);
+}
+
+WEAK int halide_perf_counters_open() {
+    int leader = -1;
+    for (int i = 0; i < halide_profiler_num_perf_counters; i++) {
+        perf_event_attr_v0 attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = perf_counter_configs[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        // Only count user-space events, which unprivileged processes
+        // are allowed to do under the default perf_event_paranoid
+        // setting.
+        attr.flags = PERF_ATTR_FLAG_EXCLUDE_KERNEL | PERF_ATTR_FLAG_EXCLUDE_HV;
+        int fd = syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, leader, 0);
+        if (fd < 0) {
+            // No PMU access (e.g. in a VM or a container, or
+            // restricted by perf_event_paranoid). Closing the leader
+            // closes the whole group.
+            if (leader >= 0) {
+                close(leader);
+            }
+            return -1;
+        }
+        if (leader < 0) {
+            leader = fd;
+        }
+    }
+    return leader;
+}
+
+WEAK int halide_perf_counters_read(int handle, uint64_t *values) {
+    // With PERF_FORMAT_GROUP, a read returns the number of counters
+    // followed by their values.
+    uint64_t buf[1 + halide_profiler_num_perf_counters];
+    ssize_t bytes = read(handle, buf, sizeof(buf));
+    if (bytes != (ssize_t)sizeof(buf) || buf[0] != halide_profiler_num_perf_counters) {
+        return -1;
+    }
+    for (int i = 0; i < halide_profiler_num_perf_counters; i++) {
+        values[i] = buf[i + 1];
+    }
+    return 0;
+}
+
+WEAK void halide_perf_counters_close(int handle) {
+    // Closing the leader closes the whole group.
+    close(handle);
+}
+
+}  // extern "C"
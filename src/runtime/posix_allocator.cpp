@@ -2,27 +2,121 @@
 #include "runtime_internal.h"
 
 #include "printer.h"
+#include "scoped_spin_lock.h"
 
 extern "C" {
 
 extern void *malloc(size_t);
 extern void free(void *);
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// While at least one batch is running (see batch.cpp), blocks freed by
+// halide_default_free are parked in a small shared cache instead of
+// being returned to the system, so that the next item of the batch can
+// pick up the scratch allocations of the previous one. The cache is
+// emptied when the last batch finishes.
+static const int scratch_cache_slots = 16;
+
+WEAK volatile int scratch_cache_users = 0;
+WEAK volatile int scratch_cache_lock = 0;
+WEAK void *scratch_cache_block[scratch_cache_slots] = {
+    NULL,
+};
+WEAK size_t scratch_cache_size[scratch_cache_slots];
+
+// The size of an allocation made by halide_default_malloc is stored
+// just before the original pointer.
+__attribute__((always_inline)) size_t &allocation_size(void *ptr) {
+    return ((size_t *)ptr)[-2];
+}
+
+WEAK void *take_cached_scratch(size_t x) {
+    ScopedSpinLock lock(&scratch_cache_lock);
+    int best = -1;
+    for (int i = 0; i < scratch_cache_slots; i++) {
+        // Don't hand out blocks much larger than what was asked for.
+        size_t size = scratch_cache_size[i];
+        if (scratch_cache_block[i] && size >= x && size / 2 <= x &&
+            (best < 0 || size < scratch_cache_size[best])) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        return NULL;
+    }
+    void *ptr = scratch_cache_block[best];
+    scratch_cache_block[best] = NULL;
+    return ptr;
+}
+
+WEAK bool put_cached_scratch(void *ptr) {
+    ScopedSpinLock lock(&scratch_cache_lock);
+    if (scratch_cache_users == 0) {
+        return false;
+    }
+    for (int i = 0; i < scratch_cache_slots; i++) {
+        if (!scratch_cache_block[i]) {
+            scratch_cache_block[i] = ptr;
+            scratch_cache_size[i] = allocation_size(ptr);
+            return true;
+        }
+    }
+    return false;
+}
+
+WEAK void halide_begin_shared_scratch() {
+    ScopedSpinLock lock(&scratch_cache_lock);
+    scratch_cache_users++;
+}
+
+WEAK void halide_end_shared_scratch() {
+    ScopedSpinLock lock(&scratch_cache_lock);
+    if (--scratch_cache_users == 0) {
+        for (int i = 0; i < scratch_cache_slots; i++) {
+            if (scratch_cache_block[i]) {
+                free(((void **)scratch_cache_block[i])[-1]);
+                scratch_cache_block[i] = NULL;
+            }
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
 
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
-    // Allocate enough space for aligning the pointer we return.
+    if (scratch_cache_users) {
+        void *ptr = take_cached_scratch(x);
+        if (ptr) {
+            return ptr;
+        }
+    }
+    // Allocate enough space for aligning the pointer we return, and
+    // for the original pointer and size we store in front of it.
     const size_t alignment = halide_malloc_alignment();
-    void *orig = malloc(x + alignment);
+    void *orig = malloc(x + alignment + 2 * sizeof(void *));
     if (orig == NULL) {
         // Will result in a failed assertion and a call to halide_error
         return NULL;
     }
     // We want to store the original pointer prior to the pointer we return.
-    void *ptr = (void *)(((size_t)orig + alignment + sizeof(void *) - 1) & ~(alignment - 1));
+    void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void *) - 1) & ~(alignment - 1));
     ((void **)ptr)[-1] = orig;
+    allocation_size(ptr) = x;
     return ptr;
 }
 
 WEAK void halide_default_free(void *user_context, void *ptr) {
+    if (scratch_cache_users && put_cached_scratch(ptr)) {
+        return;
+    }
     free(((void **)ptr)[-1]);
 }
 }
@@ -62,6 +62,9 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        for (int j = 0; j < halide_profiler_num_perf_counters; j++) {
+            p->funcs[i].perf_counters[j] = 0;
+        }
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
@@ -94,6 +97,88 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
     // Someone must have called reset_state while a kernel was running. Do nothing.
 }
 
+// Per-thread state for hardware performance counters. Counters can
+// only be read by the thread they measure, so rather than sampling
+// them, each thread reads its own counters whenever it crosses a Func
+// boundary and bills the delta to the Func it was in.
+struct perf_counter_thread_state {
+    int tid;
+    // The counter handle, or negative if they couldn't be opened.
+    int handle;
+    // The pipeline and Func this thread is currently billing to. NULL
+    // when the thread is outside of any profiled pipeline.
+    halide_profiler_pipeline_stats *pipeline;
+    int func_id;
+    uint64_t last[halide_profiler_num_perf_counters];
+};
+
+#define MAX_PERF_COUNTER_THREADS 256
+WEAK perf_counter_thread_state perf_counter_threads[MAX_PERF_COUNTER_THREADS];
+WEAK int perf_counter_num_threads = 0;
+WEAK halide_mutex perf_counter_threads_lock = {{0}};
+// Set once opening counters has failed, so that we stop trying.
+WEAK bool perf_counters_unavailable = false;
+
+WEAK perf_counter_thread_state *find_perf_counter_thread(int tid) {
+    // Entries are only ever appended (until a reset, which mustn't
+    // happen while pipelines are running), and the count is bumped
+    // after the entry is written, so the scan can proceed without the
+    // lock.
+    int n = __sync_fetch_and_add(&perf_counter_num_threads, 0);
+    for (int i = 0; i < n; i++) {
+        if (perf_counter_threads[i].tid == tid) {
+            return perf_counter_threads + i;
+        }
+    }
+    return NULL;
+}
+
+WEAK perf_counter_thread_state *find_or_create_perf_counter_thread() {
+    int tid = halide_perf_counters_thread_id();
+    perf_counter_thread_state *t = find_perf_counter_thread(tid);
+    if (t) {
+        return t;
+    }
+
+    if (perf_counters_unavailable) {
+        return NULL;
+    }
+
+    ScopedMutexLock lock(&perf_counter_threads_lock);
+    // Only this thread can add an entry for itself, so no need to
+    // rescan.
+    int n = perf_counter_num_threads;
+    if (n == MAX_PERF_COUNTER_THREADS) {
+        return NULL;
+    }
+    t = perf_counter_threads + n;
+    t->tid = tid;
+    t->handle = halide_perf_counters_open();
+    t->pipeline = NULL;
+    t->func_id = 0;
+    if (t->handle < 0 ||
+        halide_perf_counters_read(t->handle, t->last) != 0) {
+        t->handle = -1;
+        perf_counters_unavailable = true;
+        return NULL;
+    }
+    __sync_fetch_and_add(&perf_counter_num_threads, 1);
+    return t;
+}
+
+// Close every thread's counters and forget about the threads, so that
+// nothing refers to pipeline stats that are about to be freed, and a
+// new thread that reuses an old thread id opens its own counters.
+WEAK void perf_counter_threads_reset() {
+    ScopedMutexLock lock(&perf_counter_threads_lock);
+    for (int i = 0; i < perf_counter_num_threads; i++) {
+        if (perf_counter_threads[i].handle >= 0) {
+            halide_perf_counters_close(perf_counter_threads[i].handle);
+        }
+    }
+    perf_counter_num_threads = 0;
+}
+
 WEAK void sampling_profiler_thread(void *) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -284,6 +369,44 @@ WEAK void halide_profiler_memory_free(void *user_context,
     __sync_sub_and_fetch(&f_stats->memory_current, decr);
 }
 
+WEAK void halide_profiler_perf_counters_update(void *user_context,
+                                               void *pipeline_state,
+                                               int func_id) {
+    perf_counter_thread_state *t = find_or_create_perf_counter_thread();
+    if (!t) {
+        // Counters are unavailable. The rest of the profiler carries
+        // on regardless.
+        return;
+    }
+
+    uint64_t now[halide_profiler_num_perf_counters];
+    if (halide_perf_counters_read(t->handle, now) != 0) {
+        return;
+    }
+
+    if (t->pipeline) {
+        halide_profiler_func_stats *f_stats = &t->pipeline->funcs[t->func_id];
+        for (int i = 0; i < halide_profiler_num_perf_counters; i++) {
+            __sync_add_and_fetch(&f_stats->perf_counters[i], now[i] - t->last[i]);
+        }
+    }
+
+    for (int i = 0; i < halide_profiler_num_perf_counters; i++) {
+        t->last[i] = now[i];
+    }
+
+    // A negative func_id means the thread is leaving the pipeline.
+    if (func_id >= 0) {
+        halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *)pipeline_state;
+        halide_assert(user_context, p_stats != NULL);
+        halide_assert(user_context, func_id < p_stats->num_funcs);
+        t->pipeline = p_stats;
+        t->func_id = func_id;
+    } else {
+        t->pipeline = NULL;
+    }
+}
+
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
 
     char line_buf[1024];
@@ -390,6 +513,15 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+
+                uint64_t cycles = fs->perf_counters[halide_profiler_perf_counter_cycles];
+                if (cycles) {
+                    uint64_t instructions = fs->perf_counters[halide_profiler_perf_counter_instructions];
+                    sstr << " ipc: " << (float)instructions / cycles;
+                    sstr.erase(4);
+                    sstr << " cache misses: " << fs->perf_counters[halide_profiler_perf_counter_cache_misses] / p->runs
+                         << " branch misses: " << fs->perf_counters[halide_profiler_perf_counter_branch_misses] / p->runs;
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
@@ -405,6 +537,7 @@ WEAK void halide_profiler_report(void *user_context) {
 }
 
 WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
+    perf_counter_threads_reset();
     while (s->pipelines) {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
@@ -470,6 +603,15 @@ WEAK void halide_windows_profiler_shutdown() {
 
 WEAK void halide_profiler_pipeline_end(void *user_context, void *state) {
     ((halide_profiler_state *)state)->current_func = halide_profiler_outside_of_halide;
+    // The pipeline only stops billing hardware counters on its normal
+    // exit path, so make sure this thread stops billing to it even if
+    // it failed.
+    if (__sync_fetch_and_add(&perf_counter_num_threads, 0) > 0) {
+        perf_counter_thread_state *t = find_perf_counter_thread(halide_perf_counters_thread_id());
+        if (t) {
+            t->pipeline = NULL;
+        }
+    }
 }
 
 }  // extern "C"
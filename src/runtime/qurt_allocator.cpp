@@ -94,6 +94,14 @@ namespace Internal {
 WEAK halide_malloc_t custom_malloc = halide_default_malloc;
 WEAK halide_free_t custom_free = halide_default_free;
 
+// The pool above already serves repeated small allocations, so batches
+// have nothing further to share here.
+WEAK void halide_begin_shared_scratch() {
+}
+
+WEAK void halide_end_shared_scratch() {
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
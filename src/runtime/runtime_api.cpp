@@ -20,6 +20,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
     (void *)&halide_can_use_target_features,
+    (void *)&halide_cancelled,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
     (void *)&halide_cond_wait,
@@ -59,6 +60,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_error_buffer_argument_is_null,
     (void *)&halide_error_buffer_extents_negative,
     (void *)&halide_error_buffer_extents_too_large,
+    (void *)&halide_error_cancelled,
     (void *)&halide_error_constraint_violated,
     (void *)&halide_error_constraints_make_required_region_smaller,
     (void *)&halide_error_debug_to_file_failed,
@@ -82,6 +84,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_free,
     (void *)&halide_get_cpu_features,
     (void *)&halide_get_gpu_device,
+    (void *)&halide_get_job_priority,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_symbol,
     (void *)&halide_get_trace_file,
@@ -173,10 +176,12 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
     (void *)&halide_set_custom_can_use_target_features,
+    (void *)&halide_set_custom_cancelled,
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_loop_task,
     (void *)&halide_set_custom_do_task,
     (void *)&halide_set_custom_free,
+    (void *)&halide_set_custom_get_job_priority,
     (void *)&halide_set_custom_get_library_symbol,
     (void *)&halide_set_custom_get_symbol,
     (void *)&halide_set_custom_load_library,
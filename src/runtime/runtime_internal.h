@@ -132,8 +132,22 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
                                         const uint64_t *func_names);
+WEAK void halide_profiler_perf_counters_update(void *user_context,
+                                               void *pipeline_state,
+                                               int func_id);
 WEAK int halide_host_cpu_count();
 
+// Platform specific access to hardware performance counters for the
+// calling thread. halide_perf_counters_open returns a handle, or a
+// negative value if counters are unavailable. halide_perf_counters_read
+// writes halide_profiler_num_perf_counters monotonically increasing
+// values, and returns zero on success. halide_perf_counters_close may
+// be called from any thread.
+WEAK int halide_perf_counters_thread_id();
+WEAK int halide_perf_counters_open();
+WEAK int halide_perf_counters_read(int handle, uint64_t *values);
+WEAK void halide_perf_counters_close(int handle);
+
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
 WEAK int halide_device_and_host_free(void *user_context, struct halide_buffer_t *buf);
@@ -145,6 +159,9 @@ WEAK int halide_matlab_call_pipeline(void *user_context,
                                      int (*pipeline)(void **args), const halide_filter_metadata_t *metadata,
                                      int nlhs, mxArray **plhs, int nrhs, const mxArray **prhs);
 
+WEAK int halide_do_batch(void *user_context, int (*pipeline)(void **args),
+                         int count, void ***args, int *results);
+
 WEAK int halide_trace_helper(void *user_context,
                              const char *func,
                              void *value, int *coords,
@@ -169,6 +186,11 @@ namespace Internal {
 extern WEAK void halide_use_jit_module();
 extern WEAK void halide_release_jit_module();
 
+// Bracket a batch of pipeline invocations, between which the default
+// allocator may recycle freed scratch blocks. Defined by the allocator.
+extern WEAK void halide_begin_shared_scratch();
+extern WEAK void halide_end_shared_scratch();
+
 template<typename T>
 __attribute__((always_inline)) void swap(T &a, T &b) {
     T t = a;
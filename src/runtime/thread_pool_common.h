@@ -37,11 +37,15 @@ struct work {
     int threads_reserved;
 
     void *user_context;
+    halide_job_priority_t priority;
     int active_workers;
     int exit_status;
     int next_semaphore;
     // which condition variable is the owner sleeping on. NULL if it isn't sleeping.
     bool owner_is_sleeping;
+    // Jobs from halide_do_async have no owner waiting on them, and are
+    // freed by the last worker to finish them.
+    bool detached;
 
     bool make_runnable() {
         for (; next_semaphore < task.num_semaphores; next_semaphore++) {
@@ -62,6 +66,15 @@ struct work {
     bool running() {
         return task.extent || active_workers;
     }
+
+    // Whether idle threads should strictly prefer this job over
+    // another one. Jobs with no deadline sort after jobs with one.
+    bool runs_before(const work *other) const {
+        if (priority.priority != other->priority.priority) {
+            return priority.priority > other->priority.priority;
+        }
+        return (priority.deadline_ns - 1) < (other->priority.deadline_ns - 1);
+    }
 };
 
 #define MAX_THREADS 256
@@ -138,6 +151,9 @@ struct work_queue_t {
     // to prevent deadlock due to oversubscription of threads.
     int threads_reserved;
 
+    // The number of halide_do_async jobs that have not yet finished.
+    int async_jobs;
+
     bool running() const {
         return !shutdown;
     }
@@ -194,6 +210,19 @@ WEAK void dump_job_state() {
 
 WEAK void worker_thread(void *);
 
+// Push a job onto the job stack, below any jobs that should run
+// before it. When all jobs have the same priority this is a plain
+// push, which keeps the most recently enqueued (i.e. most nested)
+// work on top.
+WEAK void insert_job_already_locked(work *job) {
+    work **prev_ptr = &work_queue.jobs;
+    while (*prev_ptr && (*prev_ptr)->runs_before(job)) {
+        prev_ptr = &((*prev_ptr)->next_job);
+    }
+    job->next_job = *prev_ptr;
+    *prev_ptr = job;
+}
+
 WEAK void worker_thread_already_locked(work *owned_job) {
     while (owned_job ? owned_job->running() : !work_queue.shutdown) {
         work *job = work_queue.jobs;
@@ -250,7 +279,10 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
                 log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
             }
-            bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
+            // Owners don't pick up detached jobs, as a whole pipeline
+            // run would hold up the job they are waiting on.
+            bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) ||
+                                             (job->task.min_threads == 0 && !job->detached);
             if (!can_use_this_thread_stack) {
                 log_message("Cannot run job " << job->task.name << " on this thread.");
             }
@@ -326,10 +358,14 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 }
                 if (iters == 0) break;
 
-                // Do them
-                result = halide_do_loop_task(job->user_context, job->task.fn,
-                                             job->task.min + total_iters, iters,
-                                             job->task.closure, job);
+                // Do them, unless the pipeline has been cancelled.
+                if (halide_cancelled(job->user_context)) {
+                    result = halide_error_cancelled(job->user_context);
+                } else {
+                    result = halide_do_loop_task(job->user_context, job->task.fn,
+                                                 job->task.min + total_iters, iters,
+                                                 job->task.closure, job);
+                }
                 total_iters += iters;
                 iters = 0;
             }
@@ -342,8 +378,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             if (result != 0) {
                 job->task.extent = 0;  // Force job to be finished.
             } else if (job->task.extent > 0) {
-                job->next_job = work_queue.jobs;
-                work_queue.jobs = job;
+                insert_job_already_locked(job);
             }
         } else {
             // Claim a task from it.
@@ -359,7 +394,13 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
             // Release the lock and do the task.
             halide_mutex_unlock(&work_queue.mutex);
-            if (myjob.task_fn) {
+            // Detached jobs must always run, as their done callback
+            // is how the result (and ownership of the closure) gets
+            // back to the caller. The pipeline they run checks for
+            // cancellation itself.
+            if (!myjob.detached && halide_cancelled(myjob.user_context)) {
+                result = halide_error_cancelled(myjob.user_context);
+            } else if (myjob.task_fn) {
                 result = halide_do_task(myjob.user_context, myjob.task_fn,
                                         myjob.task.min, myjob.task.closure);
             } else {
@@ -403,6 +444,15 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
         log_message("Done working on job " << job->task.name);
 
+        if (job->detached && job->active_workers == 0 && job->task.extent == 0) {
+            free(job);
+            if (--work_queue.async_jobs == 0) {
+                // halide_shutdown_thread_pool may be waiting for this.
+                halide_cond_broadcast(&work_queue.wake_owners);
+            }
+            continue;
+        }
+
         if (wake_owners ||
             (job->active_workers == 0 && (job->task.extent == 0 || job->exit_status != 0) && job->owner_is_sleeping)) {
             // The job is done or some owned job failed via sibling linkage. Wake up the owner.
@@ -504,15 +554,12 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         }
     }
 
-    // Push the jobs onto the stack.
+    // Push the jobs onto the stack, below any higher priority work.
     for (int i = num_jobs - 1; i >= 0; i--) {
-        // We could bubble it downwards based on some heuristics, but
-        // it's not strictly necessary to do so.
-        jobs[i].next_job = work_queue.jobs;
         jobs[i].siblings = &jobs[0];
         jobs[i].sibling_count = num_jobs;
         jobs[i].threads_reserved = 0;
-        work_queue.jobs = jobs + i;
+        insert_job_already_locked(jobs + i);
     }
 
     bool nested_parallelism =
@@ -545,6 +592,23 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
     }
 }
 
+struct async_closure {
+    halide_async_task_t task;
+    void *closure;
+    halide_async_done_t done;
+};
+
+WEAK int async_task(void *user_context, int idx, uint8_t *closure) {
+    async_closure *c = (async_closure *)closure;
+    int result = c->task(user_context, c->closure);
+    if (c->done) {
+        c->done(user_context, c->closure, result);
+    }
+    // The result has been delivered; don't treat it as a failure of
+    // the job.
+    return 0;
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_loop_task_t custom_do_loop_task = halide_default_do_loop_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
@@ -552,6 +616,7 @@ WEAK halide_do_parallel_tasks_t custom_do_parallel_tasks = halide_default_do_par
 WEAK halide_semaphore_init_t custom_semaphore_init = halide_default_semaphore_init;
 WEAK halide_semaphore_try_acquire_t custom_semaphore_try_acquire = halide_default_semaphore_try_acquire;
 WEAK halide_semaphore_release_t custom_semaphore_release = halide_default_semaphore_release;
+WEAK halide_get_job_priority_t custom_get_job_priority = halide_default_get_job_priority;
 
 }  // namespace Internal
 }  // namespace Runtime
@@ -567,6 +632,9 @@ WEAK __attribute__((destructor)) void halide_thread_pool_cleanup() {
 }
 }  // namespace
 
+WEAK void halide_default_get_job_priority(void *user_context, halide_job_priority_t *priority) {
+}
+
 WEAK int halide_default_do_task(void *user_context, halide_task_t f, int idx,
                                 uint8_t *closure) {
     return f(user_context, idx, closure);
@@ -600,9 +668,13 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.active_workers = 0;
     job.next_semaphore = 0;
     job.owner_is_sleeping = false;
+    job.detached = false;
     job.siblings = &job;  // guarantees no other job points to the same siblings.
     job.sibling_count = 0;
     job.parent_job = NULL;
+    job.priority.priority = 0;
+    job.priority.deadline_ns = 0;
+    halide_get_job_priority(user_context, &job.priority);
     halide_mutex_lock(&work_queue.mutex);
     enqueue_work_already_locked(1, &job, NULL);
     worker_thread_already_locked(&job);
@@ -615,6 +687,16 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
                                           void *task_parent) {
     work *jobs = (work *)__builtin_alloca(sizeof(work) * num_tasks);
 
+    // Nested work inherits the priority of its parent.
+    halide_job_priority_t priority;
+    if (task_parent) {
+        priority = ((work *)task_parent)->priority;
+    } else {
+        priority.priority = 0;
+        priority.deadline_ns = 0;
+        halide_get_job_priority(user_context, &priority);
+    }
+
     for (int i = 0; i < num_tasks; i++) {
         if (tasks->extent <= 0) {
             // Skip extent zero jobs
@@ -624,10 +706,12 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         jobs[i].task = *tasks++;
         jobs[i].task_fn = NULL;
         jobs[i].user_context = user_context;
+        jobs[i].priority = priority;
         jobs[i].exit_status = 0;
         jobs[i].active_workers = 0;
         jobs[i].next_semaphore = 0;
         jobs[i].owner_is_sleeping = false;
+        jobs[i].detached = false;
         jobs[i].parent_job = (work *)task_parent;
     }
 
@@ -650,6 +734,56 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     return exit_status;
 }
 
+WEAK int halide_do_async(void *user_context, halide_async_task_t task, void *closure,
+                         halide_async_done_t done) {
+    // The job and its closure are freed together by the worker that
+    // finishes it.
+    work *job = (work *)malloc(sizeof(work) + sizeof(async_closure));
+    if (job == NULL) {
+        return halide_error_code_out_of_memory;
+    }
+    async_closure *c = (async_closure *)(job + 1);
+    c->task = task;
+    c->closure = closure;
+    c->done = done;
+
+    job->task.fn = NULL;
+    job->task.min = 0;
+    job->task.extent = 1;
+    job->task.serial = false;
+    job->task.semaphores = NULL;
+    job->task.num_semaphores = 0;
+    job->task.closure = (uint8_t *)c;
+    job->task.min_threads = 0;
+    job->task.name = NULL;
+    job->task_fn = async_task;
+    job->user_context = user_context;
+    job->exit_status = 0;
+    job->active_workers = 0;
+    job->next_semaphore = 0;
+    job->owner_is_sleeping = false;
+    job->detached = true;
+    job->siblings = job;
+    job->sibling_count = 0;
+    job->parent_job = NULL;
+    job->priority.priority = 0;
+    job->priority.deadline_ns = 0;
+    halide_get_job_priority(user_context, &job->priority);
+
+    halide_mutex_lock(&work_queue.mutex);
+    enqueue_work_already_locked(1, job, NULL);
+    // Nobody else is going to run it, so make sure there is at least
+    // one worker, even when the pool has been limited to one thread.
+    if (work_queue.threads_created == 0) {
+        work_queue.a_team_size++;
+        work_queue.threads[work_queue.threads_created++] =
+            halide_spawn_thread(worker_thread, NULL);
+    }
+    work_queue.async_jobs++;
+    halide_mutex_unlock(&work_queue.mutex);
+    return 0;
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -673,6 +807,11 @@ WEAK void halide_shutdown_thread_pool() {
         // to go home
         halide_mutex_lock(&work_queue.mutex);
 
+        // Let any outstanding halide_do_async work finish first.
+        while (work_queue.async_jobs > 0) {
+            halide_cond_wait(&work_queue.wake_owners, &work_queue.mutex);
+        }
+
         work_queue.shutdown = true;
         halide_cond_broadcast(&work_queue.wake_owners);
         halide_cond_broadcast(&work_queue.wake_a_team);
@@ -747,6 +886,12 @@ WEAK halide_do_par_for_t halide_set_custom_do_par_for(halide_do_par_for_t f) {
     return result;
 }
 
+WEAK halide_get_job_priority_t halide_set_custom_get_job_priority(halide_get_job_priority_t f) {
+    halide_get_job_priority_t result = custom_get_job_priority;
+    custom_get_job_priority = f;
+    return result;
+}
+
 WEAK void halide_set_custom_parallel_runtime(
     halide_do_par_for_t do_par_for,
     halide_do_task_t do_task,
@@ -765,6 +910,10 @@ WEAK void halide_set_custom_parallel_runtime(
     custom_semaphore_release = semaphore_release;
 }
 
+WEAK void halide_get_job_priority(void *user_context, halide_job_priority_t *priority) {
+    (*custom_get_job_priority)(user_context, priority);
+}
+
 WEAK int halide_do_task(void *user_context, halide_task_t f, int idx,
                         uint8_t *closure) {
     return (*custom_do_task)(user_context, f, idx, closure);
@@ -0,0 +1,108 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // The detected parameters must describe some plausible machine.
+    MachineParams host = MachineParams::host();
+    if (host.parallelism < 1 || host.last_level_cache_size == 0 || host.balance <= 0) {
+        printf("Implausible host machine params: %s\n", host.to_string().c_str());
+        return -1;
+    }
+    if (host.l2_cache_size && host.l1_cache_size > host.l2_cache_size) {
+        printf("L1 is larger than L2: %s\n", host.to_string().c_str());
+        return -1;
+    }
+
+    // Whatever can't be detected, such as the balance, comes from
+    // generic(), and so from HL_MACHINE_PARAMS.
+#ifdef _WIN32
+    _putenv_s("HL_MACHINE_PARAMS", "3,1000,17");
+#else
+    setenv("HL_MACHINE_PARAMS", "3,1000,17", 1);
+#endif
+    if (MachineParams::host().balance != 17) {
+        printf("host() didn't take the balance from HL_MACHINE_PARAMS: %s\n",
+               MachineParams::host().to_string().c_str());
+        return -1;
+    }
+    // Asking for the host machine through HL_MACHINE_PARAMS mustn't
+    // recurse.
+#ifdef _WIN32
+    _putenv_s("HL_MACHINE_PARAMS", "host");
+#else
+    setenv("HL_MACHINE_PARAMS", "host", 1);
+#endif
+    if (MachineParams::generic().to_string() != host.to_string()) {
+        printf("HL_MACHINE_PARAMS=host didn't give the host machine params: %s vs %s\n",
+               MachineParams::generic().to_string().c_str(), host.to_string().c_str());
+        return -1;
+    }
+#ifdef _WIN32
+    _putenv_s("HL_MACHINE_PARAMS", "");
+#else
+    unsetenv("HL_MACHINE_PARAMS");
+#endif
+
+    // The string form must round-trip, with and without the cache
+    // hierarchy, so that it can be used for cross-compilation.
+    MachineParams detailed(8, 8 * 1024 * 1024, 40);
+    detailed.l1_cache_size = 32 * 1024;
+    detailed.l2_cache_size = 1024 * 1024;
+    detailed.cache_line_size = 64;
+    detailed.threads_per_core = 2;
+    detailed.numa_nodes = 1;
+    for (const MachineParams &p : {host, detailed, MachineParams(16, 16 * 1024 * 1024, 40)}) {
+        MachineParams q(p.to_string());
+        if (q.to_string() != p.to_string() ||
+            q.parallelism != p.parallelism ||
+            q.last_level_cache_size != p.last_level_cache_size ||
+            q.l1_cache_size != p.l1_cache_size ||
+            q.l2_cache_size != p.l2_cache_size ||
+            q.cache_line_size != p.cache_line_size ||
+            q.threads_per_core != p.threads_per_core ||
+            q.numa_nodes != p.numa_nodes) {
+            printf("MachineParams didn't round-trip: %s vs %s\n",
+                   p.to_string().c_str(), q.to_string().c_str());
+            return -1;
+        }
+    }
+    if (MachineParams("3,1000,20").to_string() != "3,1000,20") {
+        printf("Old-style MachineParams string didn't round-trip\n");
+        return -1;
+    }
+
+    // Auto-schedule a pipeline with the cache hierarchy known, and
+    // check it still computes the right thing.
+    Buffer<float> input(1024, 1024);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (float)(x + y);
+    });
+
+    Var x("x"), y("y");
+    Func f("f"), g("g"), h("h");
+    f(x, y) = input(x, y) * 2;
+    g(x, y) = f(x, y) + f(x + 1, y) + f(x, y + 1);
+    h(x, y) = g(x, y) + g(x, y + 1);
+    h.set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(h);
+    p.auto_schedule(target, detailed);
+    Buffer<float> out = p.realize(1000, 1000);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = 2 * ((x + y) * 6 + 7);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "halide_benchmark.h"
+
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide::Tools;
+
+bool close_to(double a, double b) {
+    return std::abs(a - b) < 1e-6 * std::max(1.0, std::abs(b));
+}
+
+#define CHECK(a, b)                                                  \
+    do {                                                             \
+        if (!close_to((a), (b))) {                                   \
+            printf("Line %d: %s is %.9g instead of %.9g\n",          \
+                   __LINE__, #a, (double)(a), (double)(b));          \
+            return -1;                                               \
+        }                                                            \
+    } while (0)
+
+int main(int argc, char **argv) {
+    // No samples.
+    {
+        BenchmarkStats s = compute_benchmark_stats({});
+        CHECK(s.mean, 0);
+        CHECK(s.stddev, 0);
+        CHECK(s.outliers, 0);
+        if (s.noisy) {
+            printf("No samples shouldn't be noisy\n");
+            return -1;
+        }
+    }
+
+    // A single sample.
+    {
+        BenchmarkStats s = compute_benchmark_stats({2});
+        CHECK(s.min, 2);
+        CHECK(s.max, 2);
+        CHECK(s.p50, 2);
+        CHECK(s.p99, 2);
+        CHECK(s.mean, 2);
+        CHECK(s.stddev, 0);
+        CHECK(s.ci95_low, 2);
+        CHECK(s.ci95_high, 2);
+    }
+
+    // Percentiles interpolate linearly between the sorted samples,
+    // which needn't be given in order.
+    {
+        BenchmarkStats s = compute_benchmark_stats({3, 1, 5, 2, 4});
+        CHECK(s.min, 1);
+        CHECK(s.max, 5);
+        CHECK(s.p50, 3);
+        CHECK(s.p90, 4.6);
+        CHECK(s.p99, 4.96);
+        CHECK(s.outliers, 0);
+        CHECK(s.mean, 3);
+        // Sample (not population) standard deviation.
+        CHECK(s.stddev, std::sqrt(2.5));
+        // t = 2.776 for four degrees of freedom.
+        CHECK(s.ci95_low, 3 - 2.776 * std::sqrt(2.5 / 5));
+        CHECK(s.ci95_high, 3 + 2.776 * std::sqrt(2.5 / 5));
+        // A relative stddev of over 50% is well past the default
+        // threshold of 5%.
+        if (!s.noisy) {
+            printf("Widely spread samples should be noisy\n");
+            return -1;
+        }
+        s = compute_benchmark_stats({3, 1, 5, 2, 4}, 0.6);
+        if (s.noisy) {
+            printf("Samples within the noise threshold shouldn't be noisy\n");
+            return -1;
+        }
+    }
+
+    // A slow outlier counts towards the percentiles, but not towards
+    // the mean and stddev.
+    {
+        BenchmarkStats s = compute_benchmark_stats({1, 1, 1, 1, 1, 1, 1, 100});
+        CHECK(s.max, 100);
+        CHECK(s.p50, 1);
+        CHECK(s.p99, 1 + 0.93 * 99);
+        CHECK(s.outliers, 1);
+        CHECK(s.mean, 1);
+        CHECK(s.stddev, 0);
+        if (s.noisy) {
+            printf("A single outlier in eight samples shouldn't be noisy\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Param<int> offset;
+    ImageParam input(Int(32), 1);
+    Func f;
+    Var x;
+    f(x) = input(x) + offset;
+
+    Buffer<int> in(10), out(10);
+    in.for_each_element([&](int x) { in(x) = x; });
+    input.set(in);
+    offset.set(1);
+
+    Pipeline p(f);
+    BoundCall call = p.bind(out);
+
+    for (int i = 0; i < 3; i++) {
+        // Scalar Params and the contents of bound Buffers are read on
+        // every run.
+        offset.set(i * 10);
+        in(0) = i;
+        call.run();
+        for (int x = 0; x < 10; x++) {
+            int correct = (x == 0 ? i : x) + i * 10;
+            if (out(x) != correct) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    // ParamMap values are bound too.
+    ParamMap pm;
+    pm.set(offset, 100);
+    BoundCall call2 = p.bind(out, Target(), pm);
+    call2.run();
+    if (out(5) != 105) {
+        printf("out(5) = %d instead of 105\n", out(5));
+        return -1;
+    }
+
+    // ... at bind time, so changing the ParamMap afterwards doesn't
+    // affect the call.
+    pm.set(offset, 200);
+    call2.run();
+    if (out(5) != 105) {
+        printf("out(5) = %d instead of 105 after changing the ParamMap\n", out(5));
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::atomic<int> checks{0}, tasks{0};
+int cancel_after = 0;
+
+int my_cancelled(void *user_context) {
+    return checks++ >= cancel_after;
+}
+
+int my_do_task(void *user_context, int (*f)(void *, int, uint8_t *), int idx, uint8_t *closure) {
+    tasks++;
+    return f(user_context, idx, closure);
+}
+
+int errors = 0;
+void my_error(void *user_context, const char *msg) {
+    // halide_error_cancelled shouldn't print anything, so this
+    // should never be called.
+    printf("Unexpected error: %s\n", msg);
+    errors++;
+}
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // A chain of compute_root stages. Cancelling before the
+        // first stage should mean nothing gets computed.
+        Func f, g, h;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) * 2;
+        h(x, y) = g(x, y) + 1;
+        f.compute_root();
+        g.compute_root();
+
+        h.set_custom_cancelled(my_cancelled);
+        h.set_error_handler(my_error);
+
+        Buffer<int> out(64, 64);
+        out.fill(-1);
+
+        cancel_after = 0;
+        checks = 0;
+        h.realize(out);
+
+        if (checks == 0) {
+            printf("halide_cancelled was never called\n");
+            return -1;
+        }
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                if (out(xx, yy) != -1) {
+                    printf("out(%d, %d) was computed despite cancellation\n", xx, yy);
+                    return -1;
+                }
+            }
+        }
+
+        // Without cancellation it should still work.
+        cancel_after = 1 << 30;
+        checks = 0;
+        h.realize(out);
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                if (out(xx, yy) != (xx + yy) * 2 + 1) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), (xx + yy) * 2 + 1);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A single parallel stage with asserts disabled, so the only
+        // checks happen in the thread pool. Cancelling partway
+        // through should stop the remaining tasks from running.
+        Func f;
+        f(x, y) = x * y;
+        f.parallel(y);
+
+        f.set_custom_cancelled(my_cancelled);
+        f.set_custom_do_task(my_do_task);
+        f.set_error_handler(my_error);
+
+        Target t = get_jit_target_from_environment().with_feature(Target::NoAsserts);
+        Buffer<int> out(16, 1000);
+
+        cancel_after = 10;
+        checks = 0;
+        tasks = 0;
+        f.realize(out, t);
+
+        if (tasks > cancel_after) {
+            printf("%d tasks ran after cancelling at %d\n", (int)tasks, cancel_after);
+            return -1;
+        }
+    }
+
+    if (errors) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
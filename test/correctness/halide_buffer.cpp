@@ -415,6 +415,36 @@ int main(int argc, char **argv) {
         assert(b.dim(3).stride() == b2.dim(3).stride());
     }
 
+    {
+        // Check copy_from between packed and planar layouts, which
+        // take the strided fast paths, for various numbers of
+        // channels and element sizes.
+        for (int c = 1; c <= 5; c++) {
+            Buffer<uint8_t> packed8 = Buffer<uint8_t>::make_interleaved(37, 11, c);
+            Buffer<uint8_t> planar8(37, 11, c);
+            packed8.fill([](int x, int y, int c) { return (uint8_t)(x * 7 + y * 3 + c); });
+            planar8.copy_from(packed8);
+            check_equal(planar8, packed8);
+            packed8.fill(0);
+            packed8.copy_from(planar8);
+            check_equal(planar8, packed8);
+
+            Buffer<double> packed64 = Buffer<double>::make_interleaved(37, 11, c);
+            Buffer<double> planar64(40, 11, c);
+            planar64.fill([](int x, int y, int c) { return x + y * 100.0 + c * 10000.0; });
+            packed64.copy_from(planar64);
+            check_equal(packed64, planar64.cropped(0, 0, 37));
+
+            // A crop in x leaves the rows and planes contiguous with
+            // each other, but not with the columns.
+            Buffer<uint16_t> src16(64, 8, c), dst16(16, 8, c);
+            src16.fill([](int x, int y, int c) { return (uint16_t)(x + y * 64 + c * 512); });
+            dst16.translate(0, 20);
+            dst16.copy_from(src16);
+            check_equal(dst16, src16.cropped(0, 20, 16));
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -14,9 +14,6 @@ void test_round_trip(Buffer<T> buf, std::string format) {
     std::string filename = o.str();
     Tools::save_image(buf, filename);
 
-    // TIFF is write-only for now.
-    if (format == "tiff") return;
-
     // Reload it
     Buffer<T> reloaded = Tools::load_image(filename);
 
@@ -185,7 +182,7 @@ void do_test() {
     luma_buf.copy_from(color_buf);
     luma_buf.slice(2);
 
-    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "tiff"};
+    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "npy", "tiff"};
 #ifndef HALIDE_NO_JPEG
     formats.push_back("jpg");
 #endif
@@ -255,9 +252,235 @@ void test_mat_header() {
     }
 }
 
+template<typename T>
+void test_load_mapped(const std::string &format) {
+    std::cout << "Testing load_mapped for " << format << " " << halide_type_of<T>() << "\n";
+
+    Buffer<T> buf(23, 19, 3, 2);
+    buf.for_each_element([&](int x, int y, int c, int w) {
+        buf(x, y, c, w) = (T)(x + y * 3 + c * 5 + w * 7);
+    });
+    std::string filename = Internal::get_test_tmp_dir() + "test_mapped." + format;
+    Tools::save_image(buf, filename);
+
+    Buffer<T> mapped = Tools::load_mapped_image(filename);
+    if (!mapped.get()->owns_host_memory() || mapped.dimensions() != buf.dimensions()) {
+        printf("test_load_mapped: bad mapped buffer for %s\n", format.c_str());
+        abort();
+    }
+    mapped.for_each_element([&](const int *pos) {
+        if (mapped(pos) != buf(pos)) {
+            printf("test_load_mapped: mismatch for %s\n", format.c_str());
+            abort();
+        }
+    });
+
+    // The mapping is copy-on-write, so writes must not reach the file,
+    // and a crop must keep the mapping alive after the original is gone.
+    mapped.fill((T)0);
+    Buffer<T> reloaded = Tools::load_mapped_image(filename);
+    Buffer<T> cropped = reloaded.cropped(0, 2, 5);
+    reloaded = Buffer<T>();
+    if (cropped(2, 0, 0, 0) != (T)2 || cropped(6, 1, 1, 1) != (T)(6 + 3 + 5 + 7)) {
+        printf("test_load_mapped: mapped file was modified, or crop lost its data, for %s\n", format.c_str());
+        abort();
+    }
+}
+
+template<typename T>
+void test_band_reader(const std::string &format, int channels) {
+    std::cout << "Testing ImageBandReader for " << format << " " << halide_type_of<T>() << "x" << channels << "\n";
+
+    Buffer<T> buf = Buffer<T>::make_interleaved(301, 203, channels);
+    buf.for_each_element([&](int x, int y, int c) {
+        buf(x, y, c) = (T)(x * 3 + y * 5 + c * 7);
+    });
+    std::string filename = Internal::get_test_tmp_dir() + "test_band_reader." + format;
+    if (channels == 1) {
+        Buffer<T> luma = buf.sliced(2);
+        Tools::save_image(luma, filename);
+    } else {
+        Tools::save_image(buf, filename);
+    }
+    // Compare against load_image rather than buf, as jpg is lossy.
+    Buffer<T> whole = Tools::load_image(filename);
+
+    Tools::ImageBandReader<Buffer<>, Tools::Internal::CheckFail> reader;
+    reader.open(filename);
+    if (reader.width() != 301 || reader.height() != 203 || reader.channels() != channels) {
+        printf("test_band_reader: wrong shape for %s\n", format.c_str());
+        abort();
+    }
+    Buffer<> band;
+    int rows = 0;
+    while (reader.read_band(64, &band)) {
+        Buffer<T> typed = band;
+        if (typed.dim(1).min() != rows || typed.dimensions() != whole.dimensions()) {
+            printf("test_band_reader: band out of order for %s\n", format.c_str());
+            abort();
+        }
+        typed.for_each_element([&](const int *pos) {
+            if (typed(pos) != whole(pos)) {
+                printf("test_band_reader: mismatch for %s\n", format.c_str());
+                abort();
+            }
+        });
+        rows += typed.dim(1).extent();
+    }
+    if (rows != 203) {
+        printf("test_band_reader: read %d rows of %s, expected 203\n", rows, format.c_str());
+        abort();
+    }
+}
+
+// Load a TIFF file that save_tiff wouldn't write: 100 rows in strips of
+// 30, 30, 30 and 10 rows, stored in the file in reverse order.
+void test_tiff_strips() {
+    std::cout << "Testing multi-strip TIFF\n";
+
+    const int width = 7, height = 100, rows_per_strip = 30, num_strips = 4;
+    std::vector<uint8_t> file;
+    auto put16 = [&](uint16_t v) {
+        file.push_back(v & 0xff);
+        file.push_back(v >> 8);
+    };
+    auto put32 = [&](uint32_t v) {
+        put16(v & 0xffff);
+        put16(v >> 16);
+    };
+    auto entry = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value) {
+        put16(tag);
+        put16(type);
+        put32(count);
+        if (type == 3 && count == 1) {
+            put16(value);
+            put16(0);
+        } else {
+            put32(value);
+        }
+    };
+
+    const int num_entries = 9;
+    const uint32_t ifd_size = 2 + num_entries * 12 + 4;
+    const uint32_t offsets_at = 8 + ifd_size;
+    const uint32_t counts_at = offsets_at + num_strips * 4;
+    const uint32_t data_at = counts_at + num_strips * 4;
+
+    uint32_t strip_offsets[num_strips], strip_byte_counts[num_strips];
+    uint32_t next = data_at;
+    for (int s = num_strips - 1; s >= 0; s--) {
+        int rows = std::min(rows_per_strip, height - s * rows_per_strip);
+        strip_offsets[s] = next;
+        strip_byte_counts[s] = rows * width * 2;
+        next += strip_byte_counts[s];
+    }
+
+    file.push_back('I');
+    file.push_back('I');
+    put16(42);
+    put32(8);
+    put16(num_entries);
+    entry(256, 4, 1, width);                 // ImageWidth
+    entry(257, 4, 1, height);                // ImageLength
+    entry(258, 3, 1, 16);                    // BitsPerSample
+    entry(259, 3, 1, 1);                     // Compression
+    entry(262, 3, 1, 1);                     // PhotometricInterpretation
+    entry(273, 4, num_strips, offsets_at);   // StripOffsets
+    entry(277, 3, 1, 1);                     // SamplesPerPixel
+    entry(278, 3, 1, rows_per_strip);        // RowsPerStrip
+    entry(279, 4, num_strips, counts_at);    // StripByteCounts
+    put32(0);
+    for (uint32_t o : strip_offsets) {
+        put32(o);
+    }
+    for (uint32_t c : strip_byte_counts) {
+        put32(c);
+    }
+    for (int s = num_strips - 1; s >= 0; s--) {
+        for (int y = s * rows_per_strip; y < std::min(height, (s + 1) * rows_per_strip); y++) {
+            for (int x = 0; x < width; x++) {
+                put16(x + y * width);
+            }
+        }
+    }
+
+    std::string filename = Internal::get_test_tmp_dir() + "test_strips.tiff";
+    {
+        std::ofstream fs(filename.c_str(), std::ofstream::binary);
+        fs.write((const char *)file.data(), file.size());
+    }
+
+    Buffer<uint16_t> loaded = Tools::load_image(filename);
+    if (loaded.dimensions() != 2 || loaded.width() != width || loaded.height() != height) {
+        printf("test_tiff_strips: wrong shape\n");
+        abort();
+    }
+    loaded.for_each_element([&](int x, int y) {
+        if (loaded(x, y) != x + y * width) {
+            printf("test_tiff_strips: loaded(%d, %d) = %d instead of %d\n", x, y, loaded(x, y), x + y * width);
+            abort();
+        }
+    });
+
+    // Round trip it through save_tiff, which writes a single strip.
+    test_round_trip(loaded, "tiff");
+}
+
+// save_tiff writes a depth dimension (that of a 3-D image with more
+// slices than are plausible as channels, or of a 4-D image) as a single
+// strip per channel, with RowsPerStrip giving the height of one slice.
+template<typename T>
+void test_tiff_depth(Buffer<T> buf) {
+    std::cout << "Testing TIFF with " << buf.dimensions() << " dimensions for " << halide_type_of<T>() << "\n";
+    int i = 0;
+    buf.for_each_value([&](T &v) { v = (T)(i++ % 251); });
+    test_round_trip(buf, "tiff");
+
+    std::string filename = Internal::get_test_tmp_dir() + "test_depth.tiff";
+    Tools::save_image(buf, filename);
+    Buffer<T> reloaded = Tools::load_image(filename);
+    if (reloaded.dimensions() != buf.dimensions()) {
+        printf("test_tiff_depth: reloaded %d dimensions instead of %d\n", reloaded.dimensions(), buf.dimensions());
+        abort();
+    }
+    for (int d = 0; d < buf.dimensions(); d++) {
+        if (reloaded.dim(d).extent() != buf.dim(d).extent()) {
+            printf("test_tiff_depth: dimension %d has extent %d instead of %d\n", d, reloaded.dim(d).extent(), buf.dim(d).extent());
+            abort();
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
     test_mat_header();
+    test_tiff_strips();
+    test_tiff_depth(Buffer<uint8_t>(10, 10, 6));
+    test_tiff_depth(Buffer<uint8_t>(10, 10, 3, 2));
+    test_tiff_depth(Buffer<float>(100, 50, 3, 2));
+    for (std::string format : {"tmp", "mat", "npy"}) {
+        test_load_mapped<uint8_t>(format);
+        test_load_mapped<float>(format);
+        test_load_mapped<double>(format);
+    }
+    std::vector<std::string> band_formats = {"ppm", "pgm"};
+#ifndef HALIDE_NO_JPEG
+    band_formats.push_back("jpg");
+#endif
+#ifndef HALIDE_NO_PNG
+    band_formats.push_back("png");
+#endif
+    for (std::string format : band_formats) {
+        for (int channels : {1, 3}) {
+            if ((format == "ppm" && channels != 3) || (format == "pgm" && channels != 1)) {
+                continue;
+            }
+            test_band_reader<uint8_t>(format, channels);
+            if (format != "jpg") {
+                test_band_reader<uint16_t>(format, channels);
+            }
+        }
+    }
     return 0;
 }
@@ -1,6 +1,12 @@
 #include "Halide.h"
+#include "test/common/halide_test_dirs.h"
 #include <stdio.h>
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
 using namespace Halide;
 
 // The check has to go in the Halide namespace, because get_source_location looks for the first thing outside of it
@@ -104,7 +110,102 @@ struct HeapObject {
     inner2 inner2_array[10];
 };
 
+// Make some Funcs and Vars, and print the names they were given. Run
+// in a child process by test_names_in_child.
+void print_names() {
+    Func blur;
+    Var xx, yy;
+    Func sharpen;
+    printf("names: %s %s %s %s\n", blur.name().c_str(), xx.name().c_str(),
+           yy.name().c_str(), sharpen.name().c_str());
+}
+
+// Run this test in a child process with the given environment, and
+// return its output, with the names printed by print_names (if any) in
+// *names.
+std::string run_child(const char *argv0, const std::string &env, std::string *names) {
+    std::string output;
+#ifndef _WIN32
+    std::string cmd = env + " '" + std::string(argv0) + "' --print-names 2>&1";
+    FILE *f = popen(cmd.c_str(), "r");
+    if (!f) {
+        printf("Could not run %s\n", cmd.c_str());
+        exit(-1);
+    }
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string line = buf;
+        if (line.compare(0, 7, "names: ") == 0) {
+            *names = line;
+        }
+        output += line;
+    }
+    if (pclose(f) != 0) {
+        printf("%s failed:\n%s", cmd.c_str(), output.c_str());
+        exit(-1);
+    }
+#endif
+    return output;
+}
+
+// Check that the index of parsed debug info is cached and reused, and
+// that disabling introspection gives deterministic names.
+void test_names_in_child(const char *argv0) {
+#ifndef _WIN32
+    std::string cache_dir = Internal::get_test_tmp_dir() + "introspection_cache_" + std::to_string(getpid());
+    std::string env = "HL_DEBUG_CODEGEN=2 HL_INTROSPECTION_CACHE_DIR='" + cache_dir + "'";
+
+    std::string first_names, second_names;
+    std::string first = run_child(argv0, env, &first_names);
+    if (first_names != "names: blur xx yy sharpen\n") {
+        printf("Unexpected names with introspection: %s\n%s", first_names.c_str(), first.c_str());
+        exit(-1);
+    }
+    if (first.find("Saved debug info index to " + cache_dir) == std::string::npos) {
+        printf("First run didn't save the debug info index:\n%s", first.c_str());
+        exit(-1);
+    }
+    std::string second = run_child(argv0, env, &second_names);
+    if (second.find("Loaded debug info index from " + cache_dir) == std::string::npos) {
+        printf("Second run didn't load the debug info index:\n%s", second.c_str());
+        exit(-1);
+    }
+    if (second_names != first_names) {
+        printf("Names differ when loaded from the index: %s vs %s", second_names.c_str(), first_names.c_str());
+        exit(-1);
+    }
+
+    std::string disabled_names[2];
+    for (std::string &names : disabled_names) {
+        run_child(argv0, "HL_DISABLE_INTROSPECTION=1", &names);
+    }
+    if (disabled_names[0].empty() || disabled_names[0] != disabled_names[1] ||
+        disabled_names[0].find("blur") != std::string::npos) {
+        printf("Names with introspection disabled aren't deterministic, or were introspected: %s vs %s",
+               disabled_names[0].c_str(), disabled_names[1].c_str());
+        exit(-1);
+    }
+
+    // Remove the index cache.
+    if (DIR *dir = opendir(cache_dir.c_str())) {
+        while (struct dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                unlink((cache_dir + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(cache_dir.c_str());
+#endif
+}
+
 int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]) == "--print-names") {
+        print_names();
+        return 0;
+    }
+
     bool result = HalideIntrospectionCanary::test(&HalideIntrospectionCanary::test_a);
 
     if (result) {
@@ -116,6 +217,8 @@ int main(int argc, char **argv) {
 
     printf("Continuing with further tests...\n");
 
+    test_names_in_child(argv[0]);
+
     Foo::f(17);
 
     // Make sure it works all the way up to main
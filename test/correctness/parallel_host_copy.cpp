@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Copy the region of in covered by out into out with
+// halide_buffer_copy, via a copy_to_host stage, and check the
+// result. Host copies of 2 MB or more are split across the thread
+// pool.
+int check_copy(const Buffer<int> &in, Buffer<int> out, const char *name) {
+    Func f;
+    Var x, y;
+    f(x, y) = in(x, y);
+    f.copy_to_host();
+    f.realize(out);
+
+    for (int y = out.dim(1).min(); y <= out.dim(1).max(); y++) {
+        for (int x = out.dim(0).min(); x <= out.dim(0).max(); x++) {
+            if (out(x, y) != in(x, y)) {
+                printf("%s: out(%d, %d) = %d instead of %d\n",
+                       name, x, y, out(x, y), in(x, y));
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+Buffer<int> make_input(int w, int h) {
+    Buffer<int> in(w, h);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = x * 3 + y * 7919;
+    });
+    return in;
+}
+
+int main(int argc, char **argv) {
+    // A single contiguous chunk of ~4.4 MB, which is split into blocks
+    // of bytes that don't divide it evenly.
+    {
+        Buffer<int> in = make_input(1000, 1100);
+        if (check_copy(in, Buffer<int>(1000, 1100), "dense") != 0) {
+            return -1;
+        }
+    }
+
+    // A crop, so that each row of the source is a separate chunk.
+    {
+        Buffer<int> in = make_input(1536, 1200);
+        Buffer<int> cropped = in.get()->cropped(0, 100, 1024).cropped(1, 50, 1001);
+        Buffer<int> out(1024, 1001);
+        out.set_min(100, 50);
+        if (check_copy(cropped, out, "cropped") != 0) {
+            return -1;
+        }
+    }
+
+    // A transposed source, which the copy has to gather one element
+    // at a time.
+    {
+        Buffer<int> in = make_input(1100, 700);
+        Buffer<int> transposed = in.transposed(0, 1);
+        if (check_copy(transposed, Buffer<int>(700, 1100), "transposed") != 0) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
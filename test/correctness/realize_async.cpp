@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::atomic<int> checks{0};
+
+int cancel_after_ten(void *user_context) {
+    return checks++ >= 10;
+}
+
+void ignore_error(void *user_context, const char *msg) {
+}
+
+int main(int argc, char **argv) {
+    Func f;
+    Var x, y;
+    f(x, y) = x + y * 100;
+    f.parallel(y);
+    Pipeline p(f);
+
+    // Several realizations in flight at once.
+    const int n = 8;
+    std::vector<Buffer<int>> outs;
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < n; i++) {
+        outs.emplace_back(50, 40);
+    }
+    for (int i = 0; i < n; i++) {
+        futures.push_back(p.realize_async(outs[i]));
+    }
+    for (int i = 0; i < n; i++) {
+        futures[i].get();
+        for (int yy = 0; yy < 40; yy++) {
+            for (int xx = 0; xx < 50; xx++) {
+                if (outs[i](xx, yy) != xx + yy * 100) {
+                    printf("outs[%d](%d, %d) = %d\n", i, xx, yy, outs[i](xx, yy));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The callback form reports the exit status and the error message.
+    {
+        Func g;
+        g(x) = x;
+        g.bound(x, 0, 1);
+        Buffer<int> too_big(10);
+        std::promise<std::pair<int, std::string>> result;
+        p = Pipeline(g);
+        p.bind(too_big).run_async([&](int exit_status, const std::string &error) {
+            result.set_value({exit_status, error});
+        });
+        auto r = result.get_future().get();
+        if (r.first == 0 || r.second.find("do not cover required region") == std::string::npos) {
+            printf("Unexpected result from failing run_async: %d, \"%s\"\n", r.first, r.second.c_str());
+            return -1;
+        }
+    }
+
+    // Cancelling a realization partway through should still deliver
+    // its result, rather than leaving the caller waiting forever.
+    {
+        Func g;
+        g(x, y) = x * y;
+        g.parallel(y);
+        p = Pipeline(g);
+        p.set_custom_cancelled(cancel_after_ten);
+        Buffer<int> out(16, 1000);
+        std::promise<int> result;
+        p.bind(out).run_async([&](int exit_status, const std::string &error) {
+            result.set_value(exit_status);
+        });
+        int exit_status = result.get_future().get();
+        if (exit_status != halide_error_code_cancelled) {
+            printf("Cancelled run_async returned %d\n", exit_status);
+            return -1;
+        }
+
+        // With a custom error handler the future is just made ready.
+        checks = 0;
+        p.set_error_handler(ignore_error);
+        p.realize_async(out).get();
+    }
+
+    printf("Success!\n");
+    return 0;
+}
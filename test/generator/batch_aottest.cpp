@@ -0,0 +1,143 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "halide_benchmark.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "batch.h"
+
+using namespace Halide::Runtime;
+
+const int W = 64, H = 48, N = 256;
+
+int errors_reported = 0;
+extern "C" void my_error_handler(void *user_context, const char *msg) {
+    errors_reported++;
+}
+
+uint8_t expected_value(const Buffer<uint8_t> &in, int bias, int x, int y) {
+    int sum = bias;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int xx = std::min(std::max(x + dx, 0), in.width() - 1);
+            int yy = std::min(std::max(y + dy, 0), in.height() - 1);
+            sum += in(xx, yy);
+        }
+    }
+    return (uint8_t)(sum / 9);
+}
+
+// The argument lists for one batch: each item is an argv-style array
+// of {input, &bias, output}, as accepted by batch_argv.
+struct BatchArgs {
+    std::vector<Buffer<uint8_t>> inputs, outputs;
+    std::vector<int32_t> biases;
+    std::vector<std::vector<void *>> argvs;
+    std::vector<void **> args;
+
+    BatchArgs(int n) {
+        inputs.reserve(n);
+        outputs.reserve(n);
+        biases.resize(n);
+        argvs.resize(n);
+        args.resize(n);
+        for (int i = 0; i < n; i++) {
+            inputs.emplace_back(W, H);
+            inputs[i].for_each_element([&](int x, int y) {
+                inputs[i](x, y) = (uint8_t)(x * 3 + y * 5 + i * 7);
+            });
+            outputs.emplace_back(W, H);
+            outputs[i].fill(0);
+            biases[i] = i % 5;
+            argvs[i] = {inputs[i].raw_buffer(), &biases[i], outputs[i].raw_buffer()};
+            args[i] = argvs[i].data();
+        }
+    }
+
+    bool check(int i) const {
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                uint8_t correct = expected_value(inputs[i], biases[i], x, y);
+                if (outputs[i](x, y) != correct) {
+                    printf("item %d: output(%d, %d) = %d instead of %d\n",
+                           i, x, y, outputs[i](x, y), correct);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+int main(int argc, char **argv) {
+    halide_set_error_handler(my_error_handler);
+
+    // An empty batch does nothing.
+    if (batch_batch(0, nullptr, nullptr) != 0) {
+        printf("Empty batch failed\n");
+        return -1;
+    }
+
+    // Every item of a batch gets computed, with or without per-item results.
+    for (bool with_results : {false, true}) {
+        BatchArgs b(N);
+        std::vector<int> results(N, -1);
+        int result = batch_batch(N, b.args.data(), with_results ? results.data() : nullptr);
+        if (result != 0) {
+            printf("batch_batch failed: %d\n", result);
+            return -1;
+        }
+        for (int i = 0; i < N; i++) {
+            if (!b.check(i)) {
+                return -1;
+            }
+            if (with_results && results[i] != 0) {
+                printf("results[%d] = %d\n", i, results[i]);
+                return -1;
+            }
+        }
+    }
+
+    // A failing item is reported, and doesn't stop the rest of the batch.
+    {
+        BatchArgs b(N);
+        Buffer<uint16_t> wrong_type(W, H);
+        const int bad = N / 3;
+        b.argvs[bad][0] = wrong_type.raw_buffer();
+        std::vector<int> results(N, -1);
+        int result = batch_batch(N, b.args.data(), results.data());
+        if (result == 0 || results[bad] != result || errors_reported != 1) {
+            printf("Expected a single failure at item %d: result %d, results[%d] = %d, %d errors reported\n",
+                   bad, result, bad, results[bad], errors_reported);
+            return -1;
+        }
+        for (int i = 0; i < N; i++) {
+            if (i != bad && (results[i] != 0 || !b.check(i))) {
+                printf("Item %d was affected by the failure of item %d\n", i, bad);
+                return -1;
+            }
+        }
+    }
+
+    // Compare the batch entry point against calling the argv wrapper
+    // once per item.
+    {
+        BatchArgs b(N);
+        double t_loop = Halide::Tools::benchmark(3, 10, [&]() {
+            for (int i = 0; i < N; i++) {
+                batch_argv(b.args[i]);
+            }
+        });
+        double t_batch = Halide::Tools::benchmark(3, 10, [&]() {
+            batch_batch(N, b.args.data(), nullptr);
+        });
+        printf("%d items of %dx%d: argv loop %.3f us/item, batch %.3f us/item (%.2fx)\n",
+               N, W, H, t_loop * 1e6 / N, t_batch * 1e6 / N, t_loop / t_batch);
+    }
+
+    printf("Success!\n");
+    return 0;
+}
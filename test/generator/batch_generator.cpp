@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+// A small separable blur with a compute_root intermediate, so that each
+// call makes a heap allocation the batch entry point can recycle.
+class Batch : public Halide::Generator<Batch> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Input<int32_t> bias{"bias"};
+
+    Output<Buffer<uint8_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        Func clamped = BoundaryConditions::repeat_edge(input);
+        Func rows("rows");
+        rows(x, y) = cast<uint16_t>(clamped(x - 1, y)) + clamped(x, y) + clamped(x + 1, y);
+        output(x, y) = cast<uint8_t>((rows(x, y - 1) + rows(x, y) + rows(x, y + 1) + bias) / 9);
+
+        rows.compute_root().vectorize(x, natural_vector_size<uint16_t>(), TailStrategy::GuardWithIf);
+        output.vectorize(x, natural_vector_size<uint8_t>(), TailStrategy::GuardWithIf).parallel(y, 16);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Batch, batch)
@@ -0,0 +1,100 @@
+// Only the uncompressed formats are needed here
+#define HALIDE_NO_PNG
+#define HALIDE_NO_JPEG
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "halide_out_of_core.h"
+#include "test/common/halide_test_dirs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "out_of_core.h"
+
+using namespace Halide::Runtime;
+
+const int W = 1001, H = 777;
+
+int main(int argc, char **argv) {
+    Buffer<uint16_t> input(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 7 + y * 13) & 0xff;
+    });
+    Buffer<uint16_t> expected(W - 2, H - 2);
+    int result = out_of_core(input, 3, expected);
+    if (result != 0) {
+        printf("out_of_core failed: %d\n", result);
+        return -1;
+    }
+
+    const std::string dir = Halide::Internal::get_test_tmp_dir();
+    for (std::string format : {"npy", "tmp"}) {
+        const std::string input_file = dir + "out_of_core_input." + format;
+        const std::string output_file = dir + "out_of_core_output." + format;
+        if (format == "tmp") {
+            // .tmp files are always 4-dimensional
+            Buffer<uint16_t> input_4d = input.embedded(2).embedded(3);
+            Halide::Tools::save_image(input_4d, input_file);
+        } else {
+            Halide::Tools::save_image(input, input_file);
+        }
+
+        // Budgets from much less than the input (so that tiles are single
+        // rows) to more than everything.
+        for (size_t budget : {size_t(1) << 16, size_t(1) << 20, size_t(1) << 26}) {
+            for (int threads : {1, 4}) {
+                Halide::Tools::OutOfCoreRunner runner(out_of_core_argv, out_of_core_metadata());
+                runner.set_input("input", input_file);
+                runner.set_scalar("offset", (int32_t)3);
+                runner.set_output("output", output_file, {W - 2, H - 2});
+                runner.set_memory_budget(budget);
+                runner.set_num_threads(threads);
+                std::string error;
+                if (!runner.run(&error)) {
+                    printf("OutOfCoreRunner failed: %s\n", error.c_str());
+                    return -1;
+                }
+                const auto &stats = runner.get_stats();
+                printf("%s, budget %zu, %d threads: %d tiles of %d x %d, peak %zu bytes\n",
+                       format.c_str(), budget, threads, stats.num_tiles,
+                       stats.tile_extents[0], stats.tile_extents[1], stats.peak_bytes);
+                if (stats.peak_bytes > budget) {
+                    printf("Exceeded the memory budget\n");
+                    return -1;
+                }
+
+                Buffer<uint16_t> output = Halide::Tools::load_image(output_file);
+                while (output.dimensions() > 2) {
+                    output.slice(output.dimensions() - 1);
+                }
+                bool mismatch = false;
+                output.for_each_element([&](int x, int y) {
+                    if (output(x, y) != expected(x, y)) {
+                        mismatch = true;
+                    }
+                });
+                if (mismatch) {
+                    printf("Output does not match the in-memory result\n");
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A tile that needs input from outside the file is an error.
+    {
+        Halide::Tools::OutOfCoreRunner runner(out_of_core_argv, out_of_core_metadata());
+        runner.set_input("input", dir + "out_of_core_input.npy");
+        runner.set_output("output", dir + "out_of_core_output.npy", {W, H});
+        std::string error;
+        if (runner.run(&error)) {
+            printf("Expected a failure when the input is too small\n");
+            return -1;
+        }
+        printf("Expected error: %s\n", error.c_str());
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "Halide.h"
+
+namespace {
+
+// A 3x3 box filter with no boundary condition, so that each output
+// tile needs a region of the input two pixels larger than itself.
+class OutOfCore : public Halide::Generator<OutOfCore> {
+public:
+    Input<Buffer<uint16_t>> input{"input", 2};
+    Input<int32_t> offset{"offset", 5};
+
+    Output<Buffer<uint16_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        Func rows("rows");
+        rows(x, y) = input(x, y) + input(x, y + 1) + input(x, y + 2);
+        output(x, y) = cast<uint16_t>(rows(x, y) + rows(x + 1, y) + rows(x + 2, y) + offset);
+
+        rows.compute_at(output, y).vectorize(x, natural_vector_size<uint16_t>(), TailStrategy::GuardWithIf);
+        output.vectorize(x, natural_vector_size<uint16_t>(), TailStrategy::GuardWithIf).parallel(y, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(OutOfCore, out_of_core)
@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+std::map<std::string, int> percentages;
+void my_print(void *, const char *msg) {
+    char name[256];
+    float this_ms;
+    int this_percentage;
+    int val = sscanf(msg, " %255[^:]: %fms (%d", name, &this_ms, &this_percentage);
+    if (val == 3) {
+        percentages[name] = this_percentage;
+    }
+}
+
+int main(int argc, char **argv) {
+    // A single Func with a cheap update and an expensive update. The
+    // Func-level profiler would bill everything to f. In loop-level
+    // mode we should be able to see which update is hot.
+    Func f("f");
+    Var x("x");
+    RDom r1(0, 100, "r1"), r2(0, 100, "r2");
+
+    f(x) = 0.0f;
+    f(x) += cast<float>(r1);
+    Expr e = f(x) + r2;
+    for (int j = 0; j < 100; j++) {
+        e = sin(e);
+    }
+    f(x) += e;
+
+    f.set_custom_print(&my_print);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile).with_feature(Target::ProfileByLoop);
+    f.realize(1000, t);
+
+    for (auto p : percentages) {
+        printf("%s: %d%%\n", p.first.c_str(), p.second);
+    }
+
+    const std::string cheap = "f.s1.r1$x", expensive = "f.s2.r2$x";
+    if (!percentages.count(cheap) || !percentages.count(expensive)) {
+        printf("Expected per-loop entries for %s and %s in the profiler report\n",
+               cheap.c_str(), expensive.c_str());
+        return -1;
+    }
+
+    if (percentages[expensive] < 40 || percentages[expensive] < percentages[cheap]) {
+        printf("Percentage of runtime spent in %s: %d\n"
+               "This is suspiciously low.\n",
+               expensive.c_str(), percentages[expensive]);
+        return -1;
+    }
+
+    // The per-loop times should be shown inline in the html stmt.
+    std::string html_file = Internal::get_test_tmp_dir() + "profiler_by_loop.html";
+    Internal::ensure_no_file_exists(html_file);
+    f.compile_to_lowered_stmt(html_file, {}, Halide::HTML, t);
+    Internal::assert_file_exists(html_file);
+    std::stringstream html;
+    html << std::ifstream(html_file).rdbuf();
+    if (html.str().find("class='ProfileTime'") == std::string::npos) {
+        printf("Expected the loop times to be shown in %s\n", html_file.c_str());
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
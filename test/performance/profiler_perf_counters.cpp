@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+int lines_with_counters = 0;
+float expensive_ipc = 0;
+void my_print(void *, const char *msg) {
+    const char *ipc = strstr(msg, " ipc: ");
+    if (ipc) {
+        lines_with_counters++;
+        if (strstr(msg, " expensive:")) {
+            sscanf(ipc, " ipc: %f", &expensive_ipc);
+        }
+    }
+}
+
+int errors = 0;
+void my_error(void *, const char *msg) {
+    errors++;
+}
+
+int main(int argc, char **argv) {
+    Func cheap("cheap"), expensive("expensive");
+    Var x("x"), y("y");
+
+    cheap(x, y) = x + y;
+    Expr e = cast<float>(cheap(x, y));
+    for (int i = 0; i < 50; i++) {
+        e = sin(e);
+    }
+    expensive(x, y) = e;
+
+    cheap.compute_root();
+    expensive.parallel(y);
+    expensive.set_custom_print(&my_print);
+
+    Target t = get_jit_target_from_environment()
+                   .with_feature(Target::Profile)
+                   .with_feature(Target::ProfilePerfCounters);
+    expensive.realize(1000, 100, t);
+
+    // The JIT frees the profiler stats after every profiled run, so a
+    // run that fails part way must still stop billing counters to its
+    // stats before the next run starts.
+    {
+        Func f("f");
+        f(x, y) = x + y;
+        f.bound(x, 0, 16);
+        f.set_error_handler(&my_error);
+        f.set_custom_print(&my_print);
+        Buffer<int> too_big(32, 16);
+        f.realize(too_big, t);
+        if (errors != 1) {
+            printf("Expected the realization to fail\n");
+            return -1;
+        }
+        Buffer<int> out = f.realize({16, 16}, t);
+        if (errors != 1 || out(3, 4) != 7) {
+            printf("Realization after a failed one went wrong\n");
+            return -1;
+        }
+    }
+
+    if (lines_with_counters == 0) {
+        // Hardware counters aren't available here (no PMU, restrictive
+        // perf_event_paranoid, or an unsupported platform). The
+        // pipeline should still have run and reported times as usual.
+        printf("Hardware performance counters unavailable; skipping checks.\n");
+    } else if (expensive_ipc <= 0) {
+        printf("Expected a positive ipc for the expensive Func\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
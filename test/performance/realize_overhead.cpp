@@ -96,6 +96,18 @@ int main(int argc, char **argv) {
         std::cout << "No argument Pipeline realize reusing Realization/Target/ParamMap with no_asserts and no_bounds_query time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        f() = 42;
+
+        Pipeline p(f);
+
+        auto buf = Buffer<int32_t>::make_scalar();
+        BoundCall call = p.bind(buf);
+        double t = benchmark([&]() { call.run(); });
+        std::cout << "No argument Pipeline bound call time " << t * 1e6 << "us.\n";
+    }
+
     {
         Func f;
         Param<int> in;
@@ -129,6 +141,22 @@ int main(int argc, char **argv) {
         std::cout << "One argument Pipeline realize reusing Realization/Target/ParamMap time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        Param<int> in;
+
+        f() = in + 42;
+
+        in.set(0);
+
+        Pipeline p(f);
+
+        auto buf = Buffer<int32_t>::make_scalar();
+        BoundCall call = p.bind(buf);
+        double t = benchmark([&]() { call.run(); });
+        std::cout << "One argument Pipeline bound call time " << t * 1e6 << "us.\n";
+    }
+
     for (int i = 10; i < 100; i += 10) {
         Func f;
         std::vector<Param<int>> params(i);
@@ -3,8 +3,11 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -13,8 +16,13 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 namespace Halide {
 namespace RunGen {
 
@@ -389,6 +397,21 @@ inline Buffer<> allocate_buffer(const halide_type_t &type, const Shape &shape) {
     return b;
 }
 
+// Return the size in bytes of the last-level cache of the machine we're
+// running on, if we can find out, or a conservative guess if we can't.
+inline uint64_t last_level_cache_size() {
+#if defined(_SC_LEVEL3_CACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size <= 0) {
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+    if (size > 0) {
+        return (uint64_t)size;
+    }
+#endif
+    return 32 * 1024 * 1024;
+}
+
 inline Shape choose_output_extents(int dimensions, const Shape &defaults) {
     Shape s(dimensions);
     for (int i = 0; i < dimensions; ++i) {
@@ -1259,15 +1282,63 @@ public:
         }
     }
 
-    void run_for_benchmark(double benchmark_min_time) {
-        std::vector<void *> filter_argv = build_filter_argv();
+    // Benchmark the filter. If json_path is nonempty, also write the
+    // result, including the full distribution of sample times, to
+    // that file as JSON; otherwise append it to the file named by
+    // HL_BENCHMARK_JSON, if that is set.
+    //
+    // By default every iteration uses the same buffers, which will
+    // usually be resident in cache. If cold_cache is "rotate", each
+    // iteration instead uses the next of a pool of copies of the
+    // buffers that is larger than the cache; if it is "flush", the
+    // cache is flushed (untimed) before each iteration. cache_size is
+    // the size of the cache to defeat, in bytes; zero means that of
+    // the last-level cache of this machine.
+    void run_for_benchmark(double benchmark_min_time,
+                           uint64_t benchmark_min_samples = 0,
+                           const std::string &json_path = "",
+                           const std::string &cold_cache = "",
+                           uint64_t cache_size = 0) {
+        if (cache_size == 0) {
+            cache_size = last_level_cache_size();
+        }
 
-        const auto benchmark_inner = [this, &filter_argv]() {
+        std::vector<ArgvSet> argv_sets;
+        std::vector<char> flush_buffer;
+        std::function<void()> setup;
+        if (cold_cache.empty()) {
+            argv_sets.resize(1);
+            argv_sets[0].argv = build_filter_argv();
+        } else if (cold_cache == "rotate") {
+            argv_sets.resize(num_argv_sets_to_exceed(cache_size));
+            for (auto &s : argv_sets) {
+                init_argv_set(&s);
+            }
+            info() << "Rotating through " << argv_sets.size() << " copies of the buffers...";
+        } else if (cold_cache == "flush") {
+            argv_sets.resize(1);
+            argv_sets[0].argv = build_filter_argv();
+            // Touching every cache line of a buffer twice the size of
+            // the cache should evict everything the filter used.
+            flush_buffer.resize(cache_size * 2);
+            setup = [&flush_buffer]() {
+                for (size_t i = 0; i < flush_buffer.size(); i += 64) {
+                    flush_buffer[i]++;
+                }
+            };
+        } else {
+            fail() << "Unknown cold-cache mode: " << cold_cache << " (expected 'rotate' or 'flush')";
+        }
+
+        size_t next_set = 0;
+        const auto benchmark_inner = [this, &argv_sets, &next_set]() {
+            ArgvSet &s = argv_sets[next_set];
+            next_set = (next_set + 1) % argv_sets.size();
             // Ignore result since our halide_error() should catch everything.
-            (void)halide_argv_call(&filter_argv[0]);
+            (void)halide_argv_call(&s.argv[0]);
             // Ensure that all outputs are finished, otherwise we may just be
             // measuring how long it takes to do a kernel launch for GPU code.
-            this->device_sync_outputs();
+            this->device_sync_outputs(s);
         };
 
         info() << "Benchmarking filter...";
@@ -1275,22 +1346,172 @@ public:
         Halide::Tools::BenchmarkConfig config;
         config.min_time = benchmark_min_time;
         config.max_time = benchmark_min_time * 4;
-        auto result = Halide::Tools::benchmark(benchmark_inner, config);
+        config.min_samples = benchmark_min_samples;
+        config.name = md->name;
+        // We write our own record of the result below, which also
+        // gives the target and throughput.
+        config.log_json = false;
+        auto result = Halide::Tools::benchmark(benchmark_inner, setup, config);
+        const auto &stats = result.stats;
 
         if (!parsable_output) {
             out() << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
                   << result.samples << " samples, "
                   << result.iterations << " iterations, "
                   << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n"
-                  << "Best output throughput is " << (megapixels_out() / result.wall_time) << " mpix/sec.\n";
+                  << "Best output throughput is " << (megapixels_out() / result.wall_time) << " mpix/sec.\n"
+                  << std::setprecision(6)
+                  << "Sample times (sec/iter): p50 " << stats.p50
+                  << ", p90 " << stats.p90
+                  << ", p99 " << stats.p99
+                  << ", mean " << stats.mean << " +/- " << stats.stddev
+                  << " (95% CI " << stats.ci95_low << " to " << stats.ci95_high << ", "
+                  << stats.outliers << " outliers excluded).\n";
         } else {
             out() << md->name << "  BEST_TIME_MSEC_PER_ITER  " << result.wall_time * 1000.f << "\n"
                   << md->name << "  SAMPLES                  " << result.samples << "\n"
                   << md->name << "  ITERATIONS               " << result.iterations << "\n"
                   << md->name << "  TIMING_ACCURACY          " << result.accuracy << "\n"
+                  << md->name << "  P50_TIME_MSEC_PER_ITER   " << stats.p50 * 1000.f << "\n"
+                  << md->name << "  P90_TIME_MSEC_PER_ITER   " << stats.p90 * 1000.f << "\n"
+                  << md->name << "  P99_TIME_MSEC_PER_ITER   " << stats.p99 * 1000.f << "\n"
+                  << md->name << "  MEAN_TIME_MSEC_PER_ITER  " << stats.mean * 1000.f << "\n"
+                  << md->name << "  STDDEV_MSEC_PER_ITER     " << stats.stddev * 1000.f << "\n"
+                  << md->name << "  NOISY                    " << (stats.noisy ? 1 : 0) << "\n"
                   << md->name << "  THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() / result.wall_time) << "\n"
                   << md->name << "  HALIDE_TARGET            " << md->target << "\n";
         }
+
+        if (stats.noisy) {
+            warn() << "Benchmark results are noisy (relative stddev "
+                   << std::setprecision(2) << (stats.stddev / stats.mean * 100.0) << "%, "
+                   << stats.outliers << " of " << result.samples << " samples were outliers); "
+                   << "comparisons against them may be unreliable.";
+        }
+
+        const char *log_path = getenv("HL_BENCHMARK_JSON");
+        if (!json_path.empty() || (log_path && log_path[0])) {
+            const std::string path = json_path.empty() ? log_path : json_path;
+            std::ofstream f(path, json_path.empty() ? std::ios::app : std::ios::trunc);
+            f << "{\"target\": \"" << md->target << "\""
+              << ", \"throughput_mpix_per_sec\": " << (megapixels_out() / result.wall_time)
+              << ", \"benchmark\": " << Halide::Tools::benchmark_result_to_json(result, md->name)
+              << "}\n";
+            if (f.fail()) {
+                fail() << "Unable to write benchmark results to " << path;
+            }
+        }
+    }
+
+    // Run num_instances instances of the filter at once, each calling
+    // it repeatedly on its own thread with its own copies of the
+    // buffers, for at least benchmark_min_time seconds. This is done
+    // for 1, 2, 4, ... num_instances instances, and the throughput of
+    // each is reported, along with how well it scales compared to a
+    // single instance. Since all the instances share the Halide
+    // runtime's thread pool, this measures the contention between
+    // them. If cold_cache is "rotate", each instance rotates through
+    // its own pool of buffers larger than the cache, as for
+    // run_for_benchmark().
+    void run_for_concurrency_benchmark(double benchmark_min_time,
+                                       int num_instances,
+                                       const std::string &cold_cache = "",
+                                       uint64_t cache_size = 0) {
+        if (num_instances < 1) {
+            fail() << "The number of concurrent instances must be at least 1";
+        }
+        if (cache_size == 0) {
+            cache_size = last_level_cache_size();
+        }
+        size_t sets_per_instance = 1;
+        if (cold_cache == "rotate") {
+            sets_per_instance = num_argv_sets_to_exceed(cache_size);
+        } else if (!cold_cache.empty()) {
+            fail() << "Only the 'rotate' cold-cache mode can be used with concurrent instances";
+        }
+
+        std::vector<std::vector<ArgvSet>> argv_sets(num_instances);
+        for (auto &sets : argv_sets) {
+            sets.resize(sets_per_instance);
+            for (auto &s : sets) {
+                init_argv_set(&s);
+                // Warm up, e.g. to do any device allocation.
+                (void)halide_argv_call(&s.argv[0]);
+                device_sync_outputs(s);
+            }
+        }
+
+        info() << "Benchmarking concurrent instances of filter...";
+
+        if (!parsable_output) {
+            out() << "Concurrency benchmark for " << md->name << ":\n"
+                  << std::setw(10) << "instances" << std::setw(14) << "calls/sec"
+                  << std::setw(16) << "mean msec/call" << std::setw(12) << "efficiency" << "\n";
+        }
+
+        double single_instance_throughput = 0;
+        for (int n = 1;; n = std::min(n * 2, num_instances)) {
+            std::atomic<int> ready{0};
+            std::atomic<bool> go{false}, stop{false};
+            std::vector<uint64_t> calls(n, 0);
+            std::vector<double> busy_time(n, 0);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < n; t++) {
+                threads.emplace_back([&, t]() {
+                    std::vector<ArgvSet> &sets = argv_sets[t];
+                    ready++;
+                    while (!go) {
+                        std::this_thread::yield();
+                    }
+                    for (size_t i = 0; !stop; i = (i + 1) % sets.size()) {
+                        auto start = Halide::Tools::benchmark_now();
+                        (void)halide_argv_call(&sets[i].argv[0]);
+                        device_sync_outputs(sets[i]);
+                        auto end = Halide::Tools::benchmark_now();
+                        busy_time[t] += Halide::Tools::benchmark_duration_seconds(start, end);
+                        calls[t]++;
+                    }
+                });
+            }
+            while (ready < n) {
+                std::this_thread::yield();
+            }
+            auto start = Halide::Tools::benchmark_now();
+            go = true;
+            std::this_thread::sleep_for(std::chrono::duration<double>(benchmark_min_time));
+            stop = true;
+            for (auto &t : threads) {
+                t.join();
+            }
+            auto end = Halide::Tools::benchmark_now();
+
+            uint64_t total_calls = 0;
+            double total_busy_time = 0;
+            for (int t = 0; t < n; t++) {
+                total_calls += calls[t];
+                total_busy_time += busy_time[t];
+            }
+            const double throughput = total_calls / Halide::Tools::benchmark_duration_seconds(start, end);
+            const double mean_latency = total_busy_time / std::max<uint64_t>(total_calls, 1);
+            if (n == 1) {
+                single_instance_throughput = throughput;
+            }
+            const double efficiency = throughput / (n * single_instance_throughput);
+
+            if (!parsable_output) {
+                out() << std::setw(10) << n << std::setw(14) << std::setprecision(4) << throughput
+                      << std::setw(16) << mean_latency * 1000 << std::setw(12) << efficiency << "\n"
+                      << std::setprecision(6);
+            } else {
+                out() << md->name << "  INSTANCES_" << n << "_CALLS_PER_SEC      " << throughput << "\n"
+                      << md->name << "  INSTANCES_" << n << "_MEAN_MSEC_PER_CALL " << mean_latency * 1000 << "\n"
+                      << md->name << "  INSTANCES_" << n << "_SCALING_EFFICIENCY " << efficiency << "\n";
+            }
+
+            if (n == num_instances) {
+                break;
+            }
+        }
     }
 
     struct Output {
@@ -1342,6 +1563,70 @@ public:
         }
     }
 
+    // A set of arguments for one call to the filter, along with the
+    // buffers it owns (indexed like argv). If there are none, argv
+    // refers to the buffers in args.
+    struct ArgvSet {
+        std::vector<void *> argv;
+        std::vector<Buffer<>> buffers;
+    };
+
+    // Fill in an ArgvSet with its own copies of the input buffers and
+    // its own output buffers. (The scalars are shared.) The buffers
+    // must not move afterwards, since argv points to them.
+    void init_argv_set(ArgvSet *s) {
+        s->argv = build_filter_argv();
+        s->buffers.resize(args.size());
+        for (auto &arg_pair : args) {
+            auto &arg = arg_pair.second;
+            Buffer<> &b = s->buffers[arg.index];
+            switch (arg.metadata->kind) {
+            case halide_argument_kind_input_scalar:
+                break;
+            case halide_argument_kind_input_buffer:
+                b = allocate_buffer(arg.buffer_value.type(), get_shape(arg.buffer_value));
+                b.copy_from(arg.buffer_value);
+                s->argv[arg.index] = b.raw_buffer();
+                break;
+            case halide_argument_kind_output_buffer:
+                b = allocate_buffer(arg.buffer_value.type(), get_shape(arg.buffer_value));
+                s->argv[arg.index] = b.raw_buffer();
+                break;
+            }
+        }
+    }
+
+    // How many ArgvSets it takes for their buffers to add up to at
+    // least twice the given cache size, so that rotating through them
+    // never finds a set in cache.
+    size_t num_argv_sets_to_exceed(uint64_t cache_size) const {
+        uint64_t bytes_per_set = 0;
+        for (const auto &arg_pair : args) {
+            const auto &arg = arg_pair.second;
+            if (arg.metadata->kind != halide_argument_kind_input_scalar) {
+                bytes_per_set += arg.buffer_value.size_in_bytes();
+            }
+        }
+        constexpr uint64_t kMaxSets = 4096;
+        uint64_t num_sets = (cache_size * 2 + bytes_per_set - 1) / std::max<uint64_t>(bytes_per_set, 1);
+        if (num_sets > kMaxSets) {
+            warn() << "The buffers are so small that " << kMaxSets
+                   << " copies of them do not fill the cache; results may not be cold-cache.";
+            num_sets = kMaxSets;
+        }
+        return (size_t)std::max<uint64_t>(num_sets, 2);
+    }
+
+    void device_sync_outputs(ArgvSet &s) {
+        for (auto &arg_pair : args) {
+            auto &arg = arg_pair.second;
+            if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+                Buffer<> &b = s.buffers.empty() ? arg.buffer_value : s.buffers[arg.index];
+                b.device_sync();
+            }
+        }
+    }
+
     std::vector<void *> build_filter_argv() {
         std::vector<void *> filter_argv(args.size(), nullptr);
         for (auto &arg_pair : args) {
@@ -133,12 +133,42 @@ Flags:
         Run the filter with the given arguments many times to
         produce an estimate of average execution time; this currently
         runs "samples" sets of "iterations" each, and chooses the fastest
-        sample set.
+        sample set. The distribution of the sample times (percentiles,
+        mean, standard deviation and confidence interval) is reported
+        too, with a warning if it is noisy.
 
     --benchmark_min_time=DURATION_SECONDS [default = 0.1]:
         Override the default minimum desired benchmarking time; ignored if
         --benchmarks is not also specified.
 
+    --benchmark_min_samples=N [default = 0]:
+        Take at least this many samples, so that the percentiles are
+        meaningful (still limited to 4x --benchmark_min_time); ignored if
+        --benchmarks is not also specified.
+
+    --benchmark_json=FILE:
+        Also write the benchmark results, including every sample time,
+        to FILE as JSON; ignored if --benchmarks is not also specified.
+
+    --benchmark_cold_cache=MODE:
+        By default, every iteration of the benchmark uses the same buffers,
+        which are likely to be resident in cache. With MODE=rotate, each
+        iteration instead uses the next of a pool of copies of the input
+        and output buffers that is larger than the cache; with MODE=flush,
+        the cache is flushed before each iteration (the flush is not
+        timed). Ignored if --benchmarks is not also specified.
+
+    --benchmark_cache_size=BYTES [default = size of last-level cache]:
+        The size of the cache that --benchmark_cold_cache must defeat.
+
+    --benchmark_instances=N:
+        Instead of the usual benchmark, run 1, 2, 4, ... N instances of
+        the filter at once, each on its own thread with its own buffers,
+        and report the total throughput and how well it scales, to measure
+        contention between them (e.g. for Halide's thread pool). May be
+        combined with --benchmark_cold_cache=rotate. Ignored if
+        --benchmarks is not also specified.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -373,6 +403,11 @@ int main(int argc, char **argv) {
     bool track_memory = false;
     bool describe = false;
     double benchmark_min_time = BenchmarkConfig().min_time;
+    uint64_t benchmark_min_samples = 0;
+    std::string benchmark_json;
+    std::string benchmark_cold_cache;
+    uint64_t benchmark_cache_size = 0;
+    int benchmark_instances = 0;
     std::string default_input_buffers;
     std::string default_input_scalars;
     std::string benchmarks_flag_value;
@@ -436,6 +471,22 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_min_time)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "benchmark_min_samples") {
+                if (!parse_scalar(flag_value, &benchmark_min_samples)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_json") {
+                benchmark_json = flag_value;
+            } else if (flag_name == "benchmark_cold_cache") {
+                benchmark_cold_cache = flag_value;
+            } else if (flag_name == "benchmark_cache_size") {
+                if (!parse_scalar(flag_value, &benchmark_cache_size)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_instances") {
+                if (!parse_scalar(flag_value, &benchmark_instances) || benchmark_instances < 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "default_input_buffers") {
                 default_input_buffers = flag_value;
                 if (default_input_buffers.empty()) {
@@ -514,7 +565,13 @@ int main(int argc, char **argv) {
         if (benchmarks_flag_value != "all") {
             fail() << "The only valid value for --benchmarks is 'all'";
         }
-        r.run_for_benchmark(benchmark_min_time);
+        if (benchmark_instances > 0) {
+            r.run_for_concurrency_benchmark(benchmark_min_time, benchmark_instances,
+                                            benchmark_cold_cache, benchmark_cache_size);
+        } else {
+            r.run_for_benchmark(benchmark_min_time, benchmark_min_samples, benchmark_json,
+                                benchmark_cold_cache, benchmark_cache_size);
+        }
     } else {
         r.run_for_output();
     }
@@ -2,10 +2,18 @@
 #define BENCHMARK_H
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__)
 #include <emscripten.h>
@@ -88,10 +96,32 @@ inline double benchmark(uint64_t samples, uint64_t iterations, std::function<voi
     return best / iterations;
 }
 
+// As above, but run 'setup' before each iteration of 'op', and
+// exclude the time it takes from the measurement. This is much less
+// accurate than the version above for very short operations, since
+// each iteration is timed separately.
+inline double benchmark(uint64_t samples, uint64_t iterations, std::function<void()> op,
+                        std::function<void()> setup) {
+    double best = std::numeric_limits<double>::infinity();
+    for (uint64_t i = 0; i < samples; i++) {
+        double elapsed_seconds = 0;
+        for (uint64_t j = 0; j < iterations; j++) {
+            setup();
+            auto start = benchmark_now();
+            op();
+            auto end = benchmark_now();
+            elapsed_seconds += benchmark_duration_seconds(start, end);
+        }
+        best = std::min(best, elapsed_seconds);
+    }
+    return best / iterations;
+}
+
 // Benchmark the operation 'op': run the operation until at least min_time
 // has elapsed; the number of iterations is expanded as we
 // progress (based on initial runs of 'op') to minimize overhead. The time
-// reported will be that of the best single iteration.
+// reported will be that of the best single iteration; the distribution
+// of all the samples is reported too.
 //
 // Most callers should be able to get good results without needing to specify
 // custom BenchmarkConfig values.
@@ -120,8 +150,103 @@ struct BenchmarkConfig {
     // this. Controls accuracy. The closer to zero this gets the more
     // reliable the answer, but the longer it may take to run.
     double accuracy{0.03};
+
+    // Take at least this many samples (still subject to max_time),
+    // e.g. to get meaningful percentiles of the sample distribution.
+    uint64_t min_samples{0};
+
+    // Flag the result as noisy if the standard deviation of the
+    // samples, relative to their mean, exceeds this.
+    double noise_threshold{0.05};
+
+    // Identifies the result in JSON output.
+    std::string name;
+
+    // Append the result to the file named by HL_BENCHMARK_JSON, if
+    // set (see benchmark_log_json() below). Callers that write their
+    // own record of the result can turn this off to avoid writing it
+    // twice.
+    bool log_json{true};
+};
+
+// The distribution of the time per iteration (in seconds) across all
+// the samples taken at the final iterations-per-sample count.
+struct BenchmarkStats {
+    double min{0}, max{0};
+    double p50{0}, p90{0}, p99{0};
+
+    // The mean, standard deviation and 95% confidence interval of the
+    // mean exclude outliers.
+    double mean{0}, stddev{0};
+    double ci95_low{0}, ci95_high{0};
+
+    // The number of samples slower than the upper Tukey fence (the
+    // third quartile plus 1.5 times the interquartile range). These
+    // are usually interference from something else on the machine.
+    uint64_t outliers{0};
+
+    // True if the relative standard deviation exceeds the configured
+    // noise threshold, or if more than a quarter of the samples were
+    // outliers. Comparisons against noisy results are unreliable.
+    bool noisy{false};
 };
 
+inline BenchmarkStats compute_benchmark_stats(std::vector<double> times, double noise_threshold = 0.05) {
+    BenchmarkStats stats;
+    if (times.empty()) {
+        return stats;
+    }
+    std::sort(times.begin(), times.end());
+    const size_t n = times.size();
+
+    // Linearly interpolated percentile of the sorted times.
+    auto percentile = [&](double p) {
+        double pos = p * (n - 1);
+        size_t lo = (size_t)pos;
+        size_t hi = std::min(lo + 1, n - 1);
+        return times[lo] + (pos - lo) * (times[hi] - times[lo]);
+    };
+    stats.min = times.front();
+    stats.max = times.back();
+    stats.p50 = percentile(0.5);
+    stats.p90 = percentile(0.9);
+    stats.p99 = percentile(0.99);
+
+    const double upper_fence = percentile(0.75) + 1.5 * (percentile(0.75) - percentile(0.25));
+    size_t kept = n;
+    while (kept > 1 && times[kept - 1] > upper_fence) {
+        kept--;
+    }
+    stats.outliers = n - kept;
+
+    double sum = 0;
+    for (size_t i = 0; i < kept; i++) {
+        sum += times[i];
+    }
+    stats.mean = sum / kept;
+    double sum_sq = 0;
+    for (size_t i = 0; i < kept; i++) {
+        sum_sq += (times[i] - stats.mean) * (times[i] - stats.mean);
+    }
+    stats.stddev = kept > 1 ? std::sqrt(sum_sq / (kept - 1)) : 0;
+
+    // Two-sided 95% critical values of Student's t distribution, by
+    // degrees of freedom; beyond the table the normal value is close
+    // enough.
+    static const double t95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    const size_t dof = kept - 1;
+    const double t = dof == 0 ? 0 : dof <= 30 ? t95[dof - 1] : 1.96;
+    const double half_width = t * stats.stddev / std::sqrt((double)kept);
+    stats.ci95_low = stats.mean - half_width;
+    stats.ci95_high = stats.mean + half_width;
+
+    stats.noisy = (stats.mean > 0 && stats.stddev / stats.mean > noise_threshold) ||
+                  stats.outliers * 4 > n;
+    return stats;
+}
+
 struct BenchmarkResult {
     // Best elapsed wall-clock time per iteration (seconds).
     double wall_time;
@@ -140,17 +265,95 @@ struct BenchmarkResult {
     // Will be <= config.accuracy unless max_time is exceeded.
     double accuracy;
 
+    // The time per iteration (seconds) of each sample used for
+    // measurement, in the order they were taken, and their
+    // distribution.
+    std::vector<double> sample_times;
+    BenchmarkStats stats;
+
     operator double() const {
         return wall_time;
     }
 };
 
-inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig &config = {}) {
+// Format a result as a single-line JSON object, for feeding to
+// dashboards and regression tracking.
+inline std::string benchmark_result_to_json(const BenchmarkResult &r, const std::string &name = "") {
+    std::ostringstream o;
+    o.precision(9);
+    o << "{\"name\": \"";
+    for (char c : name) {
+        if (c == '"' || c == '\\') {
+            o << '\\';
+        }
+        o << c;
+    }
+    o << "\", \"wall_time\": " << r.wall_time
+      << ", \"samples\": " << r.samples
+      << ", \"iterations\": " << r.iterations
+      << ", \"accuracy\": " << r.accuracy
+      << ", \"min\": " << r.stats.min
+      << ", \"max\": " << r.stats.max
+      << ", \"p50\": " << r.stats.p50
+      << ", \"p90\": " << r.stats.p90
+      << ", \"p99\": " << r.stats.p99
+      << ", \"mean\": " << r.stats.mean
+      << ", \"stddev\": " << r.stats.stddev
+      << ", \"ci95_low\": " << r.stats.ci95_low
+      << ", \"ci95_high\": " << r.stats.ci95_high
+      << ", \"outliers\": " << r.stats.outliers
+      << ", \"noisy\": " << (r.stats.noisy ? "true" : "false")
+      << ", \"sample_times\": [";
+    for (size_t i = 0; i < r.sample_times.size(); i++) {
+        o << (i ? ", " : "") << r.sample_times[i];
+    }
+    o << "]}";
+    return o.str();
+}
+
+// If the environment variable HL_BENCHMARK_JSON names a file, each
+// call to the adaptive benchmark() below (without log_json turned off
+// in its config) appends its result to it as a line of JSON. This lets
+// existing benchmarks (e.g. the test/performance suite) feed dashboards
+// without modification. Results without a configured name are named by
+// the order in which they were taken.
+inline void benchmark_log_json(const BenchmarkResult &r, const BenchmarkConfig &config) {
+    const char *path = getenv("HL_BENCHMARK_JSON");
+    if (!config.log_json || !path || !path[0]) {
+        return;
+    }
+    static std::atomic<int> count{0};
+    const int index = count++;
+    std::string name = config.name.empty() ? "benchmark_" + std::to_string(index) : config.name;
+    FILE *f = fopen(path, "a");
+    if (f) {
+        fprintf(f, "%s\n", benchmark_result_to_json(r, name).c_str());
+        fclose(f);
+    }
+}
+
+// The adaptive benchmark described above. If 'setup' is non-null, it
+// is run before each iteration of 'op' and the time it takes is
+// excluded, which is useful for e.g. flushing caches between
+// iterations. In that case each sample is a single iteration, and
+// max_time limits the total time taken including that spent in
+// 'setup', so fewer samples may be taken.
+inline BenchmarkResult benchmark(std::function<void()> op, std::function<void()> setup,
+                                 const BenchmarkConfig &config = {}) {
     BenchmarkResult result{0, 0, 0};
 
+    const auto sample = [&](uint64_t iterations) {
+        return setup ? benchmark(1, iterations, op, setup) : benchmark(1, iterations, op);
+    };
+
     const double min_time = std::max(10 * 1e-6, config.min_time);
     const double max_time = std::max(config.min_time, config.max_time);
 
+    const auto start_time = benchmark_now();
+    const auto out_of_time = [&]() {
+        return setup && benchmark_duration_seconds(start_time, benchmark_now()) >= max_time;
+    };
+
     const double accuracy = 1.0 + std::min(std::max(0.001, config.accuracy), 0.1);
 
     // We will do (at least) kMinSamples samples; we will do additional
@@ -164,15 +367,19 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     for (;;) {
         result.samples = 0;
         result.iterations = 0;
+        result.sample_times.clear();
         total_time = 0;
         for (int i = 0; i < kMinSamples; i++) {
-            times[i] = benchmark(1, iters_per_sample, op);
+            times[i] = sample(iters_per_sample);
+            result.sample_times.push_back(times[i]);
             result.samples++;
             result.iterations += iters_per_sample;
             total_time += times[i] * iters_per_sample;
         }
         std::sort(times, times + kMinSamples);
-        if (times[0] * iters_per_sample * kMinSamples >= min_time) {
+        // Each iteration is timed separately if there is a setup
+        // step, so there's nothing to gain from more of them per sample.
+        if (setup || times[0] * iters_per_sample * kMinSamples >= min_time) {
             break;
         }
         // Use an estimate based on initial times to converge faster.
@@ -186,9 +393,12 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     // - No matter what, don't go over max_time; this is important, in case
     // we happen to get faster results for the first samples, then happen to transition
     // to throttled-down CPU state.
-    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
-           total_time < max_time) {
-        times[kMinSamples] = benchmark(1, iters_per_sample, op);
+    // - Also keep taking samples until we have min_samples of them.
+    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time ||
+            result.samples < config.min_samples) &&
+           total_time < max_time && !out_of_time()) {
+        times[kMinSamples] = sample(iters_per_sample);
+        result.sample_times.push_back(times[kMinSamples]);
         result.samples++;
         result.iterations += iters_per_sample;
         total_time += times[kMinSamples] * iters_per_sample;
@@ -196,10 +406,17 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     }
     result.wall_time = times[0];
     result.accuracy = (times[kMinSamples - 1] / times[0]) - 1.0;
+    result.stats = compute_benchmark_stats(result.sample_times, config.noise_threshold);
+
+    benchmark_log_json(result, config);
 
     return result;
 }
 
+inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig &config = {}) {
+    return benchmark(std::move(op), nullptr, config);
+}
+
 }  // namespace Tools
 }  // namespace Halide
 
@@ -5,19 +5,24 @@
 #define HALIDE_IMAGE_IO_H
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdarg>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifndef HALIDE_NO_PNG
 #include "png.h"
+#include "zlib.h"
 #endif
 
 #ifndef HALIDE_NO_JPEG
@@ -30,6 +35,13 @@
 #include "jpeglib.h"
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -698,123 +710,426 @@ struct FileOpener {
     FILE *const f;
 };
 
-// Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
-// Multibyte elements are assumed to be big-endian.
-template<typename ElemType, typename ImageType>
-void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
-    auto im_typed = im->template as<ElemType>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c + cmin) = read_big_endian<ElemType>(src);
+// A range of a file made addressable in memory, so that an image can
+// refer to it without copying. On posix systems it is memory-mapped
+// copy-on-write: writes through the mapping are private to this process
+// and never reach the file. On Windows the range is read into memory.
+class MappedFile {
+public:
+    // Returns nullptr if the file can't be opened, or doesn't contain
+    // size bytes at offset. size must be nonzero.
+    static MappedFile *create(const std::string &filename, uint64_t offset, size_t size) {
+        MappedFile *m = new MappedFile;
+#ifdef _WIN32
+        FileOpener f(filename, "rb");
+        m->base = malloc(size);
+        if (f.f == nullptr || m->base == nullptr ||
+            _fseeki64(f.f, (int64_t)offset, SEEK_SET) != 0 ||
+            !f.read_bytes(m->base, size)) {
+            delete m;
+            return nullptr;
+        }
+        m->data_ = m->base;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            delete m;
+            return nullptr;
+        }
+        struct stat s;
+        if (fstat(fd, &s) == 0 && offset + size <= (uint64_t)s.st_size) {
+            // The mapping must start on a page boundary.
+            const uint64_t page_size = sysconf(_SC_PAGESIZE);
+            const uint64_t map_offset = offset & ~(page_size - 1);
+            const size_t length = (size_t)(offset - map_offset) + size;
+            void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)map_offset);
+            if (p != MAP_FAILED) {
+                m->base = p;
+                m->length = length;
+                m->data_ = (uint8_t *)p + (offset - map_offset);
+            }
+        }
+        close(fd);
+        if (m->data_ == nullptr) {
+            delete m;
+            return nullptr;
+        }
+#endif
+        return m;
+    }
+
+    void *data() const {
+        return data_;
+    }
+
+    // For use with Buffer::take_ownership_of_host.
+    static void release(void *mapped_file) {
+        delete (MappedFile *)mapped_file;
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        free(base);
+#else
+        if (base != nullptr) {
+            munmap(base, length);
+        }
+#endif
+    }
+
+private:
+    MappedFile() = default;
+
+    void *base = nullptr;
+    size_t length = 0;
+    void *data_ = nullptr;
+};
+
+// Copy width pixels of channels interleaved ElemTypes from a byte buffer,
+// where multibyte elements are big-endian, into an image row with the
+// given x and c strides (in elements). Channels is the number of channels
+// if it is known at compile time, and zero otherwise. The layouts images
+// usually have -- interleaved, or planar with a unit x stride -- get
+// simple loops that the compiler can vectorize.
+template<typename ElemType, int Channels>
+void read_big_endian_pixels(const uint8_t *src, ElemType *dst, int width, int channels,
+                            ptrdiff_t x_stride, ptrdiff_t c_stride) {
+    const int n = Channels ? Channels : channels;
+    if (x_stride == n && (n == 1 || c_stride == 1)) {
+        if (sizeof(ElemType) == 1) {
+            memcpy(dst, src, (size_t)width * n);
+        } else {
+            for (ptrdiff_t i = 0; i < (ptrdiff_t)width * n; i++) {
+                dst[i] = read_big_endian<ElemType>(src + i * sizeof(ElemType));
+            }
+        }
+    } else if (x_stride == 1) {
+        for (int c = 0; c < n; c++) {
+            const uint8_t *s = src + c * sizeof(ElemType);
+            ElemType *d = dst + c * c_stride;
+            for (int x = 0; x < width; x++) {
+                d[x] = read_big_endian<ElemType>(s + (ptrdiff_t)x * n * sizeof(ElemType));
+            }
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < n; c++) {
+                dst[x * x_stride + c * c_stride] = read_big_endian<ElemType>(src);
                 src += sizeof(ElemType);
             }
         }
+    }
+}
+
+// The inverse of read_big_endian_pixels.
+template<typename ElemType, int Channels>
+void write_big_endian_pixels(const ElemType *src, uint8_t *dst, int width, int channels,
+                             ptrdiff_t x_stride, ptrdiff_t c_stride) {
+    const int n = Channels ? Channels : channels;
+    if (x_stride == n && (n == 1 || c_stride == 1)) {
+        if (sizeof(ElemType) == 1) {
+            memcpy(dst, src, (size_t)width * n);
+        } else {
+            for (ptrdiff_t i = 0; i < (ptrdiff_t)width * n; i++) {
+                write_big_endian<ElemType>(src[i], dst + i * sizeof(ElemType));
+            }
+        }
+    } else if (x_stride == 1) {
+        for (int c = 0; c < n; c++) {
+            const ElemType *s = src + c * c_stride;
+            uint8_t *d = dst + c * sizeof(ElemType);
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x], d + (ptrdiff_t)x * n * sizeof(ElemType));
+            }
+        }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < n; c++) {
+                write_big_endian<ElemType>(src[x * x_stride + c * c_stride], dst);
+                dst += sizeof(ElemType);
+            }
         }
     }
 }
 
+// Read rows [y_begin, y_end) of an image from a byte buffer that holds
+// them back to back, each row being the image's pixels with their
+// channels interleaved. Multibyte elements are assumed to be big-endian.
+template<typename ElemType, typename ImageType>
+void read_big_endian_rows(const uint8_t *src, int y_begin, int y_end, ImageType *im) {
+    auto im_typed = im->template as<ElemType>();
+    const bool has_channels = im_typed.dimensions() > 2;
+    const int xmin = im_typed.dim(0).min();
+    const int cmin = has_channels ? im_typed.dim(2).min() : 0;
+    const int width = im_typed.dim(0).extent();
+    const int channels = has_channels ? im_typed.dim(2).extent() : 1;
+    const ptrdiff_t x_stride = im_typed.dim(0).stride();
+    const ptrdiff_t c_stride = has_channels ? im_typed.dim(2).stride() : 0;
+    auto read_pixels = channels == 1 ? read_big_endian_pixels<ElemType, 1> :
+                       channels == 2 ? read_big_endian_pixels<ElemType, 2> :
+                       channels == 3 ? read_big_endian_pixels<ElemType, 3> :
+                       channels == 4 ? read_big_endian_pixels<ElemType, 4> :
+                                       read_big_endian_pixels<ElemType, 0>;
+    for (int y = y_begin; y < y_end; y++) {
+        ElemType *dst = has_channels ? &im_typed(xmin, y, cmin) : &im_typed(xmin, y);
+        read_pixels(src, dst, width, channels, x_stride, c_stride);
+        src += (size_t)width * channels * sizeof(ElemType);
+    }
+}
+
+// Copy rows [y_begin, y_end) of an image into a byte buffer, back to
+// back, in the layout read_big_endian_rows expects.
+template<typename ElemType, typename ImageType>
+void write_big_endian_rows(const ImageType &im, int y_begin, int y_end, uint8_t *dst) {
+    auto im_typed = im.template as<typename std::add_const<ElemType>::type>();
+    const bool has_channels = im_typed.dimensions() > 2;
+    const int xmin = im_typed.dim(0).min();
+    const int cmin = has_channels ? im_typed.dim(2).min() : 0;
+    const int width = im_typed.dim(0).extent();
+    const int channels = has_channels ? im_typed.dim(2).extent() : 1;
+    const ptrdiff_t x_stride = im_typed.dim(0).stride();
+    const ptrdiff_t c_stride = has_channels ? im_typed.dim(2).stride() : 0;
+    auto write_pixels = channels == 1 ? write_big_endian_pixels<ElemType, 1> :
+                        channels == 2 ? write_big_endian_pixels<ElemType, 2> :
+                        channels == 3 ? write_big_endian_pixels<ElemType, 3> :
+                        channels == 4 ? write_big_endian_pixels<ElemType, 4> :
+                                        write_big_endian_pixels<ElemType, 0>;
+    for (int y = y_begin; y < y_end; y++) {
+        const ElemType *src = has_channels ? &im_typed(xmin, y, cmin) : &im_typed(xmin, y);
+        write_pixels(src, dst, width, channels, x_stride, c_stride);
+        dst += (size_t)width * channels * sizeof(ElemType);
+    }
+}
+
+// Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
+// Multibyte elements are assumed to be big-endian.
+template<typename ElemType, typename ImageType>
+void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
+    read_big_endian_rows<ElemType, ImageType>(src, y, y + 1, im);
+}
+
 // Copy a row from an image into a byte buffer.
 // Multibyte elements are written in big-endian layout.
 template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
-    auto im_typed = im.template as<typename std::add_const<ElemType>::type>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
+    write_big_endian_rows<ElemType, ImageType>(im, y, y + 1, dst);
+}
+
+// The number of threads to encode and decode with: one per core, unless
+// HL_NUM_THREADS says otherwise, as for Halide's own thread pool.
+inline int num_io_threads() {
+    const char *env = getenv("HL_NUM_THREADS");
+    const int n = env ? atoi(env) : (int)std::thread::hardware_concurrency();
+    return std::max(1, n);
+}
+
+// Call f(i) for each i in [0, num_strips), spread over up to one thread
+// per core. Returns false if any of the calls does.
+template<typename Fn>
+bool parallel_for_strips(int num_strips, Fn f) {
+    const int num_threads = std::min(num_strips, num_io_threads());
+    std::atomic<int> next_strip(0);
+    std::atomic<bool> ok(true);
+    auto worker = [&]() {
+        for (int i = next_strip++; i < num_strips; i = next_strip++) {
+            if (!f(i)) {
+                ok = false;
             }
         }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+    return ok;
+}
+
+// The number of rows of row_bytes each to convert or transfer at a time,
+// so that scratch space stays bounded however large the image.
+inline int rows_per_band(size_t row_bytes, int height) {
+    constexpr size_t band_bytes = 16 << 20;
+    return std::max(1, (int)std::min<size_t>(height, band_bytes / std::max<size_t>(row_bytes, 1)));
+}
+
+// Split rows [y_begin, y_end) into strips big enough to be worth a thread
+// each, and call f(strip_begin, strip_end) on them in parallel.
+template<typename Fn>
+void for_each_row_strip(int y_begin, int y_end, size_t row_bytes, Fn f) {
+    constexpr size_t min_strip_bytes = 256 << 10;
+    const int rows = y_end - y_begin;
+    const size_t bytes = (size_t)std::max(rows, 0) * row_bytes;
+    const int num_strips = (int)std::min<size_t>({(size_t)std::max(rows, 0),
+                                                  std::max<size_t>(1, bytes / min_strip_bytes),
+                                                  (size_t)num_io_threads()});
+    parallel_for_strips(num_strips, [&](int i) {
+        f(y_begin + (int)((int64_t)rows * i / num_strips),
+          y_begin + (int)((int64_t)rows * (i + 1) / num_strips));
+        return true;
+    });
+}
+
+// Like read_big_endian_rows, for images of 8 or 16 bit elements, with
+// large bands converted in parallel.
+template<typename ImageType>
+void read_big_endian_band(const uint8_t *src, int y_begin, int y_end, ImageType *im) {
+    const size_t row_bytes = (size_t)im->dim(0).extent() * im->channels() * im->type().bytes();
+    const bool is_8_bit = im->type().bits == 8;
+    for_each_row_strip(y_begin, y_end, row_bytes, [&](int strip_begin, int strip_end) {
+        const uint8_t *strip_src = src + (size_t)(strip_begin - y_begin) * row_bytes;
+        if (is_8_bit) {
+            read_big_endian_rows<uint8_t, ImageType>(strip_src, strip_begin, strip_end, im);
+        } else {
+            read_big_endian_rows<uint16_t, ImageType>(strip_src, strip_begin, strip_end, im);
         }
-    }
+    });
 }
 
-#ifndef HALIDE_NO_PNG
+// Like write_big_endian_rows, for images of 8 or 16 bit elements, with
+// large bands converted in parallel.
+template<typename ImageType>
+void write_big_endian_band(const ImageType &im, int y_begin, int y_end, uint8_t *dst) {
+    const size_t row_bytes = (size_t)im.dim(0).extent() * im.channels() * im.type().bytes();
+    const bool is_8_bit = im.type().bits == 8;
+    for_each_row_strip(y_begin, y_end, row_bytes, [&](int strip_begin, int strip_end) {
+        uint8_t *strip_dst = dst + (size_t)(strip_begin - y_begin) * row_bytes;
+        if (is_8_bit) {
+            write_big_endian_rows<uint8_t, ImageType>(im, strip_begin, strip_end, strip_dst);
+        } else {
+            write_big_endian_rows<uint16_t, ImageType>(im, strip_begin, strip_end, strip_dst);
+        }
+    });
+}
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
-bool load_png(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
+// Decodes an image from the top down, a band of rows at a time. Each row
+// is produced as the image's pixels with their channels interleaved and
+// multibyte elements big-endian, as read_big_endian_rows expects.
+class RowDecoder {
+public:
+    virtual ~RowDecoder() = default;
 
-    /* open file and test for it being a png */
-    Internal::FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-    png_byte header[8];
-    if (!check(f.read_array(header), "File ended before end of header")) {
-        return false;
-    }
-    if (!check(!png_sig_cmp(header, 0, 8), "File is not recognized as a PNG file")) {
-        return false;
+    // Decode the next rows rows of the image into dst.
+    virtual bool read_rows(int rows, uint8_t *dst) = 0;
+
+    size_t row_bytes() const {
+        return (size_t)width * channels * type.bytes();
     }
 
-    /* initialize stuff */
-    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!check(png_ptr != nullptr, "png_create_read_struct failed")) {
-        return false;
+    std::vector<int> dimensions() const {
+        std::vector<int> im_dimensions = {width, height};
+        if (channels > 1) {
+            im_dimensions.push_back(channels);
+        }
+        return im_dimensions;
     }
 
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!check(info_ptr != nullptr, "png_create_info_struct failed")) {
-        return false;
+    halide_type_t type;
+    int width = 0, height = 0, channels = 0;
+};
+
+// Decode all of an image into a newly-allocated *im.
+template<typename ImageType>
+bool decode_image(RowDecoder &decoder, ImageType *im) {
+    *im = ImageType(decoder.type, decoder.dimensions());
+
+    const size_t row_bytes = decoder.row_bytes();
+    const int band_rows = rows_per_band(row_bytes, decoder.height);
+    std::vector<uint8_t> band((size_t)band_rows * row_bytes);
+    const int ymin = im->dim(1).min();
+    for (int y = 0; y < decoder.height; y += band_rows) {
+        const int rows = std::min(band_rows, decoder.height - y);
+        if (!decoder.read_rows(rows, band.data())) {
+            return false;
+        }
+        read_big_endian_band(band.data(), ymin + y, ymin + y + rows, im);
     }
+    return true;
+}
 
-    if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error loading PNG")) {
-        return false;
+#ifndef HALIDE_NO_PNG
+
+template<CheckFunc check>
+class PngDecoder : public RowDecoder {
+public:
+    ~PngDecoder() override {
+        if (png_ptr != nullptr) {
+            png_destroy_read_struct(&png_ptr, info_ptr != nullptr ? &info_ptr : nullptr, nullptr);
+        }
     }
 
-    png_init_io(png_ptr, f.f);
-    png_set_sig_bytes(png_ptr, 8);
+    bool open(const std::string &filename) {
+        /* open file and test for it being a png */
+        f.reset(new FileOpener(filename, "rb"));
+        if (!check(f->f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        png_byte header[8];
+        if (!check(f->read_array(header), "File ended before end of header")) {
+            return false;
+        }
+        if (!check(!png_sig_cmp(header, 0, 8), "File is not recognized as a PNG file")) {
+            return false;
+        }
+
+        /* initialize stuff */
+        png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        if (!check(png_ptr != nullptr, "png_create_read_struct failed")) {
+            return false;
+        }
 
-    png_read_info(png_ptr, info_ptr);
+        info_ptr = png_create_info_struct(png_ptr);
+        if (!check(info_ptr != nullptr, "png_create_info_struct failed")) {
+            return false;
+        }
 
-    const int width = png_get_image_width(png_ptr, info_ptr);
-    const int height = png_get_image_height(png_ptr, info_ptr);
-    const int channels = png_get_channels(png_ptr, info_ptr);
-    const int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error loading PNG")) {
+            return false;
+        }
 
-    const halide_type_t im_type(halide_type_uint, bit_depth);
-    std::vector<int> im_dimensions = {width, height};
-    if (channels != 1) {
-        im_dimensions.push_back(channels);
-    }
+        png_init_io(png_ptr, f->f);
+        png_set_sig_bytes(png_ptr, 8);
 
-    *im = ImageType(im_type, im_dimensions);
+        png_read_info(png_ptr, info_ptr);
 
-    png_read_update_info(png_ptr, info_ptr);
+        if (!check(png_get_interlace_type(png_ptr, info_ptr) == PNG_INTERLACE_NONE,
+                   "Interlaced PNG files are not supported")) {
+            return false;
+        }
 
-    auto copy_to_image = bit_depth == 8 ?
-                             Internal::read_big_endian_row<uint8_t, ImageType> :
-                             Internal::read_big_endian_row<uint16_t, ImageType>;
+        width = png_get_image_width(png_ptr, info_ptr);
+        height = png_get_image_height(png_ptr, info_ptr);
+        channels = png_get_channels(png_ptr, info_ptr);
+        type = halide_type_t(halide_type_uint, png_get_bit_depth(png_ptr, info_ptr));
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        png_read_row(png_ptr, row.data(), nullptr);
-        copy_to_image(row.data(), y, im);
+        png_read_update_info(png_ptr, info_ptr);
+        return true;
     }
 
-    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    bool read_rows(int rows, uint8_t *dst) override {
+        if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error loading PNG")) {
+            return false;
+        }
+        for (int y = 0; y < rows; y++) {
+            png_read_row(png_ptr, dst + (size_t)y * row_bytes(), nullptr);
+        }
+        return true;
+    }
 
-    return true;
+private:
+    std::unique_ptr<FileOpener> f;
+    png_structp png_ptr = nullptr;
+    png_infop info_ptr = nullptr;
+};
+
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_png(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    PngDecoder<check> decoder;
+    return decoder.open(filename) && decode_image(decoder, im);
 }
 
 inline const std::set<FormatInfo> &query_png() {
@@ -826,7 +1141,178 @@ inline const std::set<FormatInfo> &query_png() {
     return info;
 }
 
+inline uint8_t png_paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+}
+
+// Filter a row of n bytes, whose pixels are bpp bytes apart, given the
+// row above it. out receives the filter type and then the filtered row.
+// Like libpng, we try each of the five filters and keep the one whose
+// output has the smallest sum of absolute values (as signed bytes).
+inline void png_filter_row(const uint8_t *row, const uint8_t *prev, size_t n, size_t bpp,
+                           uint8_t *out, uint8_t *scratch) {
+    uint32_t best_sum = 0xffffffff;
+    uint8_t *best = out, *trial = scratch;
+    const size_t head = std::min(bpp, n);
+    for (int filter = 0; filter < 5; filter++) {
+        uint8_t *t = trial + 1;
+        switch (filter) {
+        case 0:  // None
+            memcpy(t, row, n);
+            break;
+        case 1:  // Sub
+            memcpy(t, row, head);
+            for (size_t i = head; i < n; i++) {
+                t[i] = row[i] - row[i - bpp];
+            }
+            break;
+        case 2:  // Up
+            for (size_t i = 0; i < n; i++) {
+                t[i] = row[i] - prev[i];
+            }
+            break;
+        case 3:  // Average
+            for (size_t i = 0; i < head; i++) {
+                t[i] = row[i] - (prev[i] >> 1);
+            }
+            for (size_t i = head; i < n; i++) {
+                t[i] = row[i] - ((row[i - bpp] + prev[i]) >> 1);
+            }
+            break;
+        default:  // Paeth
+            for (size_t i = 0; i < head; i++) {
+                t[i] = row[i] - prev[i];
+            }
+            for (size_t i = head; i < n; i++) {
+                t[i] = row[i] - png_paeth(row[i - bpp], prev[i], prev[i - bpp]);
+            }
+            break;
+        }
+        uint32_t sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            sum += t[i] < 128 ? t[i] : 256 - t[i];
+        }
+        if (sum < best_sum) {
+            best_sum = sum;
+            trial[0] = filter;
+            std::swap(best, trial);
+        }
+    }
+    if (best != out) {
+        memcpy(out, best, n + 1);
+    }
+}
+
+// Filter and deflate some rows of a PNG image, as a raw deflate stream
+// that ends on a byte boundary, so that the streams for consecutive
+// strips of rows can simply be concatenated. Only the last strip's
+// stream is marked as final.
+struct PngStrip {
+    std::vector<uint8_t> deflated;
+    uLong adler = 0;
+    size_t filtered_bytes = 0;
+
+    template<typename ImageType>
+    bool encode(const ImageType &im, int y_begin, int y_end, bool last) {
+        const size_t row_bytes = (size_t)im.dim(0).extent() * im.channels() * im.type().bytes();
+        const size_t bpp = (size_t)im.channels() * im.type().bytes();
+        std::vector<uint8_t> rows(row_bytes * 2, 0), filtered((row_bytes + 1) * 2);
+        uint8_t *prev = rows.data(), *row = rows.data() + row_bytes;
+        if (y_begin > im.dim(1).min()) {
+            write_big_endian_band(im, y_begin - 1, y_begin, prev);
+        }
+
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK) {
+            return false;
+        }
+        filtered_bytes = (y_end - y_begin) * (row_bytes + 1);
+        deflated.resize(deflateBound(&zs, filtered_bytes) + 64);
+        zs.next_out = deflated.data();
+        zs.avail_out = deflated.size();
+
+        adler = adler32(0, nullptr, 0);
+        bool ok = true;
+        for (int y = y_begin; ok && y < y_end; y++) {
+            write_big_endian_band(im, y, y + 1, row);
+            png_filter_row(row, prev, row_bytes, bpp, filtered.data(), filtered.data() + row_bytes + 1);
+            adler = adler32(adler, filtered.data(), row_bytes + 1);
+            zs.next_in = filtered.data();
+            zs.avail_in = row_bytes + 1;
+            const int flush = y + 1 < y_end ? Z_NO_FLUSH : last ? Z_FINISH : Z_SYNC_FLUSH;
+            ok = deflate_all(&zs, flush);
+            std::swap(row, prev);
+        }
+        if (y_begin == y_end) {
+            ok = deflate_all(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        }
+        deflated.resize(deflated.size() - zs.avail_out);
+        deflateEnd(&zs);
+        return ok;
+    }
+
+private:
+    // Deflate all of zs's input, growing the output as needed.
+    bool deflate_all(z_stream *zs, int flush) {
+        for (;;) {
+            if (zs->avail_out == 0) {
+                const size_t used = deflated.size();
+                deflated.resize(used * 2);
+                zs->next_out = deflated.data() + used;
+                zs->avail_out = deflated.size() - used;
+            }
+            const int result = deflate(zs, flush);
+            if (result == Z_STREAM_ERROR) {
+                return false;
+            }
+            if (flush == Z_FINISH ? result == Z_STREAM_END : zs->avail_out != 0) {
+                return true;
+            }
+        }
+    }
+};
+
+inline void png_put_u32(uint32_t v, uint8_t *dst) {
+    dst[0] = v >> 24;
+    dst[1] = v >> 16;
+    dst[2] = v >> 8;
+    dst[3] = v;
+}
+
+// Write a PNG chunk whose data is the concatenation of the given pieces.
+inline bool write_png_chunk(FileOpener &f, const char *chunk_type,
+                            const std::vector<std::pair<const uint8_t *, size_t>> &pieces) {
+    size_t length = 0;
+    uLong crc = crc32(0, (const Bytef *)chunk_type, 4);
+    for (const auto &p : pieces) {
+        length += p.second;
+        crc = crc32(crc, p.first, p.second);
+    }
+    uint8_t length_bytes[4], crc_bytes[4];
+    png_put_u32(length, length_bytes);
+    png_put_u32(crc, crc_bytes);
+    if (length >= 0x80000000u ||
+        !f.write_array(length_bytes) ||
+        !f.write_bytes(chunk_type, 4)) {
+        return false;
+    }
+    for (const auto &p : pieces) {
+        if (!f.write_bytes(p.first, p.second)) {
+            return false;
+        }
+    }
+    return f.write_array(crc_bytes);
+}
+
 // "im" is not const-ref because copy_to_host() is not const.
+//
+// The image data is filtered and deflated in strips of rows on multiple
+// threads. Each strip is an independent deflate stream that ends on a byte
+// boundary, so the strips concatenate into the single zlib stream PNG
+// expects, each in its own IDAT chunk.
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool save_png(ImageType &im, const std::string &filename) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -842,6 +1328,12 @@ bool save_png(ImageType &im, const std::string &filename) {
         return false;
     }
 
+    const halide_type_t im_type = im.type();
+    const int bit_depth = im_type.bits;
+    if (!check(bit_depth == 8 || bit_depth == 16, "Can only write PNG files with 8 or 16 bits per sample")) {
+        return false;
+    }
+
     const png_byte color_types[4] = {
         PNG_COLOR_TYPE_GRAY,
         PNG_COLOR_TYPE_GRAY_ALPHA,
@@ -849,51 +1341,75 @@ bool save_png(ImageType &im, const std::string &filename) {
         PNG_COLOR_TYPE_RGB_ALPHA};
     png_byte color_type = color_types[channels - 1];
 
+    // Aim for a strip per thread, but keep strips big enough that the
+    // compression ratio doesn't suffer and small enough to bound the
+    // memory used.
+    const size_t filtered_row_bytes = (size_t)width * channels * (bit_depth / 8) + 1;
+    int strip_rows = (height + num_io_threads() - 1) / num_io_threads();
+    strip_rows = std::max(strip_rows, (int)std::min<size_t>(height, (256 << 10) / filtered_row_bytes + 1));
+    strip_rows = std::min(strip_rows, (int)std::max<size_t>(1, (64 << 20) / filtered_row_bytes));
+    const int num_strips = std::max(1, (height + strip_rows - 1) / strip_rows);
+
+    std::vector<PngStrip> strips(num_strips);
+    const int ymin = im.dim(1).min();
+    const bool encoded = parallel_for_strips(num_strips, [&](int i) {
+        const int y_begin = ymin + i * strip_rows;
+        const int y_end = std::min(y_begin + strip_rows, ymin + height);
+        return strips[i].encode(im, y_begin, y_end, i == num_strips - 1);
+    });
+    if (!check(encoded, "[write_png_file] Failed to compress image data")) {
+        return false;
+    }
+
     // open file
     Internal::FileOpener f(filename, "wb");
     if (!check(f.f != nullptr, "[write_png_file] File could not be opened for writing")) {
         return false;
     }
 
-    // initialize stuff
-    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!check(png_ptr != nullptr, "[write_png_file] png_create_write_struct failed")) {
+    const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    uint8_t ihdr[13];
+    png_put_u32(width, ihdr);
+    png_put_u32(height, ihdr + 4);
+    ihdr[8] = bit_depth;
+    ihdr[9] = color_type;
+    ihdr[10] = PNG_COMPRESSION_TYPE_BASE;
+    ihdr[11] = PNG_FILTER_TYPE_BASE;
+    ihdr[12] = PNG_INTERLACE_NONE;
+    if (!check(f.write_array(signature) && write_png_chunk(f, "IHDR", {{ihdr, sizeof(ihdr)}}),
+               "[write_png_file] Error writing header")) {
         return false;
     }
 
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!check(info_ptr != nullptr, "[write_png_file] png_create_info_struct failed")) {
-        return false;
+    // The zlib header for a 32K window at the default compression level,
+    // and the checksum of all the filtered data.
+    const uint8_t zlib_header[2] = {0x78, 0x9c};
+    uLong adler = adler32(0, nullptr, 0);
+    for (const PngStrip &strip : strips) {
+        adler = adler32_combine(adler, strip.adler, strip.filtered_bytes);
     }
+    uint8_t zlib_trailer[4];
+    png_put_u32(adler, zlib_trailer);
 
-    if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error saving PNG")) {
-        return false;
+    for (int i = 0; i < num_strips; i++) {
+        std::vector<std::pair<const uint8_t *, size_t>> pieces;
+        if (i == 0) {
+            pieces.emplace_back(zlib_header, sizeof(zlib_header));
+        }
+        pieces.emplace_back(strips[i].deflated.data(), strips[i].deflated.size());
+        if (i == num_strips - 1) {
+            pieces.emplace_back(zlib_trailer, sizeof(zlib_trailer));
+        }
+        if (!check(write_png_chunk(f, "IDAT", pieces), "[write_png_file] Error writing image data")) {
+            return false;
+        }
+        // Release each strip once it has been written.
+        std::vector<uint8_t>().swap(strips[i].deflated);
     }
 
-    png_init_io(png_ptr, f.f);
-
-    const halide_type_t im_type = im.type();
-    const int bit_depth = im_type.bits;
-
-    png_set_IHDR(png_ptr, info_ptr, width, height,
-                 bit_depth, color_type, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-
-    png_write_info(png_ptr, info_ptr);
-
-    auto copy_from_image = bit_depth == 8 ?
-                               Internal::write_big_endian_row<uint8_t, ImageType> :
-                               Internal::write_big_endian_row<uint16_t, ImageType>;
-
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        png_write_row(png_ptr, row.data());
+    if (!check(write_png_chunk(f, "IEND", {}), "[write_png_file] Error writing end of file")) {
+        return false;
     }
-    png_write_end(png_ptr, NULL);
-    png_destroy_write_struct(&png_ptr, &info_ptr);
 
     return true;
 }
@@ -935,40 +1451,36 @@ bool read_pnm_header(Internal::FileOpener &f, const std::string &hdr_fmt, int *w
     return true;
 }
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
-bool load_pnm(const std::string &filename, int channels, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    const char *hdr_fmt = channels == 3 ? "P6" : "P5";
+template<CheckFunc check>
+class PnmDecoder : public RowDecoder {
+public:
+    bool open(const std::string &filename, int pnm_channels) {
+        const char *hdr_fmt = pnm_channels == 3 ? "P6" : "P5";
 
-    Internal::FileOpener f(filename, "rb");
-    int width, height, bit_depth;
-    if (!Internal::read_pnm_header<check>(f, hdr_fmt, &width, &height, &bit_depth)) {
-        return false;
+        f.reset(new FileOpener(filename, "rb"));
+        int bit_depth;
+        if (!read_pnm_header<check>(*f, hdr_fmt, &width, &height, &bit_depth)) {
+            return false;
+        }
+        channels = pnm_channels;
+        type = halide_type_t(halide_type_uint, bit_depth);
+        return true;
     }
 
-    const halide_type_t im_type(halide_type_uint, bit_depth);
-    std::vector<int> im_dimensions = {width, height};
-    if (channels > 1) {
-        im_dimensions.push_back(channels);
+    bool read_rows(int rows, uint8_t *dst) override {
+        return check(f->read_bytes(dst, rows * row_bytes()), "Could not read data");
     }
-    *im = ImageType(im_type, im_dimensions);
 
-    auto copy_to_image = bit_depth == 8 ?
-                             Internal::read_big_endian_row<uint8_t, ImageType> :
-                             Internal::read_big_endian_row<uint16_t, ImageType>;
+private:
+    std::unique_ptr<FileOpener> f;
+};
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        if (!check(f.read_vector(&row), "Could not read data")) {
-            return false;
-        }
-        copy_to_image(row.data(), y, im);
-    }
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_pnm(const std::string &filename, int channels, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
 
-    return true;
+    PnmDecoder<check> decoder;
+    return decoder.open(filename, channels) && decode_image(decoder, im);
 }
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -993,16 +1505,15 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
     const char *hdr_fmt = channels == 3 ? "P6" : "P5";
     fprintf(f.f, "%s\n%d %d\n%d\n", hdr_fmt, width, height, (1 << bit_depth) - 1);
 
-    auto copy_from_image = bit_depth == 8 ?
-                               Internal::write_big_endian_row<uint8_t, ImageType> :
-                               Internal::write_big_endian_row<uint16_t, ImageType>;
-
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
+    const size_t row_bytes = (size_t)width * channels * (bit_depth / 8);
+    const int band_rows = rows_per_band(row_bytes, height);
+    std::vector<uint8_t> band((size_t)band_rows * row_bytes);
     const int ymin = im.dim(1).min();
     const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        if (!check(f.write_vector(row), "Could not write data")) {
+    for (int y = ymin; y <= ymax; y += band_rows) {
+        const int rows = std::min(band_rows, ymax + 1 - y);
+        write_big_endian_band(im, y, y + rows, band.data());
+        if (!check(f.write_bytes(band.data(), rows * row_bytes), "Could not write data")) {
             return false;
         }
     }
@@ -1048,49 +1559,63 @@ bool save_ppm(ImageType &im, const std::string &filename) {
 
 #ifndef HALIDE_NO_JPEG
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
-bool load_jpg(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    Internal::FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
+template<CheckFunc check>
+class JpegDecoder : public RowDecoder {
+public:
+    ~JpegDecoder() override {
+        if (started) {
+            jpeg_destroy_decompress(&cinfo);
+        }
     }
 
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, f.f);
-    jpeg_read_header(&cinfo, TRUE);
-    jpeg_start_decompress(&cinfo);
-
-    const int width = cinfo.output_width;
-    const int height = cinfo.output_height;
-    const int channels = cinfo.output_components;
+    bool open(const std::string &filename) {
+        f.reset(new FileOpener(filename, "rb"));
+        if (!check(f->f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
 
-    const halide_type_t im_type(halide_type_uint, 8);
-    std::vector<int> im_dimensions = {width, height};
-    if (channels > 1) {
-        im_dimensions.push_back(channels);
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_decompress(&cinfo);
+        started = true;
+        jpeg_stdio_src(&cinfo, f->f);
+        jpeg_read_header(&cinfo, TRUE);
+        jpeg_start_decompress(&cinfo);
+
+        width = cinfo.output_width;
+        height = cinfo.output_height;
+        channels = cinfo.output_components;
+        type = halide_type_t(halide_type_uint, 8);
+        return true;
     }
-    *im = ImageType(im_type, im_dimensions);
-
-    auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels);
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *src = row.data();
-        jpeg_read_scanlines(&cinfo, &src, 1);
-        copy_to_image(row.data(), y, im);
+    bool read_rows(int rows, uint8_t *dst) override {
+        for (int y = 0; y < rows;) {
+            JSAMPROW row = dst + (size_t)y * row_bytes();
+            const int n = jpeg_read_scanlines(&cinfo, &row, 1);
+            if (!check(n > 0, "Could not read data")) {
+                return false;
+            }
+            y += n;
+        }
+        if (cinfo.output_scanline == cinfo.output_height) {
+            jpeg_finish_decompress(&cinfo);
+        }
+        return true;
     }
 
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
+private:
+    std::unique_ptr<FileOpener> f;
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    bool started = false;
+};
 
-    return true;
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_jpg(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    JpegDecoder<check> decoder;
+    return decoder.open(filename) && decode_image(decoder, im);
 }
 
 inline const std::set<FormatInfo> &query_jpg() {
@@ -1194,6 +1719,25 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
+// Read the header of a .tmp file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_tmp_header(FileOpener &f, halide_type_t *im_type, std::vector<int> *im_dimensions) {
+    int32_t header[5];
+    if (!check(f.read_array(header), "Count not read .tmp header")) {
+        return false;
+    }
+
+    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
+                   header[4] >= 0 && header[4] < kNumTmpCodes,
+               "Bad header on .tmp file")) {
+        return false;
+    }
+
+    *im_type = tmp_code_to_halide_type()[header[4]];
+    *im_dimensions = {header[0], header[1], header[2], header[3]};
+    return true;
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool load_tmp(const std::string &filename, ImageType *im) {
@@ -1204,19 +1748,11 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    int32_t header[5];
-    if (!check(f.read_array(header), "Count not read .tmp header")) {
-        return false;
-    }
-
-    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
-                   header[4] >= 0 && header[4] < kNumTmpCodes,
-               "Bad header on .tmp file")) {
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
         return false;
     }
-
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = {header[0], header[1], header[2], header[3]};
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1269,20 +1805,20 @@ bool write_planar_payload(ImageType &im, FileOpener &f) {
     return true;
 }
 
-// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_tmp(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    im.copy_to_host();
-
+// Write the header of a .tmp file holding an image of the given type
+// and extents, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool write_tmp_header(FileOpener &f, const halide_type_t &im_type, const std::vector<int> &im_dimensions) {
+    if (!check(im_dimensions.size() <= 4, ".tmp files support at most 4 dimensions")) {
+        return false;
+    }
     int32_t header[5] = {1, 1, 1, 1, -1};
-    for (int i = 0; i < im.dimensions(); ++i) {
-        header[i] = im.dim(i).extent();
+    for (size_t i = 0; i < im_dimensions.size(); ++i) {
+        header[i] = im_dimensions[i];
     }
     auto *table = tmp_code_to_halide_type();
     for (int i = 0; i < kNumTmpCodes; i++) {
-        if (im.type() == table[i]) {
+        if (im_type == table[i]) {
             header[4] = i;
             break;
         }
@@ -1290,12 +1826,26 @@ bool save_tmp(ImageType &im, const std::string &filename) {
     if (!check(header[4] >= 0, "Unsupported type for .tmp file")) {
         return false;
     }
+    return check(f.write_array(header), "Could not write .tmp header");
+}
+
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_tmp(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    std::vector<int> im_dimensions(im.dimensions());
+    for (int i = 0; i < im.dimensions(); ++i) {
+        im_dimensions[i] = im.dim(i).extent();
+    }
 
     FileOpener f(filename, "wb");
     if (!check(f.f != nullptr, "File could not be opened for writing")) {
         return false;
     }
-    if (!check(f.write_array(header), "Could not write .tmp header")) {
+    if (!write_tmp_header<check>(f, im.type(), im_dimensions)) {
         return false;
     }
 
@@ -1341,15 +1891,9 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+// Read the header of a .mat file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_mat_header(FileOpener &f, halide_type_t *im_type, std::vector<int> *im_dimensions) {
     uint8_t header[128];
     if (!check(f.read_array(header), "Could not read .mat header\n")) {
         return false;
@@ -1449,6 +1993,28 @@ bool load_mat(const std::string &filename, ImageType *im) {
     case miDOUBLE:
         type = halide_type_of<double>();
         break;
+    default:
+        return check(false, "Could not parse this .mat file: unsupported type\n");
+    }
+
+    *im_type = type;
+    *im_dimensions = extents;
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    if (!read_mat_header<check>(f, &type, &extents)) {
+        return false;
     }
 
     *im = ImageType(type, extents);
@@ -1678,11 +2244,532 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// ".npy" is the format numpy uses to store a single array, documented here:
+// https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+// Arrays in C order (the numpy default) have their dimensions reversed,
+// so that the innermost numpy axis becomes dimension 0 of the image (an
+// x, y, c planar image is a numpy array of shape (c, y, x)). Arrays in
+// Fortran order keep their dimension order. Only little-endian data is
+// supported.
+
+constexpr char kNpyMagic[] = "\x93NUMPY";
+constexpr size_t kNpyMagicSize = 6;
+
+struct NpyTypeCode {
+    char kind;
+    int bytes;
+    halide_type_t type;
+};
+
+inline const std::vector<NpyTypeCode> &npy_type_codes() {
+    static const std::vector<NpyTypeCode> codes = {
+        {'b', 1, halide_type_t(halide_type_uint, 1)},
+        {'u', 1, halide_type_t(halide_type_uint, 8)},
+        {'i', 1, halide_type_t(halide_type_int, 8)},
+        {'u', 2, halide_type_t(halide_type_uint, 16)},
+        {'i', 2, halide_type_t(halide_type_int, 16)},
+        {'f', 2, halide_type_t(halide_type_float, 16)},
+        {'u', 4, halide_type_t(halide_type_uint, 32)},
+        {'i', 4, halide_type_t(halide_type_int, 32)},
+        {'f', 4, halide_type_t(halide_type_float, 32)},
+        {'u', 8, halide_type_t(halide_type_uint, 64)},
+        {'i', 8, halide_type_t(halide_type_int, 64)},
+        {'f', 8, halide_type_t(halide_type_float, 64)}};
+    return codes;
+}
+
+// Find the value for a key in the python dict literal that makes up
+// the .npy header, returning the position just after the colon.
+inline size_t find_npy_header_value(const std::string &header, const std::string &key) {
+    size_t pos = header.find("'" + key + "'");
+    if (pos == std::string::npos) {
+        return pos;
+    }
+    pos = header.find(':', pos);
+    if (pos == std::string::npos) {
+        return pos;
+    }
+    pos++;
+    while (pos < header.size() && header[pos] == ' ') {
+        pos++;
+    }
+    return pos;
+}
+
+// Read the header of a .npy file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_npy_header(FileOpener &f, halide_type_t *im_type, std::vector<int> *im_dimensions) {
+    uint8_t preamble[kNpyMagicSize + 2];
+    if (!check(f.read_array(preamble), "Could not read .npy header")) {
+        return false;
+    }
+    if (!check(memcmp(preamble, kNpyMagic, kNpyMagicSize) == 0, "Bad magic number in .npy file")) {
+        return false;
+    }
+    // Version 1.0 stores the header length in two bytes; 2.0 and 3.0 use four.
+    const int major_version = preamble[kNpyMagicSize];
+    if (!check(major_version >= 1 && major_version <= 3, "Unsupported .npy version")) {
+        return false;
+    }
+    uint8_t header_len_bytes[4] = {0, 0, 0, 0};
+    if (!check(f.read_bytes(header_len_bytes, major_version == 1 ? 2 : 4), "Could not read .npy header")) {
+        return false;
+    }
+    const uint32_t header_len = header_len_bytes[0] | (header_len_bytes[1] << 8) |
+                                (header_len_bytes[2] << 16) | ((uint32_t)header_len_bytes[3] << 24);
+    std::string header(header_len, ' ');
+    if (!check(f.read_bytes(&header[0], header_len), "Could not read .npy header")) {
+        return false;
+    }
+
+    // The element type, e.g. '<f4'
+    size_t pos = find_npy_header_value(header, "descr");
+    if (!check(pos != std::string::npos && pos + 4 < header.size() && header[pos] == '\'',
+               "Could not parse this .npy file: missing descr")) {
+        return false;
+    }
+    const char byte_order = header[pos + 1];
+    const char kind = header[pos + 2];
+    const int bytes = atoi(header.c_str() + pos + 3);
+    if (!check(byte_order == '<' || byte_order == '|', "Could not parse this .npy file: only little-endian data is supported")) {
+        return false;
+    }
+    bool found_type = false;
+    for (const auto &code : npy_type_codes()) {
+        if (code.kind == kind && code.bytes == bytes) {
+            *im_type = code.type;
+            found_type = true;
+            break;
+        }
+    }
+    if (!check(found_type, "Could not parse this .npy file: unsupported descr")) {
+        return false;
+    }
+
+    pos = find_npy_header_value(header, "fortran_order");
+    if (!check(pos != std::string::npos, "Could not parse this .npy file: missing fortran_order")) {
+        return false;
+    }
+    const bool fortran_order = header.compare(pos, 4, "True") == 0;
+
+    pos = find_npy_header_value(header, "shape");
+    if (!check(pos != std::string::npos && header[pos] == '(', "Could not parse this .npy file: missing shape")) {
+        return false;
+    }
+    std::vector<int> extents;
+    const char *p = header.c_str() + pos + 1;
+    while (true) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (*p == ')') {
+            break;
+        }
+        char *end = nullptr;
+        const long extent = strtol(p, &end, 10);
+        if (!check(end != p && extent >= 0 && extent <= 0x7fffffff, "Could not parse this .npy file: bad shape")) {
+            return false;
+        }
+        extents.push_back((int)extent);
+        p = end;
+    }
+    if (!fortran_order) {
+        std::reverse(extents.begin(), extents.end());
+    }
+    *im_dimensions = extents;
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_npy_header<check>(f, &im_type, &im_dimensions)) {
+        return false;
+    }
+    *im = ImageType(im_type, im_dimensions);
+
+    // This should never fail unless the default Buffer<> constructor behavior changes.
+    if (!check(buffer_is_compact_planar(*im), "load_npy() requires compact planar images")) {
+        return false;
+    }
+
+    if (!check(f.read_bytes(im->begin(), im->size_in_bytes()), "Could not read .npy payload")) {
+        return false;
+    }
+
+    im->set_host_dirty();
+    return true;
+}
+
+inline const std::set<FormatInfo> &query_npy() {
+    // Our support arbitrarily stops at 16 dimensions, as for .mat.
+    static std::set<FormatInfo> info = []() {
+        std::set<FormatInfo> s;
+        for (int i = 0; i < 16; i++) {
+            for (const auto &code : npy_type_codes()) {
+                s.insert({code.type, i});
+            }
+        }
+        return s;
+    }();
+    return info;
+}
+
+// Write the header of a .npy file holding an image of the given type
+// and extents, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool write_npy_header(FileOpener &f, const halide_type_t &im_type, const std::vector<int> &im_dimensions) {
+    const NpyTypeCode *type_code = nullptr;
+    for (const auto &code : npy_type_codes()) {
+        if (im_type == code.type) {
+            type_code = &code;
+            break;
+        }
+    }
+    if (!check(type_code != nullptr, "Unsupported type for .npy file")) {
+        return false;
+    }
+
+    const int dims = (int)im_dimensions.size();
+    std::string header = "{'descr': '";
+    header += type_code->bytes == 1 ? '|' : '<';
+    header += type_code->kind + std::to_string(type_code->bytes) + "', 'fortran_order': False, 'shape': (";
+    for (int d = dims - 1; d >= 0; d--) {
+        header += std::to_string(im_dimensions[d]);
+        // A tuple of one element needs a trailing comma.
+        if (d > 0 || dims == 1) {
+            header += ",";
+        }
+        if (d > 0) {
+            header += " ";
+        }
+    }
+    header += "), }";
+    // Pad with spaces and a newline so that the payload starts on a
+    // 64-byte boundary, which keeps it aligned when memory-mapped.
+    const size_t preamble_size = kNpyMagicSize + 4;
+    header.append(63 - (preamble_size + header.size()) % 64, ' ');
+    header += '\n';
+    if (!check(header.size() <= 0xffff, "Could not write .npy header: too many dimensions")) {
+        return false;
+    }
+    const uint8_t preamble[4] = {1, 0, (uint8_t)(header.size() & 0xff), (uint8_t)(header.size() >> 8)};
+
+    bool success =
+        f.write_bytes(kNpyMagic, kNpyMagicSize) &&
+        f.write_array(preamble) &&
+        f.write_bytes(header.data(), header.size());
+    return check(success, "Could not write .npy header");
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_npy(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    std::vector<int> im_dimensions(im.dimensions());
+    for (int i = 0; i < im.dimensions(); ++i) {
+        im_dimensions[i] = im.dim(i).extent();
+    }
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!write_npy_header<check>(f, im.type(), im_dimensions)) {
+        return false;
+    }
+
+    if (!write_planar_payload<ImageType, check>(im, f)) {
+        return false;
+    }
+
+    return true;
+}
+
+inline uint8_t swap_bytes(uint8_t v) {
+    return v;
+}
+
+inline uint16_t swap_bytes(uint16_t v) {
+    return (v >> 8) | (v << 8);
+}
+
+inline uint32_t swap_bytes(uint32_t v) {
+    return ((uint32_t)swap_bytes((uint16_t)v) << 16) | swap_bytes((uint16_t)(v >> 16));
+}
+
+inline uint64_t swap_bytes(uint64_t v) {
+    return ((uint64_t)swap_bytes((uint32_t)v) << 32) | swap_bytes((uint32_t)(v >> 32));
+}
+
+// Copy n elements of type T that are src_stride and dst_stride elements
+// apart, optionally reversing the byte order of each. Neither pointer
+// needs to be aligned.
+template<typename T>
+void copy_elements(const uint8_t *src, ptrdiff_t src_stride, uint8_t *dst, ptrdiff_t dst_stride,
+                   int n, bool swap) {
+    if (!swap && src_stride == 1 && dst_stride == 1) {
+        memcpy(dst, src, (size_t)n * sizeof(T));
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        T v;
+        memcpy(&v, src + i * src_stride * sizeof(T), sizeof(T));
+        if (swap) {
+            v = swap_bytes(v);
+        }
+        memcpy(dst + i * dst_stride * sizeof(T), &v, sizeof(T));
+    }
+}
+
+inline void copy_elements(int bytes, const uint8_t *src, ptrdiff_t src_stride, uint8_t *dst, ptrdiff_t dst_stride,
+                          int n, bool swap) {
+    switch (bytes) {
+    case 1:
+        copy_elements<uint8_t>(src, src_stride, dst, dst_stride, n, swap);
+        break;
+    case 2:
+        copy_elements<uint16_t>(src, src_stride, dst, dst_stride, n, swap);
+        break;
+    case 4:
+        copy_elements<uint32_t>(src, src_stride, dst, dst_stride, n, swap);
+        break;
+    default:
+        copy_elements<uint64_t>(src, src_stride, dst, dst_stride, n, swap);
+        break;
+    }
+}
+
+// The tags of a TIFF file's first image, as read by load_tiff.
+class TiffDirectory {
+public:
+    // Parse the first image file directory of a TIFF file held in memory.
+    template<CheckFunc check>
+    bool parse(const std::vector<uint8_t> &file) {
+        data = &file;
+        if (!check(file.size() >= 8 && ((file[0] == 'I' && file[1] == 'I') || (file[0] == 'M' && file[1] == 'M')),
+                   "File is not recognized as a TIFF file")) {
+            return false;
+        }
+        const uint16_t one = 1;
+        const bool host_is_big_endian = *(const uint8_t *)&one == 0;
+        swap = (file[0] == 'M') != host_is_big_endian;
+        uint32_t ifd_offset = 0, entry_count = 0;
+        if (!check(get(2, 2) == 42 && get_u32(4, &ifd_offset), "File is not recognized as a TIFF file")) {
+            return false;
+        }
+        if (!check(get_u32(ifd_offset, &entry_count, 2), "TIFF file is truncated")) {
+            return false;
+        }
+        for (uint32_t i = 0; i < entry_count; i++) {
+            const size_t entry = ifd_offset + 2 + i * 12;
+            if (!check(entry + 12 <= file.size(), "TIFF file is truncated")) {
+                return false;
+            }
+            entries[get(entry, 2)] = entry;
+        }
+        return true;
+    }
+
+    // Get the values of a tag of type BYTE, SHORT or LONG, or {fallback}
+    // if it is absent. Returns an empty vector if the tag is malformed.
+    std::vector<uint32_t> values(uint16_t tag, uint32_t fallback) const {
+        auto it = entries.find(tag);
+        if (it == entries.end()) {
+            return {fallback};
+        }
+        const size_t entry = it->second;
+        const int type = get(entry + 2, 2);
+        const int size = type == 1 ? 1 : type == 3 ? 2 : type == 4 ? 4 : 0;
+        uint32_t count = 0, offset = entry + 8;
+        if (size == 0 || !get_u32(entry + 4, &count) || count == 0 ||
+            (count * (uint64_t)size > 4 && !get_u32(entry + 8, &offset)) ||
+            offset + count * (uint64_t)size > data->size()) {
+            return {};
+        }
+        std::vector<uint32_t> result(count);
+        for (uint32_t i = 0; i < count; i++) {
+            result[i] = get(offset + i * size, size);
+        }
+        return result;
+    }
+
+    uint32_t value(uint16_t tag, uint32_t fallback) const {
+        std::vector<uint32_t> v = values(tag, fallback);
+        return v.empty() ? 0 : v[0];
+    }
+
+    // Whether the file's byte order differs from the host's.
+    bool swap = false;
+
+private:
+    // Read an unsigned integer of 1, 2 or 4 bytes, which must be in range.
+    uint32_t get(size_t offset, int size) const {
+        const uint8_t *p = data->data() + offset;
+        if (size == 1) {
+            return p[0];
+        }
+        uint16_t v16;
+        uint32_t v32;
+        if (size == 2) {
+            memcpy(&v16, p, 2);
+            return swap ? swap_bytes(v16) : v16;
+        }
+        memcpy(&v32, p, 4);
+        return swap ? swap_bytes(v32) : v32;
+    }
+
+    bool get_u32(size_t offset, uint32_t *v, int size = 4) const {
+        if (offset + size > data->size()) {
+            return false;
+        }
+        *v = get(offset, size);
+        return true;
+    }
+
+    const std::vector<uint8_t> *data = nullptr;
+    std::map<uint16_t, size_t> entries;
+};
+
+// Reads uncompressed TIFF files with 8, 16, 32 or 64 bit samples, in
+// either byte order, stored chunky or planar in any number of strips,
+// which includes everything save_tiff writes. Strips are decoded in
+// parallel. Images with more than one sample per pixel get a channel
+// dimension, and images with an ImageDepth tag a depth dimension before
+// it.
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load_tiff(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
-    check(false, "Reading TIFF is not yet supported");
-    return false;
+
+    std::vector<uint8_t> file;
+    {
+        FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        if (!check(fseek(f.f, 0, SEEK_END) == 0, "Could not read file")) {
+            return false;
+        }
+        const long size = ftell(f.f);
+        if (!check(size >= 0 && fseek(f.f, 0, SEEK_SET) == 0, "Could not read file")) {
+            return false;
+        }
+        file.resize(size);
+        if (!check(f.read_vector(&file), "Could not read file")) {
+            return false;
+        }
+    }
+
+    TiffDirectory dir;
+    if (!dir.parse<check>(file)) {
+        return false;
+    }
+
+    const uint32_t width = dir.value(256, 0);
+    const uint32_t height = dir.value(257, 0);
+    const uint32_t bits = dir.value(258, 1);
+    const uint32_t compression = dir.value(259, 1);
+    const uint32_t samples = dir.value(277, 1);
+    const uint32_t planar_config = dir.value(284, 1);
+    const uint32_t sample_format = dir.value(339, 1);
+    const uint32_t depth = dir.value(32997, 1);
+    const std::vector<uint32_t> strip_offsets = dir.values(273, 0);
+    const std::vector<uint32_t> strip_byte_counts = dir.values(279, 0);
+
+    if (!check(width > 0 && width < 0x80000000u && height > 0 && height < 0x80000000u &&
+                   samples > 0 && depth > 0 && (uint64_t)height * depth < 0x80000000u,
+               "Unsupported TIFF dimensions")) {
+        return false;
+    }
+    if (!check(compression == 1, "Only uncompressed TIFF files are supported")) {
+        return false;
+    }
+    if (!check((bits == 8 || bits == 16 || bits == 32 || bits == 64) &&
+                   sample_format >= 1 && sample_format <= 3 && (sample_format != 3 || bits >= 16),
+               "Unsupported TIFF sample type")) {
+        return false;
+    }
+    if (!check(planar_config == 1 || planar_config == 2, "Unsupported TIFF planar configuration")) {
+        return false;
+    }
+
+    // Each plane (all samples if chunky, one sample if planar) is
+    // height * depth rows, split into strips of RowsPerStrip rows (the
+    // last of which may be shorter). A missing or oversized
+    // RowsPerStrip means a single strip per plane. save_tiff always
+    // writes a single strip per plane, but sets RowsPerStrip to the
+    // height of one slice, so a single strip per plane is accepted
+    // whatever RowsPerStrip says.
+    const bool planar = planar_config == 2 && samples > 1;
+    const uint32_t planes = planar ? samples : 1;
+    const uint32_t num_strips = strip_offsets.size();
+    const uint32_t rows_per_plane = height * depth;
+    const uint32_t rows_per_strip = num_strips == planes ?
+                                        rows_per_plane :
+                                        std::min(dir.value(278, rows_per_plane), rows_per_plane);
+    if (!check(rows_per_strip > 0 && num_strips > 0 && num_strips == strip_byte_counts.size() &&
+                   num_strips == planes * ((rows_per_plane + rows_per_strip - 1) / rows_per_strip),
+               "Malformed TIFF strips")) {
+        return false;
+    }
+    const uint32_t strips_per_plane = num_strips / planes;
+    const int bytes = bits / 8;
+    const size_t row_bytes = (size_t)width * (planar ? 1 : samples) * bytes;
+    for (uint32_t s = 0; s < num_strips; s++) {
+        const uint32_t first_row = (s % strips_per_plane) * rows_per_strip;
+        const uint32_t rows = std::min(rows_per_strip, rows_per_plane - first_row);
+        if (!check(first_row < rows_per_plane && strip_byte_counts[s] >= rows * row_bytes &&
+                       (uint64_t)strip_offsets[s] + rows * row_bytes <= file.size(),
+                   "Malformed TIFF strips")) {
+            return false;
+        }
+    }
+
+    const halide_type_code_t codes[] = {halide_type_uint, halide_type_int, halide_type_float};
+    std::vector<int> im_dimensions = {(int)width, (int)height};
+    if (depth > 1) {
+        im_dimensions.push_back(depth);
+    }
+    if (samples > 1) {
+        im_dimensions.push_back(samples);
+    }
+    *im = ImageType(halide_type_t(codes[sample_format - 1], bits), im_dimensions);
+
+    const ptrdiff_t x_stride = im->dim(0).stride();
+    const ptrdiff_t y_stride = im->dim(1).stride();
+    const ptrdiff_t z_stride = depth > 1 ? im->dim(2).stride() : 0;
+    const ptrdiff_t c_stride = samples > 1 ? im->dim(im->dimensions() - 1).stride() : 0;
+    uint8_t *base = (uint8_t *)im->data();
+
+    parallel_for_strips(num_strips, [&](int s) {
+        const uint32_t plane = s / strips_per_plane;
+        const uint32_t first_row = (s % strips_per_plane) * rows_per_strip;
+        const uint32_t last_row = std::min(first_row + rows_per_strip, rows_per_plane);
+        const uint8_t *src = file.data() + strip_offsets[s];
+        for (uint32_t r = first_row; r < last_row; r++, src += row_bytes) {
+            uint8_t *dst = base + ((r % height) * y_stride + (r / height) * z_stride + plane * c_stride) * bytes;
+            if (planar || samples == 1) {
+                copy_elements(bytes, src, 1, dst, x_stride, width, dir.swap);
+            } else {
+                for (uint32_t c = 0; c < samples; c++) {
+                    copy_elements(bytes, src + c * bytes, samples, dst + c * c_stride * bytes, x_stride, width, dir.swap);
+                }
+            }
+        }
+        return true;
+    });
+
+    return true;
 }
 
 inline const std::set<FormatInfo> &query_tiff() {
@@ -1753,45 +2840,9 @@ struct halide_tiff_header {
 
 #pragma pack(pop)
 
-template<typename ElemType, int BUFFER_SIZE = 1024>
-struct ElemWriter {
-    ElemWriter(FileOpener *f)
-        : f(f), next(&buf[0]), ok(true) {
-    }
-    ~ElemWriter() {
-        flush();
-    }
-
-    void operator()(const ElemType &elem) {
-        if (!ok) return;
-
-        *next++ = elem;
-        if (next == &buf[BUFFER_SIZE]) {
-            flush();
-        }
-    }
-
-    void flush() {
-        if (!ok) return;
-
-        if (next > buf) {
-            if (!f->write_bytes(buf, (next - buf) * sizeof(ElemType))) {
-                ok = false;
-            }
-            next = buf;
-        }
-    }
-
-    FileOpener *const f;
-    ElemType buf[BUFFER_SIZE];
-    ElemType *next;
-    bool ok;
-};
-
 // Note that this is a fairly simpleminded TIFF writer that doesn't
 // do any compression. It would be desirable to (optionally) support using libtiff
-// here instead, which would also allow us to provide a useful implementation
-// for TIFF reading.
+// here instead, which would also allow us to read compressed TIFF files.
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool save_tiff(ImageType &im, const std::string &filename) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -1907,43 +2958,38 @@ bool save_tiff(ImageType &im, const std::string &filename) {
         }
     }
 
-    // If image is dense, we can write it in one fell swoop
-    if (elements * bytes_per_element == im.size_in_bytes()) {
-        if (!check(f.write_bytes(im.data(), im.size_in_bytes()), "TIFF write failed")) {
+    // If image is dense and planar, we can write it in one fell swoop.
+    if (buffer_is_compact_planar(im)) {
+        return check(f.write_bytes(im.data(), im.size_in_bytes()), "TIFF write failed");
+    }
+
+    // Otherwise, gather it into planar order (x, then y, then the other
+    // dimensions) a band of rows at a time, gathering the rows of each
+    // band in parallel.
+    const size_t row_bytes = (size_t)width * bytes_per_element;
+    const int num_rows = height * shape[2].extent * shape[3].extent;
+    const int band_rows = rows_per_band(row_bytes, num_rows);
+    std::vector<uint8_t> band((size_t)band_rows * row_bytes);
+    const uint8_t *origin = (const uint8_t *)im.data();
+    for (int band_begin = 0; band_begin < num_rows; band_begin += band_rows) {
+        const int rows = std::min(band_rows, num_rows - band_begin);
+        for_each_row_strip(band_begin, band_begin + rows, row_bytes, [&](int strip_begin, int strip_end) {
+            for (int r = strip_begin; r < strip_end; r++) {
+                const int y = r % height;
+                const int z = (r / height) % shape[2].extent;
+                const int w = r / height / shape[2].extent;
+                const uint8_t *src = origin + ((ptrdiff_t)y * shape[1].stride +
+                                               (ptrdiff_t)z * shape[2].stride +
+                                               (ptrdiff_t)w * shape[3].stride) *
+                                                  bytes_per_element;
+                copy_elements(bytes_per_element, src, shape[0].stride,
+                              band.data() + (size_t)(r - band_begin) * row_bytes, 1, width, false);
+            }
+        });
+        if (!check(f.write_bytes(band.data(), rows * row_bytes), "TIFF write failed")) {
             return false;
         }
-        return true;
-    }
-
-    // Otherwise, write it out via manual traversal.
-#define HANDLE_CASE(CODE, BITS, TYPE)                    \
-    case halide_type_code(CODE, BITS): {                 \
-        ElemWriter<TYPE> ew(&f);                         \
-        im.template as<const TYPE>().for_each_value(ew); \
-        if (!check(ew.ok, "TIFF write failed")) {        \
-            return false;                                \
-        }                                                \
-        break;                                           \
-    }
-
-    switch (halide_type_code((halide_type_code_t)im_type.code, im_type.bits)) {
-        HANDLE_CASE(halide_type_float, 32, float)
-        HANDLE_CASE(halide_type_float, 64, double)
-        HANDLE_CASE(halide_type_int, 8, int8_t)
-        HANDLE_CASE(halide_type_int, 16, int16_t)
-        HANDLE_CASE(halide_type_int, 32, int32_t)
-        HANDLE_CASE(halide_type_int, 64, int64_t)
-        HANDLE_CASE(halide_type_uint, 1, bool)
-        HANDLE_CASE(halide_type_uint, 8, uint8_t)
-        HANDLE_CASE(halide_type_uint, 16, uint16_t)
-        HANDLE_CASE(halide_type_uint, 32, uint32_t)
-        HANDLE_CASE(halide_type_uint, 64, uint64_t)
-    // Note that we don't attempt to handle halide_type_handle here.
-    default:
-        assert(false && "Unsupported type");
-        return false;
     }
-#undef HANDLE_CASE
 
     return true;
 }
@@ -1986,6 +3032,7 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
         {"ppm", {load_ppm<ImageType, check>, save_ppm<ConstImageType, check>, query_ppm}},
         {"tmp", {load_tmp<ImageType, check>, save_tmp<ConstImageType, check>, query_tmp}},
         {"mat", {load_mat<ImageType, check>, save_mat<ConstImageType, check>, query_mat}},
+        {"npy", {load_npy<ImageType, check>, save_npy<ConstImageType, check>, query_npy}},
         {"tiff", {load_tiff<ImageType, check>, save_tiff<ConstImageType, check>, query_tiff}},
     };
     std::string ext = Internal::get_lowercase_extension(filename);
@@ -2031,6 +3078,60 @@ FormatInfo best_save_format(const ImageType &im, const std::set<FormatInfo> &inf
     return best;
 }
 
+typedef bool (*HeaderReader)(FileOpener &f, halide_type_t *im_type, std::vector<int> *im_dimensions);
+typedef bool (*HeaderWriter)(FileOpener &f, const halide_type_t &im_type, const std::vector<int> &im_dimensions);
+
+// The formats that store a compact planar payload after a header, so
+// that the payload can be accessed in place. Returns nullptr for other
+// formats.
+template<CheckFunc check = CheckReturn>
+HeaderReader find_header_reader(const std::string &filename) {
+    const std::string ext = get_lowercase_extension(filename);
+    if (ext == "tmp") {
+        return read_tmp_header<check>;
+    } else if (ext == "mat") {
+        return read_mat_header<check>;
+    } else if (ext == "npy") {
+        return read_npy_header<check>;
+    }
+    return nullptr;
+}
+
+template<CheckFunc check = CheckReturn>
+HeaderWriter find_header_writer(const std::string &filename) {
+    const std::string ext = get_lowercase_extension(filename);
+    if (ext == "tmp") {
+        return write_tmp_header<check>;
+    } else if (ext == "npy") {
+        return write_npy_header<check>;
+    }
+    return nullptr;
+}
+
+// Make an image of the given type and extents that refers directly to
+// the compact planar payload at the given offset in a file.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool map_payload(const std::string &filename, uint64_t offset, const halide_type_t &im_type,
+                 const std::vector<int> &im_dimensions, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    uint64_t size = im_type.bytes();
+    for (int extent : im_dimensions) {
+        size *= extent;
+    }
+    if (!check(size > 0 && size == (size_t)size, "Cannot map an empty or oversized payload")) {
+        return false;
+    }
+    MappedFile *mapped_file = MappedFile::create(filename, offset, (size_t)size);
+    if (!check(mapped_file != nullptr, "Could not map file payload")) {
+        return false;
+    }
+    *im = ImageType(im_type, mapped_file->data(), im_dimensions);
+    im->take_ownership_of_host(MappedFile::release, mapped_file);
+    im->set_host_dirty();
+    return true;
+}
+
 }  // namespace Internal
 
 struct ImageTypeConversion {
@@ -2235,6 +3336,84 @@ bool load(const std::string &filename, ImageType *im) {
     return true;
 }
 
+// Load the Image from the given file without copying its payload: the
+// Image refers directly to the file's contents, memory-mapped
+// copy-on-write, so writes to the Image never reach the file. The mapping
+// is released when the last Image sharing it is destroyed. This is
+// possible for .tmp, .mat and .npy files whose payload is aligned to the
+// element size within the file; anything else is loaded as by load().
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+
+    auto read_header = Internal::find_header_reader<check>(filename);
+    if (!read_header) {
+        return load<ImageType, check>(filename, im);
+    }
+
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    uint64_t offset = 0;
+    {
+        Internal::FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        if (!read_header(f, &im_type, &im_dimensions)) {
+            return false;
+        }
+        offset = (uint64_t)ftell(f.f);
+    }
+
+    uint64_t num_elements = 1;
+    for (int extent : im_dimensions) {
+        num_elements *= extent;
+    }
+    if (offset % im_type.bytes() != 0 || num_elements == 0) {
+        return load<ImageType, check>(filename, im);
+    }
+
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(im_type == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    DynamicImageType im_d;
+    if (!Internal::map_payload<DynamicImageType, check>(filename, offset, im_type, im_dimensions, &im_d)) {
+        return false;
+    }
+    *im = im_d.template as<typename ImageType::ElemType>();
+    return true;
+}
+
+// Like load_mapped, for a file with no header: the payload of the given
+// type and extents is stored compact and planar (dimension 0 innermost),
+// starting offset bytes into the file. offset must be a multiple of the
+// element size. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_raw_mapped(const std::string &filename, const halide_type_t &type, const std::vector<int> &extents,
+                     ImageType *im, uint64_t offset = 0) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+
+    if (!check(offset % type.bytes() == 0, "Raw payload offset must be a multiple of the element size")) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(type == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    DynamicImageType im_d;
+    if (!Internal::map_payload<DynamicImageType, check>(filename, offset, type, extents, &im_d)) {
+        return false;
+    }
+    *im = im_d.template as<typename ImageType::ElemType>();
+    return true;
+}
+
 // Save the Image in the format associated with the filename's extension.
 // If the format can't represent the Image without losing data, fail.
 // Returns false upon failure.
@@ -2296,6 +3475,143 @@ private:
     const std::string filename;
 };
 
+// Like load_image, but calls load_mapped() instead of load().
+class load_mapped_image {
+public:
+    load_mapped_image(const std::string &f)
+        : filename(f) {
+    }
+
+    template<typename ImageType>
+    operator ImageType() {
+        using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+        DynamicImageType im_d;
+        (void)load_mapped<DynamicImageType, Internal::CheckFail>(filename, &im_d);
+        return im_d.template as<typename ImageType::ElemType>();
+    }
+
+private:
+    const std::string filename;
+};
+
+// Reads an image from the top down, a band of rows at a time, so that a
+// consumer can process each band as soon as it has been decoded, without
+// holding the whole image in memory. Supports the formats that store rows
+// in order: png, jpg, pgm and ppm. For example:
+//
+//    Tools::ImageBandReader<Buffer<>> reader;
+//    if (!reader.open("huge.png")) { ... }
+//    Buffer<> band;
+//    while (reader.read_band(256, &band)) {
+//        // band holds rows [band.dim(1).min(), band.dim(1).max()] of the image.
+//    }
+//
+// Bands share storage when they are the same size, so read_band
+// overwrites the previous band; copy a band to keep it.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+class ImageBandReader {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+public:
+    // Returns false if the file can't be opened, or isn't in a supported format.
+    bool open(const std::string &filename) {
+        decoder.reset();
+        next = 0;
+        have_band = false;
+        const std::string ext = Internal::get_lowercase_extension(filename);
+        if (ext == "pgm" || ext == "ppm") {
+            auto *pnm = new Internal::PnmDecoder<check>;
+            decoder.reset(pnm);
+            if (!pnm->open(filename, ext == "ppm" ? 3 : 1)) {
+                decoder.reset();
+            }
+#ifndef HALIDE_NO_PNG
+        } else if (ext == "png") {
+            auto *png = new Internal::PngDecoder<check>;
+            decoder.reset(png);
+            if (!png->open(filename)) {
+                decoder.reset();
+            }
+#endif
+#ifndef HALIDE_NO_JPEG
+        } else if (ext == "jpg" || ext == "jpeg") {
+            auto *jpg = new Internal::JpegDecoder<check>;
+            decoder.reset(jpg);
+            if (!jpg->open(filename)) {
+                decoder.reset();
+            }
+#endif
+        } else {
+            return check(false, "ImageBandReader can't read this file format");
+        }
+        return decoder != nullptr;
+    }
+
+    bool is_open() const {
+        return decoder != nullptr;
+    }
+
+    // The type and shape of the whole image. A band has the same type,
+    // width and channels.
+    halide_type_t type() const {
+        return decoder ? decoder->type : halide_type_t();
+    }
+    int width() const {
+        return decoder ? decoder->width : 0;
+    }
+    int height() const {
+        return decoder ? decoder->height : 0;
+    }
+    int channels() const {
+        return decoder ? decoder->channels : 0;
+    }
+
+    // The first row of the next band to be read.
+    int next_row() const {
+        return next;
+    }
+
+    // Decode the next (up to) max_rows rows of the image into *band.
+    // Returns false once all the rows have been read, or on error.
+    bool read_band(int max_rows, ImageType *band) {
+        if (!check(decoder != nullptr, "ImageBandReader is not open")) {
+            return false;
+        }
+        if (next >= decoder->height) {
+            return false;
+        }
+        if (!check(max_rows > 0, "max_rows must be positive")) {
+            return false;
+        }
+        const int rows = std::min(max_rows, decoder->height - next);
+        if (!have_band || current.dim(1).extent() != rows) {
+            std::vector<int> band_dimensions = decoder->dimensions();
+            band_dimensions[1] = rows;
+            current = ImageType(decoder->type, band_dimensions);
+            have_band = true;
+        }
+        current.translate(1, next - current.dim(1).min());
+
+        const size_t row_bytes = decoder->row_bytes();
+        scratch.resize((size_t)rows * row_bytes);
+        if (!decoder->read_rows(rows, scratch.data())) {
+            return false;
+        }
+        Internal::read_big_endian_band(scratch.data(), next, next + rows, &current);
+        current.set_host_dirty();
+        next += rows;
+        *band = current;
+        return true;
+    }
+
+private:
+    std::unique_ptr<Internal::RowDecoder> decoder;
+    std::vector<uint8_t> scratch;
+    ImageType current;
+    bool have_band = false;
+    int next = 0;
+};
+
 // Like load_image, but quietly convert the loaded image to the type of the LHS
 // if necessary, discarding information if necessary.
 class load_and_convert_image {
@@ -0,0 +1,781 @@
+#ifndef HALIDE_OUT_OF_CORE_H
+#define HALIDE_OUT_OF_CORE_H
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "halide_image_io.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Runs an AOT-compiled pipeline over inputs and outputs that live on
+// disk and needn't fit in memory. The outputs are split into tiles. For
+// each tile, a bounds query on the pipeline gives the region of every
+// input it needs (including any halo), which is read from disk into a
+// tile-sized buffer; the pipeline is then run on the tile, and the
+// result written back to disk. Tiles are computed by a pool of threads,
+// while a loader thread reads the inputs for the next tiles ahead of
+// them, and the total size of the tile buffers held at any one time is
+// kept within a memory budget.
+//
+// Usage looks like:
+//
+//    Halide::Tools::OutOfCoreRunner runner(my_filter_argv, my_filter_metadata());
+//    runner.set_input("input", "scan.npy");
+//    runner.set_scalar("gain", gain);
+//    runner.set_output("output", "result.npy", {width, height, 3});
+//    runner.set_memory_budget(size_t(2) << 30);
+//    std::string error;
+//    if (!runner.run(&error)) { ... }
+//
+// Inputs may be .tmp, .mat or .npy files; outputs are created as .tmp or
+// .npy files of the given extents. Files index from zero in every
+// dimension. The region of an input that a tile needs must lie within
+// the file, so pipelines that read outside their inputs need a boundary
+// condition. Memory allocated by the pipeline itself is not counted
+// against the budget.
+
+namespace Halide {
+namespace Tools {
+
+struct OutOfCoreStats {
+    // The extents of the tiles the outputs were split into.
+    std::vector<int> tile_extents;
+    int num_tiles = 0;
+    // The largest total size of the tile buffers held at once.
+    size_t peak_bytes = 0;
+    // Summed over all threads.
+    double read_seconds = 0, compute_seconds = 0, write_seconds = 0;
+    double total_seconds = 0;
+};
+
+namespace Internal {
+
+// A file holding a compact planar payload after a header, which can
+// be read and written a region at a time, from many threads at once.
+class DiskBuffer {
+public:
+    DiskBuffer() = default;
+    DiskBuffer(const DiskBuffer &) = delete;
+    DiskBuffer &operator=(const DiskBuffer &) = delete;
+
+    ~DiskBuffer() {
+#ifdef _WIN32
+        if (f) {
+            fclose(f);
+        }
+#else
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    // Open an existing file, whose extents are then adapted to the given
+    // number of dimensions: missing trailing dimensions have extent 1,
+    // and surplus ones must have extent 1.
+    bool open(const std::string &filename, int dimensions, std::string *error) {
+        auto read_header = find_header_reader(filename);
+        if (!read_header) {
+            *error = "Unsupported file format for out-of-core input: " + filename;
+            return false;
+        }
+        {
+            FileOpener header_file(filename, "rb");
+            if (!header_file.f || !read_header(header_file, &type, &extents)) {
+                *error = "Could not read the header of " + filename;
+                return false;
+            }
+            payload_offset = ftell(header_file.f);
+        }
+        while ((int)extents.size() > dimensions && extents.back() == 1) {
+            extents.pop_back();
+        }
+        while ((int)extents.size() < dimensions) {
+            extents.push_back(1);
+        }
+        if ((int)extents.size() != dimensions) {
+            *error = filename + " has more dimensions than the pipeline expects";
+            return false;
+        }
+        return open_payload(filename, false, error);
+    }
+
+    // Create a file of the given type and extents, with an (as yet)
+    // zero payload.
+    bool create(const std::string &filename, const halide_type_t &t, const std::vector<int> &e, std::string *error) {
+        type = t;
+        extents = e;
+        auto write_header = find_header_writer(filename);
+        if (!write_header) {
+            *error = "Unsupported file format for out-of-core output: " + filename;
+            return false;
+        }
+        {
+            FileOpener header_file(filename, "wb");
+            if (!header_file.f || !write_header(header_file, type, extents)) {
+                *error = "Could not write the header of " + filename;
+                return false;
+            }
+            payload_offset = ftell(header_file.f);
+            // Extend the file to its full size, so that tiles can be
+            // written in any order.
+            const uint64_t size = payload_bytes();
+            const uint8_t zero = 0;
+#ifdef _WIN32
+            const bool seeked = _fseeki64(header_file.f, (int64_t)(payload_offset + size - 1), SEEK_SET) == 0;
+#else
+            const bool seeked = fseeko(header_file.f, (off_t)(payload_offset + size - 1), SEEK_SET) == 0;
+#endif
+            if (size > 0 && (!seeked || !header_file.write_bytes(&zero, 1))) {
+                *error = "Could not extend " + filename;
+                return false;
+            }
+        }
+        return open_payload(filename, true, error);
+    }
+
+    const halide_type_t &get_type() const {
+        return type;
+    }
+
+    const std::vector<int> &get_extents() const {
+        return extents;
+    }
+
+    // Is the region of buf within the file?
+    bool contains(const halide_buffer_t *buf) const {
+        for (int d = 0; d < buf->dimensions; d++) {
+            if (buf->dim[d].min < 0 || buf->dim[d].min + buf->dim[d].extent > extents[d]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Read the region of buf from the file into buf, or write it from
+    // buf into the file. The region must be within the file, and buf
+    // must have a dense innermost dimension.
+    bool transfer(halide_buffer_t *buf, bool writing) {
+        const int dims = buf->dimensions;
+        const int64_t bytes = buf->type.bytes();
+        if (dims == 0) {
+            return transfer_run(buf->host, payload_offset, bytes, writing);
+        }
+        if (buf->dim[0].stride != 1 || !contains(buf)) {
+            return false;
+        }
+
+        std::vector<int64_t> file_stride(dims);
+        int64_t stride = 1;
+        for (int d = 0; d < dims; d++) {
+            file_stride[d] = stride;
+            stride *= extents[d];
+        }
+
+        // Merge the innermost dimensions into one contiguous run for as
+        // long as they are contiguous both in the file and in buf.
+        int64_t run = buf->dim[0].extent;
+        int inner = 1;
+        while (inner < dims &&
+               buf->dim[inner - 1].min == 0 &&
+               buf->dim[inner - 1].extent == extents[inner - 1] &&
+               buf->dim[inner].stride == run) {
+            run *= buf->dim[inner].extent;
+            inner++;
+        }
+
+        std::vector<int> pos(dims, 0);
+        while (true) {
+            int64_t file_index = 0, buf_index = 0;
+            for (int d = 0; d < dims; d++) {
+                file_index += (buf->dim[d].min + pos[d]) * file_stride[d];
+                buf_index += (int64_t)pos[d] * buf->dim[d].stride;
+            }
+            if (!transfer_run(buf->host + buf_index * bytes, payload_offset + file_index * bytes, run * bytes, writing)) {
+                return false;
+            }
+            int d = inner;
+            while (d < dims && ++pos[d] == buf->dim[d].extent) {
+                pos[d] = 0;
+                d++;
+            }
+            if (d >= dims) {
+                break;
+            }
+        }
+        return true;
+    }
+
+private:
+    uint64_t payload_bytes() const {
+        uint64_t size = type.bytes();
+        for (int e : extents) {
+            size *= e;
+        }
+        return size;
+    }
+
+    bool open_payload(const std::string &filename, bool writing, std::string *error) {
+#ifdef _WIN32
+        f = fopen(filename.c_str(), writing ? "r+b" : "rb");
+        if (!f) {
+#else
+        fd = ::open(filename.c_str(), writing ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+#endif
+            *error = "Could not open " + filename;
+            return false;
+        }
+        return true;
+    }
+
+    bool transfer_run(uint8_t *data, uint64_t offset, int64_t size, bool writing) {
+#ifdef _WIN32
+        // No positional I/O here, so serialize the seek and the transfer.
+        std::lock_guard<std::mutex> lock(mutex);
+        if (_fseeki64(f, (int64_t)offset, SEEK_SET) != 0) {
+            return false;
+        }
+        return (writing ? fwrite(data, 1, size, f) : fread(data, 1, size, f)) == (size_t)size;
+#else
+        while (size > 0) {
+            ssize_t done = writing ? pwrite(fd, data, size, offset) : pread(fd, data, size, offset);
+            if (done <= 0) {
+                return false;
+            }
+            data += done;
+            offset += done;
+            size -= done;
+        }
+        return true;
+#endif
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    uint64_t payload_offset = 0;
+#ifdef _WIN32
+    FILE *f = nullptr;
+    std::mutex mutex;
+#else
+    int fd = -1;
+#endif
+};
+
+}  // namespace Internal
+
+class OutOfCoreRunner {
+public:
+    OutOfCoreRunner(int (*argv_call)(void **), const halide_filter_metadata_t *metadata)
+        : argv_call(argv_call), args(metadata->num_arguments) {
+        for (int i = 0; i < metadata->num_arguments; i++) {
+            args[i].metadata = &metadata->arguments[i];
+        }
+    }
+
+    // The file an input buffer is read from.
+    void set_input(const std::string &name, const std::string &filename) {
+        Arg *arg = find_arg(name, halide_argument_kind_input_buffer);
+        if (arg) {
+            arg->filename = filename;
+        }
+    }
+
+    // The file an output buffer is written to, and its extents. Every
+    // output must have the same extents.
+    void set_output(const std::string &name, const std::string &filename, const std::vector<int> &extents) {
+        Arg *arg = find_arg(name, halide_argument_kind_output_buffer);
+        if (arg) {
+            arg->filename = filename;
+            arg->extents = extents;
+        }
+    }
+
+    // The value of a scalar input. Scalars that aren't set take their
+    // default value, if the Generator gave them one.
+    void set_scalar(const std::string &name, const halide_scalar_value_t &value) {
+        Arg *arg = find_arg(name, halide_argument_kind_input_scalar);
+        if (arg) {
+            arg->scalar_value = value;
+            arg->scalar_set = true;
+        }
+    }
+
+    template<typename T>
+    void set_scalar(const std::string &name, T value) {
+        static_assert(sizeof(T) <= sizeof(halide_scalar_value_t::u), "Not a scalar type");
+        halide_scalar_value_t v;
+        memset(&v.u, 0, sizeof(v.u));
+        memcpy(&v.u, &value, sizeof(T));
+        set_scalar(name, v);
+    }
+
+    // The extents of the output tiles. Missing or zero extents cover the
+    // whole output in that dimension. If not set, the tiles are the
+    // largest that let every thread have a tile in flight and another
+    // loaded within the memory budget.
+    void set_tile_extents(const std::vector<int> &extents) {
+        tile_extents = extents;
+    }
+
+    // The most memory, in bytes, to use for tile buffers at once.
+    void set_memory_budget(size_t bytes) {
+        memory_budget = bytes;
+    }
+
+    // The number of tiles computed at once. Defaults to the number of
+    // cores. (The pipeline may also use the Halide thread pool within
+    // each tile.)
+    void set_num_threads(int n) {
+        num_threads = n;
+    }
+
+    // Run the pipeline over every tile. Returns false on failure, setting
+    // *error to the reason if error is non-null.
+    bool run(std::string *error = nullptr) {
+        std::string dummy;
+        error = error ? error : &dummy;
+        const auto start = std::chrono::steady_clock::now();
+        bool ok = prepare(error) && process_tiles(error);
+        stats.total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return ok;
+    }
+
+    const OutOfCoreStats &get_stats() const {
+        return stats;
+    }
+
+private:
+    struct Arg {
+        const halide_filter_argument_t *metadata = nullptr;
+        std::string filename;
+        std::vector<int> extents;
+        halide_scalar_value_t scalar_value;
+        bool scalar_set = false;
+        std::unique_ptr<Internal::DiskBuffer> file;
+    };
+
+    struct Tile {
+        std::vector<int> min, extent;
+        // Indexed like args; undefined for scalars.
+        std::vector<Runtime::Buffer<>> buffers;
+        size_t bytes = 0;
+    };
+
+    Arg *find_arg(const std::string &name, halide_argument_kind_t kind) {
+        for (auto &arg : args) {
+            if (name == arg.metadata->name && arg.metadata->kind == kind) {
+                return &arg;
+            }
+        }
+        setup_errors += "No " + std::string(kind == halide_argument_kind_input_scalar ? "scalar input" : kind == halide_argument_kind_input_buffer ? "input buffer" : "output buffer") +
+                        " named " + name + "\n";
+        return nullptr;
+    }
+
+    bool is_buffer(const Arg &arg) const {
+        return arg.metadata->kind != halide_argument_kind_input_scalar;
+    }
+
+    bool is_output(const Arg &arg) const {
+        return arg.metadata->kind == halide_argument_kind_output_buffer;
+    }
+
+    bool prepare(std::string *error) {
+        if (!setup_errors.empty()) {
+            *error = setup_errors;
+            return false;
+        }
+        const Arg *first_output = nullptr;
+        for (auto &arg : args) {
+            const std::string name = arg.metadata->name;
+            switch (arg.metadata->kind) {
+            case halide_argument_kind_input_scalar:
+                if (name == "__user_context") {
+                    arg.scalar_value.u.handle = nullptr;
+                } else if (!arg.scalar_set) {
+                    if (!arg.metadata->scalar_def) {
+                        *error = "No value given for scalar input " + name + ", which has no default";
+                        return false;
+                    }
+                    arg.scalar_value = *arg.metadata->scalar_def;
+                }
+                break;
+            case halide_argument_kind_input_buffer:
+                if (arg.filename.empty()) {
+                    *error = "No file given for input " + name;
+                    return false;
+                }
+                arg.file.reset(new Internal::DiskBuffer);
+                if (!arg.file->open(arg.filename, arg.metadata->dimensions, error)) {
+                    return false;
+                }
+                if (!(arg.file->get_type() == arg.metadata->type)) {
+                    *error = "The type of " + arg.filename + " does not match input " + name;
+                    return false;
+                }
+                break;
+            case halide_argument_kind_output_buffer:
+                if (arg.filename.empty()) {
+                    *error = "No file given for output " + name;
+                    return false;
+                }
+                if ((int)arg.extents.size() != arg.metadata->dimensions) {
+                    *error = "Output " + name + " needs " + std::to_string(arg.metadata->dimensions) + " extents";
+                    return false;
+                }
+                if (first_output && arg.extents != first_output->extents) {
+                    *error = "Output " + name + " has different extents from output " + first_output->metadata->name;
+                    return false;
+                }
+                first_output = &arg;
+                arg.file.reset(new Internal::DiskBuffer);
+                if (!arg.file->create(arg.filename, arg.metadata->type, arg.extents, error)) {
+                    return false;
+                }
+                break;
+            }
+        }
+        if (!first_output) {
+            *error = "The pipeline has no outputs";
+            return false;
+        }
+        output_extents = first_output->extents;
+        for (int e : output_extents) {
+            if (e <= 0) {
+                *error = "Output extents must be positive";
+                return false;
+            }
+        }
+        if (num_threads <= 0) {
+            num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+        return choose_tile_extents(error);
+    }
+
+    // Run a bounds query to find the region of each buffer argument
+    // needed to compute the given tile of the outputs. Leaves the
+    // results as unallocated buffers in tile->buffers.
+    bool query_tile(Tile *tile, std::string *error) {
+        const int out_dims = (int)output_extents.size();
+        tile->buffers.assign(args.size(), Runtime::Buffer<>());
+        std::vector<halide_dimension_t> output_shape(out_dims);
+        for (int d = 0; d < out_dims; d++) {
+            output_shape[d] = {tile->min[d], tile->extent[d], 0};
+        }
+
+        // The pipeline may constrain the shape of its outputs (e.g. to a
+        // multiple of the vector width), which changes what it needs
+        // from its inputs, so iterate until the outputs are settled.
+        for (int iteration = 0; iteration < 4; iteration++) {
+            std::vector<void *> argv(args.size(), nullptr);
+            for (size_t i = 0; i < args.size(); i++) {
+                Arg &arg = args[i];
+                if (!is_buffer(arg)) {
+                    argv[i] = &arg.scalar_value;
+                    continue;
+                }
+                std::vector<halide_dimension_t> shape(arg.metadata->dimensions, halide_dimension_t{0, 0, 0});
+                if (is_output(arg)) {
+                    shape = output_shape;
+                }
+                int64_t stride = 1;
+                for (auto &dim : shape) {
+                    dim.stride = (int32_t)stride;
+                    stride *= dim.extent;
+                }
+                tile->buffers[i] = Runtime::Buffer<>(arg.metadata->type, nullptr, (int)shape.size(), shape.data());
+                argv[i] = tile->buffers[i].raw_buffer();
+            }
+            int result = argv_call(argv.data());
+            if (result != 0) {
+                *error = "Bounds query failed with error " + std::to_string(result);
+                return false;
+            }
+
+            bool settled = true;
+            for (size_t i = 0; i < args.size(); i++) {
+                if (!is_output(args[i])) {
+                    continue;
+                }
+                const halide_buffer_t *b = tile->buffers[i].raw_buffer();
+                for (int d = 0; d < out_dims; d++) {
+                    if (b->dim[d].min != output_shape[d].min || b->dim[d].extent != output_shape[d].extent) {
+                        // The output is only ever asked to grow.
+                        const int new_min = std::min(output_shape[d].min, b->dim[d].min);
+                        const int new_max = std::max(output_shape[d].min + output_shape[d].extent,
+                                                     b->dim[d].min + b->dim[d].extent);
+                        output_shape[d].min = new_min;
+                        output_shape[d].extent = new_max - new_min;
+                        settled = false;
+                    }
+                }
+            }
+            if (settled) {
+                tile->bytes = 0;
+                for (size_t i = 0; i < args.size(); i++) {
+                    if (is_buffer(args[i])) {
+                        tile->bytes += tile->buffers[i].number_of_elements() * tile->buffers[i].type().bytes();
+                    }
+                }
+                return true;
+            }
+        }
+        *error = "The bounds query for the output tiles did not converge";
+        return false;
+    }
+
+    size_t bytes_per_tile_allowed() const {
+        // One tile being computed and one loaded per thread.
+        return memory_budget / (2 * num_threads);
+    }
+
+    bool choose_tile_extents(std::string *error) {
+        const int dims = (int)output_extents.size();
+        Tile tile;
+        tile.min.assign(dims, 0);
+        tile.extent = output_extents;
+        const bool automatic = tile_extents.empty();
+        for (int d = 0; d < (int)tile_extents.size() && d < dims; d++) {
+            if (tile_extents[d] > 0) {
+                tile.extent[d] = std::min(tile_extents[d], output_extents[d]);
+            }
+        }
+        while (true) {
+            if (!query_tile(&tile, error)) {
+                return false;
+            }
+            if (!automatic || tile.bytes <= bytes_per_tile_allowed()) {
+                break;
+            }
+            // Halve the largest of the outer dimensions, so that tiles
+            // are strips of whole rows for as long as possible.
+            int split = -1;
+            for (int d = 1; d < dims; d++) {
+                if (tile.extent[d] > 1 && (split < 0 || tile.extent[d] > tile.extent[split])) {
+                    split = d;
+                }
+            }
+            if (split < 0 && dims > 0 && tile.extent[0] > 1) {
+                split = 0;
+            }
+            if (split < 0) {
+                break;
+            }
+            tile.extent[split] = (tile.extent[split] + 1) / 2;
+        }
+        if (tile.bytes > memory_budget) {
+            *error = "A single tile needs " + std::to_string(tile.bytes) +
+                     " bytes, which is more than the memory budget of " + std::to_string(memory_budget);
+            return false;
+        }
+        stats.tile_extents = tile.extent;
+        return true;
+    }
+
+    bool process_tiles(std::string *error) {
+        const int dims = (int)output_extents.size();
+        const std::vector<int> &extent = stats.tile_extents;
+
+        // Enumerate the tiles, innermost dimension first, so that they
+        // are visited in the order they are stored on disk.
+        std::vector<Tile> tiles;
+        std::vector<int> pos(dims, 0);
+        while (true) {
+            Tile t;
+            t.min = pos;
+            t.extent.resize(dims);
+            for (int d = 0; d < dims; d++) {
+                t.extent[d] = std::min(extent[d], output_extents[d] - pos[d]);
+            }
+            tiles.push_back(std::move(t));
+            int d = 0;
+            while (d < dims && (pos[d] += extent[d]) >= output_extents[d]) {
+                pos[d] = 0;
+                d++;
+            }
+            if (d >= dims) {
+                break;
+            }
+        }
+        stats.num_tiles = (int)tiles.size();
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<Tile *> ready;
+        bool loading_done = false, failed = false;
+        size_t bytes_in_flight = 0;
+        std::string first_error;
+        auto fail = [&](const std::string &msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failed) {
+                failed = true;
+                first_error = msg;
+            }
+            cond.notify_all();
+        };
+        auto seconds_since = [](std::chrono::steady_clock::time_point t) {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+        };
+
+        // The loader runs the bounds query for each tile, waits for room in
+        // the budget, and reads the inputs the tile needs.
+        std::thread loader([&]() {
+            for (Tile &tile : tiles) {
+                std::string err;
+                if (!query_tile(&tile, &err)) {
+                    fail(err);
+                    break;
+                }
+                if (tile.bytes > memory_budget) {
+                    fail("A tile needs more memory than the budget allows");
+                    break;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [&]() {
+                        return failed ||
+                               ((int)ready.size() < num_threads &&
+                                (bytes_in_flight == 0 || bytes_in_flight + tile.bytes <= memory_budget));
+                    });
+                    if (failed) {
+                        break;
+                    }
+                    bytes_in_flight += tile.bytes;
+                    stats.peak_bytes = std::max(stats.peak_bytes, bytes_in_flight);
+                }
+                const auto start = std::chrono::steady_clock::now();
+                bool ok = true;
+                for (size_t i = 0; i < args.size() && ok; i++) {
+                    if (!is_buffer(args[i])) {
+                        continue;
+                    }
+                    Runtime::Buffer<> &b = tile.buffers[i];
+                    std::vector<int> mins(b.dimensions()), sizes(b.dimensions());
+                    for (int d = 0; d < b.dimensions(); d++) {
+                        mins[d] = b.dim(d).min();
+                        sizes[d] = b.dim(d).extent();
+                    }
+                    b = Runtime::Buffer<>(b.type(), sizes);
+                    b.translate(mins);
+                    if (!is_output(args[i])) {
+                        if (!args[i].file->contains(b.raw_buffer())) {
+                            ok = false;
+                            fail("A tile needs a region of input " + std::string(args[i].metadata->name) +
+                                 " outside of " + args[i].filename);
+                        } else if (!args[i].file->transfer(b.raw_buffer(), false)) {
+                            ok = false;
+                            fail("Could not read from " + args[i].filename);
+                        }
+                    }
+                }
+                if (!ok) {
+                    break;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.read_seconds += seconds_since(start);
+                ready.push_back(&tile);
+                cond.notify_all();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            loading_done = true;
+            cond.notify_all();
+        });
+
+        // The workers compute the loaded tiles and write back the part of
+        // each output buffer within the tile.
+        auto worker = [&]() {
+            while (true) {
+                Tile *tile = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [&]() { return failed || !ready.empty() || loading_done; });
+                    if (failed || ready.empty()) {
+                        return;
+                    }
+                    tile = ready.front();
+                    ready.pop_front();
+                    cond.notify_all();
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                std::vector<void *> argv(args.size());
+                for (size_t i = 0; i < args.size(); i++) {
+                    argv[i] = is_buffer(args[i]) ? (void *)tile->buffers[i].raw_buffer() : (void *)&args[i].scalar_value;
+                }
+                int result = argv_call(argv.data());
+                const double compute_seconds = seconds_since(start);
+                if (result != 0) {
+                    fail("The pipeline failed with error " + std::to_string(result));
+                    return;
+                }
+
+                start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < args.size(); i++) {
+                    if (!is_output(args[i])) {
+                        continue;
+                    }
+                    Runtime::Buffer<> region = tile->buffers[i];
+                    for (int d = 0; d < dims; d++) {
+                        region.crop(d, tile->min[d], tile->extent[d]);
+                    }
+                    if (!args[i].file->transfer(region.raw_buffer(), true)) {
+                        fail("Could not write to " + args[i].filename);
+                        return;
+                    }
+                }
+                const double write_seconds = seconds_since(start);
+
+                tile->buffers.clear();
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.compute_seconds += compute_seconds;
+                stats.write_seconds += write_seconds;
+                bytes_in_flight -= tile->bytes;
+                cond.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < num_threads; i++) {
+            workers.emplace_back(worker);
+        }
+        for (auto &t : workers) {
+            t.join();
+        }
+        loader.join();
+
+        if (failed) {
+            *error = first_error;
+            return false;
+        }
+        return true;
+    }
+
+    int (*const argv_call)(void **);
+    std::vector<Arg> args;
+    std::vector<int> output_extents, tile_extents;
+    size_t memory_budget = size_t(1) << 30;
+    int num_threads = 0;
+    std::string setup_errors;
+    OutOfCoreStats stats;
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_OUT_OF_CORE_H